@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef MAX_BLOBRECS
+  #if defined(EXTRAFS) || defined(QSPIFLASH)
+    #define MAX_BLOBRECS 100
+  #else
+    #define MAX_BLOBRECS 20
+  #endif
+#endif
+
+#define BLOB_KEY_SIZE        7    // blobs are only matched by 7 byte prefix of key
+#ifndef BLOB_HASH_BUCKETS
+  #define BLOB_HASH_BUCKETS 32    // must be power of 2
+#endif
+
+#if MAX_BLOBRECS > 255
+  typedef uint16_t blob_slot_t;
+  #define BLOB_SLOT_NONE  0xFFFF
+#else
+  typedef uint8_t blob_slot_t;
+  #define BLOB_SLOT_NONE    0xFF
+#endif
+
+/**
+ * \brief  RAM directory of the fixed-size records in the '/adv_blobs' file.
+ *     Maps a key prefix to its record slot via a small chained hash table, and keeps all slots
+ *     in a least-recently-used list, so that lookups and evictions don't need to scan the file.
+ */
+class AdvBlobIndex {
+  uint8_t _keys[MAX_BLOBRECS][BLOB_KEY_SIZE];
+  uint8_t _in_use[MAX_BLOBRECS];
+  blob_slot_t _hash_next[MAX_BLOBRECS];
+  blob_slot_t _lru_prev[MAX_BLOBRECS], _lru_next[MAX_BLOBRECS];
+  blob_slot_t _buckets[BLOB_HASH_BUCKETS];
+  blob_slot_t _lru_head, _lru_tail;   // head = most recently used
+  int _num_slots;
+
+  static int bucketFor(const uint8_t* key) { return key[0] & (BLOB_HASH_BUCKETS - 1); }
+
+  void unlinkLRU(int slot) {
+    blob_slot_t p = _lru_prev[slot], n = _lru_next[slot];
+    if (p != BLOB_SLOT_NONE) _lru_next[p] = n; else _lru_head = n;
+    if (n != BLOB_SLOT_NONE) _lru_prev[n] = p; else _lru_tail = p;
+  }
+
+  void unlinkHash(int slot) {
+    blob_slot_t* sp = &_buckets[bucketFor(_keys[slot])];
+    while (*sp != BLOB_SLOT_NONE) {
+      if (*sp == slot) {
+        *sp = _hash_next[slot];
+        break;
+      }
+      sp = &_hash_next[*sp];
+    }
+  }
+
+public:
+  AdvBlobIndex() { reset(0); }
+
+  /**
+   * \brief  empties the index, with all 'num_slots' records free (and initially in slot order, 0 = least recent)
+   */
+  void reset(int num_slots) {
+    if (num_slots > MAX_BLOBRECS) num_slots = MAX_BLOBRECS;
+    _num_slots = num_slots;
+    for (int i = 0; i < BLOB_HASH_BUCKETS; i++) _buckets[i] = BLOB_SLOT_NONE;
+    memset(_in_use, 0, sizeof(_in_use));
+    _lru_head = _lru_tail = BLOB_SLOT_NONE;
+    for (int i = 0; i < num_slots; i++) {
+      _hash_next[i] = BLOB_SLOT_NONE;
+      _lru_prev[i] = BLOB_SLOT_NONE;
+      _lru_next[i] = _lru_head;
+      if (_lru_head != BLOB_SLOT_NONE) _lru_prev[_lru_head] = i; else _lru_tail = i;
+      _lru_head = i;
+    }
+  }
+
+  int getNumSlots() const { return _num_slots; }
+
+  /**
+   * \returns  slot of record with matching key prefix, or -1 if not found
+   */
+  int find(const uint8_t* key) const {
+    blob_slot_t s = _buckets[bucketFor(key)];
+    while (s != BLOB_SLOT_NONE) {
+      if (memcmp(_keys[s], key, BLOB_KEY_SIZE) == 0) return s;
+      s = _hash_next[s];
+    }
+    return -1;
+  }
+
+  /**
+   * \brief  marks the given slot as the most recently used
+   */
+  void touch(int slot) {
+    if (slot < 0 || slot >= _num_slots || _lru_head == slot) return;
+    unlinkLRU(slot);
+    _lru_prev[slot] = BLOB_SLOT_NONE;
+    _lru_next[slot] = _lru_head;
+    if (_lru_head != BLOB_SLOT_NONE) _lru_prev[_lru_head] = slot; else _lru_tail = slot;
+    _lru_head = slot;
+  }
+
+  /**
+   * \returns  the slot to overwrite for a new key, ie. the least recently used one, or -1 if no slots
+   */
+  int getEvictSlot() const { return _lru_tail == BLOB_SLOT_NONE ? -1 : _lru_tail; }
+
+  /**
+   * \brief  records that 'slot' now holds the record for 'key', and marks it as most recently used
+   */
+  void assign(int slot, const uint8_t* key) {
+    if (slot < 0 || slot >= _num_slots) return;
+    if (_in_use[slot]) {
+      if (memcmp(_keys[slot], key, BLOB_KEY_SIZE) != 0) {
+        unlinkHash(slot);   // evicting a different key
+        _in_use[slot] = 0;
+      }
+    }
+    if (!_in_use[slot]) {
+      memcpy(_keys[slot], key, BLOB_KEY_SIZE);
+      int b = bucketFor(key);
+      _hash_next[slot] = _buckets[b];
+      _buckets[b] = slot;
+      _in_use[slot] = 1;
+    }
+    touch(slot);
+  }
+};
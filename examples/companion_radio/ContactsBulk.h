@@ -0,0 +1,111 @@
+#pragma once
+
+#include <helpers/ContactInfo.h>
+#include <string.h>
+
+// compact contact record flags (in RESP_CODE_CONTACTS_BULK)
+#define BULK_REC_HAS_PATH               0x01
+#define BULK_REC_HAS_GPS                0x02
+#define BULK_REC_MAX_SIZE               (PUB_KEY_SIZE + 4 + MAX_PATH_SIZE + 32 + 4 + 8 + 5)
+
+/**
+ * \brief  the compact contact records of RESP_CODE_CONTACTS_BULK frames (see docs/contacts_bulk_sync.md).
+ *     The device only writes them, readRecord() is the reference decoder for host-side apps and tests.
+ */
+class ContactsBulkCodec {
+  static int pathBytes(uint8_t out_path_len) { return ((out_path_len >> 6) + 1) * (out_path_len & 63); }
+
+public:
+  /**
+   * \returns  length of record written to 'dest' (at most BULK_REC_MAX_SIZE)
+   * \param prev_lastmod  lastmod of previous record in same frame, or 0 for the first
+   */
+  static int writeRecord(uint8_t* dest, const ContactInfo& contact, uint32_t prev_lastmod, bool omit_path) {
+    int i = 0;
+    memcpy(&dest[i], contact.id.pub_key, PUB_KEY_SIZE);
+    i += PUB_KEY_SIZE;
+    dest[i++] = contact.type;
+    dest[i++] = contact.flags;
+
+    uint8_t rec_flags = 0;
+    int path_bytes = 0;
+    if (!omit_path && contact.out_path_len != OUT_PATH_UNKNOWN && mesh::Packet::isValidPathLen(contact.out_path_len)) {
+      path_bytes = pathBytes(contact.out_path_len);
+      if (path_bytes > 0) rec_flags |= BULK_REC_HAS_PATH;
+    }
+    if (contact.gps_lat != 0 || contact.gps_lon != 0) rec_flags |= BULK_REC_HAS_GPS;
+    dest[i++] = rec_flags;
+
+    dest[i++] = contact.out_path_len;
+    if (rec_flags & BULK_REC_HAS_PATH) {
+      memcpy(&dest[i], contact.out_path, path_bytes);   // just the used bytes
+      i += path_bytes;
+    }
+    int name_len = strnlen(contact.name, sizeof(contact.name) - 1);
+    dest[i++] = name_len;
+    memcpy(&dest[i], contact.name, name_len);
+    i += name_len;
+    memcpy(&dest[i], &contact.last_advert_timestamp, 4);
+    i += 4;
+    if (rec_flags & BULK_REC_HAS_GPS) {
+      memcpy(&dest[i], &contact.gps_lat, 4);
+      i += 4;
+      memcpy(&dest[i], &contact.gps_lon, 4);
+      i += 4;
+    }
+    // lastmod, as zigzag varint delta from previous record in same frame
+    int32_t delta = (int32_t)(contact.lastmod - prev_lastmod);
+    uint32_t val = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    while (val >= 0x80) {
+      dest[i++] = (val & 0x7F) | 0x80;
+      val >>= 7;
+    }
+    dest[i++] = val;
+    return i;
+  }
+
+  /**
+   * \returns  number of bytes of 'src' consumed, or 0 if the record is truncated or malformed
+   * \param prev_lastmod  lastmod of previous record in same frame, or 0 for the first
+   */
+  static int readRecord(const uint8_t* src, int len, ContactInfo& contact, uint32_t prev_lastmod) {
+    memset(&contact, 0, sizeof(contact));
+    int i = 0;
+    if (len < PUB_KEY_SIZE + 5) return 0;
+    memcpy(contact.id.pub_key, &src[i], PUB_KEY_SIZE);
+    i += PUB_KEY_SIZE;
+    contact.type = src[i++];
+    contact.flags = src[i++];
+    uint8_t rec_flags = src[i++];
+    contact.out_path_len = src[i++];
+    if (rec_flags & BULK_REC_HAS_PATH) {
+      int path_bytes = pathBytes(contact.out_path_len);
+      if (path_bytes > MAX_PATH_SIZE || i + path_bytes > len) return 0;
+      memcpy(contact.out_path, &src[i], path_bytes);
+      i += path_bytes;
+    }
+    if (i >= len) return 0;
+    int name_len = src[i++];
+    if (name_len >= (int) sizeof(contact.name) || i + name_len + 4 > len) return 0;
+    memcpy(contact.name, &src[i], name_len);
+    i += name_len;
+    memcpy(&contact.last_advert_timestamp, &src[i], 4);
+    i += 4;
+    if (rec_flags & BULK_REC_HAS_GPS) {
+      if (i + 8 > len) return 0;
+      memcpy(&contact.gps_lat, &src[i], 4);
+      i += 4;
+      memcpy(&contact.gps_lon, &src[i], 4);
+      i += 4;
+    }
+    uint32_t val = 0;
+    for (int shift = 0; ; shift += 7) {
+      if (i >= len || shift > 28) return 0;
+      uint8_t b = src[i++];
+      val |= (uint32_t)(b & 0x7F) << shift;
+      if ((b & 0x80) == 0) break;
+    }
+    contact.lastmod = prev_lastmod + (uint32_t)((int32_t)(val >> 1) ^ -(int32_t)(val & 1));
+    return i;
+  }
+};
@@ -1,12 +1,6 @@
 #include <Arduino.h>
 #include "DataStore.h"
 
-#if defined(EXTRAFS) || defined(QSPIFLASH)
-  #define MAX_BLOBRECS 100
-#else
-  #define MAX_BLOBRECS 20
-#endif
-
 DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra(nullptr), _clock(&clock),
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
     identity_store(fs, "")
@@ -16,6 +10,12 @@ DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra
     identity_store(fs, "/identity")
 #endif
 {
+  _num_stored = _num_paged = 0;
+  _needs_rewrite = true;
+  _journal_recs = 0;
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  _blob_index_loaded = false;
+#endif
 }
 
 #if defined(EXTRAFS) || defined(QSPIFLASH)
@@ -28,19 +28,14 @@ DataStore::DataStore(FILESYSTEM& fs, FILESYSTEM& fsExtra, mesh::RTCClock& clock)
     identity_store(fs, "/identity")
 #endif
 {
-}
-#endif
-
-static File openWrite(FILESYSTEM* fs, const char* filename) {
+  _num_stored = _num_paged = 0;
+  _needs_rewrite = true;
+  _journal_recs = 0;
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-  fs->remove(filename);
-  return fs->open(filename, FILE_O_WRITE);
-#elif defined(RP2040_PLATFORM)
-  return fs->open(filename, "w");
-#else
-  return fs->open(filename, "w", true);
+  _blob_index_loaded = false;
 #endif
 }
+#endif
 
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   static uint32_t _ContactsChannelsTotalBlocks = 0;
@@ -57,6 +52,10 @@ void DataStore::begin() {
   #if defined(EXTRAFS) || defined(QSPIFLASH)
   migrateToSecondaryFS();
   #endif
+#elif defined(ESP32)
+  // init 'blob store' support
+  _blobs.begin(_fs);
+  _blobs.importLegacyDir("/bl");   // one-off migration from 'one file per blob' layout
 #else
   // init 'blob store' support
   _fs->mkdir("/bl");
@@ -155,6 +154,29 @@ File DataStore::openRead(FILESYSTEM* fs, const char* filename) {
 #endif
 }
 
+File DataStore::openWrite(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  fs->remove(filename);
+  return fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "w");
+#else
+  return fs->open(filename, "w", true);
+#endif
+}
+
+File DataStore::openAppend(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  File f = fs->open(filename, FILE_O_WRITE);
+  if (f) f.seek(f.size());
+  return f;
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "a");
+#else
+  return fs->open(filename, "a", true);
+#endif
+}
+
 bool DataStore::removeFile(const char* filename) {
   return _fs->remove(filename);
 }
@@ -164,7 +186,10 @@ bool DataStore::removeFile(FILESYSTEM* fs, const char* filename) {
 }
 
 bool DataStore::formatFileSystem() {
+  _num_stored = _num_paged = 0;   // contacts journal is gone
+  _needs_rewrite = true;
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  _blob_index_loaded = false;
   if (_fsExtra == nullptr) {
     return _fs->format();
   } else {
@@ -175,7 +200,10 @@ bool DataStore::formatFileSystem() {
 #elif defined(ESP32)
   bool fs_success = ((fs::SPIFFSFS *)_fs)->format();
   esp_err_t nvs_err = nvs_flash_erase(); // no need to reinit, will be done by reboot
+  _blobs.begin(_fs);   // now empty
   return fs_success && (nvs_err == ESP_OK);
+#elif defined(NATIVE_PLATFORM)
+  return _fs->format();
 #else
   #error "need to implement format()"
 #endif
@@ -272,64 +300,405 @@ void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_
   }
 }
 
+#define CONTACT_REC_SIZE       152
+#define CONTACTS_JOURNAL       "/contacts3.jnl"
+#define CONTACTS_FILE_NEW      "/contacts3.new"
+
+#define JOURNAL_OP_UPDATE      'U'    // followed by full contact record
+#define JOURNAL_OP_DELETE      'D'    // followed by CONTACT_SAVED_KEY_SIZE prefix of pub_key
+
+static void packContact(const ContactInfo& c, uint8_t rec[]) {
+  uint8_t* dp = rec;
+  memcpy(dp, c.id.pub_key, 32); dp += 32;
+  memcpy(dp, c.name, 32); dp += 32;
+  *dp++ = c.type;
+  *dp++ = c.flags;
+  *dp++ = 0;  // unused
+  memcpy(dp, &c.sync_since, 4); dp += 4;   // was 'reserved'
+  *dp++ = c.out_path_len;
+  memcpy(dp, &c.last_advert_timestamp, 4); dp += 4;
+  memcpy(dp, c.out_path, 64); dp += 64;
+  memcpy(dp, &c.lastmod, 4); dp += 4;
+  memcpy(dp, &c.gps_lat, 4); dp += 4;
+  memcpy(dp, &c.gps_lon, 4);
+}
+
+static void unpackContact(ContactInfo& c, const uint8_t rec[]) {
+  const uint8_t* sp = rec;
+  c.id = mesh::Identity(sp); sp += 32;
+  memcpy(c.name, sp, 32); sp += 32;
+  c.type = *sp++;
+  c.flags = *sp++;
+  sp++;  // unused
+  memcpy(&c.sync_since, sp, 4); sp += 4;
+  c.out_path_len = *sp++;
+  memcpy(&c.last_advert_timestamp, sp, 4); sp += 4;
+  memcpy(c.out_path, sp, 64); sp += 64;
+  memcpy(&c.lastmod, sp, 4); sp += 4;
+  memcpy(&c.gps_lat, sp, 4); sp += 4;
+  memcpy(&c.gps_lon, sp, 4);
+}
+
+static uint32_t hashContactRec(const uint8_t rec[]) {
+  uint32_t h = 2166136261UL;   // FNV-1a
+  for (int i = 0; i < CONTACT_REC_SIZE; i++) {
+    h = (h ^ rec[i]) * 16777619UL;
+  }
+  return h;
+}
+
+#define CONTACT_LOC_JOURNAL      0x80000000   // latest record is in journal, rather than /contacts3
+#define CONTACT_LOC_RESIDENT     0x40000000   // contact is in host's RAM
+#define CONTACT_LOC_OFFSET_MASK  0x3FFFFFFF
+
+#define MAX_PAGED_CONTACTS   (MAX_STORED_CONTACTS - MAX_CONTACTS)
+
+int DataStore::findStoredContact(const uint8_t* key, int prefix_len, int hint) const {
+  if (prefix_len > CONTACT_SAVED_KEY_SIZE) prefix_len = CONTACT_SAVED_KEY_SIZE;
+
+  // contacts are usually still in the same order as when last saved
+  if (hint >= 0 && hint < _num_stored && memcmp(_stored[hint].key, key, prefix_len) == 0) return hint;
+
+  for (int i = 0; i < _num_stored; i++) {
+    if (memcmp(_stored[i].key, key, prefix_len) == 0) return i;
+  }
+  return -1;  // not found
+}
+
+int DataStore::addStoredContact(const uint8_t* key, uint32_t hash, uint32_t loc) {
+  if (_num_stored >= MAX_STORED_CONTACTS) return -1;  // directory is full
+
+  int i = _num_stored++;
+  memcpy(_stored[i].key, key, CONTACT_SAVED_KEY_SIZE);
+  _stored[i].hash = hash;
+  _stored[i].loc = loc;
+  if ((loc & CONTACT_LOC_RESIDENT) == 0) _num_paged++;
+  return i;
+}
+
+bool DataStore::readStoredContact(int i, uint8_t rec[], int len) {
+  uint32_t loc = _stored[i].loc;
+  File file = openRead(_getContactsChannelsFS(), (loc & CONTACT_LOC_JOURNAL) ? CONTACTS_JOURNAL : "/contacts3");
+  if (!file) return false;
+
+  bool success = file.seek(loc & CONTACT_LOC_OFFSET_MASK) && file.read(rec, len) == len;
+  file.close();
+  return success;
+}
+
+bool DataStore::appendJournal(File& file, uint8_t op, const uint8_t* data, int len, uint32_t& rec_pos) {
+  if (!file) {
+    file = openAppend(_getContactsChannelsFS(), CONTACTS_JOURNAL);
+    if (!file) return false;
+  }
+  rec_pos = file.size() + 1;  // after the 'op' byte
+
+  if (file.write(&op, 1) != 1 || file.write(data, len) != len) return false;
+  _journal_recs++;
+  return true;
+}
+
 void DataStore::loadContacts(DataStoreHost* host) {
-File file = openRead(_getContactsChannelsFS(), "/contacts3");
-    if (file) {
-      bool full = false;
-      while (!full) {
-        ContactInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused;
-
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *)&c.name, 32) == 32);
-        success = success && (file.read(&c.type, 1) == 1);
-        success = success && (file.read(&c.flags, 1) == 1);
-        success = success && (file.read(&unused, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  uint8_t rec[CONTACT_REC_SIZE];
+
+  // recover from interrupted saveContactsFull()
+  if (fs->exists(CONTACTS_FILE_NEW)) {
+    if (fs->exists("/contacts3")) {
+      fs->remove(CONTACTS_FILE_NEW);   // old file was never removed, so new one may be incomplete
+    } else {
+      fs->rename(CONTACTS_FILE_NEW, "/contacts3");
+    }
+  }
 
-        if (!success) break; // EOF
+  _num_stored = _num_paged = 0;
+  _journal_recs = 0;
+  _needs_rewrite = false;
 
-        c.id = mesh::Identity(pub_key);
-        if (!host->onContactLoaded(c)) full = true;
+  int num_dropped = 0;
+  File file = openRead(fs, "/contacts3");
+  if (file) {
+    uint32_t pos = 0;
+    while (file.read(rec, CONTACT_REC_SIZE) == CONTACT_REC_SIZE) {
+      ContactInfo c;
+      unpackContact(c, rec);
+      uint32_t h = hashContactRec(rec);
+
+      if (host->onContactLoaded(c)) {
+        addStoredContact(c.id.pub_key, h, pos | CONTACT_LOC_RESIDENT);
+      } else if (_num_paged < MAX_PAGED_CONTACTS) {
+        addStoredContact(c.id.pub_key, h, pos);   // leave in flash, until needed
+      } else {
+        num_dropped++;
       }
-      file.close();
+      pos += CONTACT_REC_SIZE;
     }
+    file.close();
+  }
+
+  // now replay changes made since /contacts3 was last written
+  bool clean = true;
+  file = openRead(fs, CONTACTS_JOURNAL);
+  if (file) {
+    uint32_t pos = 0;
+    uint8_t op;
+    while (file.read(&op, 1) == 1) {
+      if (op == JOURNAL_OP_UPDATE && file.read(rec, CONTACT_REC_SIZE) == CONTACT_REC_SIZE) {
+        ContactInfo c;
+        unpackContact(c, rec);
+        uint32_t h = hashContactRec(rec);
+        uint32_t loc = (pos + 1) | CONTACT_LOC_JOURNAL;
+
+        int i = findStoredContact(c.id.pub_key, CONTACT_SAVED_KEY_SIZE, -1);
+        if (i >= 0) {
+          if (_stored[i].loc & CONTACT_LOC_RESIDENT) {
+            host->onContactJournalUpdate(c);
+            loc |= CONTACT_LOC_RESIDENT;
+          }
+          _stored[i].hash = h;
+          _stored[i].loc = loc;
+        } else if (host->onContactJournalUpdate(c)) {
+          addStoredContact(c.id.pub_key, h, loc | CONTACT_LOC_RESIDENT);
+        } else if (_num_paged < MAX_PAGED_CONTACTS) {
+          addStoredContact(c.id.pub_key, h, loc);
+        } else {
+          num_dropped++;
+        }
+        pos += 1 + CONTACT_REC_SIZE;
+      } else if (op == JOURNAL_OP_DELETE && file.read(rec, CONTACT_SAVED_KEY_SIZE) == CONTACT_SAVED_KEY_SIZE) {
+        int i = findStoredContact(rec, CONTACT_SAVED_KEY_SIZE, -1);
+        if (i >= 0) {
+          if (_stored[i].loc & CONTACT_LOC_RESIDENT) {
+            host->onContactJournalDelete(rec, CONTACT_SAVED_KEY_SIZE);
+          } else {
+            _num_paged--;
+          }
+          _stored[i] = _stored[--_num_stored];
+        }
+        pos += 1 + CONTACT_SAVED_KEY_SIZE;
+      } else {
+        clean = false;   // torn write at tail
+        break;
+      }
+      _journal_recs++;
+    }
+    file.close();
+  }
+
+  if (num_dropped > 0) {
+    MESH_DEBUG_PRINTLN("DataStore: no room for %d stored contacts", num_dropped);
+  }
+  if (!clean) {
+    MESH_DEBUG_PRINTLN("DataStore: contacts journal truncated after %d records", _journal_recs);
+    saveContactsFull(host);   // so that further appends aren't lost behind the bad record
+  }
+}
+
+void DataStore::saveContactsFull(DataStoreHost* host) {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  _needs_rewrite = true;   // until success
+
+  File file = openWrite(fs, CONTACTS_FILE_NEW);
+  if (!file) return;
+
+  uint32_t idx = 0;
+  ContactInfo c;
+  uint8_t rec[CONTACT_REC_SIZE];
+  bool success = true;
+
+  // resident contacts first, so they are the ones loaded into RAM at next boot
+  while (success && host->getContactForSave(idx, c)) {
+    packContact(c, rec);
+    success = (file.write(rec, CONTACT_REC_SIZE) == CONTACT_REC_SIZE);
+    idx++;  // advance to next contact
+  }
+  int num_resident = idx;
+
+  // then copy the paged out ones, from wherever their latest record is
+  for (int i = 0; success && i < _num_stored; i++) {
+    if (_stored[i].loc & CONTACT_LOC_RESIDENT) continue;
+
+    success = readStoredContact(i, rec, CONTACT_REC_SIZE) && file.write(rec, CONTACT_REC_SIZE) == CONTACT_REC_SIZE;
+  }
+  file.close();
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("DataStore: saveContactsFull() failed");
+    fs->remove(CONTACTS_FILE_NEW);
+    return;
+  }
+
+  // NOTE: loadContacts() resolves a crash between these two steps, and if power is lost before the
+  //    journal is removed, replaying it over the new file is harmless
+  fs->remove("/contacts3");
+  fs->rename(CONTACTS_FILE_NEW, "/contacts3");
+  fs->remove(CONTACTS_JOURNAL);
+  _journal_recs = 0;
+  _needs_rewrite = false;
+
+  // rebuild directory to match new file, ie. [resident...][paged...]
+  int n = 0;
+  uint32_t pos = num_resident * CONTACT_REC_SIZE;
+  for (int i = 0; i < _num_stored; i++) {
+    if (_stored[i].loc & CONTACT_LOC_RESIDENT) continue;
+
+    _stored[n] = _stored[i];
+    _stored[n].loc = pos;
+    pos += CONTACT_REC_SIZE;
+    n++;
+  }
+  int num_paged = n;
+  if (num_resident > MAX_STORED_CONTACTS - num_paged) num_resident = MAX_STORED_CONTACTS - num_paged;  // should not happen
+  memmove(&_stored[num_resident], &_stored[0], num_paged * sizeof(_stored[0]));
+
+  pos = 0;
+  for (idx = 0; idx < num_resident && host->getContactForSave(idx, c); idx++) {
+    packContact(c, rec);
+    memcpy(_stored[idx].key, c.id.pub_key, CONTACT_SAVED_KEY_SIZE);
+    _stored[idx].hash = hashContactRec(rec);
+    _stored[idx].loc = pos | CONTACT_LOC_RESIDENT;
+    pos += CONTACT_REC_SIZE;
+  }
+  _num_stored = num_resident + num_paged;
+  _num_paged = num_paged;
 }
 
 void DataStore::saveContacts(DataStoreHost* host) {
-  File file = openWrite(_getContactsChannelsFS(), "/contacts3");
-  if (file) {
-    uint32_t idx = 0;
-    ContactInfo c;
-    uint8_t unused = 0;
-
-    while (host->getContactForSave(idx, c)) {
-      bool success = (file.write(c.id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *)&c.name, 32) == 32);
-      success = success && (file.write(&c.type, 1) == 1);
-      success = success && (file.write(&c.flags, 1) == 1);
-      success = success && (file.write(&unused, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-      success = success && (file.write(c.out_path, 64) == 64);
-      success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
+  if (_needs_rewrite || _journal_recs >= CONTACTS_JOURNAL_MAX_RECS) {
+    saveContactsFull(host);
+    return;
+  }
 
-      if (!success) break; // write failed
+  uint8_t seen[(MAX_STORED_CONTACTS + 7) / 8];
+  memset(seen, 0, sizeof(seen));
+
+  File file;
+  uint32_t idx = 0;
+  ContactInfo c;
+  uint8_t rec[CONTACT_REC_SIZE];
+  bool success = true;
+  int hint = 0;
+
+  while (success && host->getContactForSave(idx, c)) {
+    packContact(c, rec);
+    uint32_t h = hashContactRec(rec);
+
+    bool is_new = false;
+    int i = findStoredContact(c.id.pub_key, CONTACT_SAVED_KEY_SIZE, hint);
+    if (i < 0) {
+      i = addStoredContact(c.id.pub_key, 0, CONTACT_LOC_RESIDENT);
+      if (i < 0) { success = false; break; }
+      is_new = true;
+    } else if ((_stored[i].loc & CONTACT_LOC_RESIDENT) == 0) {
+      _stored[i].loc |= CONTACT_LOC_RESIDENT;   // has been paged in
+      _num_paged--;
+    }
+    if (is_new || _stored[i].hash != h) {
+      uint32_t pos;
+      success = appendJournal(file, JOURNAL_OP_UPDATE, rec, CONTACT_REC_SIZE, pos);
+      if (success) {
+        _stored[i].hash = h;
+        _stored[i].loc = pos | CONTACT_LOC_JOURNAL | CONTACT_LOC_RESIDENT;
+      } else if (is_new) {
+        _num_stored--;
+        break;
+      }
+    }
+    seen[i >> 3] |= (1 << (i & 7));
+    hint = i + 1;
+    idx++;
+  }
 
-      idx++;  // advance to next contact
+  // anything resident previously, but no longer in host, has been removed
+  for (int i = _num_stored - 1; success && i >= 0; i--) {
+    if ((_stored[i].loc & CONTACT_LOC_RESIDENT) == 0 || (seen[i >> 3] & (1 << (i & 7)))) continue;
+
+    uint32_t pos;
+    success = appendJournal(file, JOURNAL_OP_DELETE, _stored[i].key, CONTACT_SAVED_KEY_SIZE, pos);
+    if (success) {
+      _stored[i] = _stored[--_num_stored];   // already visited the one at end, so its 'seen' bit doesn't matter
     }
-    file.close();
   }
+  if (file) file.close();
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("DataStore: contacts journal write failed, rewriting all");
+    saveContactsFull(host);
+  } else if (_journal_recs >= CONTACTS_JOURNAL_MAX_RECS) {
+    saveContactsFull(host);   // compact
+  }
+}
+
+bool DataStore::pageOutContact(const ContactInfo& contact) {
+  if (_needs_rewrite || _num_paged >= MAX_PAGED_CONTACTS) return false;
+
+  uint8_t rec[CONTACT_REC_SIZE];
+  packContact(contact, rec);
+  uint32_t h = hashContactRec(rec);
+
+  int i = findStoredContact(contact.id.pub_key, CONTACT_SAVED_KEY_SIZE, -1);
+  if (i >= 0 && (_stored[i].loc & CONTACT_LOC_RESIDENT) == 0) return true;   // already paged out
+  if (i < 0 && _num_stored >= MAX_STORED_CONTACTS) return false;
+
+  if (i < 0 || _stored[i].hash != h) {   // latest version not yet in storage
+    File file;
+    uint32_t pos;
+    bool success = appendJournal(file, JOURNAL_OP_UPDATE, rec, CONTACT_REC_SIZE, pos);
+    if (file) file.close();
+    if (!success) {
+      _needs_rewrite = true;
+      return false;
+    }
+    if (i < 0) {
+      addStoredContact(contact.id.pub_key, h, pos | CONTACT_LOC_JOURNAL);
+      return true;
+    }
+    _stored[i].hash = h;
+    _stored[i].loc = pos | CONTACT_LOC_JOURNAL;
+  } else {
+    _stored[i].loc &= ~CONTACT_LOC_RESIDENT;
+  }
+  _num_paged++;
+  return true;
+}
+
+bool DataStore::pageInContact(const uint8_t* key, int prefix_len, ContactInfo& dest) {
+  int n = prefix_len < CONTACT_SAVED_KEY_SIZE ? prefix_len : CONTACT_SAVED_KEY_SIZE;
+  uint8_t rec[CONTACT_REC_SIZE];
+
+  for (int i = 0; i < _num_stored; i++) {
+    if ((_stored[i].loc & CONTACT_LOC_RESIDENT) || memcmp(_stored[i].key, key, n) != 0) continue;
+
+    if (!readStoredContact(i, rec, CONTACT_REC_SIZE) || memcmp(rec, key, prefix_len) != 0) continue;
+
+    unpackContact(dest, rec);
+    _stored[i].loc |= CONTACT_LOC_RESIDENT;
+    _num_paged--;
+    return true;
+  }
+  return false;  // not found
+}
+
+int DataStore::searchPagedContactsByHash(const uint8_t* hash, uint8_t pub_keys[][PUB_KEY_SIZE], int max_matches) {
+  int n = 0;
+  for (int i = 0; i < _num_stored && n < max_matches; i++) {
+    if ((_stored[i].loc & CONTACT_LOC_RESIDENT) || memcmp(_stored[i].key, hash, PATH_HASH_SIZE) != 0) continue;
+
+    if (readStoredContact(i, pub_keys[n], PUB_KEY_SIZE)) n++;   // pub_key is at start of record
+  }
+  return n;
+}
+
+bool DataStore::getNextPagedContact(int& cursor, ContactInfo& dest) {
+  uint8_t rec[CONTACT_REC_SIZE];
+  while (cursor < _num_stored) {
+    int i = cursor++;
+    if ((_stored[i].loc & CONTACT_LOC_RESIDENT) == 0 && readStoredContact(i, rec, CONTACT_REC_SIZE)) {
+      unpackContact(dest, rec);
+      return true;
+    }
+  }
+  return false;  // no more
 }
 
 void DataStore::loadChannels(DataStoreHost* host) {
@@ -339,13 +708,14 @@ void DataStore::loadChannels(DataStoreHost* host) {
       uint8_t channel_idx = 0;
       while (!full) {
         ChannelDetails ch;
-        uint8_t unused[4];
+        uint8_t extra[4];   // [0] is flags, rest reserved
 
-        bool success = (file.read(unused, 4) == 4);
+        bool success = (file.read(extra, 4) == 4);
         success = success && (file.read((uint8_t *)ch.name, 32) == 32);
         success = success && (file.read((uint8_t *)ch.channel.secret, 32) == 32);
 
         if (!success) break; // EOF
+        ch.flags = extra[0];
 
         if (host->onChannelLoaded(channel_idx, ch)) {
           channel_idx++;
@@ -362,11 +732,12 @@ void DataStore::saveChannels(DataStoreHost* host) {
   if (file) {
     uint8_t channel_idx = 0;
     ChannelDetails ch;
-    uint8_t unused[4];
-    memset(unused, 0, 4);
+    uint8_t extra[4];   // [0] is flags, rest reserved
+    memset(extra, 0, 4);
 
     while (host->getChannelForSave(channel_idx, ch)) {
-      bool success = (file.write(unused, 4) == 4);
+      extra[0] = ch.flags;
+      bool success = (file.write(extra, 4) == 4);
       success = success && (file.write((uint8_t *)ch.name, 32) == 32);
       success = success && (file.write((uint8_t *)ch.channel.secret, 32) == 32);
 
@@ -399,9 +770,49 @@ void DataStore::checkAdvBlobFile() {
       }
       file.close();
     }
+    _blob_index_loaded = false;
   }
 }
 
+void DataStore::loadBlobIndex() {
+  // one pass over just the record headers, to build the RAM directory
+  File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
+  if (file) {
+    int num_slots = file.size() / sizeof(BlobRec);
+    _blob_index.reset(num_slots);
+    num_slots = _blob_index.getNumSlots();
+
+    uint32_t stamps[MAX_BLOBRECS];
+    blob_slot_t order[MAX_BLOBRECS];
+    BlobRec tmp;
+    int n = 0;
+    for (int slot = 0; slot < num_slots; slot++) {
+      file.seek(slot * sizeof(BlobRec));
+      if (file.read((uint8_t *) &tmp, offsetof(BlobRec, data)) != offsetof(BlobRec, data)) break;
+
+      if (tmp.len > 0) _blob_index.assign(slot, tmp.key);
+
+      // insertion sort of slots, by timestamp (zeroed/unused records are oldest)
+      int i = n++;
+      while (i > 0 && stamps[i - 1] > tmp.timestamp) {
+        stamps[i] = stamps[i - 1];
+        order[i] = order[i - 1];
+        i--;
+      }
+      stamps[i] = tmp.timestamp;
+      order[i] = slot;
+    }
+    file.close();
+
+    for (int i = 0; i < n; i++) {
+      _blob_index.touch(order[i]);   // oldest first, so newest ends up at head of LRU list
+    }
+  } else {
+    _blob_index.reset(0);
+  }
+  _blob_index_loaded = true;
+}
+
 void DataStore::migrateToSecondaryFS() {
   // migrate old adv_blobs, contacts3 and channels2 files to secondary FS if they don't already exist
   if (!_fsExtra->exists("/adv_blobs")) {
@@ -511,16 +922,20 @@ void DataStore::migrateToSecondaryFS() {
 }
 
 uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  if (!_blob_index_loaded) loadBlobIndex();
+
+  int slot = _blob_index.find(key);  // only match by 7 byte prefix
+  if (slot < 0) return 0;   // not found
+
   File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
-  uint8_t len = 0;  // 0 = not found
+  uint8_t len = 0;
   if (file) {
     BlobRec tmp;
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        len = tmp.len;
-        memcpy(dest_buf, tmp.data, len);
-        break;
-      }
+    file.seek(slot * sizeof(BlobRec));
+    if (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp) && tmp.len <= MAX_ADVERT_PKT_LEN) {
+      len = tmp.len;
+      memcpy(dest_buf, tmp.data, len);
+      _blob_index.touch(slot);
     }
     file.close();
   }
@@ -530,43 +945,45 @@ uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_b
 bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
   if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
   checkAdvBlobFile();
+  if (!_blob_index_loaded) loadBlobIndex();
+
+  // find matching key OR evict least recently used
+  int slot = _blob_index.find(key);
+  if (slot < 0) slot = _blob_index.getEvictSlot();
+  if (slot < 0) return false;   // no records in file
+
   File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);
   if (file) {
-    uint32_t pos = 0, found_pos = 0;
-    uint32_t min_timestamp = 0xFFFFFFFF;
-
-    // search for matching key OR evict by oldest timestmap
     BlobRec tmp;
-    file.seek(0);
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        found_pos = pos;
-        break;
-      }
-      if (tmp.timestamp < min_timestamp) {
-        min_timestamp = tmp.timestamp;
-        found_pos = pos;
-      }
-
-      pos += sizeof(tmp);
-    }
-
     memcpy(tmp.key, key, sizeof(tmp.key));  // just record 7 byte prefix of key
     memcpy(tmp.data, src_buf, len);
     tmp.len = len;
     tmp.timestamp = _clock->getCurrentTime();
 
-    file.seek(found_pos);
-    file.write((uint8_t *) &tmp, sizeof(tmp));
-
+    file.seek(slot * sizeof(BlobRec));
+    bool success = file.write((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp);
     file.close();
-    return true;
+
+    if (success) _blob_index.assign(slot, key);
+    return success;
   }
   return false; // error
 }
 bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
   return true; // this is just a stub on NRF52/STM32 platforms
 }
+#elif defined(ESP32)
+uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  return _blobs.get(key, key_len, dest_buf);
+}
+
+bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
+  return _blobs.put(key, key_len, src_buf, len);
+}
+
+bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
+  return _blobs.remove(key, key_len);
+}
 #else
 inline void makeBlobPath(const uint8_t key[], int key_len, char* path, size_t path_size) {
   char fname[18];
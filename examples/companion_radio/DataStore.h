@@ -4,10 +4,31 @@
 #include <helpers/ContactInfo.h>
 #include <helpers/ChannelDetails.h>
 #include "NodePrefs.h"
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  #include "AdvBlobIndex.h"
+#elif defined(ESP32)
+  #include "PackedBlobStore.h"
+#endif
+
+#ifndef MAX_CONTACTS
+  #define MAX_CONTACTS 100
+#endif
+
+#ifndef MAX_STORED_CONTACTS
+  #define MAX_STORED_CONTACTS   MAX_CONTACTS   // if more than MAX_CONTACTS, least recently used contacts are paged out to flash
+#endif
+
+#ifndef CONTACTS_JOURNAL_MAX_RECS
+  #define CONTACTS_JOURNAL_MAX_RECS   64    // compact into /contacts3 after this many journal records
+#endif
+
+#define CONTACT_SAVED_KEY_SIZE   8
 
 class DataStoreHost {
 public:
   virtual bool onContactLoaded(const ContactInfo& contact) =0;
+  virtual bool onContactJournalUpdate(const ContactInfo& contact) =0;
+  virtual void onContactJournalDelete(const uint8_t* key_prefix, int prefix_len) =0;
   virtual bool getContactForSave(uint32_t idx, ContactInfo& contact) =0;
   virtual bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) =0;
   virtual bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) =0;
@@ -19,9 +40,33 @@ class DataStore {
   mesh::RTCClock* _clock;
   IdentityStore identity_store;
 
+  // directory of every contact in storage, with where its latest record is (either in /contacts3 or the journal),
+  // so that saveContacts() only appends records for contacts which have changed, and paged out contacts can be found
+  struct StoredContact {
+    uint8_t  key[CONTACT_SAVED_KEY_SIZE];
+    uint32_t hash;    // of latest record
+    uint32_t loc;     // CONTACT_LOC_* flags, and offset of latest record
+  };
+  StoredContact _stored[MAX_STORED_CONTACTS];
+  int _num_stored;
+  int _num_paged;       // number of _stored[] which are NOT resident in host
+  bool _needs_rewrite;  // next save must rewrite the whole file
+  int _journal_recs;
+
   void loadPrefsInt(const char *filename, NodePrefs& prefs, double& node_lat, double& node_lon);
+  int findStoredContact(const uint8_t* key, int prefix_len, int hint) const;
+  int addStoredContact(const uint8_t* key, uint32_t hash, uint32_t loc);
+  bool readStoredContact(int i, uint8_t rec[], int len);
+  bool appendJournal(File& file, uint8_t op, const uint8_t* data, int len, uint32_t& rec_pos);
+  void saveContactsFull(DataStoreHost* host);
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  AdvBlobIndex _blob_index;
+  bool _blob_index_loaded;
+
   void checkAdvBlobFile();
+  void loadBlobIndex();
+#elif defined(ESP32)
+  PackedBlobStore _blobs;
 #endif
 
 public:
@@ -37,6 +82,11 @@ public:
   void savePrefs(const NodePrefs& prefs, double node_lat, double node_lon);
   void loadContacts(DataStoreHost* host);
   void saveContacts(DataStoreHost* host);
+  bool pageOutContact(const ContactInfo& contact);
+  bool pageInContact(const uint8_t* key, int prefix_len, ContactInfo& dest);
+  int searchPagedContactsByHash(const uint8_t* hash, uint8_t pub_keys[][PUB_KEY_SIZE], int max_matches);
+  bool getNextPagedContact(int& cursor, ContactInfo& dest);
+  int getNumPagedContacts() const { return _num_paged; }
   void loadChannels(DataStoreHost* host);
   void saveChannels(DataStoreHost* host);
   void migrateToSecondaryFS();
@@ -45,6 +95,8 @@ public:
   bool deleteBlobByKey(const uint8_t key[], int key_len);
   File openRead(const char* filename);
   File openRead(FILESYSTEM* fs, const char* filename);
+  File openWrite(FILESYSTEM* fs, const char* filename);
+  File openAppend(FILESYSTEM* fs, const char* filename);
   bool removeFile(const char* filename);
   bool removeFile(FILESYSTEM* fs, const char* filename);
   uint32_t getStorageUsedKb() const;
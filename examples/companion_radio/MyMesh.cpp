@@ -1,4 +1,5 @@
 #include "MyMesh.h"
+#include "ContactsBulk.h"
 
 #include <Arduino.h> // needed for PlatformIO
 #include <Mesh.h>
@@ -58,11 +59,14 @@
 #define CMD_GET_AUTOADD_CONFIG        59
 #define CMD_GET_ALLOWED_REPEAT_FREQ   60
 #define CMD_SET_PATH_HASH_MODE        61
+#define CMD_GET_CONTACTS_BULK         62   // same as CMD_GET_CONTACTS, but multiple compact records per reply frame
 
 // Stats sub-types for CMD_GET_STATS
 #define STATS_TYPE_CORE               0
 #define STATS_TYPE_RADIO              1
 #define STATS_TYPE_PACKETS             2
+#define STATS_TYPE_BOOT               3
+#define STATS_TYPE_OFFLINE_QUEUE      4
 
 #define RESP_CODE_OK                  0
 #define RESP_CODE_ERR                 1
@@ -91,6 +95,7 @@
 #define RESP_CODE_STATS               24   // v8+, second byte is stats type
 #define RESP_CODE_AUTOADD_CONFIG      25
 #define RESP_ALLOWED_REPEAT_FREQ      26
+#define RESP_CODE_CONTACTS_BULK       27   // multiple of these (after CMD_GET_CONTACTS_BULK)
 
 #define SEND_TIMEOUT_BASE_MILLIS        500
 #define FLOOD_SEND_TIMEOUT_FACTOR       16.0f
@@ -118,6 +123,7 @@
 #define PUSH_CODE_CONTROL_DATA          0x8E   // v8+
 #define PUSH_CODE_CONTACT_DELETED       0x8F // used to notify client app of deleted contact when overwriting oldest
 #define PUSH_CODE_CONTACTS_FULL         0x90 // used to notify client app that contacts storage is full
+#define PUSH_CODE_BINARY_RESPONSE_PART  0x91 // one fragment of a multipart _BINARY_REQ reply
 
 #define ERR_CODE_UNSUPPORTED_CMD        1
 #define ERR_CODE_NOT_FOUND              2
@@ -128,6 +134,9 @@
 
 #define MAX_SIGN_DATA_LEN               (8 * 1024) // 8K
 
+// CMD_GET_CONTACTS_BULK flags
+#define BULK_FLAG_OMIT_PATHS            0x01   // app doesn't want out_path bytes (out_path_len is still sent)
+
 // Auto-add config bitmask
 // Bit 0: If set, overwrite oldest non-favourite contact when contacts file is full
 // Bits 1-4: these indicate which contact types to auto-add when manual_contact_mode = 0x01
@@ -178,6 +187,46 @@ void MyMesh::writeContactRespFrame(uint8_t code, const ContactInfo &contact) {
   _serial->writeFrame(out_frame, i);
 }
 
+bool MyMesh::writeContactsBulkFrame() {
+  int i = 0;
+  out_frame[i++] = RESP_CODE_CONTACTS_BULK;
+  out_frame[i++] = 0;   // num records, filled in below
+
+  uint8_t rec[BULK_REC_MAX_SIZE];
+  uint32_t prev_lastmod = 0;
+  int n = 0;
+  while (n < 255) {
+    if (!_iter_has_pending) {
+      if (!_iter.hasNext(this, _iter_pending)) break;   // EOF
+      if (_iter_pending.lastmod <= _iter_filter_since) continue; // apply the 'since' filter
+      _iter_has_pending = true;
+    }
+    int len = ContactsBulkCodec::writeRecord(rec, _iter_pending, prev_lastmod, _iter_bulk_flags & BULK_FLAG_OMIT_PATHS);
+    if (i + len > MAX_FRAME_SIZE) break;   // goes in next frame
+
+    memcpy(&out_frame[i], rec, len);
+    i += len;
+    prev_lastmod = _iter_pending.lastmod;
+    if (_iter_pending.lastmod > _most_recent_lastmod) {
+      _most_recent_lastmod = _iter_pending.lastmod; // save for the RESP_CODE_END_OF_CONTACTS frame
+    }
+    _iter_has_pending = false;
+    n++;
+  }
+  if (n == 0) return false;   // no more contacts
+
+  out_frame[1] = n;
+  _serial->writeFrame(out_frame, i);
+  return true;
+}
+
+void MyMesh::writeEndOfContactsFrame() {
+  out_frame[0] = RESP_CODE_END_OF_CONTACTS;
+  memcpy(&out_frame[1], &_most_recent_lastmod, 4); // include the most recent lastmod, so app can update their 'since'
+  _serial->writeFrame(out_frame, 5);
+  _iter_started = false;
+}
+
 void MyMesh::updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, const uint8_t *frame, int len) {
   int i = 0;
   uint8_t code = frame[i++]; // eg. CMD_ADD_UPDATE_CONTACT
@@ -203,46 +252,16 @@ void MyMesh::updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, co
   }
 }
 
-bool MyMesh::Frame::isChannelMsg() const {
-  return buf[0] == RESP_CODE_CHANNEL_MSG_RECV || buf[0] == RESP_CODE_CHANNEL_MSG_RECV_V3;
+static bool isChannelMsg(const uint8_t frame[]) {
+  return frame[0] == RESP_CODE_CHANNEL_MSG_RECV || frame[0] == RESP_CODE_CHANNEL_MSG_RECV_V3;
 }
 
 void MyMesh::addToOfflineQueue(const uint8_t frame[], int len) {
-  if (offline_queue_len >= OFFLINE_QUEUE_SIZE) {
-    MESH_DEBUG_PRINTLN("WARN: offline_queue is full!");
-    int pos = 0;
-    while (pos < offline_queue_len) {
-      if (offline_queue[pos].isChannelMsg()) {
-        for (int i = pos; i < offline_queue_len - 1; i++) { // delete oldest channel msg from queue
-          offline_queue[i] = offline_queue[i + 1];
-        }
-        MESH_DEBUG_PRINTLN("INFO: removed oldest channel message from queue.");
-        offline_queue[offline_queue_len - 1].len = len;
-        memcpy(offline_queue[offline_queue_len - 1].buf, frame, len);
-        return;
-      }
-      pos++;
-    }
-    MESH_DEBUG_PRINTLN("INFO: no channel messages to remove from queue.");
-  } else {
-    offline_queue[offline_queue_len].len = len;
-    memcpy(offline_queue[offline_queue_len].buf, frame, len);
-    offline_queue_len++;
-  }
+  offline_queue.add(frame, len, isChannelMsg(frame));
 }
 
 int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
-  if (offline_queue_len > 0) {         // check offline queue
-    size_t len = offline_queue[0].len; // take from top of queue
-    memcpy(frame, offline_queue[0].buf, len);
-
-    offline_queue_len--;
-    for (int i = 0; i < offline_queue_len; i++) { // delete top item from queue
-      offline_queue[i] = offline_queue[i + 1];
-    }
-    return len;
-  }
-  return 0; // queue is empty
+  return offline_queue.get(frame);
 }
 
 float MyMesh::getAirtimeBudgetFactor() const {
@@ -271,7 +290,18 @@ uint8_t MyMesh::getExtraAckTransmitCount() const {
   return _prefs.multi_acks;
 }
 
+mesh::DispatcherAction MyMesh::onRecvPacket(mesh::Packet* pkt) {
+  if (!isBootComplete()) {
+    // contacts/channels are still loading, so keep packet in the inbound queue until they are
+    _mgr->queueInbound(pkt, futureMillis(BOOT_RX_HOLD_MILLIS));
+    return ACTION_MANUAL_HOLD;
+  }
+  return BaseChatMesh::onRecvPacket(pkt);
+}
+
 void MyMesh::logRxRaw(float snr, float rssi, const uint8_t raw[], int len) {
+  markBootPhase(BOOT_PHASE_FIRST_RX);
+
   if (_serial->isConnected() && len + 3 <= MAX_FRAME_SIZE) {
     int i = 0;
     out_frame[i++] = PUSH_CODE_LOG_RX_DATA;
@@ -452,7 +482,7 @@ void MyMesh::queueMessage(const ContactInfo &from, uint8_t txt_type, mesh::Packe
   // we only want to show text messages on display, not cli data
   bool should_display = txt_type == TXT_TYPE_PLAIN || txt_type == TXT_TYPE_SIGNED_PLAIN;
   if (should_display && _ui) {
-    _ui->newMsg(path_len, from.name, text, offline_queue_len);
+    _ui->newMsg(path_len, from.name, text, offline_queue.count());
     if (!_serial->isConnected()) {
       _ui->notify(UIEventType::contactMessage);
     }
@@ -556,7 +586,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   if (getChannel(channel_idx, channel_details)) {
     channel_name = channel_details.name;
   }
-  if (_ui) _ui->newMsg(path_len, channel_name, text, offline_queue_len);
+  if (_ui) _ui->newMsg(path_len, channel_name, text, offline_queue.count());
 #endif
 }
 
@@ -678,6 +708,24 @@ void MyMesh::onContactResponse(const ContactInfo &contact, const uint8_t *data,
   }
 }
 
+void MyMesh::onContactResponsePart(const ContactInfo &contact, uint32_t tag, int idx, int count, const uint8_t *chunk, int chunk_len) {
+  if (count == 1) {
+    BaseChatMesh::onContactResponsePart(contact, tag, idx, count, chunk, chunk_len);   // as normal _BINARY_RESPONSE
+  } else if (tag == pending_req) {
+    if (idx == count - 1) pending_req = 0;
+
+    int i = 0;
+    out_frame[i++] = PUSH_CODE_BINARY_RESPONSE_PART;
+    out_frame[i++] = idx;
+    out_frame[i++] = count;
+    memcpy(&out_frame[i], &tag, 4);   // app needs to match this to RESP_CODE_SENT.tag
+    i += 4;
+    memcpy(&out_frame[i], chunk, chunk_len);
+    i += chunk_len;
+    _serial->writeFrame(out_frame, i);
+  }
+}
+
 bool MyMesh::onContactPathRecv(ContactInfo& contact, uint8_t* in_path, uint8_t in_path_len, uint8_t* out_path, uint8_t out_path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
   if (extra_type == PAYLOAD_TYPE_RESPONSE && extra_len > 4) {
     uint32_t tag;
@@ -791,17 +839,36 @@ uint32_t MyMesh::calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t
 
 void MyMesh::onSendTimeout() {}
 
+bool MyMesh::onContactJournalUpdate(const ContactInfo& contact) {
+  ContactInfo* existing = lookupContactByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+  if (existing) {
+    *existing = contact;
+    existing->shared_secret_valid = false;
+    return true;
+  }
+  return onContactLoaded(contact);
+}
+
+void MyMesh::onContactJournalDelete(const uint8_t* key_prefix, int prefix_len) {
+  ContactInfo* existing = lookupContactByPubKey(key_prefix, prefix_len);
+  if (existing) removeContact(*existing);
+}
+
 MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMeshTables &tables, DataStore& store, AbstractUITask* ui)
     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables),
       _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store), _ui(ui) {
   _iter_started = false;
+  _iter_bulk = _iter_has_pending = false;
+  _iter_bulk_flags = 0;
+  _iter_session = 0;
   _cli_rescue = false;
-  offline_queue_len = 0;
   app_target_ver = 0;
   clearPendingReqs();
   next_ack_idx = 0;
   sign_data = NULL;
   dirty_contacts_expiry = 0;
+  _boot_stage = BOOT_PHASE_SETUP;
+  memset(_boot_millis, 0, sizeof(_boot_millis));
   memset(advert_paths, 0, sizeof(advert_paths));
   memset(send_scope.key, 0, sizeof(send_scope.key));
 
@@ -820,7 +887,9 @@ MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMe
 }
 
 void MyMesh::begin(bool has_display) {
+  markBootPhase(BOOT_PHASE_STORAGE);
   BaseChatMesh::begin();
+  offline_queue.begin(_store);
 
   if (!_store->loadMainIdentity(self_id)) {
     self_id = radio_new_identity(); // create new random identity
@@ -876,14 +945,30 @@ void MyMesh::begin(bool has_display) {
   _active_ble_pin = 0;
 #endif
 
-  resetContacts();
-  _store->loadContacts(this);
-  bootstrapRTCfromContacts();
-  addChannel("Public", PUBLIC_GROUP_PSK); // pre-configure Andy's public channel
-  _store->loadChannels(this);
-
   radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
   radio_set_tx_power(_prefs.tx_power_dbm);
+  markBootPhase(BOOT_PHASE_RADIO);
+
+  // NOTE: contacts and channels are loaded from loop(), so the rest of setup() isn't held up by them
+}
+
+void MyMesh::loadNextStore() {
+  // one stage per loop(), so that radio and UI still get serviced in between
+  switch (_boot_stage) {
+  case BOOT_PHASE_SETUP:
+    break;
+  case BOOT_PHASE_CONTACTS:
+    resetContacts();
+    _store->loadContacts(this);
+    bootstrapRTCfromContacts();
+    break;
+  case BOOT_PHASE_CHANNELS:
+    addChannel("Public", PUBLIC_GROUP_PSK); // pre-configure Andy's public channel
+    _store->loadChannels(this);
+    break;
+  }
+  markBootPhase(_boot_stage);
+  _boot_stage++;
 }
 
 const char *MyMesh::getNodeName() {
@@ -926,7 +1011,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     int i = 0;
     out_frame[i++] = RESP_CODE_DEVICE_INFO;
     out_frame[i++] = FIRMWARE_VER_CODE;
-    out_frame[i++] = MAX_CONTACTS / 2;   // v3+
+    out_frame[i++] = (MAX_STORED_CONTACTS / 2 > 255) ? 255 : MAX_STORED_CONTACTS / 2;   // v3+
     out_frame[i++] = MAX_GROUP_CHANNELS; // v3+
     memcpy(&out_frame[i], &_prefs.ble_pin, 4);
     i += 4;
@@ -1048,7 +1133,7 @@ void MyMesh::handleCmdFrame(size_t len) {
         writeErrFrame(ERR_CODE_NOT_FOUND); // bad channel_idx
       }
     }
-  } else if (cmd_frame[0] == CMD_GET_CONTACTS) { // get Contact list
+  } else if (cmd_frame[0] == CMD_GET_CONTACTS || cmd_frame[0] == CMD_GET_CONTACTS_BULK) { // get Contact list
     if (_iter_started) {
       writeErrFrame(ERR_CODE_BAD_STATE); // iterator is currently busy
     } else {
@@ -1057,16 +1142,20 @@ void MyMesh::handleCmdFrame(size_t len) {
       } else {
         _iter_filter_since = 0;
       }
+      _iter_bulk = cmd_frame[0] == CMD_GET_CONTACTS_BULK;
+      _iter_bulk_flags = (_iter_bulk && len >= 6) ? cmd_frame[5] : 0;
 
       uint8_t reply[5];
       reply[0] = RESP_CODE_CONTACTS_START;
-      uint32_t count = getNumContacts(); // total, NOT filtered count
+      uint32_t count = getNumContacts() + _store->getNumPagedContacts(); // total, NOT filtered count
       memcpy(&reply[1], &count, 4);
       _serial->writeFrame(reply, 5);
 
       // start iterator
       _iter = startContactsIterator();
       _iter_started = true;
+      _iter_session = _serial->getReplySession();
+      _iter_has_pending = false;
       _most_recent_lastmod = 0;
     }
   } else if (cmd_frame[0] == CMD_SET_ADVERT_NAME && len >= 2) {
@@ -1228,7 +1317,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if ((out_len = getFromOfflineQueue(out_frame)) > 0) {
       _serial->writeFrame(out_frame, out_len);
 #ifdef DISPLAY_CLASS
-      if (_ui) _ui->msgRead(offline_queue_len);
+      if (_ui) _ui->msgRead(offline_queue.count());
 #endif
     } else {
       out_frame[0] = RESP_CODE_NO_MORE_MESSAGES;
@@ -1554,6 +1643,7 @@ void MyMesh::handleCmdFrame(size_t len) {
       i += 32;
       memcpy(&out_frame[i], channel.channel.secret, 16);
       i += 16; // NOTE: only 128-bit supported
+      out_frame[i++] = channel.flags;
       _serial->writeFrame(out_frame, i);
     } else {
       writeErrFrame(ERR_CODE_NOT_FOUND);
@@ -1566,6 +1656,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     StrHelper::strncpy(channel.name, (char *)&cmd_frame[2], 32);
     memset(channel.channel.secret, 0, sizeof(channel.channel.secret));
     memcpy(channel.channel.secret, &cmd_frame[2 + 32], 16); // NOTE: only 128-bit supported
+    channel.flags = len >= 2 + 32 + 16 + 1 ? cmd_frame[2 + 32 + 16] : 0;   // optional
     if (setChannel(channel_idx, channel)) {
       saveChannels();
       writeOKFrame();
@@ -1753,6 +1844,30 @@ void MyMesh::handleCmdFrame(size_t len) {
       memcpy(&out_frame[i], &n_recv_direct, 4); i += 4;
       memcpy(&out_frame[i], &n_recv_errors, 4); i += 4;
       _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_BOOT) {
+      int i = 0;
+      out_frame[i++] = RESP_CODE_STATS;
+      out_frame[i++] = STATS_TYPE_BOOT;
+      out_frame[i++] = NUM_BOOT_PHASES;
+      memcpy(&out_frame[i], _boot_millis, sizeof(_boot_millis)); i += sizeof(_boot_millis);
+      _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_OFFLINE_QUEUE) {
+      int i = 0;
+      out_frame[i++] = RESP_CODE_STATS;
+      out_frame[i++] = STATS_TYPE_OFFLINE_QUEUE;
+      uint16_t n_direct = offline_queue.getNumDirect();
+      uint16_t n_channel = offline_queue.getNumChannel();
+      uint16_t n_spooled = offline_queue.getNumSpooled();
+      uint32_t dropped_direct = offline_queue.getDroppedDirect();
+      uint32_t dropped_channel = offline_queue.getDroppedChannel();
+      uint32_t link_dropped = _serial->getNumDroppedFrames();
+      memcpy(&out_frame[i], &n_direct, 2); i += 2;
+      memcpy(&out_frame[i], &n_channel, 2); i += 2;
+      memcpy(&out_frame[i], &n_spooled, 2); i += 2;
+      memcpy(&out_frame[i], &dropped_direct, 4); i += 4;
+      memcpy(&out_frame[i], &dropped_channel, 4); i += 4;
+      memcpy(&out_frame[i], &link_dropped, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
     } else {
       writeErrFrame(ERR_CODE_ILLEGAL_ARG); // invalid stats sub-type
     }
@@ -1990,23 +2105,31 @@ void MyMesh::checkSerialInterface() {
   size_t len = _serial->checkRecvFrame(cmd_frame);
   if (len > 0) {
     handleCmdFrame(len);
-  } else if (_iter_started              // check if our ContactsIterator is 'running'
-             && !_serial->isWriteBusy() // don't spam the Serial Interface too quickly!
-  ) {
-    ContactInfo contact;
-    if (_iter.hasNext(this, contact)) {
-      if (contact.lastmod > _iter_filter_since) { // apply the 'since' filter
-        writeContactRespFrame(RESP_CODE_CONTACT, contact);
-        if (contact.lastmod > _most_recent_lastmod) {
-          _most_recent_lastmod = contact.lastmod; // save for the RESP_CODE_END_OF_CONTACTS frame
+
+    // handle any more commands already queued (eg. pipelined by app, or from other clients), while there's room for replies
+    for (int n = 1; n < MAX_CMD_FRAMES_PER_LOOP && !_serial->isWriteBusy(); n++) {
+      len = _serial->checkRecvFrame(cmd_frame);
+      if (len == 0) break;
+      handleCmdFrame(len);
+    }
+  } else if (_iter_started) {           // check if our ContactsIterator is 'running'
+    _serial->setReplySession(_iter_session);   // contacts go to client that asked for them
+    if (_serial->isWriteBusy()) return;        // don't spam the Serial Interface too quickly!
+
+    if (_iter_bulk) {
+      if (!writeContactsBulkFrame()) writeEndOfContactsFrame();
+    } else {
+      ContactInfo contact;
+      if (_iter.hasNext(this, contact)) {
+        if (contact.lastmod > _iter_filter_since) { // apply the 'since' filter
+          writeContactRespFrame(RESP_CODE_CONTACT, contact);
+          if (contact.lastmod > _most_recent_lastmod) {
+            _most_recent_lastmod = contact.lastmod; // save for the RESP_CODE_END_OF_CONTACTS frame
+          }
         }
+      } else { // EOF
+        writeEndOfContactsFrame();
       }
-    } else { // EOF
-      out_frame[0] = RESP_CODE_END_OF_CONTACTS;
-      memcpy(&out_frame[1], &_most_recent_lastmod,
-             4); // include the most recent lastmod, so app can update their 'since'
-      _serial->writeFrame(out_frame, 5);
-      _iter_started = false;
     }
   //} else if (!_serial->isWriteBusy()) {
   //  checkConnections();    // TODO - deprecate the 'Connections' stuff
@@ -2014,11 +2137,14 @@ void MyMesh::checkSerialInterface() {
 }
 
 void MyMesh::loop() {
+  if (!isBootComplete()) {
+    loadNextStore();
+  }
   BaseChatMesh::loop();
 
   if (_cli_rescue) {
     checkCLIRescueCmd();
-  } else {
+  } else if (isBootComplete()) {
     checkSerialInterface();
   }
 
@@ -25,6 +25,7 @@
 
 #include "DataStore.h"
 #include "NodePrefs.h"
+#include "OfflineQueue.h"
 
 #include <RTClib.h>
 #include <helpers/ArduinoHelpers.h>
@@ -59,10 +60,23 @@
 #define MAX_CONTACTS 100
 #endif
 
-#ifndef OFFLINE_QUEUE_SIZE
-#define OFFLINE_QUEUE_SIZE 16
+#ifndef MAX_CMD_FRAMES_PER_LOOP
+#define MAX_CMD_FRAMES_PER_LOOP 4
 #endif
 
+#ifndef BOOT_RX_HOLD_MILLIS
+#define BOOT_RX_HOLD_MILLIS 20   // how often held packets are re-checked, while contacts/channels still loading
+#endif
+
+// boot timeline, millis at end of each phase (see STATS_TYPE_BOOT)
+#define BOOT_PHASE_STORAGE   0   // MyMesh::begin() entered, ie. filesystems mounted
+#define BOOT_PHASE_RADIO     1   // identity and prefs loaded, radio configured
+#define BOOT_PHASE_SETUP     2   // first loop(), ie. rest of setup() done
+#define BOOT_PHASE_CONTACTS  3
+#define BOOT_PHASE_CHANNELS  4   // all stores loaded, now processing packets and app commands
+#define BOOT_PHASE_FIRST_RX  5
+#define NUM_BOOT_PHASES      6
+
 #ifndef BLE_NAME_PREFIX
 #define BLE_NAME_PREFIX "MeshCore-"
 #endif
@@ -115,6 +129,7 @@ protected:
   void sendFloodScoped(const ContactInfo& recipient, mesh::Packet* pkt, uint32_t delay_millis=0) override;
   void sendFloodScoped(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t delay_millis=0) override;
 
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override;
   void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override;
   bool isAutoAddEnabled() const override;
   bool shouldAutoAddContactType(uint8_t type) const override;
@@ -140,6 +155,7 @@ protected:
   uint8_t onContactRequest(const ContactInfo &contact, uint32_t sender_timestamp, const uint8_t *data,
                            uint8_t len, uint8_t *reply) override;
   void onContactResponse(const ContactInfo &contact, const uint8_t *data, uint8_t len) override;
+  void onContactResponsePart(const ContactInfo &contact, uint32_t tag, int idx, int count, const uint8_t *chunk, int chunk_len) override;
   void onControlDataRecv(mesh::Packet *packet) override;
   void onRawDataRecv(mesh::Packet *packet) override;
   void onTraceRecv(mesh::Packet *packet, uint32_t tag, uint32_t auth_code, uint8_t flags,
@@ -150,7 +166,11 @@ protected:
   void onSendTimeout() override;
 
   // DataStoreHost methods
-  bool onContactLoaded(const ContactInfo& contact) override { return addContact(contact); }
+  bool onContactLoaded(const ContactInfo& contact) override {
+    return getNumContacts() < MAX_CONTACTS && addContact(contact);   // any others stay paged out in DataStore
+  }
+  bool onContactJournalUpdate(const ContactInfo& contact) override;
+  void onContactJournalDelete(const uint8_t* key_prefix, int prefix_len) override;
   bool getContactForSave(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
   bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return setChannel(channel_idx, ch); }
   bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return getChannel(channel_idx, ch); }
@@ -167,6 +187,8 @@ private:
   void writeErrFrame(uint8_t err_code);
   void writeDisabledFrame();
   void writeContactRespFrame(uint8_t code, const ContactInfo &contact);
+  bool writeContactsBulkFrame();
+  void writeEndOfContactsFrame();
   void updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, const uint8_t *frame, int len);
   void addToOfflineQueue(const uint8_t frame[], int len);
   int getFromOfflineQueue(uint8_t frame[]);
@@ -176,8 +198,21 @@ private:
   bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) override {
     return _store->putBlobByKey(key, key_len, src_buf, len);
   }
+  bool pageOutContact(const ContactInfo& contact) override { return _store->pageOutContact(contact); }
+  bool loadPagedContact(const uint8_t* pub_key, int prefix_len, ContactInfo& dest) override {
+    return _store->pageInContact(pub_key, prefix_len, dest);
+  }
+  int searchPagedContactsByHash(const uint8_t* hash, uint8_t pub_keys[][PUB_KEY_SIZE], int max_matches) override {
+    return _store->searchPagedContactsByHash(hash, pub_keys, max_matches);
+  }
+  bool getNextPagedContact(int& cursor, ContactInfo& dest) const override {
+    return _store->getNextPagedContact(cursor, dest);
+  }
 
   void checkCLIRescueCmd();
+  void loadNextStore();
+  bool isBootComplete() const { return _boot_stage > BOOT_PHASE_CHANNELS; }
+  void markBootPhase(uint8_t phase) { if (_boot_millis[phase] == 0) _boot_millis[phase] = _ms->getMillis(); }
   void checkSerialInterface();
   bool isValidClientRepeatFreq(uint32_t f) const;
 
@@ -197,14 +232,20 @@ private:
   ContactsIterator _iter;
   uint32_t _iter_filter_since;
   uint32_t _most_recent_lastmod;
+  ContactInfo _iter_pending;   // next contact for CMD_GET_CONTACTS_BULK, which didn't fit in last frame
   uint32_t _active_ble_pin;
   bool _iter_started;
+  bool _iter_bulk, _iter_has_pending;
+  uint8_t _iter_bulk_flags;
+  int _iter_session;
   bool _cli_rescue;
   char cli_command[80];
   uint8_t app_target_ver;
   uint8_t *sign_data;
   uint32_t sign_data_len;
   unsigned long dirty_contacts_expiry;
+  uint8_t _boot_stage;   // next BOOT_PHASE_ to run from loop()
+  uint32_t _boot_millis[NUM_BOOT_PHASES];
 
   TransportKey send_scope;
 
@@ -212,14 +253,7 @@ private:
   uint8_t out_frame[MAX_FRAME_SIZE + 1];
   CayenneLPP telemetry;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-
-    bool isChannelMsg() const;
-  };
-  int offline_queue_len;
-  Frame offline_queue[OFFLINE_QUEUE_SIZE];
+  OfflineQueue offline_queue;
 
   struct AckTableEntry {
     unsigned long msg_sent;
@@ -0,0 +1,242 @@
+#include <Arduino.h>
+#include "OfflineQueue.h"
+
+#define SPOOL_HDR_SIZE      2    // len, is_channel
+
+#define SPOOL_SLOTS         (OFFLINE_SPOOL_SEGMENTS + 1)
+#define SPOOL_SEG_BYTES     (OFFLINE_SPOOL_MAX_BYTES / OFFLINE_SPOOL_SEGMENTS)
+
+#if OFFLINE_SPOOL_MAX_BYTES > 0 && SPOOL_SEG_BYTES < SPOOL_HDR_SIZE + MAX_FRAME_SIZE
+  #error "OFFLINE_SPOOL_MAX_BYTES too small for OFFLINE_SPOOL_SEGMENTS"
+#endif
+
+static void segName(char* dest, int seg) {
+  sprintf(dest, "/offline_q%d", seg);
+}
+
+OfflineQueue::OfflineQueue() : _store(NULL), _spool_fs(NULL) {
+  _head = _ring_len = 0;
+  _num_direct = _num_channel = 0;
+  _spool_direct = _spool_channel = 0;
+  _rd_seg = _num_segs = 0;
+  _wr_sealed = false;
+  _spool_rd = _spool_bytes = 0;
+  _dropped_direct = _dropped_channel = 0;
+}
+
+void OfflineQueue::begin(DataStore* store) {
+  _store = store;
+  if (OFFLINE_SPOOL_MAX_BYTES > 0) {
+    _spool_fs = store->getSecondaryFS() ? store->getSecondaryFS() : store->getPrimaryFS();
+    char name[16];
+    for (int seg = 0; seg < SPOOL_SLOTS; seg++) {
+      segName(name, seg);
+      _spool_fs->remove(name);
+    }
+  }
+}
+
+void OfflineQueue::pushRing(const uint8_t frame[], int len, bool is_channel) {
+  Frame* f = &_ring[(_head + _ring_len) % OFFLINE_QUEUE_SIZE];
+  f->len = len;
+  f->is_channel = is_channel;
+  memcpy(f->buf, frame, len);
+  _ring_len++;
+}
+
+bool OfflineQueue::removeOldestChannelMsg() {
+  // oldest frames are always in the ring, not the spool
+  for (int i = 0; i < _ring_len; i++) {
+    if (_ring[(_head + i) % OFFLINE_QUEUE_SIZE].is_channel) {
+      for (int j = i; j > 0; j--) {   // close the gap by moving the (fewer) older frames up one slot
+        _ring[(_head + j) % OFFLINE_QUEUE_SIZE] = _ring[(_head + j - 1) % OFFLINE_QUEUE_SIZE];
+      }
+      _head = (_head + 1) % OFFLINE_QUEUE_SIZE;
+      _ring_len--;
+      _num_channel--;
+      _dropped_channel++;
+      MESH_DEBUG_PRINTLN("OfflineQueue: removed oldest channel message");
+
+      refillFromSpool();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OfflineQueue::startSegment() {
+  if (_num_segs >= SPOOL_SLOTS) return false;   // segments were sealed early, or left part empty by large frames
+
+  int seg = (_rd_seg + _num_segs) % SPOOL_SLOTS;
+  char name[16];
+  segName(name, seg);
+  _spool_fs->remove(name);
+  _seg_len[seg] = 0;
+  _num_segs++;
+  _wr_sealed = false;
+  return true;
+}
+
+void OfflineQueue::removeOldestSegment() {
+  char name[16];
+  segName(name, _rd_seg);
+  _spool_fs->remove(name);   // the only flash work needed to reclaim it
+  _rd_seg = (_rd_seg + 1) % SPOOL_SLOTS;
+  _num_segs--;
+  _spool_rd = 0;
+}
+
+bool OfflineQueue::appendSpool(const uint8_t frame[], int len, bool is_channel) {
+  if (_spool_fs == NULL) return false;
+
+  uint32_t rec_len = SPOOL_HDR_SIZE + len;
+  if (_spool_bytes + rec_len > OFFLINE_SPOOL_MAX_BYTES) return false;
+
+  int seg = (_rd_seg + _num_segs - 1) % SPOOL_SLOTS;
+  if (_num_segs == 0 || _wr_sealed || _seg_len[seg] + rec_len > SPOOL_SEG_BYTES) {
+    if (!startSegment()) return false;
+    seg = (_rd_seg + _num_segs - 1) % SPOOL_SLOTS;
+  }
+
+  char name[16];
+  segName(name, seg);
+  File f = _store->openAppend(_spool_fs, name);
+  if (!f) return false;
+
+  uint8_t hdr[SPOOL_HDR_SIZE];
+  hdr[0] = len;
+  hdr[1] = is_channel;
+  bool success = f.write(hdr, SPOOL_HDR_SIZE) == SPOOL_HDR_SIZE && f.write(frame, len) == len;
+  f.close();
+
+  if (!success) {
+    // segment may now have a partial record at the end, so don't append after it. Frames before it are
+    // still read back, as reads stop at _seg_len
+    MESH_DEBUG_PRINTLN("OfflineQueue: spool write failed");
+    _wr_sealed = true;
+    return false;
+  }
+  _seg_len[seg] += rec_len;
+  _spool_bytes += rec_len;
+  if (is_channel) {
+    _spool_channel++;
+  } else {
+    _spool_direct++;
+  }
+  return true;
+}
+
+void OfflineQueue::refillFromSpool() {
+  if (getNumSpooled() == 0 || _ring_len >= OFFLINE_QUEUE_SIZE) return;
+
+  while (_num_segs > 1 && _spool_rd >= _seg_len[_rd_seg]) {   // skip any left empty by a failed write
+    removeOldestSegment();
+  }
+
+  Frame* dest = &_ring[(_head + _ring_len) % OFFLINE_QUEUE_SIZE];
+  uint8_t hdr[SPOOL_HDR_SIZE];
+  char name[16];
+  segName(name, _rd_seg);
+  File f = _store->openRead(_spool_fs, name);
+  bool success = f && f.seek(_spool_rd) && f.read(hdr, SPOOL_HDR_SIZE) == SPOOL_HDR_SIZE
+              && hdr[0] > 0 && hdr[0] <= MAX_FRAME_SIZE && f.read(dest->buf, hdr[0]) == hdr[0];
+  if (f) f.close();
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("OfflineQueue: spool read failed at segment %d, offset %d", _rd_seg, _spool_rd);
+    resetSpool();
+    return;
+  }
+  dest->len = hdr[0];
+  dest->is_channel = hdr[1];
+  _ring_len++;
+  _spool_rd += SPOOL_HDR_SIZE + hdr[0];
+  _spool_bytes -= SPOOL_HDR_SIZE + hdr[0];
+  if (dest->is_channel) {
+    _spool_channel--;
+  } else {
+    _spool_direct--;
+  }
+
+  if (getNumSpooled() == 0) {
+    resetSpool();   // drained, so start again from an empty segment
+  } else if (_num_segs > 1 && _spool_rd >= _seg_len[_rd_seg]) {
+    removeOldestSegment();
+  }
+}
+
+void OfflineQueue::resetSpool() {
+  // any frames still in the spool are lost
+  _num_direct -= _spool_direct;
+  _dropped_direct += _spool_direct;
+  _num_channel -= _spool_channel;
+  _dropped_channel += _spool_channel;
+  _spool_direct = _spool_channel = 0;
+
+  while (_num_segs > 0) removeOldestSegment();
+  _rd_seg = 0;
+  _spool_bytes = 0;
+}
+
+bool OfflineQueue::storeFrame(const uint8_t frame[], int len, bool is_channel) {
+  // new frames go to the ring only while nothing is waiting in the spool, to keep them in order
+  if (getNumSpooled() == 0 && _ring_len < OFFLINE_QUEUE_SIZE) {
+    pushRing(frame, len, is_channel);
+    return true;
+  }
+  return appendSpool(frame, len, is_channel);
+}
+
+bool OfflineQueue::add(const uint8_t frame[], int len, bool is_channel) {
+  if (len <= 0 || len > MAX_FRAME_SIZE) return false;
+
+  if (is_channel) {
+    if (_num_channel >= OFFLINE_MAX_CHANNEL_FRAMES && !removeOldestChannelMsg()) {
+      _dropped_channel++;
+      return false;
+    }
+  } else if (_num_direct >= OFFLINE_MAX_DIRECT_FRAMES) {
+    MESH_DEBUG_PRINTLN("OfflineQueue: direct quota reached, dropping frame");
+    _dropped_direct++;
+    return false;
+  }
+
+  bool success = storeFrame(frame, len, is_channel);
+  if (!success && removeOldestChannelMsg()) {   // out of space, so make room
+    success = storeFrame(frame, len, is_channel);
+  }
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("OfflineQueue: full, dropping frame");
+    if (is_channel) {
+      _dropped_channel++;
+    } else {
+      _dropped_direct++;
+    }
+    return false;
+  }
+  if (is_channel) {
+    _num_channel++;
+  } else {
+    _num_direct++;
+  }
+  return true;
+}
+
+int OfflineQueue::get(uint8_t frame[]) {
+  if (_ring_len == 0) return 0;  // queue is empty
+
+  Frame* f = &_ring[_head];
+  int len = f->len;
+  memcpy(frame, f->buf, len);
+  if (f->is_channel) {
+    _num_channel--;
+  } else {
+    _num_direct--;
+  }
+  _head = (_head + 1) % OFFLINE_QUEUE_SIZE;
+  _ring_len--;
+
+  refillFromSpool();
+  return len;
+}
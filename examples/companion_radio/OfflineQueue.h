@@ -0,0 +1,96 @@
+#pragma once
+
+#include <helpers/BaseSerialInterface.h>   // for MAX_FRAME_SIZE
+#include "DataStore.h"
+
+#ifndef OFFLINE_QUEUE_SIZE
+  #define OFFLINE_QUEUE_SIZE 16
+#endif
+
+#ifndef OFFLINE_SPOOL_MAX_BYTES
+  #if defined(ESP32) || defined(EXTRAFS) || defined(QSPIFLASH)
+    #define OFFLINE_SPOOL_MAX_BYTES  (128*1024)
+  #elif defined(RP2040_PLATFORM)
+    #define OFFLINE_SPOOL_MAX_BYTES  (64*1024)
+  #else
+    #define OFFLINE_SPOOL_MAX_BYTES  0     // internal flash too small, RAM queue only
+  #endif
+#endif
+
+#ifndef OFFLINE_SPOOL_SEGMENTS
+  #define OFFLINE_SPOOL_SEGMENTS   8     // spool is split across this many files
+#endif
+
+// per-class quotas, counting frames in both RAM and the spool
+#ifndef OFFLINE_MAX_DIRECT_FRAMES
+  #define OFFLINE_MAX_DIRECT_FRAMES   (OFFLINE_QUEUE_SIZE + OFFLINE_SPOOL_MAX_BYTES/48)
+#endif
+#ifndef OFFLINE_MAX_CHANNEL_FRAMES
+  #if OFFLINE_SPOOL_MAX_BYTES > 0
+    #define OFFLINE_MAX_CHANNEL_FRAMES  (OFFLINE_MAX_DIRECT_FRAMES*3/4)   // so a busy channel can't crowd out direct msgs
+  #else
+    #define OFFLINE_MAX_CHANNEL_FRAMES  OFFLINE_QUEUE_SIZE   // RAM only: oldest channel msg is evicted for a direct one instead
+  #endif
+#endif
+
+/**
+ * \brief  FIFO of frames waiting for the app to sync them (CMD_SYNC_NEXT_MESSAGE).
+ *     The oldest frames are held in a RAM ring buffer. Once that is full, newer frames are appended to a spool
+ *     in flash, and are read back into the ring (in order) as the app drains it. The spool is a ring of segment
+ *     files: frames are appended to the newest one, and the oldest is removed once it has all been read back,
+ *     so space is reclaimed without rewriting anything.
+ */
+class OfflineQueue {
+  struct Frame {
+    uint8_t len;
+    uint8_t is_channel;
+    uint8_t buf[MAX_FRAME_SIZE];
+  };
+
+  DataStore* _store;
+  FILESYSTEM* _spool_fs;
+  Frame _ring[OFFLINE_QUEUE_SIZE];
+  uint16_t _head, _ring_len;
+  uint16_t _num_direct, _num_channel;     // total, ie. ring + spool
+  uint16_t _spool_direct, _spool_channel;
+  uint8_t _rd_seg, _num_segs;        // oldest segment (the one being read back), and how many are in use
+  bool _wr_sealed;                   // newest segment takes no more appends (a write to it failed)
+  uint32_t _spool_rd;                // offset in oldest segment
+  uint32_t _spool_bytes;             // not yet read back, in all segments
+  uint32_t _seg_len[OFFLINE_SPOOL_SEGMENTS + 1];   // one spare, for the segment being read back
+  uint32_t _dropped_direct, _dropped_channel;
+
+  void pushRing(const uint8_t frame[], int len, bool is_channel);
+  bool removeOldestChannelMsg();
+  bool storeFrame(const uint8_t frame[], int len, bool is_channel);
+  bool appendSpool(const uint8_t frame[], int len, bool is_channel);
+  bool startSegment();
+  void removeOldestSegment();
+  void refillFromSpool();
+  void resetSpool();
+
+public:
+  OfflineQueue();
+
+  /**
+   * \brief  discards any spool left from before a reboot (the RAM part of the queue did not survive it)
+   */
+  void begin(DataStore* store);
+
+  /**
+   * \returns  false if frame was dropped (quota reached, or out of space)
+   */
+  bool add(const uint8_t frame[], int len, bool is_channel);
+
+  /**
+   * \returns  length of oldest frame (copied to 'frame'), or zero if queue is empty
+   */
+  int get(uint8_t frame[]);
+
+  int count() const { return _num_direct + _num_channel; }
+  int getNumDirect() const { return _num_direct; }
+  int getNumChannel() const { return _num_channel; }
+  int getNumSpooled() const { return _spool_direct + _spool_channel; }
+  uint32_t getDroppedDirect() const { return _dropped_direct; }
+  uint32_t getDroppedChannel() const { return _dropped_channel; }
+};
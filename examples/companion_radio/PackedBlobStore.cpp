@@ -0,0 +1,282 @@
+#include <Arduino.h>
+#include "PackedBlobStore.h"
+
+#if defined(ESP32)
+
+#include <Utils.h>
+
+#define BLOB_FILE          "/blobs"
+#define BLOB_FILE_NEW      "/blobs.new"
+
+#define BLOB_REC_MAGIC     0xB7
+#define BLOB_HDR_SIZE      (1 + PACKED_BLOB_KEY_SIZE + 1 + 1)   // magic, key, len, checksum
+
+#ifndef BLOB_COMPACT_MIN_DEAD
+  #define BLOB_COMPACT_MIN_DEAD   (8*1024)
+#endif
+
+static uint8_t calcChecksum(const uint8_t* key, const uint8_t* data, uint8_t len) {
+  uint8_t sum = len;
+  for (int i = 0; i < PACKED_BLOB_KEY_SIZE; i++) sum = (sum << 1 | sum >> 7) ^ key[i];
+  for (int i = 0; i < len; i++) sum = (sum << 1 | sum >> 7) ^ data[i];
+  return sum;
+}
+
+static void makeKey(uint8_t dest[], const uint8_t key[], int key_len) {
+  if (key_len > PACKED_BLOB_KEY_SIZE) key_len = PACKED_BLOB_KEY_SIZE; // just use first 8 bytes (prefix)
+  memset(dest, 0, PACKED_BLOB_KEY_SIZE);
+  memcpy(dest, key, key_len);
+}
+
+int PackedBlobStore::findEntry(const uint8_t* key) const {
+  for (int i = 0; i < _num_entries; i++) {
+    if (memcmp(_entries[i].key, key, PACKED_BLOB_KEY_SIZE) == 0) return i;
+  }
+  return -1;  // not found
+}
+
+void PackedBlobStore::removeEntry(int idx) {
+  _dead_bytes += BLOB_HDR_SIZE + _entries[idx].len;
+  _live_bytes -= BLOB_HDR_SIZE + _entries[idx].len;
+  _entries[idx] = _entries[--_num_entries];   // order of entries is not important
+}
+
+bool PackedBlobStore::appendRecord(const uint8_t* key, const uint8_t* data, uint8_t len, uint32_t& offset) {
+  File f = _fs->open(BLOB_FILE, "a");
+  if (!f) return false;
+  offset = f.size();
+
+  uint8_t hdr[BLOB_HDR_SIZE];
+  hdr[0] = BLOB_REC_MAGIC;
+  memcpy(&hdr[1], key, PACKED_BLOB_KEY_SIZE);
+  hdr[1 + PACKED_BLOB_KEY_SIZE] = len;
+  hdr[2 + PACKED_BLOB_KEY_SIZE] = calcChecksum(key, data, len);
+
+  bool success = f.write(hdr, BLOB_HDR_SIZE) == BLOB_HDR_SIZE;
+  success = success && (len == 0 || f.write(data, len) == len);
+  f.close();
+
+  if (!success) {
+    // file may now have a partial record at the end, which would stop loadFile() there. Rewrite it cleanly.
+    MESH_DEBUG_PRINTLN("PackedBlobStore: append failed, compacting");
+    compact();
+  }
+  return success;
+}
+
+bool PackedBlobStore::loadFile() {
+  _num_entries = 0;
+  _live_bytes = _dead_bytes = 0;
+
+  File f = _fs->open(BLOB_FILE, "r", false);
+  if (!f) return true;  // no blobs yet
+
+  bool clean = true;
+  uint32_t pos = 0;
+  uint32_t file_size = f.size();
+  uint8_t hdr[BLOB_HDR_SIZE];
+  uint8_t data[256];
+  while (pos < file_size) {
+    if (f.read(hdr, BLOB_HDR_SIZE) != BLOB_HDR_SIZE || hdr[0] != BLOB_REC_MAGIC) {
+      clean = false;
+      break;
+    }
+    uint8_t* key = &hdr[1];
+    uint8_t len = hdr[1 + PACKED_BLOB_KEY_SIZE];
+    if (f.read(data, len) != len || calcChecksum(key, data, len) != hdr[2 + PACKED_BLOB_KEY_SIZE]) {
+      clean = false;   // torn write at tail
+      break;
+    }
+
+    int idx = findEntry(key);
+    if (idx >= 0) removeEntry(idx);   // superseded by this record
+    if (len == 0) {
+      _dead_bytes += BLOB_HDR_SIZE;    // a tombstone
+    } else {
+      if (_num_entries >= MAX_PACKED_BLOBS) {
+        int oldest = 0;
+        for (int i = 1; i < _num_entries; i++) {
+          if (_entries[i].offset < _entries[oldest].offset) oldest = i;
+        }
+        removeEntry(oldest);
+      }
+      Entry* e = &_entries[_num_entries++];
+      memcpy(e->key, key, PACKED_BLOB_KEY_SIZE);
+      e->offset = pos;
+      e->len = len;
+      _live_bytes += BLOB_HDR_SIZE + len;
+    }
+    pos += BLOB_HDR_SIZE + len;
+  }
+  f.close();
+
+  if (!clean) {
+    MESH_DEBUG_PRINTLN("PackedBlobStore: bad record at offset %d, truncating", pos);
+    _dead_bytes += file_size - pos;
+  }
+  return clean;
+}
+
+void PackedBlobStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+
+  // recover from interrupted compact()
+  if (_fs->exists(BLOB_FILE_NEW)) {
+    if (_fs->exists(BLOB_FILE)) {
+      _fs->remove(BLOB_FILE_NEW);   // old file was never removed, so new one may be incomplete
+    } else {
+      _fs->rename(BLOB_FILE_NEW, BLOB_FILE);   // new file was complete, just not renamed
+    }
+  }
+  if (!loadFile()) {
+    compact();   // drop the partial tail, so appends start from a clean record boundary
+  }
+}
+
+void PackedBlobStore::importLegacyDir(const char* dir) {
+  char path[64];
+  uint8_t key[PACKED_BLOB_KEY_SIZE];
+  uint8_t buf[256];
+  int count = 0;
+
+  // NOTE: removing files while iterating a directory is not safe, so restart the listing after each one
+  while (true) {
+    File root = _fs->open(dir, "r", false);
+    if (!root) break;
+    File f = root.openNextFile();
+    root.close();
+    if (!f) break;
+
+    const char* name = f.name();
+    const char* sp = strrchr(name, '/');
+    if (sp) name = sp + 1;   // some cores return full path
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    bool imported = true;
+    if (!f.isDirectory() && strlen(name) == PACKED_BLOB_KEY_SIZE*2 && mesh::Utils::fromHex(key, PACKED_BLOB_KEY_SIZE, name)) {
+      int len = f.read(buf, 255);
+      if (len < 0 || (len > 0 && !put(key, PACKED_BLOB_KEY_SIZE, buf, len))) {
+        imported = false;
+      } else {
+        count++;
+      }
+    }
+    f.close();
+    if (!imported) {
+      // eg. file system full. Keep this file (and the rest), to retry on next boot
+      MESH_DEBUG_PRINTLN("PackedBlobStore: could not migrate %s", path);
+      break;
+    }
+    if (!_fs->remove(path)) break;   // avoid looping forever on the same file
+  }
+  if (count > 0) {
+    MESH_DEBUG_PRINTLN("PackedBlobStore: migrated %d blob files", count);
+  }
+}
+
+uint8_t PackedBlobStore::get(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  uint8_t k[PACKED_BLOB_KEY_SIZE];
+  makeKey(k, key, key_len);
+
+  int idx = findEntry(k);
+  if (idx < 0) return 0;  // not found
+
+  uint8_t len = 0;
+  File f = _fs->open(BLOB_FILE, "r", false);
+  if (f) {
+    if (f.seek(_entries[idx].offset + BLOB_HDR_SIZE) && f.read(dest_buf, _entries[idx].len) == _entries[idx].len) {
+      len = _entries[idx].len;
+    }
+    f.close();
+  }
+  return len;
+}
+
+bool PackedBlobStore::put(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
+  if (_fs == NULL || len == 0) return false;
+
+  uint8_t k[PACKED_BLOB_KEY_SIZE];
+  makeKey(k, key, key_len);
+
+  uint32_t offset;
+  if (!appendRecord(k, src_buf, len, offset)) return false;
+
+  int idx = findEntry(k);
+  if (idx >= 0) {
+    removeEntry(idx);   // previous version is now dead
+  } else if (_num_entries >= MAX_PACKED_BLOBS) {
+    int oldest = 0;   // map is full, so evict the least recently written
+    for (int i = 1; i < _num_entries; i++) {
+      if (_entries[i].offset < _entries[oldest].offset) oldest = i;
+    }
+    removeEntry(oldest);
+  }
+  Entry* e = &_entries[_num_entries++];
+  memcpy(e->key, k, PACKED_BLOB_KEY_SIZE);
+  e->offset = offset;
+  e->len = len;
+  _live_bytes += BLOB_HDR_SIZE + len;
+
+  checkCompact();
+  return true;
+}
+
+bool PackedBlobStore::remove(const uint8_t key[], int key_len) {
+  if (_fs == NULL) return false;
+
+  uint8_t k[PACKED_BLOB_KEY_SIZE];
+  makeKey(k, key, key_len);
+
+  int idx = findEntry(k);
+  if (idx < 0) return true;   // return true even if blob did not exist
+
+  uint32_t offset;
+  if (!appendRecord(k, NULL, 0, offset)) return false;  // write tombstone
+  removeEntry(idx);
+  _dead_bytes += BLOB_HDR_SIZE;
+
+  checkCompact();
+  return true;
+}
+
+void PackedBlobStore::checkCompact() {
+  if (_dead_bytes >= BLOB_COMPACT_MIN_DEAD && _dead_bytes > _live_bytes) {
+    compact();
+  }
+}
+
+bool PackedBlobStore::compact() {
+  File src = _fs->open(BLOB_FILE, "r", false);
+  File dest = _fs->open(BLOB_FILE_NEW, "w", true);
+  bool success = dest;
+
+  uint8_t rec[BLOB_HDR_SIZE + 256];
+  for (int i = 0; success && i < _num_entries; i++) {
+    int rec_len = BLOB_HDR_SIZE + _entries[i].len;
+    success = src && src.seek(_entries[i].offset) && src.read(rec, rec_len) == rec_len && rec[0] == BLOB_REC_MAGIC;
+    success = success && dest.write(rec, rec_len) == rec_len;
+  }
+  if (src) src.close();
+  if (dest) dest.close();
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("PackedBlobStore: compact failed");
+    _fs->remove(BLOB_FILE_NEW);
+    return false;
+  }
+
+  // NOTE: begin() resolves a crash between these two steps
+  _fs->remove(BLOB_FILE);
+  _fs->rename(BLOB_FILE_NEW, BLOB_FILE);
+
+  uint32_t pos = 0;
+  for (int i = 0; i < _num_entries; i++) {
+    _entries[i].offset = pos;
+    pos += BLOB_HDR_SIZE + _entries[i].len;
+  }
+  _live_bytes = pos;
+  _dead_bytes = 0;
+  return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#ifndef MAX_PACKED_BLOBS
+  #ifdef MAX_CONTACTS
+    #define MAX_PACKED_BLOBS  (MAX_CONTACTS + 16)
+  #else
+    #define MAX_PACKED_BLOBS  116
+  #endif
+#endif
+
+#define PACKED_BLOB_KEY_SIZE   8    // blobs are matched by 8 byte prefix of key
+
+/**
+ * \brief  Log-structured store of small blobs (eg. raw advert packets) in a single file.
+ *     New/updated blobs are appended as records, a RAM map tracks key -> record offset, and dead records
+ *     (superseded or deleted) are periodically reclaimed by rewriting just the live records to a new file.
+ */
+class PackedBlobStore {
+  struct Entry {
+    uint8_t  key[PACKED_BLOB_KEY_SIZE];
+    uint32_t offset;    // of record header, in file
+    uint8_t  len;
+  };
+
+  FILESYSTEM* _fs;
+  Entry _entries[MAX_PACKED_BLOBS];
+  int _num_entries;
+  uint32_t _live_bytes, _dead_bytes;
+
+  int findEntry(const uint8_t* key) const;
+  void removeEntry(int idx);
+  bool appendRecord(const uint8_t* key, const uint8_t* data, uint8_t len, uint32_t& offset);
+  bool loadFile();
+  void checkCompact();
+
+public:
+  PackedBlobStore() : _fs(NULL), _num_entries(0), _live_bytes(0), _dead_bytes(0) { }
+
+  /**
+   * \brief  loads the RAM map from the blob file, recovering from an interrupted compaction if needed.
+   */
+  void begin(FILESYSTEM* fs);
+
+  /**
+   * \brief  one-off migration of the legacy 'one file per blob' layout, ie. <dir>/<hex key>
+   */
+  void importLegacyDir(const char* dir);
+
+  uint8_t get(const uint8_t key[], int key_len, uint8_t dest_buf[]);
+  bool put(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len);
+  bool remove(const uint8_t key[], int key_len);
+
+  /**
+   * \brief  rewrites only the live records to a new file, then atomically replaces the old one.
+   */
+  bool compact();
+
+  int getNumBlobs() const { return _num_entries; }
+};
@@ -7,8 +7,10 @@ KissModem::KissModem(Stream& serial, mesh::LocalIdentity& identity, mesh::RNG& r
   _rx_len = 0;
   _rx_escaped = false;
   _rx_active = false;
-  _has_pending_tx = false;
-  _pending_tx_len = 0;
+  memset(_tx_queue, 0, sizeof(_tx_queue));
+  _tx_count = 0;
+  _tx_seq = 0;
+  _tx_current = nullptr;
   _txdelay = KISS_DEFAULT_TXDELAY;
   _persistence = KISS_DEFAULT_PERSISTENCE;
   _slottime = KISS_DEFAULT_SLOTTIME;
@@ -21,46 +23,66 @@ KissModem::KissModem(Stream& serial, mesh::LocalIdentity& identity, mesh::RNG& r
   _getCurrentRssiCallback = nullptr;
   _getStatsCallback = nullptr;
   _config = {0, 0, 0, 0, 0};
-  _signal_report_enabled = true;
+  _rx_report_mode = RX_REPORT_META;
+  _out_len = 0;
 }
 
 void KissModem::begin() {
   _rx_len = 0;
   _rx_escaped = false;
   _rx_active = false;
-  _has_pending_tx = false;
+  for (int i = 0; i < KISS_TX_QUEUE_SIZE; i++) _tx_queue[i].len = 0;
+  _tx_count = 0;
+  _tx_current = nullptr;
   _tx_state = TX_IDLE;
 }
 
-void KissModem::writeByte(uint8_t b) {
-  if (b == KISS_FEND) {
-    _serial.write(KISS_FESC);
-    _serial.write(KISS_TFEND);
-  } else if (b == KISS_FESC) {
-    _serial.write(KISS_FESC);
-    _serial.write(KISS_TFESC);
-  } else {
-    _serial.write(b);
+void KissModem::flushOut() {
+  if (_out_len > 0) {
+    _serial.write(_out_buf, _out_len);
+    _out_len = 0;
   }
 }
 
-void KissModem::writeFrame(uint8_t type, const uint8_t* data, uint16_t len) {
-  _serial.write(KISS_FEND);
-  writeByte(type);
+void KissModem::beginFrame(uint8_t type) {
+  _out_len = 0;
+  _out_buf[_out_len++] = KISS_FEND;
+  appendFrame(&type, 1);
+}
+
+void KissModem::appendFrame(const uint8_t* data, uint16_t len) {
   for (uint16_t i = 0; i < len; i++) {
-    writeByte(data[i]);
+    if (_out_len > KISS_OUT_BUF_SIZE - 3) flushOut();   // room for an escaped byte + closing FEND
+
+    uint8_t b = data[i];
+    if (b == KISS_FEND) {
+      _out_buf[_out_len++] = KISS_FESC;
+      _out_buf[_out_len++] = KISS_TFEND;
+    } else if (b == KISS_FESC) {
+      _out_buf[_out_len++] = KISS_FESC;
+      _out_buf[_out_len++] = KISS_TFESC;
+    } else {
+      _out_buf[_out_len++] = b;
+    }
   }
-  _serial.write(KISS_FEND);
+}
+
+void KissModem::endFrame() {
+  _out_buf[_out_len++] = KISS_FEND;
+  flushOut();
+}
+
+void KissModem::writeFrame(uint8_t type, const uint8_t* data, uint16_t len) {
+  beginFrame(type);
+  appendFrame(data, len);
+  endFrame();
 }
 
 void KissModem::writeHardwareFrame(uint8_t sub_cmd, const uint8_t* data, uint16_t len) {
-  _serial.write(KISS_FEND);
-  writeByte(KISS_CMD_SETHARDWARE);
-  writeByte(sub_cmd);
-  for (uint16_t i = 0; i < len; i++) {
-    writeByte(data[i]);
-  }
-  _serial.write(KISS_FEND);
+  beginFrame(KISS_CMD_SETHARDWARE);
+  appendFrame(&sub_cmd, 1);
+  appendFrame(data, len);
+  endFrame();
 }
 
 void KissModem::writeHardwareError(uint8_t error_code) {
@@ -118,20 +140,18 @@ void KissModem::processFrame() {
   uint8_t port = (type_byte >> 4) & 0x0F;
   uint8_t cmd = type_byte & 0x0F;
 
-  if (port != 0) return;
-
   const uint8_t* data = &_rx_buf[1];
   uint16_t data_len = _rx_len - 1;
 
-  switch (cmd) {
-    case KISS_CMD_DATA:
-      if (data_len > 0 && data_len <= KISS_MAX_PACKET_SIZE && !_has_pending_tx) {
-        memcpy(_pending_tx, data, data_len);
-        _pending_tx_len = data_len;
-        _has_pending_tx = true;
-      }
-      break;
+  if (cmd == KISS_CMD_DATA && port <= KISS_TX_MAX_PRIORITY) {
+    if (data_len > 0 && data_len <= KISS_MAX_PACKET_SIZE && !queueTx(data, data_len, port)) {
+      writeHardwareError(HW_ERR_TX_QUEUE_FULL);
+    }
+    return;
+  }
+  if (port != 0) return;
 
+  switch (cmd) {
     case KISS_CMD_TXDELAY:
       if (data_len >= 1) _txdelay = data[0];
       break;
@@ -172,16 +192,10 @@ void KissModem::handleHardwareCommand(uint8_t sub_cmd, const uint8_t* data, uint
       handleGetRandom(data, len);
       break;
     case HW_CMD_VERIFY_SIGNATURE:
-      handleVerifySignature(data, len);
-      break;
     case HW_CMD_SIGN_DATA:
-      handleSignData(data, len);
-      break;
     case HW_CMD_ENCRYPT_DATA:
-      handleEncryptData(data, len);
-      break;
     case HW_CMD_DECRYPT_DATA:
-      handleDecryptData(data, len);
+      handleCryptoOp(sub_cmd, data, len);
       break;
     case HW_CMD_KEY_EXCHANGE:
       handleKeyExchange(data, len);
@@ -223,7 +237,7 @@ void KissModem::handleHardwareCommand(uint8_t sub_cmd, const uint8_t* data, uint
       handleGetBattery();
       break;
     case HW_CMD_PING:
-      handlePing();
+      handlePing(data, len);
       break;
     case HW_CMD_GET_SENSORS:
       handleGetSensors(data, len);
@@ -243,16 +257,48 @@ void KissModem::handleHardwareCommand(uint8_t sub_cmd, const uint8_t* data, uint
     case HW_CMD_GET_SIGNAL_REPORT:
       handleGetSignalReport();
       break;
+    case HW_CMD_BATCH:
+      handleBatch(data, len);
+      break;
     default:
       writeHardwareError(HW_ERR_UNKNOWN_CMD);
       break;
   }
 }
 
+bool KissModem::queueTx(const uint8_t* data, uint16_t len, uint8_t priority) {
+  for (int i = 0; i < KISS_TX_QUEUE_SIZE; i++) {
+    TxSlot* slot = &_tx_queue[i];
+    if (slot->len == 0) {
+      memcpy(slot->data, data, len);
+      slot->len = len;
+      slot->priority = priority;
+      slot->seq = _tx_seq++;
+      _tx_count++;
+      return true;
+    }
+  }
+  return false;
+}
+
+KissModem::TxSlot* KissModem::nextTx() {
+  TxSlot* best = nullptr;
+  for (int i = 0; i < KISS_TX_QUEUE_SIZE; i++) {
+    TxSlot* slot = &_tx_queue[i];
+    if (slot->len == 0) continue;
+    if (best == nullptr || slot->priority > best->priority
+        || (slot->priority == best->priority && (int32_t)(slot->seq - best->seq) < 0)) {
+      best = slot;
+    }
+  }
+  return best;
+}
+
 void KissModem::processTx() {
   switch (_tx_state) {
     case TX_IDLE:
-      if (_has_pending_tx) {
+      _tx_current = nextTx();
+      if (_tx_current) {
         if (_fullduplex) {
           _tx_timer = millis();
           _tx_state = TX_DELAY;
@@ -284,7 +330,8 @@ void KissModem::processTx() {
 
     case TX_DELAY:
       if (millis() - _tx_timer >= (uint32_t)_txdelay * 10) {
-        _radio.startSendRaw(_pending_tx, _pending_tx_len);
+        _tx_current = nextTx();   // in case a higher priority frame arrived during CSMA
+        _radio.startSendRaw(_tx_current->data, _tx_current->len);
         _tx_state = TX_SENDING;
       }
       break;
@@ -292,9 +339,15 @@ void KissModem::processTx() {
     case TX_SENDING:
       if (_radio.isSendComplete()) {
         _radio.onSendFinished();
-        uint8_t result = 0x01;
-        writeHardwareFrame(HW_RESP_TX_DONE, &result, 1);
-        _has_pending_tx = false;
+        _tx_current->len = 0;   // free the slot
+        _tx_current = nullptr;
+        _tx_count--;
+
+        uint8_t resp[3];
+        resp[0] = 0x01;                  // result
+        resp[1] = _tx_count;             // still queued, so host can keep the queue full
+        resp[2] = KISS_TX_QUEUE_SIZE;
+        writeHardwareFrame(HW_RESP_TX_DONE, resp, 3);
         _tx_state = TX_IDLE;
       }
       break;
@@ -302,8 +355,23 @@ void KissModem::processTx() {
 }
 
 void KissModem::onPacketReceived(int8_t snr, int8_t rssi, const uint8_t* packet, uint16_t len) {
+  if (_rx_report_mode == RX_REPORT_COMBINED) {
+    uint32_t now = millis();
+    uint8_t meta[7];
+    meta[0] = HW_RESP_RX_PACKET;
+    meta[1] = (uint8_t)snr;
+    meta[2] = (uint8_t)rssi;
+    memcpy(&meta[3], &now, 4);
+
+    beginFrame(KISS_CMD_SETHARDWARE);
+    appendFrame(meta, sizeof(meta));
+    appendFrame(packet, len);
+    endFrame();
+    return;
+  }
+
   writeFrame(KISS_CMD_DATA, packet, len);
-  if (_signal_report_enabled) {
+  if (_rx_report_mode == RX_REPORT_META) {
     uint8_t meta[2] = { (uint8_t)snr, (uint8_t)rssi };
     writeHardwareFrame(HW_RESP_RX_META, meta, 2);
   }
@@ -330,70 +398,128 @@ void KissModem::handleGetRandom(const uint8_t* data, uint16_t len) {
   writeHardwareFrame(HW_RESP(HW_CMD_GET_RANDOM), buf, requested);
 }
 
-void KissModem::handleVerifySignature(const uint8_t* data, uint16_t len) {
-  if (len < PUB_KEY_SIZE + SIGNATURE_SIZE + 1) {
-    writeHardwareError(HW_ERR_INVALID_LENGTH);
-    return;
-  }
+int KissModem::cryptoOp(uint8_t sub_cmd, const uint8_t* data, uint16_t len, uint8_t* out) {
+  switch (sub_cmd) {
+    case HW_CMD_VERIFY_SIGNATURE: {
+      if (len < PUB_KEY_SIZE + SIGNATURE_SIZE + 1) return -HW_ERR_INVALID_LENGTH;
+
+      mesh::Identity signer(data);
+      const uint8_t* signature = data + PUB_KEY_SIZE;
+      const uint8_t* msg = data + PUB_KEY_SIZE + SIGNATURE_SIZE;
+      uint16_t msg_len = len - PUB_KEY_SIZE - SIGNATURE_SIZE;
+
+      out[0] = signer.verify(signature, msg, msg_len) ? 0x01 : 0x00;
+      return 1;
+    }
+    case HW_CMD_VERIFY_SIGNATURE | HW_BATCH_SIGNER_IN_MSG: {   // Batch only
+      if (len < SIGNATURE_SIZE + PUB_KEY_SIZE) return -HW_ERR_INVALID_LENGTH;
+
+      mesh::Identity signer(data + SIGNATURE_SIZE);
+      out[0] = signer.verify(data, data + SIGNATURE_SIZE, len - SIGNATURE_SIZE) ? 0x01 : 0x00;
+      return 1;
+    }
+    case HW_CMD_SIGN_DATA:
+      if (len < 1) return -HW_ERR_INVALID_LENGTH;
 
-  mesh::Identity signer(data);
-  const uint8_t* signature = data + PUB_KEY_SIZE;
-  const uint8_t* msg = data + PUB_KEY_SIZE + SIGNATURE_SIZE;
-  uint16_t msg_len = len - PUB_KEY_SIZE - SIGNATURE_SIZE;
+      _identity.sign(out, data, len);
+      return SIGNATURE_SIZE;
 
-  uint8_t result = signer.verify(signature, msg, msg_len) ? 0x01 : 0x00;
-  writeHardwareFrame(HW_RESP(HW_CMD_VERIFY_SIGNATURE), &result, 1);
+    case HW_CMD_ENCRYPT_DATA: {
+      if (len < PUB_KEY_SIZE + 1) return -HW_ERR_INVALID_LENGTH;
+
+      int encrypted_len = mesh::Utils::encryptThenMAC(data, out, data + PUB_KEY_SIZE, len - PUB_KEY_SIZE);
+      return encrypted_len > 0 ? encrypted_len : -HW_ERR_ENCRYPT_FAILED;
+    }
+    case HW_CMD_DECRYPT_DATA: {
+      if (len < PUB_KEY_SIZE + CIPHER_MAC_SIZE + 1) return -HW_ERR_INVALID_LENGTH;
+
+      int decrypted_len = mesh::Utils::MACThenDecrypt(data, out, data + PUB_KEY_SIZE, len - PUB_KEY_SIZE);
+      return decrypted_len > 0 ? decrypted_len : -HW_ERR_MAC_FAILED;
+    }
+    default:
+      return -HW_ERR_UNKNOWN_CMD;
+  }
 }
 
-void KissModem::handleSignData(const uint8_t* data, uint16_t len) {
-  if (len < 1) {
-    writeHardwareError(HW_ERR_INVALID_LENGTH);
-    return;
+/* largest result cryptoOp() can give for an item of 'len' bytes, or 0 if it can only fail */
+static uint16_t maxCryptoResult(uint8_t sub_cmd, uint16_t len) {
+  switch (sub_cmd) {
+    case HW_CMD_VERIFY_SIGNATURE:
+    case HW_CMD_VERIFY_SIGNATURE | HW_BATCH_SIGNER_IN_MSG:
+      return 1;
+    case HW_CMD_SIGN_DATA:
+      return SIGNATURE_SIZE;
+    case HW_CMD_ENCRYPT_DATA:   // plaintext padded to a whole block, plus MAC
+      if (len <= PUB_KEY_SIZE) return 0;
+      return CIPHER_MAC_SIZE + (len - PUB_KEY_SIZE + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE * CIPHER_BLOCK_SIZE;
+    case HW_CMD_DECRYPT_DATA:
+      return len > PUB_KEY_SIZE + CIPHER_MAC_SIZE ? len - PUB_KEY_SIZE - CIPHER_MAC_SIZE : 0;
+    default:
+      return 0;
   }
+}
 
-  uint8_t signature[SIGNATURE_SIZE];
-  _identity.sign(signature, data, len);
-  writeHardwareFrame(HW_RESP(HW_CMD_SIGN_DATA), signature, SIGNATURE_SIZE);
+void KissModem::handleCryptoOp(uint8_t sub_cmd, const uint8_t* data, uint16_t len) {
+  int result_len = cryptoOp(sub_cmd, data, len, _crypto_buf);
+  if (result_len >= 0) {
+    writeHardwareFrame(HW_RESP(sub_cmd), _crypto_buf, result_len);
+  } else {
+    writeHardwareError(-result_len);
+  }
 }
 
-void KissModem::handleEncryptData(const uint8_t* data, uint16_t len) {
-  if (len < PUB_KEY_SIZE + 1) {
+void KissModem::handleBatch(const uint8_t* data, uint16_t len) {
+  if (len < 2) {
     writeHardwareError(HW_ERR_INVALID_LENGTH);
     return;
   }
-
-  const uint8_t* key = data;
-  const uint8_t* plaintext = data + PUB_KEY_SIZE;
-  uint16_t plaintext_len = len - PUB_KEY_SIZE;
-
-  uint8_t buf[KISS_MAX_FRAME_SIZE];
-  int encrypted_len = mesh::Utils::encryptThenMAC(key, buf, plaintext, plaintext_len);
-
-  if (encrypted_len > 0) {
-    writeHardwareFrame(HW_RESP(HW_CMD_ENCRYPT_DATA), buf, encrypted_len);
-  } else {
-    writeHardwareError(HW_ERR_ENCRYPT_FAILED);
+  uint8_t sub_cmd = data[0];
+  uint8_t count = data[1];
+  if (sub_cmd != HW_CMD_VERIFY_SIGNATURE && sub_cmd != (HW_CMD_VERIFY_SIGNATURE | HW_BATCH_SIGNER_IN_MSG)
+      && sub_cmd != HW_CMD_SIGN_DATA && sub_cmd != HW_CMD_ENCRYPT_DATA && sub_cmd != HW_CMD_DECRYPT_DATA) {
+    writeHardwareError(HW_ERR_INVALID_PARAM);
+    return;
   }
-}
 
-void KissModem::handleDecryptData(const uint8_t* data, uint16_t len) {
-  if (len < PUB_KEY_SIZE + CIPHER_MAC_SIZE + 1) {
+  // check all items are there, and that the response will fit in a frame, before any response is written:
+  // type, response code, sub-command and count, then per item status, length and the largest result
+  uint32_t ofs = 2;
+  uint32_t resp_len = 1 + 3;
+  int n = 0;
+  while (n < count && ofs + 2 <= len) {
+    uint16_t item_len = data[ofs] | (data[ofs + 1] << 8);
+    ofs += 2 + item_len;
+    if (ofs <= len) resp_len += 3 + maxCryptoResult(sub_cmd, item_len);
+    n++;
+  }
+  if (count == 0 || n != count || ofs != len || resp_len > KISS_MAX_FRAME_SIZE) {
     writeHardwareError(HW_ERR_INVALID_LENGTH);
     return;
   }
 
-  const uint8_t* key = data;
-  const uint8_t* ciphertext = data + PUB_KEY_SIZE;
-  uint16_t ciphertext_len = len - PUB_KEY_SIZE;
+  uint8_t hdr[3] = { HW_RESP(HW_CMD_BATCH), sub_cmd, count };
+  beginFrame(KISS_CMD_SETHARDWARE);
+  appendFrame(hdr, 3);
 
-  uint8_t buf[KISS_MAX_FRAME_SIZE];
-  int decrypted_len = mesh::Utils::MACThenDecrypt(key, buf, ciphertext, ciphertext_len);
+  ofs = 2;
+  for (int i = 0; i < count; i++) {
+    uint16_t item_len = data[ofs] | (data[ofs + 1] << 8);
+    int result_len = cryptoOp(sub_cmd, &data[ofs + 2], item_len, _crypto_buf);
+    ofs += 2 + item_len;
 
-  if (decrypted_len > 0) {
-    writeHardwareFrame(HW_RESP(HW_CMD_DECRYPT_DATA), buf, decrypted_len);
-  } else {
-    writeHardwareError(HW_ERR_MAC_FAILED);
+    uint8_t item_hdr[3];
+    if (result_len >= 0) {
+      item_hdr[0] = 0;   // OK
+    } else {
+      item_hdr[0] = -result_len;   // HW_ERR_*
+      result_len = 0;
+    }
+    item_hdr[1] = result_len & 0xFF;
+    item_hdr[2] = result_len >> 8;
+    appendFrame(item_hdr, 3);
+    appendFrame(_crypto_buf, result_len);
   }
+  endFrame();
 }
 
 void KissModem::handleKeyExchange(const uint8_t* data, uint16_t len) {
@@ -524,8 +650,8 @@ void KissModem::handleGetBattery() {
   writeHardwareFrame(HW_RESP(HW_CMD_GET_BATTERY), (uint8_t*)&mv, 2);
 }
 
-void KissModem::handlePing() {
-  writeHardwareFrame(HW_RESP(HW_CMD_PING), nullptr, 0);
+void KissModem::handlePing(const uint8_t* data, uint16_t len) {
+  writeHardwareFrame(HW_RESP(HW_CMD_PING), data, len);   // echo, so host can time round trips of any size
 }
 
 void KissModem::handleGetSensors(const uint8_t* data, uint16_t len) {
@@ -570,12 +696,14 @@ void KissModem::handleSetSignalReport(const uint8_t* data, uint16_t len) {
     writeHardwareError(HW_ERR_INVALID_LENGTH);
     return;
   }
-  _signal_report_enabled = (data[0] != 0x00);
-  uint8_t val = _signal_report_enabled ? 0x01 : 0x00;
-  writeHardwareFrame(HW_RESP(HW_CMD_GET_SIGNAL_REPORT), &val, 1);
+  if (data[0] == RX_REPORT_COMBINED) {
+    _rx_report_mode = RX_REPORT_COMBINED;
+  } else {
+    _rx_report_mode = data[0] != 0x00 ? RX_REPORT_META : RX_REPORT_OFF;
+  }
+  writeHardwareFrame(HW_RESP(HW_CMD_GET_SIGNAL_REPORT), &_rx_report_mode, 1);
 }
 
 void KissModem::handleGetSignalReport() {
-  uint8_t val = _signal_report_enabled ? 0x01 : 0x00;
-  writeHardwareFrame(HW_RESP(HW_CMD_GET_SIGNAL_REPORT), &val, 1);
+  writeHardwareFrame(HW_RESP(HW_CMD_GET_SIGNAL_REPORT), &_rx_report_mode, 1);
 }
@@ -11,9 +11,24 @@
 #define KISS_TFEND 0xDC
 #define KISS_TFESC 0xDD
 
-#define KISS_MAX_FRAME_SIZE  512
+/* Unescaped frame size limit, both ways, so also the limit on one Batch request and on its response */
+#ifndef KISS_MAX_FRAME_SIZE
+  #if defined(ESP32)
+    #define KISS_MAX_FRAME_SIZE  2048
+  #elif defined(NRF52_PLATFORM)
+    #define KISS_MAX_FRAME_SIZE  1024
+  #else
+    #define KISS_MAX_FRAME_SIZE  512
+  #endif
+#endif
 #define KISS_MAX_PACKET_SIZE 255
 
+/* Encoded output buffer: worst case is every byte escaped.  Longer frames are written in several chunks. */
+#define KISS_OUT_BUF_SIZE    (2 + 2 * (KISS_MAX_PACKET_SIZE + 8))
+
+/* largest result of one crypto op: encrypted data is padded to a block, plus MAC */
+#define KISS_CRYPTO_OUT_SIZE (KISS_MAX_FRAME_SIZE + CIPHER_BLOCK_SIZE + CIPHER_MAC_SIZE)
+
 #define KISS_CMD_DATA        0x00
 #define KISS_CMD_TXDELAY     0x01
 #define KISS_CMD_PERSISTENCE 0x02
@@ -27,6 +42,12 @@
 #define KISS_DEFAULT_PERSISTENCE 63
 #define KISS_DEFAULT_SLOTTIME    10
 
+/* Data frames queued for TX.  Port nibble of a Data frame is its priority: 0 = normal, 1 = high. */
+#ifndef KISS_TX_QUEUE_SIZE
+  #define KISS_TX_QUEUE_SIZE     8
+#endif
+#define KISS_TX_MAX_PRIORITY     1
+
 #define HW_CMD_GET_IDENTITY      0x01
 #define HW_CMD_GET_RANDOM        0x02
 #define HW_CMD_VERIFY_SIGNATURE  0x03
@@ -53,6 +74,11 @@
 #define HW_CMD_REBOOT            0x18
 #define HW_CMD_SET_SIGNAL_REPORT 0x19
 #define HW_CMD_GET_SIGNAL_REPORT 0x1A
+#define HW_CMD_BATCH             0x1B   // several Verify/Sign/Encrypt/Decrypt items in one frame
+
+/* Batch sub-command flag, for VerifySignature only: items are Signature + Message, and the signer's public key
+   is the first 32 bytes of Message, as in adverts */
+#define HW_BATCH_SIGNER_IN_MSG   0x40
 
 /* Response code = command code | 0x80.  Generic / unsolicited use 0xF0+. */
 #define HW_RESP(cmd)             ((cmd) | 0x80)
@@ -64,6 +90,12 @@
 /* Unsolicited notifications (no corresponding request) */
 #define HW_RESP_TX_DONE          0xF8
 #define HW_RESP_RX_META          0xF9
+#define HW_RESP_RX_PACKET        0xFA
+
+/* SetSignalReport modes */
+#define RX_REPORT_OFF            0x00
+#define RX_REPORT_META           0x01   // Data frame, then RxMeta
+#define RX_REPORT_COMBINED       0x02   // single RxPacket frame, with metadata inline
 
 #define HW_ERR_INVALID_LENGTH    0x01
 #define HW_ERR_INVALID_PARAM     0x02
@@ -71,6 +103,7 @@
 #define HW_ERR_MAC_FAILED        0x04
 #define HW_ERR_UNKNOWN_CMD       0x05
 #define HW_ERR_ENCRYPT_FAILED    0x06
+#define HW_ERR_TX_QUEUE_FULL     0x07
 
 #define KISS_FIRMWARE_VERSION 1
 
@@ -108,9 +141,16 @@ class KissModem {
   bool _rx_escaped;
   bool _rx_active;
 
-  uint8_t _pending_tx[KISS_MAX_PACKET_SIZE];
-  uint16_t _pending_tx_len;
-  bool _has_pending_tx;
+  struct TxSlot {
+    uint8_t data[KISS_MAX_PACKET_SIZE];
+    uint8_t len;       // 0 if slot is free
+    uint8_t priority;
+    uint32_t seq;      // FIFO order, within a priority
+  };
+  TxSlot _tx_queue[KISS_TX_QUEUE_SIZE];
+  int _tx_count;
+  uint32_t _tx_seq;
+  TxSlot* _tx_current;   // being sent (or waiting for CSMA)
 
   uint8_t _txdelay;
   uint8_t _persistence;
@@ -127,22 +167,30 @@ class KissModem {
   GetStatsCallback _getStatsCallback;
 
   RadioConfig _config;
-  bool _signal_report_enabled;
+  uint8_t _rx_report_mode;
+
+  uint8_t _out_buf[KISS_OUT_BUF_SIZE];
+  uint16_t _out_len;
+  uint8_t _crypto_buf[KISS_CRYPTO_OUT_SIZE];   // result of one crypto op, kept off the stack
 
-  void writeByte(uint8_t b);
+  void beginFrame(uint8_t type);
+  void appendFrame(const uint8_t* data, uint16_t len);
+  void endFrame();
+  void flushOut();
   void writeFrame(uint8_t type, const uint8_t* data, uint16_t len);
   void writeHardwareFrame(uint8_t sub_cmd, const uint8_t* data, uint16_t len);
   void writeHardwareError(uint8_t error_code);
   void processFrame();
   void handleHardwareCommand(uint8_t sub_cmd, const uint8_t* data, uint16_t len);
   void processTx();
+  bool queueTx(const uint8_t* data, uint16_t len, uint8_t priority);
+  TxSlot* nextTx();
 
   void handleGetIdentity();
   void handleGetRandom(const uint8_t* data, uint16_t len);
-  void handleVerifySignature(const uint8_t* data, uint16_t len);
-  void handleSignData(const uint8_t* data, uint16_t len);
-  void handleEncryptData(const uint8_t* data, uint16_t len);
-  void handleDecryptData(const uint8_t* data, uint16_t len);
+  int cryptoOp(uint8_t sub_cmd, const uint8_t* data, uint16_t len, uint8_t* out);
+  void handleCryptoOp(uint8_t sub_cmd, const uint8_t* data, uint16_t len);
+  void handleBatch(const uint8_t* data, uint16_t len);
   void handleKeyExchange(const uint8_t* data, uint16_t len);
   void handleHash(const uint8_t* data, uint16_t len);
   void handleSetRadio(const uint8_t* data, uint16_t len);
@@ -156,7 +204,7 @@ class KissModem {
   void handleGetNoiseFloor();
   void handleGetStats();
   void handleGetBattery();
-  void handlePing();
+  void handlePing(const uint8_t* data, uint16_t len);
   void handleGetSensors(const uint8_t* data, uint16_t len);
   void handleGetMCUTemp();
   void handleReboot();
@@ -178,6 +226,7 @@ public:
 
   void onPacketReceived(int8_t snr, int8_t rssi, const uint8_t* packet, uint16_t len);
   bool isTxBusy() const { return _tx_state != TX_IDLE; }
+  int getTxQueueDepth() const { return _tx_count; }
   /** True only when radio is actually transmitting; use to skip recvRaw in main loop. */
   bool isActuallyTransmitting() const { return _tx_state == TX_SENDING; }
 };
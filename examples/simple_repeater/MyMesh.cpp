@@ -41,7 +41,7 @@
   #define TXT_ACK_DELAY 200
 #endif
 
-#define FIRMWARE_VER_LEVEL       2
+#define FIRMWARE_VER_LEVEL       3
 
 #define REQ_TYPE_GET_STATUS         0x01 // same as _GET_STATS
 #define REQ_TYPE_KEEP_ALIVE         0x02
@@ -50,6 +50,13 @@
 #define REQ_TYPE_GET_NEIGHBOURS     0x06
 #define REQ_TYPE_GET_OWNER_INFO     0x07     // FIRMWARE_VER_LEVEL >= 2
 
+// REQ_FLAG_MULTIPART, REQ_TYPE_MULTIPART_ACK                               // FIRMWARE_VER_LEVEL >= 3
+
+#define NEIGHBOURS_FORMAT_COMPACT   1        // GET_NEIGHBOURS request_version, FIRMWARE_VER_LEVEL >= 3
+#define ACL_FORMAT_COMPACT          1        // GET_ACCESS_LIST first param, FIRMWARE_VER_LEVEL >= 3
+
+#define MAX_SINGLE_REPLY_LEN  (MAX_PACKET_PAYLOAD - CIPHER_MAC_SIZE - (CIPHER_BLOCK_SIZE-1))   // most createDatagram() can take
+
 #define RESP_SERVER_LOGIN_OK        0 // response to ANON_REQ
 
 #define ANON_REQ_TYPE_REGIONS      0x01
@@ -158,7 +165,7 @@ uint8_t MyMesh::handleAnonRegionsReq(const mesh::Identity& sender, uint32_t send
     uint32_t now = getRTCClock()->getCurrentTime();
     memcpy(&reply_data[4], &now, 4);     // include our clock (for easy clock sync, and packet hash uniqueness)
 
-    return 8 + region_map.exportNamesTo((char *) &reply_data[8], sizeof(reply_data) - 12, REGION_DENY_FLOOD);   // reply length
+    return 8 + region_map.exportNamesTo((char *) &reply_data[8], MAX_PACKET_PAYLOAD - 12, REGION_DENY_FLOOD);   // reply length
   }
   return 0;
 }
@@ -201,6 +208,8 @@ uint8_t MyMesh::handleAnonClockReq(const mesh::Identity& sender, uint32_t sender
     reply_data[8] |= 0x01;  // is bridge, type UART
 #elif WITH_ESPNOW_BRIDGE
     reply_data[8] |= 0x03;  // is bridge, type ESP-NOW
+#elif WITH_UDP_BRIDGE
+    reply_data[8] |= 0x05;  // is bridge, type UDP
 #endif
     if (_prefs.disable_fwd) {   // is this repeater currently disabled
       reply_data[8] |= 0x80;  // is disabled
@@ -211,7 +220,7 @@ uint8_t MyMesh::handleAnonClockReq(const mesh::Identity& sender, uint32_t sender
   return 0;
 }
 
-int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t *payload, size_t payload_len) {
+int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t *payload, size_t payload_len, int reply_max) {
   // uint32_t now = getRTCClock()->getCurrentTimeUnique();
   // memcpy(reply_data, &now, 4);   // response packets always prefixed with timestamp
   memcpy(reply_data, &sender_timestamp, 4); // reflect sender_timestamp back in response packet (kind of like a 'tag')
@@ -266,8 +275,8 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
     uint8_t res1 = payload[1];   // reserved for future  (extra query params)
     uint8_t res2 = payload[2];
     if (res1 == 0 && res2 == 0) {
-      uint8_t ofs = 4;
-      for (int i = 0; i < acl.getNumClients() && ofs + 7 <= sizeof(reply_data) - 4; i++) {
+      int ofs = 4;
+      for (int i = 0; i < acl.getNumClients() && ofs + 7 <= reply_max - 4; i++) {
         auto c = acl.getClientByIdx(i);
         if (c->permissions == 0) continue;  // skip deleted entries
         memcpy(&reply_data[ofs], c->id.pub_key, 6); ofs += 6;  // just 6-byte pub_key prefix
@@ -275,10 +284,14 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       }
       return ofs;
     }
+    if (res1 == ACL_FORMAT_COMPACT) {
+      int prefix_len = (res2 == 0 || res2 > PUB_KEY_SIZE) ? 6 : res2;
+      return 4 + acl.exportCompact(&reply_data[4], reply_max - 4, prefix_len);
+    }
   }
   if (payload[0] == REQ_TYPE_GET_NEIGHBOURS) {
     uint8_t request_version = payload[1];
-    if (request_version == 0) {
+    if (request_version == 0 || request_version == NEIGHBOURS_FORMAT_COMPACT) {
 
       // reply data offset (after response sender_timestamp/tag)
       int reply_offset = 4;
@@ -339,15 +352,19 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       }
 #endif
 
-      // build results buffer
+      // build results, after the two counts
       int results_count = 0;
       int results_offset = 0;
-      uint8_t results_buffer[130];
+      uint8_t* results_buffer = &reply_data[reply_offset + 4];
+      int results_max = reply_max > MAX_SINGLE_REPLY_LEN ? reply_max - (reply_offset + 4) : 130;
+      if (request_version == NEIGHBOURS_FORMAT_COMPACT) results_max = reply_max - (reply_offset + 4);
+      CompactWriter compact(results_buffer, results_max);
+      int32_t prev_secs_ago = 0;
       for(int index = 0; index < count && index + offset < neighbours_count; index++){
         
         // stop if we can't fit another entry in results
         int entry_size = pubkey_prefix_length + 4 + 1;
-        if(results_offset + entry_size > sizeof(results_buffer)){
+        if(request_version == 0 && results_offset + entry_size > results_max){
           MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS no more entries can fit in results buffer");
           break;
         }
@@ -356,9 +373,24 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
         // add next neighbour to results
         auto neighbour = sorted_neighbours[index + offset];
         uint32_t heard_seconds_ago = getRTCClock()->getCurrentTime() - neighbour->heard_timestamp;
-        memcpy(&results_buffer[results_offset], neighbour->id.pub_key, pubkey_prefix_length); results_offset += pubkey_prefix_length;
-        memcpy(&results_buffer[results_offset], &heard_seconds_ago, 4); results_offset += 4;
-        memcpy(&results_buffer[results_offset], &neighbour->snr, 1); results_offset += 1;
+        if (request_version == NEIGHBOURS_FORMAT_COMPACT) {
+          // heard_seconds_ago as signed delta from previous entry (small, when sorted by time), snr as-is
+          int mark = compact.mark();
+          compact.putBytes(neighbour->id.pub_key, pubkey_prefix_length);
+          compact.putSigned((int32_t)heard_seconds_ago - prev_secs_ago);
+          compact.putByte(neighbour->snr);
+          if (compact.hasOverflow()) {
+            compact.rewind(mark);
+            MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS no more entries can fit in results buffer");
+            break;
+          }
+          prev_secs_ago = heard_seconds_ago;
+          results_offset = compact.getLength();
+        } else {
+          memcpy(&results_buffer[results_offset], neighbour->id.pub_key, pubkey_prefix_length); results_offset += pubkey_prefix_length;
+          memcpy(&results_buffer[results_offset], &heard_seconds_ago, 4); results_offset += 4;
+          memcpy(&results_buffer[results_offset], &neighbour->snr, 1); results_offset += 1;
+        }
         results_count++;
 #endif
 
@@ -368,7 +400,7 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS neighbours_count=%d results_count=%d", neighbours_count, results_count);
       memcpy(&reply_data[reply_offset], &neighbours_count, 2); reply_offset += 2;
       memcpy(&reply_data[reply_offset], &results_count, 2); reply_offset += 2;
-      memcpy(&reply_data[reply_offset], &results_buffer, results_offset); reply_offset += results_offset;
+      reply_offset += results_offset;   // already in place
 
       return reply_offset;
     }
@@ -599,6 +631,42 @@ void MyMesh::onAdvertRecv(mesh::Packet *packet, const mesh::Identity &id, uint32
   }
 }
 
+void MyMesh::sendReplyFragments(ClientInfo* client, const uint8_t* secret, MultipartSession* s, uint16_t send_mask, uint8_t path_hash_size) {
+  uint8_t frag[MAX_PACKET_PAYLOAD];
+  for (int i = 0; i < s->count; i++) {
+    if ((send_mask & (1 << i)) == 0) continue;
+
+    int frag_len = multipart.writeFragment(s, i, frag);
+    mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, client->id, secret, frag, frag_len);
+    if (reply == NULL) break;   // pool empty, rest will be asked for again
+    if (client->out_path_len != OUT_PATH_UNKNOWN) {
+      sendDirect(reply, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
+    } else {
+      sendFlood(reply, SERVER_RESPONSE_DELAY, path_hash_size);
+    }
+  }
+}
+
+void MyMesh::handleMultipartAck(ClientInfo* client, const uint8_t* secret, const uint8_t* data, int len, uint8_t path_hash_size) {
+  if (len < 6) return;
+
+  uint32_t tag;
+  uint16_t recv_mask;
+  memcpy(&tag, data, 4);
+  memcpy(&recv_mask, &data[4], 2);
+
+  MultipartSession* s = multipart.findSession(tag, client->id.pub_key, true);
+  if (s == NULL) return;   // expired, or already complete
+
+  uint16_t missing = multipart.applyAck(s, recv_mask);
+  if (missing == 0) {
+    multipart.release(s);   // requester has it all, free the pool packets now
+  } else {
+    MESH_DEBUG_PRINTLN("handleMultipartAck: resending mask=%04X", (uint32_t)missing);
+    sendReplyFragments(client, secret, s, missing, path_hash_size);
+  }
+}
+
 void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx, const uint8_t *secret,
                             uint8_t *data, size_t len) {
   int i = matching_peer_indexes[sender_idx];
@@ -613,12 +681,34 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
     memcpy(&timestamp, data, 4);
 
     if (timestamp > client->last_timestamp) { // prevent replay attacks
-      int reply_len = handleRequest(client, timestamp, &data[4], len - 4);
+      if (data[4] == REQ_TYPE_MULTIPART_ACK) {
+        client->last_timestamp = timestamp;
+        handleMultipartAck(client, secret, &data[5], len - 5, packet->getPathHashSize());
+        return;
+      }
+      bool is_multipart = (data[4] & REQ_FLAG_MULTIPART) != 0;
+      data[4] &= ~REQ_FLAG_MULTIPART;
+
+      int reply_len = handleRequest(client, timestamp, &data[4], len - 4, is_multipart ? sizeof(reply_data) : MAX_SINGLE_REPLY_LEN);
       if (reply_len == 0) return; // invalid command
 
       client->last_timestamp = timestamp;
       client->last_activity = getRTCClock()->getCurrentTime();
 
+      MultipartSession* s = NULL;
+      if (is_multipart) {
+        s = multipart.startOutbound(timestamp, client->id.pub_key, &reply_data[4], reply_len - 4);
+        if (s) {
+          reply_len = multipart.writeFragment(s, 0, reply_data);
+        } else {   // not enough buffers, so redo as a normal reply, after the MULTIPART_UNFRAGMENTED marker
+          reply_len = handleRequest(client, timestamp, &data[4], len - 4, MAX_SINGLE_REPLY_LEN - 1);
+          if (reply_len < 4 || reply_len > MAX_SINGLE_REPLY_LEN - 1) reply_len = 4;   // eg. big telemetry, so send empty reply rather than cut it short
+          memmove(&reply_data[5], &reply_data[4], reply_len - 4);
+          reply_data[4] = MULTIPART_UNFRAGMENTED;
+          reply_len++;
+        }
+      }
+
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
         mesh::Packet *path = createPathReturn(client->id, secret, packet->path, packet->path_len,
@@ -634,6 +724,8 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
             sendFlood(reply, SERVER_RESPONSE_DELAY, packet->getPathHashSize());
           }
         }
+        // rest of fragments. (if flood, requester will ask for them by ACK, once paths are known)
+        if (s && s->count > 1) sendReplyFragments(client, secret, s, s->fullMask() & ~1, packet->getPathHashSize());
       }
     } else {
       MESH_DEBUG_PRINTLN("onPeerDataRecv: possible replay attack detected");
@@ -804,10 +896,13 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
       discover_limiter(4, 120),  // max 4 every 2 minutes
       anon_limiter(4, 180)   // max 4 every 3 minutes
 #if defined(WITH_RS232_BRIDGE)
-      , bridge(&_prefs, WITH_RS232_BRIDGE, _mgr, &rtc)
+      , bridge(&_prefs, WITH_RS232_BRIDGE, _mgr, &rtc, (SimpleMeshTables *)&tables, this)
 #endif
 #if defined(WITH_ESPNOW_BRIDGE)
-      , bridge(&_prefs, _mgr, &rtc)
+      , bridge(&_prefs, _mgr, &rtc, (SimpleMeshTables *)&tables, this)
+#endif
+#if defined(WITH_UDP_BRIDGE)
+      , bridge(&_prefs, bridge_socket, _mgr, &rtc, (SimpleMeshTables *)&tables, this)
 #endif
 {
   last_millis = 0;
@@ -865,6 +960,7 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
 void MyMesh::begin(FILESYSTEM *fs) {
   mesh::Mesh::begin();
   _fs = fs;
+  multipart.begin(_mgr, _ms);
   // load persisted prefs
   _cli.loadPrefs(_fs);
   acl.load(_fs, self_id);
@@ -1247,6 +1343,7 @@ void MyMesh::loop() {
 #endif
 
   mesh::Mesh::loop();
+  multipart.checkExpired();
 
   if (next_flood_advert && millisHasNowPassed(next_flood_advert)) {
     mesh::Packet *pkt = createSelfAdvert();
@@ -23,6 +23,11 @@
 #define WITH_BRIDGE
 #endif
 
+#ifdef WITH_UDP_BRIDGE
+#include "helpers/bridges/UDPBridge.h"
+#define WITH_BRIDGE
+#endif
+
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/ArduinoHelpers.h>
 #include <helpers/ClientACL.h>
@@ -33,6 +38,8 @@
 #include <helpers/StatsFormatHelper.h>
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/RegionMap.h>
+#include <helpers/MultipartReply.h>
+#include <helpers/CompactEncoding.h>
 #include "RateLimiter.h"
 
 #ifdef WITH_BRIDGE
@@ -89,7 +96,7 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   NodePrefs _prefs;
   ClientACL  acl;
   CommonCLI _cli;
-  uint8_t reply_data[MAX_PACKET_PAYLOAD];
+  uint8_t reply_data[4 + MULTIPART_MAX_REPLY];   // only requests with REQ_FLAG_MULTIPART can use more than MAX_PACKET_PAYLOAD
   uint8_t reply_path[MAX_PATH_SIZE];
   int8_t  reply_path_len;
   uint8_t reply_path_hash_size;
@@ -112,10 +119,14 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint8_t pending_sf;
   uint8_t pending_cr;
   int  matching_peer_indexes[MAX_CLIENTS];
+  MultipartTransfers multipart;
 #if defined(WITH_RS232_BRIDGE)
   RS232Bridge bridge;
 #elif defined(WITH_ESPNOW_BRIDGE)
   ESPNowBridge bridge;
+#elif defined(WITH_UDP_BRIDGE)
+  WiFiUDPBridgeSocket bridge_socket;
+  UDPBridge bridge;
 #endif
 
   void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr);
@@ -124,7 +135,9 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint8_t handleAnonRegionsReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
   uint8_t handleAnonOwnerReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
   uint8_t handleAnonClockReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
-  int handleRequest(ClientInfo* sender, uint32_t sender_timestamp, uint8_t* payload, size_t payload_len);
+  int handleRequest(ClientInfo* sender, uint32_t sender_timestamp, uint8_t* payload, size_t payload_len, int reply_max);
+  void handleMultipartAck(ClientInfo* client, const uint8_t* secret, const uint8_t* data, int len, uint8_t path_hash_size);
+  void sendReplyFragments(ClientInfo* client, const uint8_t* secret, MultipartSession* s, uint16_t send_mask, uint8_t path_hash_size);
   mesh::Packet* createSelfAdvert();
 
   File openAppend(const char* fname);
@@ -234,6 +247,12 @@ public:
     bridge.end();
     bridge.begin();
   }
+
+  void formatBridgeStatsReply(char *reply) override {
+    sprintf(reply, "{\"direct_drops\":%u,\"ack_drops\":%u,\"flood_drops\":%u,\"advert_drops\":%u}",
+            bridge.getIngressDrops(BRIDGE_PRIO_DIRECT), bridge.getIngressDrops(BRIDGE_PRIO_ACK),
+            bridge.getIngressDrops(BRIDGE_PRIO_FLOOD), bridge.getIngressDrops(BRIDGE_PRIO_ADVERT));
+  }
 #endif
 
   // To check if there is pending work
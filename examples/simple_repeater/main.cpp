@@ -88,6 +88,10 @@ void setup() {
 
   sensors.begin();
 
+#ifdef WITH_EXTRA_RADIO
+  // eg. a second LoRa module on another band (or an ESPNOWRadio), declared by the board's target
+  the_mesh.addRadio(WITH_EXTRA_RADIO);
+#endif
   the_mesh.begin(fs);
 
 #ifdef DISPLAY_CLASS
@@ -10,7 +10,16 @@
 
 #define POST_SYNC_DELAY_SECS        6
 
-#define FIRMWARE_VER_LEVEL       1
+#ifndef MAX_PUSHES_IN_FLIGHT
+  #define MAX_PUSHES_IN_FLIGHT      4     // pushes awaiting ACK, to different clients
+#endif
+#define PUSH_MAX_OUTBOUND           2     // don't start a push while this many packets already wait for airtime
+#define PUSH_ACTIVE_CLIENT_SECS     (10*60)
+
+#define POST_BATCH_MAX_LEN          (4 + 1 + 4 + MAX_POST_TEXT_LEN)   // no bigger than pushing the longest single post
+#define POST_BATCH_REC_HDR          9     // timestamp, author prefix, text_len
+
+#define FIRMWARE_VER_LEVEL       2    // >= 2 can push TXT_TYPE_SIGNED_BATCH
 
 #define REQ_TYPE_GET_STATUS         0x01 // same as _GET_STATS
 #define REQ_TYPE_KEEP_ALIVE         0x02
@@ -40,11 +49,10 @@ struct ServerStats {
 
 void MyMesh::addPost(ClientInfo *client, const char *postData) {
   // TODO: suggested postData format: <title>/<descrption>
-  posts[next_post_idx].author = client->id; // add to cyclic queue
-  StrHelper::strncpy(posts[next_post_idx].text, postData, MAX_POST_TEXT_LEN);
-
-  posts[next_post_idx].post_timestamp = getRTCClock()->getCurrentTimeUnique();
-  next_post_idx = (next_post_idx + 1) % MAX_UNSYNCED_POSTS;
+  if (!posts.add(client->id, postData, getRTCClock()->getCurrentTimeUnique())) {
+    MESH_DEBUG_PRINTLN("addPost: unable to store post");
+    return;
+  }
 
   next_push = futureMillis(PUSH_NOTIFY_DELAY_MILLIS);
   _num_posted++; // stats
@@ -67,9 +75,46 @@ void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
   memcpy(&reply_data[len], post.text, text_len);
   len += text_len;
 
+  sendPush(client, len, post.post_timestamp);
+}
+
+bool MyMesh::pushPostBatchToClient(ClientInfo *client, uint32_t seq) {
+  uint32_t now = getRTCClock()->getCurrentTime();
+  int len = 6;   // timestamp, flags, count
+  int count = 0;
+  uint32_t last_timestamp = 0;
+  PostInfo post;
+  for (; seq < posts.getNextSeq() && count < 255; seq++) {
+    if (posts.isAuthor(seq, client->id)) continue;   // don't push posts to the author
+    if (now < posts.getTimestamp(seq) + POST_SYNC_DELAY_SECS || !posts.load(seq, post)) break;
+
+    int text_len = strlen(post.text);
+    if (len + POST_BATCH_REC_HDR + text_len > POST_BATCH_MAX_LEN) break;
+
+    memcpy(&reply_data[len], &post.post_timestamp, 4); len += 4;
+    memcpy(&reply_data[len], post.author.pub_key, 4); len += 4;   // just first 4 bytes
+    reply_data[len++] = text_len;
+    memcpy(&reply_data[len], post.text, text_len); len += text_len;
+    last_timestamp = post.post_timestamp;
+    count++;
+  }
+  if (count < 2) return false;  // not worth it, caller will push single post
+
+  memcpy(reply_data, &last_timestamp, 4);   // this is a PAST timestamp... but should be accepted by client
+  uint8_t attempt;
+  getRNG()->random(&attempt, 1); // need this for re-tries, so packet hash (and ACK) will be different
+  reply_data[4] = (TXT_TYPE_SIGNED_BATCH << 2) | (attempt & 3);
+  reply_data[5] = count;
+
+  sendPush(client, len, last_timestamp);   // client's sync_since advances to last post, once ACK'd
+  _num_batched_posts += count;
+  return true;
+}
+
+void MyMesh::sendPush(ClientInfo *client, int len, uint32_t last_post_timestamp) {
   // calc expected ACK reply
   mesh::Utils::sha256((uint8_t *)&client->extra.room.pending_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
-  client->extra.room.push_post_timestamp = post.post_timestamp;
+  client->extra.room.push_post_timestamp = last_post_timestamp;
 
   auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->shared_secret, reply_data, len);
   if (reply) {
@@ -90,30 +135,114 @@ void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
   }
 }
 
+uint32_t MyMesh::getNextUnsyncedPost(ClientInfo *client) {
+  auto r = &client->extra.room;
+  if (r->cursor_since != r->sync_since || r->post_cursor < posts.getFirstSeq()) {   // sync_since changed, or post has rolled out
+    r->post_cursor = posts.findFirstAfter(r->sync_since);
+    r->cursor_since = r->sync_since;
+  }
+  uint32_t seq = r->post_cursor;
+  while (seq < posts.getNextSeq() && posts.isAuthor(seq, client->id)) {   // don't push posts to the author
+    seq++;
+  }
+  return seq;
+}
+
 uint8_t MyMesh::getUnsyncedCount(ClientInfo *client) {
   uint8_t count = 0;
-  for (int k = 0; k < MAX_UNSYNCED_POSTS; k++) {
-    if (posts[k].post_timestamp > client->extra.room.sync_since // is new post for this Client?
-        && !posts[k].author.matches(client->id)) {   // don't push posts to the author
-      count++;
-    }
+  for (uint32_t seq = getNextUnsyncedPost(client); seq < posts.getNextSeq() && count < 255; seq++) {
+    if (!posts.isAuthor(seq, client->id)) count++;
   }
   return count;
 }
 
+ClientInfo* MyMesh::pickPushClient() {
+  uint32_t now = getRTCClock()->getCurrentTime();
+  int n = acl.getNumClients();
+  ClientInfo* best = NULL;
+  int best_idx = 0, best_score = -1;
+  for (int k = 0; k < n; k++) {
+    int i = (next_client_idx + k) % n;
+    auto c = acl.getClientByIdx(i);
+    if (c->extra.room.pending_ack || c->last_activity == 0 || c->extra.room.push_failures >= 3) {
+      continue;   // already waiting for ACK, OR evicted, OR retries max
+    }
+    uint32_t seq = getNextUnsyncedPost(c);
+    if (seq >= posts.getNextSeq() || now < posts.getTimestamp(seq) + POST_SYNC_DELAY_SECS) continue;  // nothing to push (yet)
+
+    // prefer clients with more posts waiting, and those recently heard from (ie. probably still in range)
+    int backlog = posts.getNextSeq() - seq;   // NOTE: may include own posts, but good enough for a priority
+    int score = backlog > 32 ? 32 : backlog;
+    if (now < c->last_activity + PUSH_ACTIVE_CLIENT_SECS) score += 32;
+
+    if (score > best_score) {
+      best = c;
+      best_idx = i;
+      best_score = score;
+    }
+  }
+  if (best) next_client_idx = (best_idx + 1) % n;
+  return best;
+}
+
+void MyMesh::onPostSynced(ClientInfo *client, uint32_t post_timestamp) {
+  auto r = &client->extra.room;
+  r->sync_since = post_timestamp; // advance Client's SINCE timestamp, to sync next post
+
+  uint32_t now = getRTCClock()->getCurrentTime();
+  uint32_t secs = now > post_timestamp ? now - post_timestamp : 0;
+  if (secs > 0xFFFF) secs = 0xFFFF;
+  r->sync_latency_avg = r->num_synced == 0 ? secs : (r->sync_latency_avg * 7 + secs) / 8;
+  if (secs > r->sync_latency_max) r->sync_latency_max = secs;
+  if (r->num_synced < 0xFFFF) r->num_synced++;
+
+  _num_synced++;
+  _sync_latency_sum += secs;
+  if (secs > _sync_latency_max) _sync_latency_max = secs;
+}
+
 bool MyMesh::processAck(const uint8_t *data) {
   for (int i = 0; i < acl.getNumClients(); i++) {
     auto client = acl.getClientByIdx(i);
-    if (client->extra.room.pending_ack && memcmp(data, &client->extra.room.pending_ack, 4) == 0) { // got an ACK from Client!
-      client->extra.room.pending_ack = 0; // clear this, so next push can happen
-      client->extra.room.push_failures = 0;
-      client->extra.room.sync_since = client->extra.room.push_post_timestamp; // advance Client's SINCE timestamp, to sync next post
+    auto r = &client->extra.room;
+    if (r->pending_ack && memcmp(data, &r->pending_ack, 4) == 0) { // got an ACK from Client!
+      r->pending_ack = 0; // clear this, so next push can happen
+      r->push_failures = 0;
+      onPostSynced(client, r->push_post_timestamp);
+      return true;
+    }
+    if (r->prev_ack && memcmp(data, &r->prev_ack, 4) == 0) {   // ACK of a push we had given up on
+      r->prev_ack = 0;
+      r->push_failures = 0;
+      if (r->pending_ack && r->push_post_timestamp == r->prev_ack_post_timestamp) {
+        r->pending_ack = 0;   // retry of same post, no need to wait for its ACK now
+      }
+      if (r->prev_ack_post_timestamp > r->sync_since) onPostSynced(client, r->prev_ack_post_timestamp);
+      _num_late_acks++;
       return true;
     }
   }
   return false;
 }
 
+void MyMesh::formatSyncStatsReply(char *reply, bool print_clients) {
+  int in_flight = 0;
+  for (int i = 0; i < acl.getNumClients(); i++) {
+    auto c = acl.getClientByIdx(i);
+    if (c->extra.room.pending_ack) in_flight++;
+
+    if (print_clients && c->last_activity != 0) {
+      Serial.printf("%02X%02X%02X%02X synced:%d unsynced:%d avg:%ds max:%ds fails:%d%s\n",
+          (uint32_t)c->id.pub_key[0], (uint32_t)c->id.pub_key[1], (uint32_t)c->id.pub_key[2], (uint32_t)c->id.pub_key[3],
+          (uint32_t)c->extra.room.num_synced, (uint32_t)getUnsyncedCount(c),
+          (uint32_t)c->extra.room.sync_latency_avg, (uint32_t)c->extra.room.sync_latency_max,
+          (uint32_t)c->extra.room.push_failures, c->extra.room.pending_ack ? " (pending)" : "");
+    }
+  }
+  sprintf(reply, "in_flight:%d synced:%u batched:%u late_acks:%u avg:%us max:%us", in_flight, _num_synced, _num_batched_posts,
+          (uint32_t)_num_late_acks, _num_synced ? _sync_latency_sum / _num_synced : 0, _sync_latency_max);
+}
+
 mesh::Packet *MyMesh::createSelfAdvert() {
   uint8_t app_data[MAX_ADVERT_DATA_SIZE];
   uint8_t app_data_len = _cli.buildAdvertData(ADV_TYPE_ROOM, app_data);
@@ -289,6 +418,8 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
     memcpy(&sender_sync_since, &data[4], 4); // sender's "sync messags SINCE x" timestamp
 
     data[len] = 0;                                        // ensure null terminator
+    int pw_len = strlen((char *)&data[8]);
+    uint8_t client_ver = (9 + pw_len < (int)len) ? data[9 + pw_len] : 0;   // NEW: optional, after password's null terminator
 
     ClientInfo* client = NULL;
     if (data[8] == 0) {   // blank password, just check if sender is in ACL
@@ -334,6 +465,8 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
     }
 
+    client->extra.room.client_ver = client_ver;
+
     if (packet->isRouteFlood()) {
       client->out_path_len = OUT_PATH_UNKNOWN;  // need to rediscover out_path
     }
@@ -626,11 +759,12 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.gps_interval = 0;
   _prefs.advert_loc_policy = ADVERT_LOC_PREFS;
 
-  next_post_idx = 0;
   next_client_idx = 0;
   next_push = 0;
-  memset(posts, 0, sizeof(posts));
   _num_posted = _num_post_pushes = 0;
+  _num_late_acks = 0;
+  _num_batched_posts = 0;
+  _num_synced = _sync_latency_sum = _sync_latency_max = 0;
 }
 
 void MyMesh::begin(FILESYSTEM *fs) {
@@ -640,6 +774,7 @@ void MyMesh::begin(FILESYSTEM *fs) {
   _cli.loadPrefs(_fs);
 
   acl.load(_fs, self_id);
+  posts.begin(_fs);
 
   radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
   radio_set_tx_power(_prefs.tx_power_dbm);
@@ -801,6 +936,8 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       Serial.printf("\n");
     }
     reply[0] = 0;
+  } else if (strcmp(command, "get sync") == 0) {
+    formatSyncStatsReply(reply, sender_timestamp == 0);   // per-client details only to serial console
   } else{
     _cli.handleCommand(sender_timestamp, command, reply);  // common CLI commands
   }
@@ -815,43 +952,41 @@ void MyMesh::loop() {
 
   if (millisHasNowPassed(next_push) && acl.getNumClients() > 0) {
     // check for ACK timeouts
+    int in_flight = 0;
     for (int i = 0; i < acl.getNumClients(); i++) {
       auto c = acl.getClientByIdx(i);
       if (c->extra.room.pending_ack && millisHasNowPassed(c->extra.room.ack_timeout)) {
         c->extra.room.push_failures++;
-        c->extra.room.pending_ack = 0; // reset  (TODO: keep prev expected_ack's in a list, incase they arrive LATER, after we retry)
+        c->extra.room.prev_ack = c->extra.room.pending_ack;   // keep, incase it arrives LATER, after we retry
+        c->extra.room.prev_ack_post_timestamp = c->extra.room.push_post_timestamp;
+        c->extra.room.pending_ack = 0; // reset
         MESH_DEBUG_PRINTLN("pending ACK timed out: push_failures: %d", (uint32_t)c->extra.room.push_failures);
+      } else if (c->extra.room.pending_ack) {
+        in_flight++;
       }
     }
-    // check next Round-Robin client, and sync next new post
-    auto client = acl.getClientByIdx(next_client_idx);
+
+    // several clients can each have a push in flight, but don't queue up more than the airtime budget allows
+    ClientInfo* client = NULL;
+    if (in_flight < MAX_PUSHES_IN_FLIGHT && _mgr->getOutboundCount(0xFFFFFFFF) < PUSH_MAX_OUTBOUND) {
+      client = pickPushClient();
+    }
     bool did_push = false;
-    if (client->extra.room.pending_ack == 0 && client->last_activity != 0 &&
-        client->extra.room.push_failures < 3) { // not already waiting for ACK, AND not evicted, AND retries not max
-      MESH_DEBUG_PRINTLN("loop - checking for client %02X", (uint32_t)client->id.pub_key[0]);
-      uint32_t now = getRTCClock()->getCurrentTime();
-      for (int k = 0, idx = next_post_idx; k < MAX_UNSYNCED_POSTS; k++) {
-        auto p = &posts[idx];
-        if (now >= p->post_timestamp + POST_SYNC_DELAY_SECS &&
-            p->post_timestamp > client->extra.room.sync_since // is new post for this Client?
-            && !p->author.matches(client->id)) {   // don't push posts to the author
-          // push this post to Client, then wait for ACK
-          pushPostToClient(client, *p);
-          did_push = true;
-          MESH_DEBUG_PRINTLN("loop - pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], p->text);
-          break;
-        }
-        idx = (idx + 1) % MAX_UNSYNCED_POSTS; // wrap to start of cyclic queue
-      }
-    } else {
-      MESH_DEBUG_PRINTLN("loop - skipping busy (or evicted) client %02X", (uint32_t)client->id.pub_key[0]);
+    PostInfo p;
+    if (client && client->extra.room.client_ver >= 1 && pushPostBatchToClient(client, getNextUnsyncedPost(client))) {
+      // pushed several short posts in one packet, then wait for single ACK
+      did_push = true;
+      MESH_DEBUG_PRINTLN("loop - pushed batch to client %02X", (uint32_t)client->id.pub_key[0]);
+    } else if (client && posts.load(getNextUnsyncedPost(client), p)) {
+      // push this post to Client, then wait for ACK
+      pushPostToClient(client, p);
+      did_push = true;
+      MESH_DEBUG_PRINTLN("loop - pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], p.text);
     }
-    next_client_idx = (next_client_idx + 1) % acl.getNumClients(); // round robin polling for each client
 
     if (did_push) {
-      next_push = futureMillis(SYNC_PUSH_INTERVAL);
+      next_push = futureMillis(SYNC_PUSH_INTERVAL / MAX_PUSHES_IN_FLIGHT);
     } else {
-      // were no unsynced posts for curr client, so proccess next client much quicker! (in next loop())
       next_push = futureMillis(SYNC_PUSH_INTERVAL / 8);
     }
   }
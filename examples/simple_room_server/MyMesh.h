@@ -22,6 +22,7 @@
 #include <helpers/ClientACL.h>
 #include <RTClib.h>
 #include <target.h>
+#include "PostStore.h"
 
 /* ------------------------------ Config -------------------------------- */
 
@@ -63,10 +64,6 @@
   #define  ADMIN_PASSWORD  "password"
 #endif
 
-#ifndef MAX_UNSYNCED_POSTS
-  #define MAX_UNSYNCED_POSTS    32
-#endif
-
 #ifndef SERVER_RESPONSE_DELAY
   #define SERVER_RESPONSE_DELAY   300
 #endif
@@ -79,14 +76,6 @@
 
 #define PACKET_LOG_FILE  "/packet_log"
 
-#define MAX_POST_TEXT_LEN    (160-9)
-
-struct PostInfo {
-  mesh::Identity author;
-  uint32_t post_timestamp;   // by OUR clock
-  char text[MAX_POST_TEXT_LEN+1];
-};
-
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   FILESYSTEM* _fs;
   uint32_t last_millis;
@@ -100,9 +89,11 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint8_t reply_data[MAX_PACKET_PAYLOAD];
   unsigned long next_push;
   uint16_t _num_posted, _num_post_pushes;
-  int next_client_idx;  // for round-robin polling
-  int next_post_idx;
-  PostInfo posts[MAX_UNSYNCED_POSTS];   // cyclic queue
+  uint16_t _num_late_acks;
+  uint32_t _num_synced, _sync_latency_sum, _sync_latency_max;
+  uint32_t _num_batched_posts;
+  int next_client_idx;  // where next priority scan starts, so ties are round-robin
+  PostStore posts;
   CayenneLPP telemetry;
   unsigned long set_radio_at, revert_radio_at;
   float pending_freq;
@@ -113,8 +104,14 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
 
   void addPost(ClientInfo* client, const char* postData);
   void pushPostToClient(ClientInfo* client, PostInfo& post);
+  bool pushPostBatchToClient(ClientInfo* client, uint32_t seq);
+  void sendPush(ClientInfo* client, int len, uint32_t last_post_timestamp);
+  uint32_t getNextUnsyncedPost(ClientInfo* client);
   uint8_t getUnsyncedCount(ClientInfo* client);
+  ClientInfo* pickPushClient();
+  void onPostSynced(ClientInfo* client, uint32_t post_timestamp);
   bool processAck(const uint8_t *data);
+  void formatSyncStatsReply(char *reply, bool print_clients);
   mesh::Packet* createSelfAdvert();
   File openAppend(const char* fname);
   int handleRequest(ClientInfo* sender, uint32_t sender_timestamp, uint8_t* payload, size_t payload_len);
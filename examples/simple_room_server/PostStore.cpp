@@ -0,0 +1,204 @@
+#include <Arduino.h>
+#include "PostStore.h"
+#include <helpers/TxtDataHelpers.h>
+
+#define POSTS_TMP_FILE     "/posts.tmp"
+
+#define SEG_POSTS          (MAX_STORED_POSTS / 2)
+#define POST_REC_SIZE      (4 + PUB_KEY_SIZE + MAX_POST_TEXT_LEN+1)   // timestamp, author, text
+#define POST_HDR_SIZE      8    // just timestamp + author prefix, for the index
+
+static const char* segName(int seg) {
+  return seg ? "/posts1" : "/posts0";
+}
+
+static int segOf(uint32_t seq) {
+  return (seq / SEG_POSTS) % 2;
+}
+
+static File openRead(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_READ);
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "r");
+#else
+  return fs->open(filename, "r", false);
+#endif
+}
+
+static File openWrite(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  fs->remove(filename);
+  return fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "w");
+#else
+  return fs->open(filename, "w", true);
+#endif
+}
+
+static File openAppend(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  File f = fs->open(filename, FILE_O_WRITE);
+  if (f) f.seek(f.size());
+  return f;
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "a");
+#else
+  return fs->open(filename, "a", true);
+#endif
+}
+
+void PostStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+
+  uint32_t first_ts[2];
+  for (int seg = 0; seg < 2; seg++) {
+    first_ts[seg] = 0;
+    File f = openRead(_fs, segName(seg));
+    if (f) {
+      if (f.read((uint8_t *) &first_ts[seg], 4) != 4) first_ts[seg] = 0;
+      f.close();
+    }
+  }
+
+  // older segment first (an empty segment counts as the older one)
+  int older = (first_ts[0] == 0 || (first_ts[1] != 0 && first_ts[0] < first_ts[1])) ? 0 : 1;
+  uint32_t older_base = older * SEG_POSTS;   // so that segOf(seq) matches
+  uint32_t newer_base = older_base + SEG_POSTS;
+
+  int n = loadSegment(older, older_base);
+  _first_seq = older_base;
+  _next_seq = older_base + n;
+
+  if (first_ts[older ^ 1] != 0) {
+    if (n < SEG_POSTS) {   // shouldn't happen, unless MAX_STORED_POSTS was changed
+      MESH_DEBUG_PRINTLN("PostStore: discarding partial segment %d", older);
+      _fs->remove(segName(older));
+      _first_seq = newer_base;
+    }
+    _next_seq = newer_base + loadSegment(older ^ 1, newer_base);
+  }
+  MESH_DEBUG_PRINTLN("PostStore: loaded %d posts", getNumPosts());
+}
+
+int PostStore::loadSegment(int seg, uint32_t base_seq) {
+  File f = openRead(_fs, segName(seg));
+  if (!f) return 0;
+
+  uint32_t size = f.size();
+  int num_recs = size / POST_REC_SIZE;
+  if (num_recs > SEG_POSTS) num_recs = SEG_POSTS;
+
+  uint8_t hdr[POST_HDR_SIZE];
+  int n = 0;
+  while (n < num_recs && f.seek(n * POST_REC_SIZE) && f.read(hdr, POST_HDR_SIZE) == POST_HDR_SIZE) {
+    IndexEntry* e = &_index[(base_seq + n) % MAX_STORED_POSTS];
+    memcpy(&e->timestamp, hdr, 4);
+    memcpy(e->author, &hdr[4], sizeof(e->author));
+    n++;
+  }
+  f.close();
+
+  if (n < SEG_POSTS && size != n * POST_REC_SIZE) {   // eg. power lost during an append
+    if (!repairSegment(seg, n)) {
+      _fs->remove(segName(seg));
+      return 0;
+    }
+  }
+  return n;
+}
+
+bool PostStore::repairSegment(int seg, int num_recs) {
+  MESH_DEBUG_PRINTLN("PostStore: truncating segment %d to %d posts", seg, num_recs);
+
+  File src = openRead(_fs, segName(seg));
+  File dest = openWrite(_fs, POSTS_TMP_FILE);
+  bool success = src && dest;
+
+  uint8_t rec[POST_REC_SIZE];
+  for (int i = 0; success && i < num_recs; i++) {
+    success = src.read(rec, POST_REC_SIZE) == POST_REC_SIZE && dest.write(rec, POST_REC_SIZE) == POST_REC_SIZE;
+  }
+  if (src) src.close();
+  if (dest) dest.close();
+
+  if (!success) {
+    _fs->remove(POSTS_TMP_FILE);
+    return false;
+  }
+  _fs->remove(segName(seg));
+  return _fs->rename(POSTS_TMP_FILE, segName(seg));
+}
+
+bool PostStore::add(const mesh::Identity& author, const char* text, uint32_t timestamp) {
+  if (_fs == NULL) return false;
+
+  uint32_t last = getLastTimestamp();
+  if (timestamp <= last) timestamp = last + 1;
+
+  int seg = segOf(_next_seq);
+  if (_next_seq % SEG_POSTS == 0) {   // starting a new segment, so it replaces the older one
+    _fs->remove(segName(seg));
+    if (_next_seq >= SEG_POSTS && _first_seq < _next_seq - SEG_POSTS) _first_seq = _next_seq - SEG_POSTS;
+  }
+
+  uint8_t rec[POST_REC_SIZE];
+  memset(rec, 0, sizeof(rec));
+  memcpy(rec, &timestamp, 4);
+  memcpy(&rec[4], author.pub_key, PUB_KEY_SIZE);
+  StrHelper::strncpy((char *) &rec[4 + PUB_KEY_SIZE], text, MAX_POST_TEXT_LEN);
+
+  File f = openAppend(_fs, segName(seg));
+  bool success = f && f.write(rec, POST_REC_SIZE) == POST_REC_SIZE;
+  if (f) f.close();
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("PostStore: append failed");
+    if (!repairSegment(seg, _next_seq % SEG_POSTS)) {   // don't leave a partial record
+      _fs->remove(segName(seg));
+      _next_seq -= _next_seq % SEG_POSTS;   // lost the posts in this segment
+      if (_first_seq > _next_seq) _first_seq = _next_seq;
+    }
+    return false;
+  }
+
+  IndexEntry* e = &_index[_next_seq % MAX_STORED_POSTS];
+  e->timestamp = timestamp;
+  memcpy(e->author, author.pub_key, sizeof(e->author));
+  _next_seq++;
+  return true;
+}
+
+uint32_t PostStore::findFirstAfter(uint32_t since) const {
+  uint32_t lo = _first_seq, hi = _next_seq;
+  while (lo < hi) {   // binary search, as timestamps are always increasing
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (getTimestamp(mid) > since) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+bool PostStore::load(uint32_t seq, PostInfo& post) const {
+  if (_fs == NULL || seq < _first_seq || seq >= _next_seq) return false;
+
+  File f = openRead(_fs, segName(segOf(seq)));
+  if (!f) return false;
+
+  uint8_t rec[POST_REC_SIZE];
+  bool success = f.seek((seq % SEG_POSTS) * POST_REC_SIZE) && f.read(rec, POST_REC_SIZE) == POST_REC_SIZE;
+  f.close();
+
+  if (success) {
+    memcpy(&post.post_timestamp, rec, 4);
+    post.author = mesh::Identity(&rec[4]);
+    memcpy(post.text, &rec[4 + PUB_KEY_SIZE], MAX_POST_TEXT_LEN+1);
+    post.text[MAX_POST_TEXT_LEN] = 0;
+    success = post.post_timestamp == getTimestamp(seq);
+  }
+  return success;
+}
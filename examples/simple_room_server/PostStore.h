@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Mesh.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#define MAX_POST_TEXT_LEN    (160-9)
+
+// total posts kept in flash (two segment files of half this each), so retention is between half and all of this
+#ifndef MAX_STORED_POSTS
+  #if defined(ESP32)
+    #define MAX_STORED_POSTS   512
+  #elif defined(RP2040_PLATFORM)
+    #define MAX_STORED_POSTS   256
+  #else
+    #define MAX_STORED_POSTS   32     // internal flash too small for more
+  #endif
+#endif
+
+#if MAX_STORED_POSTS < 2 || (MAX_STORED_POSTS % 2) != 0
+  #error "MAX_STORED_POSTS must be an even number"
+#endif
+
+struct PostInfo {
+  mesh::Identity author;
+  uint32_t post_timestamp;   // by OUR clock
+  char text[MAX_POST_TEXT_LEN+1];
+};
+
+/**
+ * \brief  Timestamp ordered log of room posts, persisted to flash.
+ *     Posts are appended to one of two segment files, and when the current segment is full the older one is
+ *     removed and started again. Each post gets a sequence number (only valid until reboot), and a RAM index
+ *     of timestamp + author prefix per post means finding a client's next post needs no file access.
+ */
+class PostStore {
+  struct IndexEntry {
+    uint32_t timestamp;
+    uint8_t  author[4];    // pub_key prefix, same as included in pushed posts
+  };
+
+  FILESYSTEM* _fs;
+  IndexEntry _index[MAX_STORED_POSTS];   // by seq % MAX_STORED_POSTS
+  uint32_t _first_seq, _next_seq;
+
+  const IndexEntry& entry(uint32_t seq) const { return _index[seq % MAX_STORED_POSTS]; }
+  int loadSegment(int seg, uint32_t base_seq);
+  bool repairSegment(int seg, int num_recs);
+
+public:
+  PostStore() : _fs(NULL), _first_seq(0), _next_seq(0) { }
+
+  /**
+   * \brief  builds the RAM index from the segment files
+   */
+  void begin(FILESYSTEM* fs);
+
+  /**
+   * \brief  appends new post. Timestamp is bumped if needed, to keep log in order (eg. if RTC was set back)
+   * \returns  false if post could not be written to flash
+   */
+  bool add(const mesh::Identity& author, const char* text, uint32_t timestamp);
+
+  /**
+   * \returns  seq of the oldest post with timestamp greater than 'since', or getNextSeq() if none
+   */
+  uint32_t findFirstAfter(uint32_t since) const;
+
+  /**
+   * \brief  reads the full post from flash
+   */
+  bool load(uint32_t seq, PostInfo& post) const;
+
+  uint32_t getFirstSeq() const { return _first_seq; }
+  uint32_t getNextSeq() const { return _next_seq; }
+  uint32_t getTimestamp(uint32_t seq) const { return entry(seq).timestamp; }
+  uint32_t getLastTimestamp() const { return _next_seq > _first_seq ? getTimestamp(_next_seq - 1) : 0; }
+  bool isAuthor(uint32_t seq, const mesh::Identity& id) const { return memcmp(entry(seq).author, id.pub_key, 4) == 0; }
+  int getNumPosts() const { return _next_seq - _first_seq; }
+};
@@ -46,7 +46,7 @@
 
 /* ------------------------------ Code -------------------------------- */
 
-#define FIRMWARE_VER_LEVEL       1
+#define FIRMWARE_VER_LEVEL       2
 
 #define REQ_TYPE_LOGIN               0x00
 #define REQ_TYPE_GET_STATUS          0x01
@@ -55,6 +55,8 @@
 #define REQ_TYPE_GET_AVG_MIN_MAX     0x04
 #define REQ_TYPE_GET_ACCESS_LIST     0x05
 
+#define ACL_FORMAT_COMPACT           1      // GET_ACCESS_LIST first param, FIRMWARE_VER_LEVEL >= 2
+
 #define RESP_SERVER_LOGIN_OK      0   // response to ANON_REQ
 
 #define CLI_REPLY_DELAY_MILLIS  1000
@@ -233,6 +235,10 @@ uint8_t SensorMesh::handleRequest(uint8_t perms, uint32_t sender_timestamp, uint
       }
       return ofs;
     }
+    if (res1 == ACL_FORMAT_COMPACT) {
+      int prefix_len = (res2 == 0 || res2 > PUB_KEY_SIZE) ? 6 : res2;
+      return 4 + acl.exportCompact(&reply_data[4], MAX_PACKET_PAYLOAD - CIPHER_MAC_SIZE - (CIPHER_BLOCK_SIZE-1) - 4, prefix_len);
+    }
   }
   return 0;  // unknown command
 }
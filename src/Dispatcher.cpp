@@ -14,14 +14,34 @@ namespace mesh {
   #define NOISE_FLOOR_CALIB_INTERVAL   2000     // 2 seconds
 #endif
 
+void Dispatcher::initPort(RadioPort& port, Radio* radio) {
+  port.radio = radio;
+  port.outbound = NULL;
+  port.air_time = 0;
+  port.next_tx_time = 0;
+  port.cad_busy_start = 0;
+  port.next_floor_calib_time = port.next_agc_reset_time = 0;
+  port.radio_nonrx_start = 0;
+  port.prev_isrecv_mode = true;
+}
+
+int Dispatcher::addRadio(Radio& radio) {
+  if (num_ports >= MAX_RADIO_PORTS) return -1;
+  initPort(ports[num_ports], &radio);
+  return num_ports++;
+}
+
 void Dispatcher::begin() {
   n_sent_flood = n_sent_direct = 0;
   n_recv_flood = n_recv_direct = 0;
   _err_flags = 0;
-  radio_nonrx_start = _ms->getMillis();
 
-  _radio->begin();
-  prev_isrecv_mode = _radio->isInRecvMode();
+  for (int p = 0; p < num_ports; p++) {
+    RadioPort& port = ports[p];
+    port.radio_nonrx_start = _ms->getMillis();
+    port.radio->begin();
+    port.prev_isrecv_mode = port.radio->isInRecvMode();
+  }
 }
 
 float Dispatcher::getAirtimeBudgetFactor() const {
@@ -40,34 +60,61 @@ uint32_t Dispatcher::getCADFailMaxDuration() const {
 }
 
 void Dispatcher::loop() {
-  if (millisHasNowPassed(next_floor_calib_time)) {
-    _radio->triggerNoiseFloorCalibrate(getInterferenceThreshold());
-    next_floor_calib_time = futureMillis(NOISE_FLOOR_CALIB_INTERVAL);
+  bool any_idle = false;
+  for (int p = 0; p < num_ports; p++) {
+    if (checkPortSend(p)) any_idle = true;
+  }
+  if (!any_idle) return;  // can't do any more radio activity until a send is complete or timed out
+
+  // check inbound (delayed) queue
+  {
+    Packet* pkt = _mgr->getNextInbound(_ms->getMillis());
+    if (pkt) {
+      processRecvPacket(pkt);
+    }
+  }
+  for (int p = 0; p < num_ports; p++) {
+    if (ports[p].outbound == NULL) {
+      checkRecv(p);
+      checkSend(p);
+    }
+  }
+}
+
+bool Dispatcher::checkPortSend(int p) {
+  RadioPort& port = ports[p];
+  Radio* radio = port.radio;
+
+  if (millisHasNowPassed(port.next_floor_calib_time)) {
+    radio->triggerNoiseFloorCalibrate(getInterferenceThreshold());
+    port.next_floor_calib_time = futureMillis(NOISE_FLOOR_CALIB_INTERVAL);
   }
-  _radio->loop();
+  radio->loop();
 
   // check for radio 'stuck' in mode other than Rx
-  bool is_recv = _radio->isInRecvMode();
-  if (is_recv != prev_isrecv_mode) {
-    prev_isrecv_mode = is_recv;
+  bool is_recv = radio->isInRecvMode();
+  if (is_recv != port.prev_isrecv_mode) {
+    port.prev_isrecv_mode = is_recv;
     if (!is_recv) {
-      radio_nonrx_start = _ms->getMillis();
+      port.radio_nonrx_start = _ms->getMillis();
     }
   }
-  if (!is_recv && _ms->getMillis() - radio_nonrx_start > 8000) {   // radio has not been in Rx mode for 8 seconds!
+  if (!is_recv && _ms->getMillis() - port.radio_nonrx_start > 8000) {   // radio has not been in Rx mode for 8 seconds!
     _err_flags |= ERR_EVENT_STARTRX_TIMEOUT;
   }
 
+  Packet* outbound = port.outbound;
   if (outbound) {  // waiting for outbound send to be completed
-    if (_radio->isSendComplete()) {
-      long t = _ms->getMillis() - outbound_start;
+    if (radio->isSendComplete()) {
+      long t = _ms->getMillis() - port.outbound_start;
       total_air_time += t;  // keep track of how much air time we are using
+      port.air_time += t;
       //Serial.print("  airtime="); Serial.println(t);
 
       // will need radio silence up to next_tx_time
-      next_tx_time = futureMillis(t * getAirtimeBudgetFactor());
+      port.next_tx_time = futureMillis(t * getPortAirtimeBudgetFactor(p));
 
-      _radio->onSendFinished();
+      radio->onSendFinished();
       logTx(outbound, 2 + outbound->getPathByteLen() + outbound->payload_len);
       if (outbound->isRouteFlood()) {
         n_sent_flood++;
@@ -75,37 +122,28 @@ void Dispatcher::loop() {
         n_sent_direct++;
       }
       releasePacket(outbound);  // return to pool
-      outbound = NULL;
-    } else if (millisHasNowPassed(outbound_expiry)) {
+      port.outbound = NULL;
+    } else if (millisHasNowPassed(port.outbound_expiry)) {
       MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): WARNING: outbound packed send timed out!", getLogDateTime());
 
-      _radio->onSendFinished();
+      radio->onSendFinished();
       logTxFail(outbound, 2 + outbound->getPathByteLen() + outbound->payload_len);
 
       releasePacket(outbound);  // return to pool
-      outbound = NULL;
+      port.outbound = NULL;
     } else {
-      return;  // can't do any more radio activity until send is complete or timed out
+      return false;
     }
 
     // going back into receive mode now...
-    next_agc_reset_time = futureMillis(getAGCResetInterval());
+    port.next_agc_reset_time = futureMillis(getAGCResetInterval());
   }
 
-  if (getAGCResetInterval() > 0 && millisHasNowPassed(next_agc_reset_time)) {
-    _radio->resetAGC();
-    next_agc_reset_time = futureMillis(getAGCResetInterval());
-  }
-
-  // check inbound (delayed) queue
-  {
-    Packet* pkt = _mgr->getNextInbound(_ms->getMillis());
-    if (pkt) {
-      processRecvPacket(pkt);
-    }
+  if (getAGCResetInterval() > 0 && millisHasNowPassed(port.next_agc_reset_time)) {
+    radio->resetAGC();
+    port.next_agc_reset_time = futureMillis(getAGCResetInterval());
   }
-  checkRecv();
-  checkSend();
+  return true;
 }
 
 bool Dispatcher::tryParsePacket(Packet* pkt, const uint8_t* raw, int len) {
@@ -150,24 +188,26 @@ bool Dispatcher::tryParsePacket(Packet* pkt, const uint8_t* raw, int len) {
   return true;  // success
 }
 
-void Dispatcher::checkRecv() {
+void Dispatcher::checkRecv(int p) {
+  Radio* radio = ports[p].radio;
   Packet* pkt;
   float score;
   uint32_t air_time;
   {
     uint8_t raw[MAX_TRANS_UNIT+1];
-    int len = _radio->recvRaw(raw, MAX_TRANS_UNIT);
+    int len = radio->recvRaw(raw, MAX_TRANS_UNIT);
     if (len > 0) {
-      logRxRaw(_radio->getLastSNR(), _radio->getLastRSSI(), raw, len);
+      logRxRaw(radio->getLastSNR(), radio->getLastRSSI(), raw, len);
 
       pkt = _mgr->allocNew();
       if (pkt == NULL) {
         MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): WARNING: received data, no unused packets available!", getLogDateTime());
       } else {
         if (tryParsePacket(pkt, raw, len)) {
-          pkt->_snr = _radio->getLastSNR() * 4.0f;
-          score = _radio->packetScore(_radio->getLastSNR(), len);
-          air_time = _radio->getEstAirtimeFor(len);
+          pkt->_snr = radio->getLastSNR() * 4.0f;
+          pkt->_rx_port = p;
+          score = radio->packetScore(radio->getLastSNR(), len);
+          air_time = radio->getEstAirtimeFor(len);
           rx_air_time += air_time;
         } else {
           _mgr->free(pkt);  // put back into pool
@@ -183,7 +223,7 @@ void Dispatcher::checkRecv() {
     Serial.print(getLogDateTime());
     Serial.printf(": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d time=%d", 
             pkt->getRawLength(), pkt->getPayloadType(), pkt->isRouteDirect() ? "D" : "F", pkt->payload_len,
-            (int)pkt->getSNR(), (int)_radio->getLastRSSI(), (int)(score*1000), air_time);
+            (int)pkt->getSNR(), (int)radio->getLastRSSI(), (int)(score*1000), air_time);
 
     static uint8_t packet_hash[MAX_HASH_SIZE];
     pkt->calculatePacketHash(packet_hash);
@@ -230,14 +270,46 @@ void Dispatcher::processRecvPacket(Packet* pkt) {
     uint8_t priority = (action >> 24) - 1;
     uint32_t _delay = action & 0xFFFFFF;
 
-    _mgr->queueOutbound(pkt, priority, futureMillis(_delay));
+    queueOutbound(pkt, priority, futureMillis(_delay));
   }
 }
 
-void Dispatcher::checkSend() {
-  if (_mgr->getOutboundCount(_ms->getMillis()) == 0) return;  // nothing waiting to send
+void Dispatcher::queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  uint8_t mask = getOutboundPorts(packet) & ((1 << num_ports) - 1);
+  if (mask == 0) {
+    _mgr->free(packet);
+    return;
+  }
+
+  // one copy per port, as each port sends (and then frees) in its own time
+  int p = 0;
+  while ((mask & (1 << p)) == 0) p++;
+  for (int q = p + 1; q < num_ports; q++) {
+    if ((mask & (1 << q)) == 0) continue;
+    Packet* copy = _mgr->allocNew();
+    if (copy == NULL) {
+      MESH_DEBUG_PRINTLN("%s Dispatcher::queueOutbound(): WARNING: no unused packets for port %d", getLogDateTime(), q);
+      _err_flags |= ERR_EVENT_FULL;
+      continue;
+    }
+    *copy = *packet;
+    copy->_tx_ports = 1 << q;
+    _mgr->queueOutbound(copy, priority, scheduled_for);
+  }
+  packet->_tx_ports = 1 << p;
+  _mgr->queueOutbound(packet, priority, scheduled_for);
+}
+
+void Dispatcher::checkSend(int p) {
+  RadioPort& port = ports[p];
+  Radio* radio = port.radio;
+  unsigned long& cad_busy_start = port.cad_busy_start;
+  unsigned long& next_tx_time = port.next_tx_time;
+
+  int waiting = num_ports == 1 ? _mgr->getOutboundCount(_ms->getMillis()) : _mgr->getOutboundCountFor(_ms->getMillis(), 1 << p);
+  if (waiting == 0) return;  // nothing waiting to send on this port
   if (!millisHasNowPassed(next_tx_time)) return;   // still in 'radio silence' phase (from airtime budget setting)
-  if (_radio->isReceiving()) {   // LBT - check if radio is currently mid-receive, or if channel activity
+  if (radio->isReceiving()) {   // LBT - check if radio is currently mid-receive, or if channel activity
     if (cad_busy_start == 0) {
       cad_busy_start = _ms->getMillis();   // record when CAD busy state started
     }
@@ -255,7 +327,8 @@ void Dispatcher::checkSend() {
   }
   cad_busy_start = 0;  // reset busy state
 
-  outbound = _mgr->getNextOutbound(_ms->getMillis());
+  Packet*& outbound = port.outbound;
+  outbound = num_ports == 1 ? _mgr->getNextOutbound(_ms->getMillis()) : _mgr->getNextOutboundFor(_ms->getMillis(), 1 << p);
   if (outbound) {
     int len = 0;
     uint8_t raw[MAX_TRANS_UNIT];
@@ -275,9 +348,9 @@ void Dispatcher::checkSend() {
     } else {
       memcpy(&raw[len], outbound->payload, outbound->payload_len); len += outbound->payload_len;
 
-      uint32_t max_airtime = _radio->getEstAirtimeFor(len)*3/2;
-      outbound_start = _ms->getMillis();
-      bool success = _radio->startSendRaw(raw, len);
+      uint32_t max_airtime = radio->getEstAirtimeFor(len)*3/2;
+      port.outbound_start = _ms->getMillis();
+      bool success = radio->startSendRaw(raw, len);
       if (!success) {
         MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): ERROR: send start failed!", getLogDateTime());
 
@@ -287,7 +360,7 @@ void Dispatcher::checkSend() {
         outbound = NULL;
         return;
       }
-      outbound_expiry = futureMillis(max_airtime);
+      port.outbound_expiry = futureMillis(max_airtime);
 
     #if MESH_PACKET_LOGGING
       Serial.print(getLogDateTime());
@@ -324,7 +397,7 @@ void Dispatcher::sendPacket(Packet* packet, uint8_t priority, uint32_t delay_mil
     MESH_DEBUG_PRINTLN("%s Dispatcher::sendPacket(): ERROR: invalid packet... path_len=%d, payload_len=%d", getLogDateTime(), (uint32_t) packet->path_len, (uint32_t) packet->payload_len);
     _mgr->free(packet);
   } else {
-    _mgr->queueOutbound(packet, priority, futureMillis(delay_millis));
+    queueOutbound(packet, priority, futureMillis(delay_millis));
   }
 }
 
@@ -90,6 +90,14 @@ public:
   virtual void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) = 0;
   virtual Packet* getNextOutbound(uint32_t now) = 0;    // by priority
   virtual int getOutboundCount(uint32_t now) const = 0;
+
+  // by priority, only packets still to be sent on these radio ports. Managers that don't track ports only serve port 0
+  virtual Packet* getNextOutboundFor(uint32_t now, uint8_t port_mask) {
+    return (port_mask & 1) ? getNextOutbound(now) : NULL;
+  }
+  virtual int getOutboundCountFor(uint32_t now, uint8_t port_mask) const {
+    return (port_mask & 1) ? getOutboundCount(now) : 0;
+  }
   virtual int getFreeCount() const = 0;
   virtual Packet* getOutboundByIdx(int i) = 0;
   virtual Packet* removeOutboundByIdx(int i) = 0;
@@ -108,40 +116,54 @@ typedef uint32_t  DispatcherAction;
 #define ERR_EVENT_CAD_TIMEOUT       (1 << 1)
 #define ERR_EVENT_STARTRX_TIMEOUT   (1 << 2)
 
+#ifndef MAX_RADIO_PORTS
+  #define MAX_RADIO_PORTS   2
+#endif
+#if MAX_RADIO_PORTS < 1 || MAX_RADIO_PORTS > 8
+  #error "MAX_RADIO_PORTS must be 1..8"
+#endif
+
 /**
  * \brief  The low-level task that manages detecting incoming Packets, and the queueing
  *      and scheduling of outbound Packets.
+ *    Can drive several radios (ports), eg. two LoRa modules on different bands. Each port has its own
+ *    airtime budget, LBT and send state. Outbound packets are copied for each port getOutboundPorts() picks,
+ *    and packets from every port go through the same onRecvPacket(), so share the mesh's duplicate tables.
 */
 class Dispatcher {
-  Packet* outbound;  // current outbound packet
-  unsigned long outbound_expiry, outbound_start, total_air_time, rx_air_time;
-  unsigned long next_tx_time;
-  unsigned long cad_busy_start;
-  unsigned long radio_nonrx_start;
-  unsigned long next_floor_calib_time, next_agc_reset_time;
-  bool  prev_isrecv_mode;
+  struct RadioPort {
+    Radio* radio;
+    Packet* outbound;  // current outbound packet
+    unsigned long outbound_expiry, outbound_start, air_time;
+    unsigned long next_tx_time;
+    unsigned long cad_busy_start;
+    unsigned long radio_nonrx_start;
+    unsigned long next_floor_calib_time, next_agc_reset_time;
+    bool  prev_isrecv_mode;
+  };
+  RadioPort ports[MAX_RADIO_PORTS];
+  int num_ports;
+  unsigned long total_air_time, rx_air_time;
   uint32_t n_sent_flood, n_sent_direct;
   uint32_t n_recv_flood, n_recv_direct;
 
+  void initPort(RadioPort& port, Radio* radio);
   void processRecvPacket(Packet* pkt);
+  void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for);
 
 protected:
   PacketManager* _mgr;
-  Radio* _radio;
+  Radio* _radio;   // first (or only) port
   MillisecondClock* _ms;
   uint16_t _err_flags;
 
   Dispatcher(Radio& radio, MillisecondClock& ms, PacketManager& mgr)
     : _radio(&radio), _ms(&ms), _mgr(&mgr)
   {
-    outbound = NULL;
+    num_ports = 1;
+    initPort(ports[0], &radio);
     total_air_time = rx_air_time = 0;
-    next_tx_time = 0;
-    cad_busy_start = 0;
-    next_floor_calib_time = next_agc_reset_time = 0;
     _err_flags = 0;
-    radio_nonrx_start = 0;
-    prev_isrecv_mode = true;
   }
 
   virtual DispatcherAction onRecvPacket(Packet* pkt) = 0;
@@ -154,6 +176,12 @@ protected:
   virtual const char* getLogDateTime() { return ""; }
 
   virtual float getAirtimeBudgetFactor() const;
+
+  /**
+   * \brief  interface policy: which ports an outbound packet is sent on.
+   * \returns  mask of port numbers, (1 << port). Default is every port, so floods and direct packets cross bands.
+  */
+  virtual uint8_t getOutboundPorts(const Packet* packet) const { return 0xFF; }
   virtual int calcRxDelay(float score, uint32_t air_time) const;
   virtual uint32_t getCADFailRetryDelay() const;
   virtual uint32_t getCADFailMaxDuration() const;
@@ -164,6 +192,21 @@ public:
   void begin();
   void loop();
 
+  /**
+   * \brief  adds another radio port, must be before begin()
+   * \returns  port number, or -1 if already have MAX_RADIO_PORTS
+  */
+  int addRadio(Radio& radio);
+  int getNumRadios() const { return num_ports; }
+  Radio* getRadio(int port) const { return ports[port].radio; }
+  unsigned long getPortAirTime(int port) const { return ports[port].air_time; }  // in milliseconds
+
+  /**
+   * \brief  a port's airtime budget: after transmitting for t, it stays silent for t * factor.
+   *    Default is getAirtimeBudgetFactor(). Also used by bridges, to shape what they pass to the mesh.
+  */
+  virtual float getPortAirtimeBudgetFactor(int port) const { return getAirtimeBudgetFactor(); }
+
   Packet* obtainNewPacket();
   void releasePacket(Packet* packet);
   void sendPacket(Packet* packet, uint8_t priority, uint32_t delay_millis=0);
@@ -185,8 +228,9 @@ public:
 
 private:
   bool tryParsePacket(Packet* pkt, const uint8_t* raw, int len);
-  void checkRecv();
-  void checkSend();
+  bool checkPortSend(int p);   // returns false while port is still mid-send
+  void checkRecv(int p);
+  void checkSend(int p);
 };
 
 }
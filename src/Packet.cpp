@@ -8,6 +8,7 @@ Packet::Packet() {
   header = 0;
   path_len = 0;
   payload_len = 0;
+  _rx_port = _tx_ports = 0;
 }
 
 bool Packet::isValidPathLen(uint8_t path_len) {
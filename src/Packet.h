@@ -49,6 +49,8 @@ public:
   uint8_t path[MAX_PATH_SIZE];
   uint8_t payload[MAX_PACKET_PAYLOAD];
   int8_t _snr;
+  uint8_t _rx_port;    // Dispatcher radio port this was received on
+  uint8_t _tx_ports;   // mask of Dispatcher radio ports this is queued for
 
   /**
    * \brief calculate the hash of payload + type
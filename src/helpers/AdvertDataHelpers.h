@@ -16,6 +16,9 @@
 #define ADV_FEAT2_MASK        0x40   // FUTURE
 #define ADV_NAME_MASK         0x80
 
+// feat1 bits
+#define ADV_FEAT1_TXT_COMPRESS  0x0001   // chat node can decode TXT_FLAG_COMPRESSED text
+
 class AdvertDataBuilder {
   uint8_t _type;
   bool _has_loc;
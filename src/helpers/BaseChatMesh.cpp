@@ -21,6 +21,7 @@ mesh::Packet* BaseChatMesh::createSelfAdvert(const char* name) {
   uint8_t app_data_len;
   {
     AdvertDataBuilder builder(ADV_TYPE_CHAT, name);
+    builder.setFeat1(ADV_FEAT1_TXT_COMPRESS);
     app_data_len = builder.encodeTo(app_data);
   }
 
@@ -32,6 +33,7 @@ mesh::Packet* BaseChatMesh::createSelfAdvert(const char* name, double lat, doubl
   uint8_t app_data_len;
   {
     AdvertDataBuilder builder(ADV_TYPE_CHAT, name, lat, lon);
+    builder.setFeat1(ADV_FEAT1_TXT_COMPRESS);
     app_data_len = builder.encodeTo(app_data);
   }
 
@@ -69,26 +71,54 @@ void BaseChatMesh::bootstrapRTCfromContacts() {
 
 ContactInfo* BaseChatMesh::allocateContactSlot() {
   if (num_contacts < MAX_CONTACTS) {
+    contact_last_used[num_contacts] = ++use_counter;
     return &contacts[num_contacts++];
-  } else if (shouldOverwriteWhenFull()) {
+  }
+
+  // try paging out the least recently used contact (non-favourites first)
+  int lru_idx = -1;
+  for (int i = 0; i < num_contacts; i++) {
+    if (isContactPinned(i)) continue;   // caller may still hold a pointer to it
+    bool is_favourite = (contacts[i].flags & 0x01) != 0;
+    bool lru_favourite = lru_idx >= 0 && (contacts[lru_idx].flags & 0x01) != 0;
+    if (lru_idx < 0 || (is_favourite == lru_favourite ? contact_last_used[i] < contact_last_used[lru_idx] : lru_favourite)) {
+      lru_idx = i;
+    }
+  }
+  if (lru_idx >= 0 && pageOutContact(contacts[lru_idx])) {
+    contact_last_used[lru_idx] = ++use_counter;
+    return &contacts[lru_idx];
+  }
+
+  if (shouldOverwriteWhenFull()) {
     // Find oldest non-favourite contact by oldest lastmod timestamp
     int oldest_idx = -1;
     uint32_t oldest_lastmod = 0xFFFFFFFF;
     for (int i = 0; i < num_contacts; i++) {
       bool is_favourite = (contacts[i].flags & 0x01) != 0;
-      if (!is_favourite && contacts[i].lastmod < oldest_lastmod) {
+      if (!is_favourite && !isContactPinned(i) && contacts[i].lastmod < oldest_lastmod) {
         oldest_lastmod = contacts[i].lastmod;
         oldest_idx = i;
       }
     }
     if (oldest_idx >= 0) {
       onContactOverwrite(contacts[oldest_idx].id.pub_key);
+      contact_last_used[oldest_idx] = ++use_counter;
       return &contacts[oldest_idx];
     }
   }
   return NULL; // no space, no overwrite or all contacts are all favourites
 }
 
+mesh::DispatcherAction BaseChatMesh::onRecvPacket(mesh::Packet* pkt) {
+  // the handlers hold ContactInfo pointers (eg. the sender) while paging in others, so pin every contact
+  // used while handling this packet
+  pinned_after = use_counter;
+  auto action = mesh::Mesh::onRecvPacket(pkt);
+  pinned_after = 0xFFFFFFFF;
+  return action;
+}
+
 void BaseChatMesh::populateContactFromAdvert(ContactInfo& ci, const mesh::Identity& id, const AdvertDataParser& parser, uint32_t timestamp) {
   memset(&ci, 0, sizeof(ci));
   ci.id = id;
@@ -110,17 +140,23 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     return;
   }
 
+  setCompressPeer(id.pub_key, parser.getType() == ADV_TYPE_CHAT && (parser.getFeat1() & ADV_FEAT1_TXT_COMPRESS) != 0);
+
   ContactInfo* from = NULL;
   for (int i = 0; i < num_contacts; i++) {
     if (id.matches(contacts[i].id)) {  // is from one of our contacts
       from = &contacts[i];
-      if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
-        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
-        return;
-      }
+      touchContact(from);
       break;
     }
   }
+  if (from == NULL) {
+    from = pageInContact(id.pub_key, PUB_KEY_SIZE);   // maybe one of our paged out contacts
+  }
+  if (from && timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
+    MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+    return;
+  }
 
   // save a copy of raw advert packet (to support "Share..." function)
   int plen;
@@ -176,32 +212,66 @@ int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
       matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
   }
+  if (n < MAX_SEARCH_RESULTS) {
+    // also try any paged out contacts, but only page one in if packet turns out to be from them
+    int k = searchPagedContactsByHash(hash, paged_matches, MAX_SEARCH_RESULTS - n);
+    for (int j = 0; j < k; j++) {
+      matching_peer_indexes[n++] = MAX_CONTACTS + j;
+    }
+  }
   return n;
 }
 
+ContactInfo* BaseChatMesh::getMatchingPeer(int peer_idx) {
+  int i = matching_peer_indexes[peer_idx];
+  if (i >= MAX_CONTACTS && i < MAX_CONTACTS + MAX_SEARCH_RESULTS) {
+    return pageInContact(paged_matches[i - MAX_CONTACTS], PUB_KEY_SIZE);
+  }
+  if (i >= 0 && i < num_contacts) {
+    touchContact(&contacts[i]);
+    return &contacts[i];
+  }
+  return NULL;
+}
+
 void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
   if (i >= 0 && i < num_contacts) {
     memcpy(dest_secret, contacts[i].getSharedSecret(self_id), PUB_KEY_SIZE);
+  } else if (i >= MAX_CONTACTS && i < MAX_CONTACTS + MAX_SEARCH_RESULTS) {
+    self_id.calcSharedSecret(dest_secret, paged_matches[i - MAX_CONTACTS]);
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
 }
 
 void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) {
-  int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
-    MESH_DEBUG_PRINTLN("onPeerDataRecv: Invalid sender idx: %d", i);
+  ContactInfo* sender = getMatchingPeer(sender_idx);
+  if (sender == NULL) {
+    MESH_DEBUG_PRINTLN("onPeerDataRecv: Invalid sender idx: %d", matching_peer_indexes[sender_idx]);
     return;
   }
 
-  ContactInfo& from = contacts[i];
+  ContactInfo& from = *sender;
 
   if (type == PAYLOAD_TYPE_TXT_MSG && len > 5) {
     uint32_t timestamp;
     memcpy(&timestamp, data, 4);  // timestamp (by sender's RTC clock - which could be wrong)
     uint8_t flags = data[4] >> 2;   // message attempt number, and other flags
 
+    uint8_t plain[5 + MAX_TEXT_LEN + 1];
+    if (flags & TXT_FLAG_COMPRESSED) {
+      int n = decompressText(plain, data, len);
+      if (n < 0) {
+        MESH_DEBUG_PRINTLN("onPeerDataRecv: invalid compressed text");
+        return;
+      }
+      setCompressPeer(from.id.pub_key, true);
+      data = plain;   // NOTE: ACK hash is of the decompressed text, but with the txt_type as sent
+      len = n;
+      flags &= ~TXT_FLAG_COMPRESSED;
+    }
+
     // len can be > original length, but 'text' will be padded with zeroes
     data[len] = 0; // need to make a C string again, with null terminator
 
@@ -239,6 +309,38 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
       uint32_t ack_hash;    // calc truncated hash of the message timestamp + text + OUR pub_key, to prove to sender that we got it
       mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, 9 + strlen((char *)&data[9]), self_id.pub_key, PUB_KEY_SIZE);
 
+      if (packet->isRouteFlood()) {
+        // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the ACK
+        mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
+                                                PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4);
+        if (path) sendFloodScoped(from, path, TXT_ACK_DELAY);
+      } else {
+        sendAckTo(from, ack_hash);
+      }
+    } else if (flags == TXT_TYPE_SIGNED_BATCH) {
+      // records of: timestamp(4), sender_prefix(4), text_len(1), text
+      int num = data[5];
+      int i = 6;
+      char text[MAX_PACKET_PAYLOAD];
+      from.lastmod = getRTCClock()->getCurrentTime(); // update last heard time
+      while (num > 0 && i + 9 <= (int)len && i + 9 + data[i + 8] <= (int)len) {
+        uint32_t post_timestamp;
+        memcpy(&post_timestamp, &data[i], 4);
+        int text_len = data[i + 8];
+        memcpy(text, &data[i + 9], text_len);
+        text[text_len] = 0;
+
+        if (post_timestamp > from.sync_since) {  // make sure 'sync_since' is up-to-date
+          from.sync_since = post_timestamp;
+        }
+        onSignedMessageRecv(from, packet, post_timestamp, &data[i + 4], text);  // let UI know
+        i += 9 + text_len;
+        num--;
+      }
+
+      uint32_t ack_hash;    // calc truncated hash of the whole batch + OUR pub_key, to prove to sender that we got it
+      mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, i, self_id.pub_key, PUB_KEY_SIZE);
+
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the ACK
         mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
@@ -272,7 +374,7 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
       }
     }
   } else if (type == PAYLOAD_TYPE_RESPONSE && len > 0) {
-    onContactResponse(from, data, len);
+    if (!handleMultipartFragment(from, data, len, false)) onContactResponse(from, data, len);
     if (packet->isRouteFlood() && from.out_path_len != OUT_PATH_UNKNOWN) {
       // we have direct path, but other node is still sending flood response, so maybe they didn't receive reciprocal path properly(?)
       handleReturnPathRetry(from, packet->path, packet->path_len);
@@ -281,13 +383,13 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
 }
 
 bool BaseChatMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
-  int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
-    MESH_DEBUG_PRINTLN("onPeerPathRecv: Invalid sender idx: %d", i);
+  ContactInfo* sender = getMatchingPeer(sender_idx);
+  if (sender == NULL) {
+    MESH_DEBUG_PRINTLN("onPeerPathRecv: Invalid sender idx: %d", matching_peer_indexes[sender_idx]);
     return false;
   }
 
-  ContactInfo& from = contacts[i];
+  ContactInfo& from = *sender;
 
   return onContactPathRecv(from, packet->path, packet->path_len, path, path_len, extra_type, extra, extra_len);
 }
@@ -306,11 +408,66 @@ bool BaseChatMesh::onContactPathRecv(ContactInfo& from, uint8_t* in_path, uint8_
       txt_send_timeout = 0;   // matched one we're waiting for, cancel timeout timer
     }
   } else if (extra_type == PAYLOAD_TYPE_RESPONSE && extra_len > 0) {
-    onContactResponse(from, extra, extra_len);
+    if (!handleMultipartFragment(from, extra, extra_len, true)) onContactResponse(from, extra, extra_len);
   }
   return true;  // send reciprocal path if necessary
 }
 
+bool BaseChatMesh::handleMultipartFragment(const ContactInfo& from, const uint8_t* data, uint8_t len, bool via_path) {
+  if (len < 5) return false;
+
+  uint32_t tag;
+  memcpy(&tag, data, 4);
+  MultipartSession* s = multipart.findSession(tag, from.id.pub_key, false);
+  if (s == NULL) return false;   // not a multipart reply
+
+  if (data[4] == MULTIPART_UNFRAGMENTED) {   // responder fell back to a normal reply
+    multipart.release(s);
+    uint8_t temp[MAX_PACKET_PAYLOAD];
+    memcpy(temp, &tag, 4);
+    memcpy(&temp[4], &data[5], len - 5);
+    onContactResponse(from, temp, len - 1);
+    return true;
+  }
+
+  int res = multipart.recvFragment(s, data, len);
+  if (res > 0) {
+    for (int i = 0; i < s->count; i++) {
+      const uint8_t* chunk;
+      int chunk_len = multipart.getChunk(s, i, &chunk);
+      onContactResponsePart(from, tag, i, s->count, chunk, chunk_len);
+    }
+    if (s->count > 1) sendMultipartAck(s);   // let responder free its buffers now
+    multipart.release(s);
+  } else if (res == 0 && via_path) {
+    // flood request, so responder only sent fragment 0 with the returned path, and is waiting for this ACK to send the rest
+    sendMultipartAck(s);
+  }
+  return true;
+}
+
+void BaseChatMesh::sendMultipartAck(const MultipartSession* s) {
+  ContactInfo* contact = lookupContactByPubKey(s->peer, sizeof(s->peer));
+  if (contact == NULL) return;
+
+  uint8_t req[7];
+  req[0] = REQ_TYPE_MULTIPART_ACK;
+  memcpy(&req[1], &s->tag, 4);
+  memcpy(&req[5], &s->mask, 2);
+
+  uint32_t tag, est_timeout;
+  sendRequest(*contact, req, sizeof(req), tag, est_timeout);
+}
+
+void BaseChatMesh::onContactResponsePart(const ContactInfo& contact, uint32_t tag, int idx, int count, const uint8_t* chunk, int chunk_len) {
+  if (count == 1) {   // fits a normal response
+    uint8_t temp[4 + MULTIPART_CHUNK_SIZE];
+    memcpy(temp, &tag, 4);
+    memcpy(&temp[4], chunk, chunk_len);
+    onContactResponse(contact, temp, 4 + chunk_len);
+  }
+}
+
 void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
   ContactInfo* from;
   if ((from = processAck((uint8_t *)&ack_crc)) != NULL) {
@@ -345,6 +502,14 @@ int BaseChatMesh::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel d
 
 void BaseChatMesh::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) {
   uint8_t txt_type = data[4];
+  uint8_t plain[5 + MAX_TEXT_LEN + 1];
+  if (type == PAYLOAD_TYPE_GRP_TXT && len > 5 && (txt_type >> 2) == TXT_FLAG_COMPRESSED) {
+    int n = decompressText(plain, data, len);
+    if (n < 0) return;
+    data = plain;
+    len = n;
+    txt_type &= ~(TXT_FLAG_COMPRESSED << 2);
+  }
   if (type == PAYLOAD_TYPE_GRP_TXT && len > 5 && (txt_type >> 2) == 0) {  // 0 = plain text msg
     uint32_t timestamp;
     memcpy(&timestamp, data, 4);
@@ -367,9 +532,21 @@ mesh::Packet* BaseChatMesh::composeMsgPacket(const ContactInfo& recipient, uint3
   temp[4] = (attempt & 3);
   memcpy(&temp[5], text, text_len + 1);
 
-  // calc expected ACK reply
+  uint8_t packed[MAX_TEXT_LEN];
+  int packed_len = 0;
+  if (attempt <= 3 && canCompressTo(recipient)) {
+    packed_len = TextCompressor::compress(packed, sizeof(packed), text, text_len);
+    if (packed_len > 0) temp[4] |= (TXT_FLAG_COMPRESSED << 2);
+  }
+
+  // calc expected ACK reply (always of the uncompressed text)
   mesh::Utils::sha256((uint8_t *)&expected_ack, 4, temp, 5 + text_len, self_id.pub_key, PUB_KEY_SIZE);
 
+  if (packed_len > 0) {
+    memcpy(&temp[5], packed, packed_len);
+    return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, recipient.getSharedSecret(self_id), temp, 5 + packed_len);
+  }
+
   int len = 5 + text_len;
   if (attempt > 3) {
     temp[len++] = 0;  // null terminator
@@ -437,7 +614,18 @@ bool BaseChatMesh::sendGroupMessage(uint32_t timestamp, mesh::GroupChannel& chan
   memcpy(ep, text, text_len);
   ep[text_len] = 0;  // null terminator
 
-  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_TXT, channel, temp, 5 + prefix_len + text_len);
+  int len = 5 + prefix_len + text_len;
+  if (allowCompressedChannelText(channel)) {
+    uint8_t packed[MAX_TEXT_LEN];
+    int packed_len = TextCompressor::compress(packed, sizeof(packed), (const char *) &temp[5], prefix_len + text_len);
+    if (packed_len > 0) {
+      temp[4] |= (TXT_FLAG_COMPRESSED << 2);
+      memcpy(&temp[5], packed, packed_len);
+      len = 5 + packed_len;
+    }
+  }
+
+  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_TXT, channel, temp, len);
   if (pkt) {
     sendFloodScoped(channel, pkt);
     return true;
@@ -445,6 +633,33 @@ bool BaseChatMesh::sendGroupMessage(uint32_t timestamp, mesh::GroupChannel& chan
   return false;
 }
 
+void BaseChatMesh::setCompressPeer(const uint8_t* pub_key, bool can_decode) {
+  for (int i = 0; i < MAX_COMPRESS_PEERS; i++) {
+    if (memcmp(compress_peers[i], pub_key, 4) == 0) {
+      if (!can_decode) memset(compress_peers[i], 0, 4);   // eg. downgraded firmware
+      return;
+    }
+  }
+  if (can_decode) {   // replace the oldest
+    memcpy(compress_peers[next_compress_peer], pub_key, 4);
+    next_compress_peer = (next_compress_peer + 1) % MAX_COMPRESS_PEERS;
+  }
+}
+
+bool BaseChatMesh::canCompressTo(const ContactInfo& contact) const {
+  if (contact.type != ADV_TYPE_CHAT) return false;
+  for (int i = 0; i < MAX_COMPRESS_PEERS; i++) {
+    if (memcmp(compress_peers[i], contact.id.pub_key, 4) == 0) return true;
+  }
+  return false;
+}
+
+int BaseChatMesh::decompressText(uint8_t* dest, const uint8_t* data, size_t len) {
+  memcpy(dest, data, 5);   // timestamp, txt_type
+  int n = TextCompressor::decompress((char *) &dest[5], MAX_TEXT_LEN, &data[5], len - 5);
+  return n < 0 ? -1 : 5 + n;
+}
+
 bool BaseChatMesh::shareContactZeroHop(const ContactInfo& contact) {
   int plen = getBlobByKey(contact.id.pub_key, PUB_KEY_SIZE, temp_buf);  // retrieve last raw advert packet
   if (plen == 0) return false;  // not found
@@ -482,14 +697,16 @@ int BaseChatMesh::sendLogin(const ContactInfo& recipient, const char* password,
   mesh::Packet* pkt;
   {
     int tlen;
-    uint8_t temp[24];
+    uint8_t temp[28];
     uint32_t now = getRTCClock()->getCurrentTimeUnique();
     memcpy(temp, &now, 4);   // mostly an extra blob to help make packet_hash unique
     if (recipient.type == ADV_TYPE_ROOM) {
       memcpy(&temp[4], &recipient.sync_since, 4);
       int len = strlen(password); if (len > 15) len = 15;  // max 15 chars currently
       memcpy(&temp[8], password, len);
-      tlen = 8 + len;
+      temp[8 + len] = 0;    // older room servers just see a null terminated password
+      temp[9 + len] = ROOM_CLIENT_VER_LEVEL;
+      tlen = 10 + len;
     } else {
       int len = strlen(password); if (len > 15) len = 15;  // max 15 chars currently
       memcpy(&temp[4], password, len);
@@ -550,6 +767,9 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, const uint8_t* req_
 
     pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, recipient.getSharedSecret(self_id), temp, 4 + data_len);
   }
+  if (pkt && data_len > 0 && (req_data[0] & REQ_FLAG_MULTIPART) != 0) {
+    multipart.expectInbound(tag, recipient.id.pub_key);
+  }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
     if (recipient.out_path_len == OUT_PATH_UNKNOWN) {
@@ -752,9 +972,26 @@ ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
 ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
   for (int i = 0; i < num_contacts; i++) {
     auto c = &contacts[i];
-    if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
+    if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) {
+      touchContact(c);
+      return c;
+    }
   }
-  return NULL;  // not found
+  return pageInContact(pub_key, prefix_len);  // NULL if not found
+}
+
+ContactInfo* BaseChatMesh::pageInContact(const uint8_t* pub_key, int prefix_len) {
+  ContactInfo c;
+  if (!loadPagedContact(pub_key, prefix_len, c)) return NULL;
+
+  ContactInfo* dest = allocateContactSlot();   // may page out another
+  if (dest == NULL) {
+    pageOutContact(c);   // put it back
+    return NULL;
+  }
+  *dest = c;
+  dest->shared_secret_valid = false;
+  return dest;
 }
 
 bool BaseChatMesh::addContact(const ContactInfo& contact) {
@@ -778,6 +1015,7 @@ bool BaseChatMesh::removeContact(ContactInfo& contact) {
   num_contacts--;
   while (idx < num_contacts) {
     contacts[idx] = contacts[idx + 1];
+    contact_last_used[idx] = contact_last_used[idx + 1];
     idx++;
   }
   return true;  // Success
@@ -795,6 +1033,7 @@ ChannelDetails* BaseChatMesh::addChannel(const char* name, const char* psk_base6
     if (len == 32 || len == 16) {
       mesh::Utils::sha256(dest->channel.hash, sizeof(dest->channel.hash), dest->channel.secret, len);
       StrHelper::strncpy(dest->name, name, sizeof(dest->name));
+      dest->flags = 0;
       num_channels++;
       return dest;
     }
@@ -843,6 +1082,12 @@ int BaseChatMesh::findChannelIdx(const mesh::GroupChannel& ch) {
 }
 #endif
 
+bool BaseChatMesh::allowCompressedChannelText(const mesh::GroupChannel& channel) {
+  // a channel can't negotiate, so only if the user has said all members support it
+  ChannelDetails details;
+  return getChannel(findChannelIdx(channel), details) && (details.flags & CHANNEL_FLAG_COMPRESS_TEXT) != 0;
+}
+
 bool BaseChatMesh::getContactByIdx(uint32_t idx, ContactInfo& contact) {
   if (idx >= num_contacts) return false;
 
@@ -855,7 +1100,9 @@ ContactsIterator BaseChatMesh::startContactsIterator() {
 }
 
 bool ContactsIterator::hasNext(const BaseChatMesh* mesh, ContactInfo& dest) {
-  if (next_idx >= mesh->getNumContacts()) return false;
+  if (next_idx >= mesh->getNumContacts()) {
+    return mesh->getNextPagedContact(paged_cursor, dest);   // then any paged out ones
+  }
 
   dest = mesh->contacts[next_idx++];
   return true;
@@ -864,6 +1111,10 @@ bool ContactsIterator::hasNext(const BaseChatMesh* mesh, ContactInfo& dest) {
 void BaseChatMesh::loop() {
   Mesh::loop();
 
+  multipart.checkExpired();
+  MultipartSession* s = multipart.getNextAckDue();
+  if (s) sendMultipartAck(s);   // some fragments are missing
+
   if (txt_send_timeout && millisHasNowPassed(txt_send_timeout)) {
     // failed to get an ACK
     onSendTimeout();
@@ -4,6 +4,8 @@
 #include <Mesh.h>
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/TxtDataHelpers.h>
+#include <helpers/MultipartReply.h>
+#include <helpers/TextCompressor.h>
 
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
@@ -29,6 +31,7 @@ class BaseChatMesh;
 
 class ContactsIterator {
   int next_idx = 0;
+  int paged_cursor = 0;
 public:
   bool hasNext(const BaseChatMesh* mesh, ContactInfo& dest);
 };
@@ -41,6 +44,11 @@ public:
   #define MAX_CONNECTIONS  16
 #endif
 
+// contacts remembered as able to decode compressed text (from their adverts)
+#ifndef MAX_COMPRESS_PEERS
+  #define MAX_COMPRESS_PEERS  32
+#endif
+
 struct ConnectionInfo {
   mesh::Identity server_id;
   unsigned long next_ping;
@@ -59,9 +67,13 @@ class BaseChatMesh : public mesh::Mesh {
   friend class ContactsIterator;
 
   ContactInfo contacts[MAX_CONTACTS];
+  uint32_t contact_last_used[MAX_CONTACTS];   // for choosing which contact to page out
+  uint32_t use_counter;
+  uint32_t pinned_after;   // while handling a packet, contacts used since then are pinned (not paged out/overwritten)
   int num_contacts;
   int sort_array[MAX_CONTACTS];
   int matching_peer_indexes[MAX_SEARCH_RESULTS];
+  uint8_t paged_matches[MAX_SEARCH_RESULTS][PUB_KEY_SIZE];   // pub_keys of paged out contacts, which match hash
   unsigned long txt_send_timeout;
 #ifdef MAX_GROUP_CHANNELS
   ChannelDetails channels[MAX_GROUP_CHANNELS];
@@ -70,15 +82,29 @@ class BaseChatMesh : public mesh::Mesh {
   mesh::Packet* _pendingLoopback;
   uint8_t temp_buf[MAX_TRANS_UNIT];
   ConnectionInfo connections[MAX_CONNECTIONS];
+  MultipartTransfers multipart;
+  uint8_t compress_peers[MAX_COMPRESS_PEERS][4];   // pub_key prefixes (transient)
+  int next_compress_peer;
 
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, uint32_t ack_hash);
+  void touchContact(const ContactInfo* contact) { contact_last_used[contact - contacts] = ++use_counter; }
+  bool isContactPinned(int idx) const { return contact_last_used[idx] > pinned_after; }
+  ContactInfo* pageInContact(const uint8_t* pub_key, int prefix_len);
+  ContactInfo* getMatchingPeer(int peer_idx);
+  bool handleMultipartFragment(const ContactInfo& from, const uint8_t* data, uint8_t len, bool via_path);
+  void sendMultipartAck(const MultipartSession* s);
+  void setCompressPeer(const uint8_t* pub_key, bool can_decode);
+  bool canCompressTo(const ContactInfo& contact) const;
+  int  decompressText(uint8_t* dest, const uint8_t* data, size_t len);
 
 protected:
   BaseChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
       : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
   { 
     num_contacts = 0;
+    use_counter = 0;
+    pinned_after = 0xFFFFFFFF;
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
@@ -86,6 +112,9 @@ protected:
     txt_send_timeout = 0;
     _pendingLoopback = NULL;
     memset(connections, 0, sizeof(connections));
+    multipart.begin(&mgr, &ms);
+    memset(compress_peers, 0, sizeof(compress_peers));
+    next_compress_peer = 0;
   }
 
   void bootstrapRTCfromContacts();
@@ -97,6 +126,7 @@ protected:
   virtual bool isAutoAddEnabled() const { return true; }
   virtual bool shouldAutoAddContactType(uint8_t type) const { return true; }
   virtual void onContactsFull() {};
+  virtual bool allowCompressedChannelText(const mesh::GroupChannel& channel);   // default: channel has CHANNEL_FLAG_COMPRESS_TEXT
   virtual bool shouldOverwriteWhenFull() const { return false; }
   virtual void onContactOverwrite(const uint8_t* pub_key) {};
   virtual void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) = 0;
@@ -112,6 +142,8 @@ protected:
   virtual void onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) = 0;
   virtual uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) = 0;
   virtual void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) = 0;
+  // reply to a request sent with REQ_FLAG_MULTIPART, called for each chunk in order, once all have arrived
+  virtual void onContactResponsePart(const ContactInfo& contact, uint32_t tag, int idx, int count, const uint8_t* chunk, int chunk_len);
   virtual void handleReturnPathRetry(const ContactInfo& contact, const uint8_t* path, uint8_t path_len);
 
   virtual void sendFloodScoped(const ContactInfo& recipient, mesh::Packet* pkt, uint32_t delay_millis=0);
@@ -121,7 +153,14 @@ protected:
   virtual int  getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) { return 0; }  // not implemented
   virtual bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) { return false; }
 
+  // contact paging, for sub-classes which can keep more contacts in storage than fit in contacts[]
+  virtual bool pageOutContact(const ContactInfo& contact) { return false; }   // true if now safely in storage
+  virtual bool loadPagedContact(const uint8_t* pub_key, int prefix_len, ContactInfo& dest) { return false; }
+  virtual int  searchPagedContactsByHash(const uint8_t* hash, uint8_t pub_keys[][PUB_KEY_SIZE], int max_matches) { return 0; }
+  virtual bool getNextPagedContact(int& cursor, ContactInfo& dest) const { return false; }
+
   // Mesh overrides
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override;
   void onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) override;
   int searchPeersByHash(const uint8_t* hash) override;
   void getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) override;
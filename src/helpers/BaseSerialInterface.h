@@ -18,4 +18,16 @@ public:
   virtual bool isWriteBusy() const = 0;
   virtual size_t writeFrame(const uint8_t src[], size_t len) = 0;
   virtual size_t checkRecvFrame(uint8_t dest[]) = 0;
+
+  /**
+   * \returns  number of frames dropped because the send or recv queue was full
+   */
+  virtual uint32_t getNumDroppedFrames() const { return 0; }
+
+  /**
+   * \brief  for interfaces with several clients, identifies the client that replies (non-push frames) go to.
+   *     Defaults to the client that sent the last frame returned by checkRecvFrame().
+   */
+  virtual int getReplySession() const { return 0; }
+  virtual void setReplySession(int session) { }
 };
@@ -3,7 +3,10 @@
 #include <Arduino.h>
 #include <Mesh.h>
 
+#define CHANNEL_FLAG_COMPRESS_TEXT   0x01   // all members can decode TXT_FLAG_COMPRESSED
+
 struct ChannelDetails {
   mesh::GroupChannel channel;
   char name[32];
+  uint8_t flags;
 };
@@ -1,4 +1,5 @@
 #include "ClientACL.h"
+#include "CompactEncoding.h"
 
 static File openWrite(FILESYSTEM* _fs, const char* filename) {
   #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
@@ -141,3 +142,45 @@ bool ClientACL::applyPermissions(const mesh::LocalIdentity& self_id, const uint8
   }
   return true;
 }
+
+int ClientACL::exportCompact(uint8_t* dest, int max_len, int prefix_len) const {
+  CompactWriter out(dest, max_len);
+
+  int total = 0;
+  for (int i = 0; i < num_clients; i++) {
+    if (clients[i].permissions != 0) total++;
+  }
+  out.putVarint(total);
+
+  bool full = out.hasOverflow();
+  for (int i = 0; i < num_clients && !full; i++) {
+    uint8_t perms = clients[i].permissions;
+    if (perms == 0) continue;
+
+    bool done = false;   // group already written?
+    for (int j = 0; j < i && !done; j++) done = clients[j].permissions == perms;
+    if (done) continue;
+
+    int group = out.mark();
+    out.putByte(perms);
+    out.putByte(0);   // count, filled in below
+    int n = 0;
+    for (int k = i; k < num_clients && n < 255 && !out.hasOverflow(); k++) {
+      if (clients[k].permissions != perms) continue;
+      int m = out.mark();
+      out.putBytes(clients[k].id.pub_key, prefix_len);
+      if (out.hasOverflow()) {
+        out.rewind(m);
+        full = true;
+        break;
+      }
+      n++;
+    }
+    if (n == 0) {
+      out.rewind(group);
+      break;
+    }
+    dest[group + 1] = n;
+  }
+  return out.getLength();
+}
@@ -25,8 +25,15 @@ struct ClientInfo {
       uint32_t sync_since;  // sync messages SINCE this timestamp (by OUR clock)
       uint32_t pending_ack;
       uint32_t push_post_timestamp;
+      uint32_t post_cursor;   // first post after sync_since, ie. cached lookup  (transient)
+      uint32_t cursor_since;  // the sync_since that post_cursor was found for
       unsigned long ack_timeout;
       uint8_t  push_failures;
+      uint32_t prev_ack;      // of last timed out push, in case it arrives late
+      uint32_t prev_ack_post_timestamp;
+      uint16_t num_synced;    // posts ACK'd by client
+      uint16_t sync_latency_avg, sync_latency_max;   // secs, from post to ACK
+      uint8_t  client_ver;    // ROOM_CLIENT_VER_LEVEL sent at login
     } room;
   } extra;
   
@@ -55,6 +62,13 @@ public:
   ClientInfo* putClient(const mesh::Identity& id, uint8_t init_perms);
   bool applyPermissions(const mesh::LocalIdentity& self_id, const uint8_t* pubkey, int key_len, uint8_t perms);
 
+  /**
+   * \brief  writes the ACL grouped by permissions: varint total entries, then for each distinct permissions
+   *     value: permissions(1), count(1), count x pub_key prefix.  Deleted entries are skipped.
+   * \returns  length written, which only includes whole entries
+   */
+  int exportCompact(uint8_t* dest, int max_len, int prefix_len) const;
+
   int getNumClients() const { return num_clients; }
   ClientInfo* getClientByIdx(int idx) { return &clients[idx]; }
 };
@@ -345,6 +345,8 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
                 "rs232"
 #elif WITH_ESPNOW_BRIDGE
                 "espnow"
+#elif WITH_UDP_BRIDGE
+                "udp"
 #else
                 "none"
 #endif
@@ -364,6 +366,8 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
 #ifdef WITH_ESPNOW_BRIDGE
       } else if (memcmp(config, "bridge.channel", 14) == 0) {
         sprintf(reply, "> %d", (uint32_t)_prefs->bridge_channel);
+#endif
+#if defined(WITH_ESPNOW_BRIDGE) || defined(WITH_UDP_BRIDGE)
       } else if (memcmp(config, "bridge.secret", 13) == 0) {
         sprintf(reply, "> %s", _prefs->bridge_secret);
 #endif
@@ -623,6 +627,8 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
         } else {
           strcpy(reply, "Error: channel must be between 1-14");
         }
+#endif
+#if defined(WITH_ESPNOW_BRIDGE) || defined(WITH_UDP_BRIDGE)
       } else if (memcmp(config, "bridge.secret ", 14) == 0) {
         StrHelper::strncpy(_prefs->bridge_secret, &config[14], sizeof(_prefs->bridge_secret));
         _callbacks->restartBridge();
@@ -807,6 +813,8 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
       _callbacks->formatRadioStatsReply(reply);
     } else if (sender_timestamp == 0 && memcmp(command, "stats-core", 10) == 0 && (command[10] == 0 || command[10] == ' ')) {
       _callbacks->formatStatsReply(reply);
+    } else if (sender_timestamp == 0 && memcmp(command, "stats-bridge", 12) == 0 && (command[12] == 0 || command[12] == ' ')) {
+      _callbacks->formatBridgeStatsReply(reply);
     } else {
       strcpy(reply, "Unknown command");
     }
@@ -5,7 +5,7 @@
 #include <helpers/SensorManager.h>
 #include <helpers/ClientACL.h>
 
-#if defined(WITH_RS232_BRIDGE) || defined(WITH_ESPNOW_BRIDGE)
+#if defined(WITH_RS232_BRIDGE) || defined(WITH_ESPNOW_BRIDGE) || defined(WITH_UDP_BRIDGE)
 #define WITH_BRIDGE
 #endif
 
@@ -41,8 +41,8 @@ struct NodePrefs { // persisted to file
   uint16_t bridge_delay;  // milliseconds (default 500 ms)
   uint8_t bridge_pkt_src; // 0 = logTx, 1 = logRx (default logTx)
   uint32_t bridge_baud;   // 9600, 19200, 38400, 57600, 115200 (default 115200)
-  uint8_t bridge_channel; // 1-14 (ESP-NOW only)
-  char bridge_secret[16]; // for XOR encryption of bridge packets (ESP-NOW only)
+  uint8_t bridge_channel; // 1-14 (ESP-NOW and UDP)
+  char bridge_secret[16]; // key for encrypting and authenticating bridge packets (ESP-NOW and UDP)
   // Power setting
   uint8_t powersaving_enabled; // boolean
   // Gps settings
@@ -88,6 +88,10 @@ public:
   virtual void restartBridge() {
     // no op by default
   };
+
+  virtual void formatBridgeStatsReply(char *reply) {
+    strcpy(reply, "Bridge not supported");
+  };
 };
 
 class CommonCLI {
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * \brief  Writes compact response fields: LEB128 varints, zig-zag signed deltas, raw bytes.
+ *     Fields that don't fit set the overflow flag, so a caller can mark() before an entry, and rewind()
+ *     to drop a partly written entry, keeping responses to whole entries.
+ */
+class CompactWriter {
+  uint8_t* _buf;
+  int _len, _max;
+  bool _overflow;
+
+public:
+  CompactWriter(uint8_t* buf, int max_len) : _buf(buf), _len(0), _max(max_len), _overflow(false) { }
+
+  void putByte(uint8_t b) {
+    if (_len < _max) _buf[_len++] = b; else _overflow = true;
+  }
+  void putBytes(const uint8_t* src, int n) {
+    if (_len + n <= _max) { memcpy(&_buf[_len], src, n); _len += n; } else _overflow = true;
+  }
+  void putVarint(uint32_t v) {
+    while (v >= 0x80) {
+      putByte((v & 0x7F) | 0x80);
+      v >>= 7;
+    }
+    putByte(v);
+  }
+  void putSigned(int32_t v) {   // zig-zag, so small negatives are small too
+    putVarint(((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+  }
+
+  int mark() const { return _len; }
+  void rewind(int mark) { _len = mark; _overflow = false; }
+  bool hasOverflow() const { return _overflow; }
+  int getLength() const { return _len; }
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "BaseSerialInterface.h"
+
+#define FRAME_POOL_HEADROOM   3    // space in front of each frame for a transport header, eg. WiFi '>' + len
+
+// RAM budget for all frame buffers of a serial interface (send + recv)
+#ifndef SERIAL_FRAME_POOL_BYTES
+  #if defined(NRF52_PLATFORM)
+    #define SERIAL_FRAME_POOL_BYTES  (24 * (FRAME_POOL_HEADROOM + MAX_FRAME_SIZE))
+  #else
+    #define SERIAL_FRAME_POOL_BYTES  (16 * (FRAME_POOL_HEADROOM + MAX_FRAME_SIZE))
+  #endif
+#endif
+
+#define SERIAL_FRAME_POOL_SIZE  (SERIAL_FRAME_POOL_BYTES / (FRAME_POOL_HEADROOM + MAX_FRAME_SIZE))
+
+#if SERIAL_FRAME_POOL_SIZE < 2 || SERIAL_FRAME_POOL_SIZE > 254
+  #error "SERIAL_FRAME_POOL_BYTES must allow 2..254 frames"
+#endif
+
+/**
+ * \brief  Fixed pool of frame buffers, shared by the send and recv queues of a serial interface.
+ *     A frame is copied in once, and from then on only its handle is queued. Buffers are reference counted,
+ *     so the same frame can be in more than one queue (eg. for several clients) without copying it.
+ *     alloc() and release() may be called from the BLE stack's task as well as from loop().
+ */
+class FramePool {
+  uint8_t _bufs[SERIAL_FRAME_POOL_SIZE][FRAME_POOL_HEADROOM + MAX_FRAME_SIZE];
+  uint8_t _lens[SERIAL_FRAME_POOL_SIZE];
+  uint8_t _refs[SERIAL_FRAME_POOL_SIZE];
+  uint8_t _free[SERIAL_FRAME_POOL_SIZE];
+  volatile int _num_free;
+#if defined(ESP32)
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+  void lock() {
+#if defined(ESP32)
+    portENTER_CRITICAL(&_mux);
+#elif defined(NRF52_PLATFORM)
+    taskENTER_CRITICAL();
+#endif
+  }
+  void unlock() {
+#if defined(ESP32)
+    portEXIT_CRITICAL(&_mux);
+#elif defined(NRF52_PLATFORM)
+    taskEXIT_CRITICAL();
+#endif
+  }
+
+public:
+  FramePool() { reset(); }
+
+  void reset() {
+    lock();
+    for (int i = 0; i < SERIAL_FRAME_POOL_SIZE; i++) {
+      _free[i] = SERIAL_FRAME_POOL_SIZE - 1 - i;
+      _refs[i] = 0;
+    }
+    _num_free = SERIAL_FRAME_POOL_SIZE;
+    unlock();
+  }
+
+  /**
+   * \brief  takes a free buffer, with a ref count of one.
+   * \param  src  frame to copy in, or NULL if caller will write it in place (see data())
+   * \returns  handle, or -1 if pool is exhausted
+   */
+  int alloc(const uint8_t src[], size_t len) {
+    if (len > MAX_FRAME_SIZE) return -1;
+
+    lock();
+    int h = _num_free > 0 ? _free[--_num_free] : -1;
+    if (h >= 0) _refs[h] = 1;
+    unlock();
+
+    if (h >= 0) {
+      _lens[h] = len;
+      if (src) memcpy(data(h), src, len);
+    }
+    return h;
+  }
+
+  void addRef(int h) {
+    lock();
+    _refs[h]++;
+    unlock();
+  }
+
+  void release(int h) {
+    lock();
+    if (_refs[h] > 0 && --_refs[h] == 0) {
+      _free[_num_free++] = h;
+    }
+    unlock();
+  }
+
+  uint8_t* data(int h) { return &_bufs[h][FRAME_POOL_HEADROOM]; }
+  uint8_t* headroom(int h) { return _bufs[h]; }
+  size_t length(int h) const { return _lens[h]; }
+  int getNumFree() const { return _num_free; }
+};
+
+/**
+ * \brief  FIFO of FramePool handles. Safe for one producer and one consumer in different tasks.
+ */
+class FrameQueue {
+  #define FRAME_QUEUE_SLOTS  (SERIAL_FRAME_POOL_SIZE + 1)   // one always empty, so full and empty can be told apart
+
+  uint8_t _slots[FRAME_QUEUE_SLOTS];
+  volatile uint8_t _wr, _rd;
+  uint32_t _dropped;
+
+public:
+  FrameQueue() : _wr(0), _rd(0), _dropped(0) { }
+
+  int count() const { return (_wr + FRAME_QUEUE_SLOTS - _rd) % FRAME_QUEUE_SLOTS; }
+  bool isEmpty() const { return _wr == _rd; }
+  bool isFull() const { return (_wr + 1) % FRAME_QUEUE_SLOTS == _rd; }
+
+  /**
+   * \brief  queues the handle, or counts a drop if handle is invalid (ie. pool exhausted) or queue is full
+   */
+  bool push(FramePool& pool, int h) {
+    if (h < 0 || isFull()) {
+      if (h >= 0) pool.release(h);
+      _dropped++;
+      return false;
+    }
+    _slots[_wr] = h;
+    _wr = (_wr + 1) % FRAME_QUEUE_SLOTS;
+    return true;
+  }
+
+  bool pushCopy(FramePool& pool, const uint8_t src[], size_t len) {
+    return push(pool, pool.alloc(src, len));
+  }
+
+  int peek() const { return isEmpty() ? -1 : _slots[_rd]; }
+
+  /**
+   * \brief  removes the oldest frame, and releases it back to the pool
+   */
+  void pop(FramePool& pool) {
+    if (isEmpty()) return;
+    pool.release(_slots[_rd]);
+    _rd = (_rd + 1) % FRAME_QUEUE_SLOTS;
+  }
+
+  void clear(FramePool& pool) {
+    while (!isEmpty()) pop(pool);
+  }
+
+  void markDropped() { _dropped++; }
+  uint32_t getNumDropped() const { return _dropped; }
+};
@@ -1,6 +1,6 @@
 #pragma once
 
-#if defined(ESP32) || defined(RP2040_PLATFORM)
+#if defined(ESP32) || defined(RP2040_PLATFORM) || defined(NATIVE_PLATFORM)
   #include <FS.h>
   #define FILESYSTEM  fs::FS
 #elif defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
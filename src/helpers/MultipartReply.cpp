@@ -0,0 +1,165 @@
+#include "MultipartReply.h"
+
+MultipartSession* MultipartTransfers::allocSession(uint32_t tag, const uint8_t* peer_key, bool outbound) {
+  MultipartSession* s = NULL;
+  for (int i = 0; i < MULTIPART_MAX_SESSIONS; i++) {
+    if (!_sessions[i].in_use) { s = &_sessions[i]; break; }
+  }
+  if (s == NULL) return NULL;
+
+  memset(s, 0, sizeof(*s));
+  s->tag = tag;
+  memcpy(s->peer, peer_key, sizeof(s->peer));
+  s->outbound = outbound;
+  s->in_use = true;
+  s->expiry = _ms->getMillis() + MULTIPART_EXPIRY_MILLIS;
+  return s;
+}
+
+mesh::Packet* MultipartTransfers::allocChunk() {
+  if (_mgr->getFreeCount() <= MULTIPART_MIN_FREE_PACKETS) return NULL;
+  return _mgr->allocNew();
+}
+
+MultipartSession* MultipartTransfers::startOutbound(uint32_t tag, const uint8_t* peer_key, const uint8_t* data, int len) {
+  int count = (len + MULTIPART_CHUNK_SIZE - 1) / MULTIPART_CHUNK_SIZE;
+  if (count == 0) count = 1;
+  if (count > MULTIPART_MAX_FRAGS) return NULL;
+
+  MultipartSession* s = findSession(tag, peer_key, true);   // eg. request was retried
+  if (s) release(s);
+  s = allocSession(tag, peer_key, true);
+  if (s == NULL) return NULL;
+
+  s->count = count;
+  for (int i = 0; i < count; i++) {
+    mesh::Packet* chunk = allocChunk();
+    if (chunk == NULL) {
+      MESH_DEBUG_PRINTLN("MultipartTransfers: pool too low for %d fragments", count);
+      release(s);
+      return NULL;
+    }
+    int n = len - i*MULTIPART_CHUNK_SIZE;
+    if (n > MULTIPART_CHUNK_SIZE) n = MULTIPART_CHUNK_SIZE;
+    memcpy(chunk->payload, &data[i*MULTIPART_CHUNK_SIZE], n);
+    chunk->payload_len = n;
+    s->chunks[i] = chunk;
+  }
+  return s;
+}
+
+MultipartSession* MultipartTransfers::expectInbound(uint32_t tag, const uint8_t* peer_key) {
+  MultipartSession* s = allocSession(tag, peer_key, false);
+  if (s == NULL) {   // newest request wins, so recycle the oldest inbound session
+    MultipartSession* oldest = NULL;
+    for (int i = 0; i < MULTIPART_MAX_SESSIONS; i++) {
+      MultipartSession* t = &_sessions[i];
+      if (!t->outbound && (oldest == NULL || (long)(t->expiry - oldest->expiry) < 0)) oldest = t;
+    }
+    if (oldest) {
+      release(oldest);
+      s = allocSession(tag, peer_key, false);
+    }
+  }
+  return s;
+}
+
+MultipartSession* MultipartTransfers::findSession(uint32_t tag, const uint8_t* peer_key, bool outbound) {
+  for (int i = 0; i < MULTIPART_MAX_SESSIONS; i++) {
+    MultipartSession* s = &_sessions[i];
+    if (s->in_use && s->outbound == outbound && s->tag == tag && memcmp(s->peer, peer_key, sizeof(s->peer)) == 0) return s;
+  }
+  return NULL;
+}
+
+int MultipartTransfers::formatFragment(uint8_t* dest, uint32_t tag, int idx, int count, const uint8_t* chunk, int chunk_len) {
+  memcpy(dest, &tag, 4);
+  dest[4] = (idx << 4) | (count - 1);
+  dest[5] = chunk_len;
+  memcpy(&dest[MULTIPART_HDR_SIZE], chunk, chunk_len);
+  return MULTIPART_HDR_SIZE + chunk_len;
+}
+
+int MultipartTransfers::writeFragment(const MultipartSession* s, int idx, uint8_t* dest) const {
+  const mesh::Packet* chunk = s->chunks[idx];
+  return formatFragment(dest, s->tag, idx, s->count, chunk->payload, chunk->payload_len);
+}
+
+int MultipartTransfers::recvFragment(MultipartSession* s, const uint8_t* data, int len) {
+  if (len < MULTIPART_HDR_SIZE) return -1;
+
+  int idx = data[4] >> 4;
+  int count = (data[4] & 0x0F) + 1;
+  int chunk_len = data[5];
+  if (idx >= count || count > MULTIPART_MAX_FRAGS || chunk_len > MULTIPART_CHUNK_SIZE
+      || MULTIPART_HDR_SIZE + chunk_len > len) return -1;
+  if (s->count != 0 && s->count != count) return -1;
+
+  s->count = count;
+  s->expiry = _ms->getMillis() + MULTIPART_EXPIRY_MILLIS;
+  if ((s->mask & (1 << idx)) == 0) {
+    mesh::Packet* chunk = allocChunk();   // if none, will be re-sent, once we ACK without it
+    if (chunk) {
+      memcpy(chunk->payload, &data[MULTIPART_HDR_SIZE], chunk_len);
+      chunk->payload_len = chunk_len;
+      s->chunks[idx] = chunk;
+      s->mask |= (1 << idx);
+      s->retries = 0;   // making progress
+    }
+  }
+
+  if (s->isComplete()) {
+    s->ack_due = 0;
+    return 1;
+  }
+  s->ack_due = _ms->getMillis() + MULTIPART_ACK_GAP_MILLIS;
+  return 0;
+}
+
+int MultipartTransfers::getChunk(const MultipartSession* s, int idx, const uint8_t** chunk) const {
+  if (idx >= s->count || s->chunks[idx] == NULL) return 0;
+  *chunk = s->chunks[idx]->payload;
+  return s->chunks[idx]->payload_len;
+}
+
+uint16_t MultipartTransfers::applyAck(MultipartSession* s, uint16_t recv_mask) {
+  s->mask |= recv_mask & s->fullMask();
+  s->expiry = _ms->getMillis() + MULTIPART_EXPIRY_MILLIS;
+  return s->fullMask() & ~s->mask;
+}
+
+MultipartSession* MultipartTransfers::getNextAckDue() {
+  for (int i = 0; i < MULTIPART_MAX_SESSIONS; i++) {
+    MultipartSession* s = &_sessions[i];
+    if (s->in_use && !s->outbound && s->ack_due && hasPassed(s->ack_due)) {
+      if (s->retries >= MULTIPART_MAX_ACK_RETRIES) {
+        s->ack_due = 0;   // give up, leave for checkExpired()
+        continue;
+      }
+      s->retries++;
+      s->ack_due = _ms->getMillis() + MULTIPART_ACK_GAP_MILLIS * (1 + s->retries);
+      return s;
+    }
+  }
+  return NULL;
+}
+
+void MultipartTransfers::release(MultipartSession* s) {
+  for (int i = 0; i < MULTIPART_MAX_FRAGS; i++) {
+    if (s->chunks[i]) {
+      _mgr->free(s->chunks[i]);
+      s->chunks[i] = NULL;
+    }
+  }
+  s->in_use = false;
+}
+
+void MultipartTransfers::checkExpired() {
+  for (int i = 0; i < MULTIPART_MAX_SESSIONS; i++) {
+    MultipartSession* s = &_sessions[i];
+    if (s->in_use && hasPassed(s->expiry)) {
+      MESH_DEBUG_PRINTLN("MultipartTransfers: session expired, tag=%08X", s->tag);
+      release(s);
+    }
+  }
+}
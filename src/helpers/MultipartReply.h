@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Mesh.h>
+
+#define REQ_FLAG_MULTIPART       0x80   // OR'd into REQ type byte: requester can reassemble a multipart reply
+#define REQ_TYPE_MULTIPART_ACK   0x0F   // params: tag(4), mask of fragments received(2)
+
+// fragment payload: tag(4), (index << 4) | (count - 1), chunk_len(1), chunk
+#define MULTIPART_HDR_SIZE       6
+#define MULTIPART_CHUNK_SIZE     (MAX_PACKET_PAYLOAD - 2 - CIPHER_MAC_SIZE - (CIPHER_BLOCK_SIZE-1) - MULTIPART_HDR_SIZE)
+
+// in place of index/count: responder had no buffers, so rest is the whole reply, unfragmented (empty if it didn't fit)
+#define MULTIPART_UNFRAGMENTED   0xF0
+
+#ifndef MULTIPART_MAX_FRAGS
+  #define MULTIPART_MAX_FRAGS    8
+#endif
+#if MULTIPART_MAX_FRAGS < 1 || MULTIPART_MAX_FRAGS > 16
+  #error "MULTIPART_MAX_FRAGS must be 1..16"
+#endif
+
+#define MULTIPART_MAX_REPLY      (MULTIPART_MAX_FRAGS * MULTIPART_CHUNK_SIZE)   // excluding tag
+
+#ifndef MULTIPART_MAX_SESSIONS
+  #define MULTIPART_MAX_SESSIONS  2
+#endif
+
+// pool packets a transfer must leave free, so forwarding isn't starved
+#ifndef MULTIPART_MIN_FREE_PACKETS
+  #define MULTIPART_MIN_FREE_PACKETS  8
+#endif
+
+#define MULTIPART_EXPIRY_MILLIS   60000   // since last activity
+#define MULTIPART_ACK_GAP_MILLIS   6000   // no fragment for this long, so ask for the missing ones
+#define MULTIPART_MAX_ACK_RETRIES     3
+
+struct MultipartSession {
+  uint32_t tag;
+  uint8_t  peer[4];      // pub_key prefix of other node
+  bool     in_use;
+  bool     outbound;     // we are the responder
+  uint8_t  count;        // number of fragments, 0 if not yet known (inbound)
+  uint8_t  retries;
+  uint16_t mask;         // fragments received (inbound) or ACK'd (outbound)
+  unsigned long expiry;
+  unsigned long ack_due; // inbound: when to send next selective ACK, 0 if none
+  mesh::Packet* chunks[MULTIPART_MAX_FRAGS];   // borrowed from packet pool, chunk in payload[]
+
+  uint16_t fullMask() const { return count >= 16 ? 0xFFFF : (uint16_t)((1 << count) - 1); }
+  bool isComplete() const { return count > 0 && (mask & fullMask()) == fullMask(); }
+};
+
+/**
+ * \brief  Fragmentation and reassembly of REQ/RESPONSE replies too big for one packet, eg. neighbour lists, ACL dumps.
+ *    Fragments are normal PAYLOAD_TYPE_RESPONSE datagrams, so existing repeaters forward them. The requester
+ *    recovers lost fragments with a selective-repeat ACK (REQ_TYPE_MULTIPART_ACK) listing what it has.
+ *    Chunks are held in Packets borrowed from the mesh's PacketManager, rather than in dedicated buffers.
+ */
+class MultipartTransfers {
+  mesh::PacketManager* _mgr;
+  mesh::MillisecondClock* _ms;
+  MultipartSession _sessions[MULTIPART_MAX_SESSIONS];
+
+  MultipartSession* allocSession(uint32_t tag, const uint8_t* peer_key, bool outbound);
+  mesh::Packet* allocChunk();
+  bool hasPassed(unsigned long t) const { return (long)(_ms->getMillis() - t) >= 0; }
+
+public:
+  MultipartTransfers() : _mgr(NULL), _ms(NULL) { memset(_sessions, 0, sizeof(_sessions)); }
+
+  void begin(mesh::PacketManager* mgr, mesh::MillisecondClock* ms) { _mgr = mgr; _ms = ms; }
+
+  /**
+   * \brief  responder: splits 'data' (reply, excluding tag) into chunks ready to send
+   * \returns  NULL if no free session or not enough pool packets
+   */
+  MultipartSession* startOutbound(uint32_t tag, const uint8_t* peer_key, const uint8_t* data, int len);
+
+  /**
+   * \brief  requester: expect a multipart reply for request 'tag'
+   */
+  MultipartSession* expectInbound(uint32_t tag, const uint8_t* peer_key);
+
+  MultipartSession* findSession(uint32_t tag, const uint8_t* peer_key, bool outbound);
+
+  /**
+   * \brief  writes fragment 'idx' as a RESPONSE payload to 'dest' (MAX_PACKET_PAYLOAD)
+   * \returns  length
+   */
+  int writeFragment(const MultipartSession* s, int idx, uint8_t* dest) const;
+  static int formatFragment(uint8_t* dest, uint32_t tag, int idx, int count, const uint8_t* chunk, int chunk_len);
+
+  /**
+   * \brief  requester: stores an incoming fragment (RESPONSE payload)
+   * \returns  -1 if not a valid fragment, 1 if reply is now complete, else 0
+   */
+  int recvFragment(MultipartSession* s, const uint8_t* data, int len);
+
+  /**
+   * \brief  gets chunk 'idx' of a session (valid until release())
+   */
+  int getChunk(const MultipartSession* s, int idx, const uint8_t** chunk) const;
+
+  /**
+   * \brief  responder: applies a selective ACK
+   * \returns  mask of fragments still to be (re)sent
+   */
+  uint16_t applyAck(MultipartSession* s, uint16_t recv_mask);
+
+  /**
+   * \returns  inbound session which needs a selective ACK sent now, or NULL
+   */
+  MultipartSession* getNextAckDue();
+
+  void release(MultipartSession* s);
+
+  /**
+   * \brief  releases sessions idle for MULTIPART_EXPIRY_MILLIS, and their pool packets
+   */
+  void checkExpired();
+};
@@ -9,20 +9,68 @@
 #define MAX_PACKET_HASHES  128
 #define MAX_PACKET_ACKS     64
 
+// interfaces a packet can be seen on. Bridges share the mesh's tables, so each packet is only hashed once,
+// and a packet from one interface can be passed to the others, but never back to where it came from.
+// The tables aren't locked, so they must only be used from the main loop: bridges whose driver calls back
+// from another task (eg. ESP-NOW on the WiFi task) copy what they receive there, and check it in loop().
+#define PACKET_IFACE_MESH     0x01
+#define PACKET_IFACE_RS232    0x02
+#define PACKET_IFACE_ESPNOW   0x04
+#define PACKET_IFACE_UDP      0x08
+
 class SimpleMeshTables : public mesh::MeshTables {
   uint8_t _hashes[MAX_PACKET_HASHES*MAX_HASH_SIZE];
+  uint8_t _hash_ifaces[MAX_PACKET_HASHES];
   int _next_idx;
   uint32_t _acks[MAX_PACKET_ACKS];
+  uint8_t _ack_ifaces[MAX_PACKET_ACKS];
   int _next_ack_idx;
   uint32_t _direct_dups, _flood_dups;
 
+  // the same packet is usually checked by mesh then bridge(s) in turn, so remember last hash
+  uint8_t _last_payload[MAX_PACKET_PAYLOAD];
+  uint8_t _last_type, _last_path_len, _last_len;
+  uint8_t _last_hash[MAX_HASH_SIZE];
+
+  void getPacketHash(const mesh::Packet* packet, uint8_t* hash) {
+    uint8_t t = packet->getPayloadType();
+    if (_last_len == 0 || t != _last_type || packet->payload_len != _last_len
+        || (t == PAYLOAD_TYPE_TRACE && packet->path_len != _last_path_len)
+        || memcmp(packet->payload, _last_payload, _last_len) != 0) {
+      packet->calculatePacketHash(_last_hash);
+      _last_type = t;
+      _last_path_len = packet->path_len;
+      _last_len = packet->payload_len;
+      memcpy(_last_payload, packet->payload, _last_len);
+    }
+    memcpy(hash, _last_hash, MAX_HASH_SIZE);
+  }
+
+  bool markSeen(uint8_t* ifaces, uint8_t iface, const mesh::Packet* packet) {
+    if (*ifaces & iface) {
+      if (iface == PACKET_IFACE_MESH) {
+        if (packet->isRouteDirect()) {
+          _direct_dups++;   // keep some stats
+        } else {
+          _flood_dups++;
+        }
+      }
+      return true;
+    }
+    *ifaces |= iface;
+    return false;
+  }
+
 public:
   SimpleMeshTables() { 
     memset(_hashes, 0, sizeof(_hashes));
+    memset(_hash_ifaces, 0, sizeof(_hash_ifaces));
     _next_idx = 0;
     memset(_acks, 0, sizeof(_acks));
+    memset(_ack_ifaces, 0, sizeof(_ack_ifaces));
     _next_ack_idx = 0;
     _direct_dups = _flood_dups = 0;
+    _last_len = 0;
   }
 
 #ifdef ESP32
@@ -31,6 +79,8 @@ public:
     f.read((uint8_t *) &_next_idx, sizeof(_next_idx));
     f.read((uint8_t *) &_acks[0], sizeof(_acks));
     f.read((uint8_t *) &_next_ack_idx, sizeof(_next_ack_idx));
+    memset(_hash_ifaces, 0xFF, sizeof(_hash_ifaces));   // interfaces not saved, so assume seen on all
+    memset(_ack_ifaces, 0xFF, sizeof(_ack_ifaces));
   }
   void saveTo(File f) {
     f.write(_hashes, sizeof(_hashes));
@@ -41,41 +91,41 @@ public:
 #endif
 
   bool hasSeen(const mesh::Packet* packet) override {
+    return hasSeen(packet, PACKET_IFACE_MESH);
+  }
+
+  /**
+   * \returns  true if packet was already seen on given interface, else marks it as seen on that interface
+   * NOTE: main loop only, see above
+   */
+  bool hasSeen(const mesh::Packet* packet, uint8_t iface) {
     if (packet->getPayloadType() == PAYLOAD_TYPE_ACK) {
       uint32_t ack;
       memcpy(&ack, packet->payload, 4);
       for (int i = 0; i < MAX_PACKET_ACKS; i++) {
-        if (ack == _acks[i]) { 
-          if (packet->isRouteDirect()) {
-            _direct_dups++;   // keep some stats
-          } else {
-            _flood_dups++;
-          }
-          return true;
+        if (ack == _acks[i] && _ack_ifaces[i]) {
+          return markSeen(&_ack_ifaces[i], iface, packet);
         }
       }
   
       _acks[_next_ack_idx] = ack;
+      _ack_ifaces[_next_ack_idx] = iface;
       _next_ack_idx = (_next_ack_idx + 1) % MAX_PACKET_ACKS;  // cyclic table  
       return false;
     }
 
     uint8_t hash[MAX_HASH_SIZE];
-    packet->calculatePacketHash(hash);
+    getPacketHash(packet, hash);
 
     const uint8_t* sp = _hashes;
     for (int i = 0; i < MAX_PACKET_HASHES; i++, sp += MAX_HASH_SIZE) {
-      if (memcmp(hash, sp, MAX_HASH_SIZE) == 0) { 
-        if (packet->isRouteDirect()) {
-          _direct_dups++;   // keep some stats
-        } else {
-          _flood_dups++;
-        }
-        return true;
+      if (_hash_ifaces[i] && memcmp(hash, sp, MAX_HASH_SIZE) == 0) { 
+        return markSeen(&_hash_ifaces[i], iface, packet);
       }
     }
 
     memcpy(&_hashes[_next_idx*MAX_HASH_SIZE], hash, MAX_HASH_SIZE);
+    _hash_ifaces[_next_idx] = iface;
     _next_idx = (_next_idx + 1) % MAX_PACKET_HASHES;  // cyclic table
     return false;
   }
@@ -85,19 +135,19 @@ public:
       uint32_t ack;
       memcpy(&ack, packet->payload, 4);
       for (int i = 0; i < MAX_PACKET_ACKS; i++) {
-        if (ack == _acks[i]) { 
-          _acks[i] = 0;
+        if (ack == _acks[i] && _ack_ifaces[i]) { 
+          _ack_ifaces[i] &= ~PACKET_IFACE_MESH;
           break;
         }
       }
     } else {
       uint8_t hash[MAX_HASH_SIZE];
-      packet->calculatePacketHash(hash);
+      getPacketHash(packet, hash);
 
       uint8_t* sp = _hashes;
       for (int i = 0; i < MAX_PACKET_HASHES; i++, sp += MAX_HASH_SIZE) {
-        if (memcmp(hash, sp, MAX_HASH_SIZE) == 0) { 
-          memset(sp, 0, MAX_HASH_SIZE);
+        if (_hash_ifaces[i] && memcmp(hash, sp, MAX_HASH_SIZE) == 0) { 
+          _hash_ifaces[i] &= ~PACKET_IFACE_MESH;
           break;
         }
       }
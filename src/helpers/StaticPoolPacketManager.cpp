@@ -8,20 +8,22 @@ PacketQueue::PacketQueue(int max_entries) {
   _num = 0;
 }
 
-int PacketQueue::countBefore(uint32_t now) const {
+int PacketQueue::countBefore(uint32_t now, uint8_t port_mask) const {
   int n = 0;
   for (int j = 0; j < _num; j++) {
     if ((int32_t)(_schedule_table[j] - now) > 0) continue;   // scheduled for future... ignore for now
+    if (port_mask != 0xFF && (_table[j]->_tx_ports & port_mask) == 0) continue;   // for another radio port
     n++;
   }
   return n;
 }
 
-mesh::Packet* PacketQueue::get(uint32_t now) {
+mesh::Packet* PacketQueue::get(uint32_t now, uint8_t port_mask) {
   uint8_t min_pri = 0xFF;
   int best_idx = -1;
   for (int j = 0; j < _num; j++) {
     if ((int32_t)(_schedule_table[j] - now) > 0) continue;   // scheduled for future... ignore for now
+    if (port_mask != 0xFF && (_table[j]->_tx_ports & port_mask) == 0) continue;   // for another radio port
     if (_pri_table[j] < min_pri) {  // select most important priority amongst non-future entries
       min_pri = _pri_table[j];
       best_idx = j;
@@ -93,10 +95,18 @@ mesh::Packet* StaticPoolPacketManager::getNextOutbound(uint32_t now) {
   return send_queue.get(now);
 }
 
+mesh::Packet* StaticPoolPacketManager::getNextOutboundFor(uint32_t now, uint8_t port_mask) {
+  return send_queue.get(now, port_mask);
+}
+
 int  StaticPoolPacketManager::getOutboundCount(uint32_t now) const {
   return send_queue.countBefore(now);
 }
 
+int  StaticPoolPacketManager::getOutboundCountFor(uint32_t now, uint8_t port_mask) const {
+  return send_queue.countBefore(now, port_mask);
+}
+
 int StaticPoolPacketManager::getFreeCount() const {
   return unused.count();
 }
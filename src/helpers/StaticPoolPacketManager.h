@@ -10,10 +10,10 @@ class PacketQueue {
 
 public:
   PacketQueue(int max_entries);
-  mesh::Packet* get(uint32_t now);
+  mesh::Packet* get(uint32_t now, uint8_t port_mask=0xFF);
   bool add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);
   int count() const { return _num; }
-  int countBefore(uint32_t now) const;
+  int countBefore(uint32_t now, uint8_t port_mask=0xFF) const;
   mesh::Packet* itemAt(int i) const { return _table[i]; }
   mesh::Packet* removeByIdx(int i);
 };
@@ -28,7 +28,9 @@ public:
   void free(mesh::Packet* packet) override;
   void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
   mesh::Packet* getNextOutbound(uint32_t now) override;
+  mesh::Packet* getNextOutboundFor(uint32_t now, uint8_t port_mask) override;
   int getOutboundCount(uint32_t now) const override;
+  int getOutboundCountFor(uint32_t now, uint8_t port_mask) const override;
   int getFreeCount() const override;
   mesh::Packet* getOutboundByIdx(int i) override;
   mesh::Packet* removeOutboundByIdx(int i) override;
@@ -0,0 +1,155 @@
+#include "TextCompressor.h"
+#include <string.h>
+
+#define TC_FIRST_CHAR     32      // printable ASCII, 32..126
+#define TC_NUM_CHARS      95
+#define TC_SYM_ESC        95      // followed by 8 bits raw byte
+#define TC_FIRST_TOKEN    96
+#define TC_NUM_TOKENS     34
+#define TC_NUM_SYMBOLS    (TC_FIRST_TOKEN + TC_NUM_TOKENS)
+#define TC_MAX_CODE_LEN   15
+
+// canonical Huffman code lengths, by symbol.  Generated by tools/text_compress/gen_tables.py, from a chat corpus plus English letter frequencies
+static const uint8_t code_lens[TC_NUM_SYMBOLS] = {
+  3, 9, 13, 13, 13, 13, 13, 8, 13, 13, 13, 13, 13, 10, 10, 13, 8, 9, 8, 9, 9, 9, 9, 10,
+  9, 9, 10, 13, 13, 13, 13, 7, 13, 9, 10, 8, 10, 10, 12, 9, 8, 7, 10, 12, 9, 9, 9, 11,
+  10, 12, 9, 8, 8, 11, 11, 8, 12, 9, 11, 13, 13, 13, 13, 13, 13, 5, 7, 5, 6, 5, 6, 6,
+  5, 5, 10, 6, 6, 5, 5, 4, 6, 11, 6, 5, 5, 6, 7, 5, 9, 6, 11, 13, 13, 13, 13, 11,
+  6, 8, 10, 7, 7, 10, 10, 8, 8, 9, 13, 9, 13, 9, 8, 7, 8, 6, 7, 6, 7, 6, 8, 10,
+  7, 7, 7, 8, 7, 5, 7, 6, 7, 6,
+};
+static const char* const tokens[TC_NUM_TOKENS] = {   // longest first
+  " the ", " you", " and", "the", "ing", "ent", "ion", "tha", " to", " is", " it", " in", " of", " on", "th", "he", "in", "er", "an", "re", "on", "at", "en", "nd", "es", "or", "ou", "is", "ll", "e ", "s ", "t ", "d ", ", "
+};
+
+static uint16_t codes[TC_NUM_SYMBOLS];
+static uint8_t  sorted_syms[TC_NUM_SYMBOLS];        // by code length, then symbol
+static uint16_t first_code[TC_MAX_CODE_LEN + 1];
+static uint8_t  first_idx[TC_MAX_CODE_LEN + 1], len_count[TC_MAX_CODE_LEN + 1];
+static uint8_t  token_lens[TC_NUM_TOKENS];
+static bool tables_ready = false;
+
+static void buildTables() {
+  int n = 0;
+  uint16_t code = 0;
+  for (int len = 1; len <= TC_MAX_CODE_LEN; len++) {
+    first_code[len] = code;
+    first_idx[len] = n;
+    len_count[len] = 0;
+    for (int s = 0; s < TC_NUM_SYMBOLS; s++) {
+      if (code_lens[s] != len) continue;
+      codes[s] = code++;
+      sorted_syms[n++] = s;
+      len_count[len]++;
+    }
+    code <<= 1;
+  }
+  for (int t = 0; t < TC_NUM_TOKENS; t++) token_lens[t] = strlen(tokens[t]);
+  tables_ready = true;
+}
+
+class BitWriter {
+  uint8_t* _dest;
+  int _max, _len;
+  uint32_t _acc;
+  int _bits;
+public:
+  BitWriter(uint8_t* dest, int max_len) : _dest(dest), _max(max_len), _len(0), _acc(0), _bits(0) { }
+
+  bool put(uint32_t v, int nbits) {
+    _acc = (_acc << nbits) | v;
+    _bits += nbits;
+    while (_bits >= 8) {
+      if (_len >= _max) return false;
+      _bits -= 8;
+      _dest[_len++] = _acc >> _bits;
+    }
+    return true;
+  }
+  int finish() {   // pad last byte with zeros
+    if (_bits > 0) {
+      if (_len >= _max) return -1;
+      _dest[_len++] = _acc << (8 - _bits);
+      _bits = 0;
+    }
+    return _len;
+  }
+};
+
+int TextCompressor::compress(uint8_t* dest, int dest_max, const char* text, int text_len) {
+  if (text_len > 255 || dest_max < 2) return 0;
+  if (!tables_ready) buildTables();
+
+  int max_len = dest_max < text_len ? dest_max : text_len - 1;   // must be at least one byte shorter
+  if (max_len < 2) return 0;
+  dest[0] = text_len;
+  BitWriter out(&dest[1], max_len - 1);
+
+  int i = 0;
+  while (i < text_len) {
+    int sym = -1;
+    for (int t = 0; t < TC_NUM_TOKENS; t++) {   // longest first
+      if (token_lens[t] <= text_len - i && memcmp(&text[i], tokens[t], token_lens[t]) == 0) {
+        sym = TC_FIRST_TOKEN + t;
+        i += token_lens[t];
+        break;
+      }
+    }
+    uint8_t c = text[i];
+    bool ok;
+    if (sym >= 0) {
+      ok = out.put(codes[sym], code_lens[sym]);
+    } else if (c >= TC_FIRST_CHAR && c < TC_FIRST_CHAR + TC_NUM_CHARS) {
+      sym = c - TC_FIRST_CHAR;
+      ok = out.put(codes[sym], code_lens[sym]);
+      i++;
+    } else {
+      ok = out.put(codes[TC_SYM_ESC], code_lens[TC_SYM_ESC]) && out.put(c, 8);
+      i++;
+    }
+    if (!ok) return 0;   // not worth it
+  }
+  int n = out.finish();
+  return n < 0 ? 0 : 1 + n;
+}
+
+int TextCompressor::decompress(char* dest, int dest_max, const uint8_t* src, int src_len) {
+  if (src_len < 1 || src[0] > dest_max) return -1;
+  if (!tables_ready) buildTables();
+
+  int text_len = src[0];
+  int total_bits = (src_len - 1) * 8;
+  int bit_pos = 0;
+  #define NEXT_BIT()  ((src[1 + (bit_pos >> 3)] >> (7 - (bit_pos & 7))) & 1)
+
+  int n = 0;
+  while (n < text_len) {
+    int code = 0, sym = -1;
+    for (int len = 1; len <= TC_MAX_CODE_LEN; len++) {
+      if (bit_pos >= total_bits) return -1;
+      code = (code << 1) | NEXT_BIT();
+      bit_pos++;
+      if (code >= first_code[len] && code - first_code[len] < len_count[len]) {
+        sym = sorted_syms[first_idx[len] + code - first_code[len]];
+        break;
+      }
+    }
+    if (sym < 0) return -1;
+
+    if (sym >= TC_FIRST_TOKEN) {
+      int tlen = token_lens[sym - TC_FIRST_TOKEN];
+      if (n + tlen > text_len) return -1;
+      memcpy(&dest[n], tokens[sym - TC_FIRST_TOKEN], tlen);
+      n += tlen;
+    } else if (sym == TC_SYM_ESC) {
+      if (bit_pos + 8 > total_bits) return -1;
+      uint8_t c = 0;
+      for (int b = 0; b < 8; b++, bit_pos++) c = (c << 1) | NEXT_BIT();
+      dest[n++] = c;
+    } else {
+      dest[n++] = TC_FIRST_CHAR + sym;
+    }
+  }
+  #undef NEXT_BIT
+  return n;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \brief  Compression for short chat text. Common English fragments (" the", "ing", ...) are single symbols,
+ *     and all symbols are coded with a fixed Huffman code, tuned for mesh chat. Printable ASCII is 4-13 bits,
+ *     other bytes (eg. UTF-8) cost 14 bits, so non-English text usually won't compress, and is sent as-is.
+ *     Compressed form is: text length(1), then the code bits, MSB first.
+ */
+class TextCompressor {
+public:
+  /**
+   * \returns  compressed length, or 0 if it wouldn't be shorter than 'text_len' (or fit 'dest_max')
+   */
+  static int compress(uint8_t* dest, int dest_max, const char* text, int text_len);
+
+  /**
+   * \returns  text length (not null terminated), or -1 if 'src' is invalid or text longer than 'dest_max'
+   */
+  static int decompress(char* dest, int dest_max, const uint8_t* src, int src_len);
+};
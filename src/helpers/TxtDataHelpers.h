@@ -6,6 +6,12 @@
 #define TXT_TYPE_PLAIN          0    // a plain text message
 #define TXT_TYPE_CLI_DATA       1    // a CLI command
 #define TXT_TYPE_SIGNED_PLAIN   2    // plain text, signed by sender
+#define TXT_TYPE_SIGNED_BATCH   3    // several signed plain texts (room server posts), see ROOM_CLIENT_VER_LEVEL
+
+#define TXT_FLAG_COMPRESSED     0x20 // OR'd into txt_type: text is TextCompressor encoded. Only sent to nodes advertising ADV_FEAT1_TXT_COMPRESS
+
+// sent by client in room server login, after the password's null terminator.  >= 1 means TXT_TYPE_SIGNED_BATCH is understood
+#define ROOM_CLIENT_VER_LEVEL   1
 
 class StrHelper {
 public:
@@ -26,6 +26,24 @@ uint16_t BridgeBase::fletcher16(const uint8_t *data, size_t len) {
   return (sum2 << 8) | sum1;
 }
 
+uint16_t BridgeBase::writeFrame(const mesh::Packet *packet, uint8_t *dest) {
+  uint16_t len = packet->writeTo(dest + BRIDGE_MAGIC_SIZE + BRIDGE_LENGTH_SIZE);
+  if (len > (MAX_TRANS_UNIT + 1)) {
+    return 0;
+  }
+
+  dest[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
+  dest[1] = BRIDGE_PACKET_MAGIC & 0xFF;
+  dest[2] = (len >> 8) & 0xFF;
+  dest[3] = len & 0xFF;
+
+  uint16_t checksum = fletcher16(dest + 4, len);
+  dest[4 + len] = (checksum >> 8) & 0xFF;
+  dest[5 + len] = checksum & 0xFF;
+
+  return len + BRIDGE_FRAME_OVERHEAD;
+}
+
 bool BridgeBase::validateChecksum(const uint8_t *data, size_t len, uint16_t received_checksum) {
   uint16_t calculated_checksum = fletcher16(data, len);
   return received_checksum == calculated_checksum;
@@ -39,10 +57,97 @@ void BridgeBase::handleReceivedPacket(mesh::Packet *packet) {
     return;
   }
 
-  if (!_seen_packets.hasSeen(packet)) {
-    // bridge_delay provides a buffer to prevent immediate processing conflicts in the mesh network.
-    _mgr->queueInbound(packet, millis() + _prefs->bridge_delay);
-  } else {
+  if (hasSeen(packet)) {
     _mgr->free(packet);
+    return;
+  }
+
+  uint8_t prio = getIngressPrio(packet);
+  IngressSlot *slot = NULL;
+  for (int i = 0; i < BRIDGE_INGRESS_QUEUE_SIZE && slot == NULL; i++) {
+    if (_ingress[i].packet == NULL) slot = &_ingress[i];
+  }
+  if (slot == NULL) {
+    // queue full, so find lowest priority, newest packet
+    IngressSlot *worst = &_ingress[0];
+    for (int i = 1; i < BRIDGE_INGRESS_QUEUE_SIZE; i++) {
+      IngressSlot *s = &_ingress[i];
+      if (s->prio > worst->prio || (s->prio == worst->prio && (int32_t)(s->seq - worst->seq) > 0)) worst = s;
+    }
+    if (worst->prio <= prio) { // new packet is no more important, so it goes
+      BRIDGE_DEBUG_PRINTLN("RX ingress full, dropping prio=%d\n", prio);
+      _ingress_drops[prio]++;
+      _mgr->free(packet);
+      return;
+    }
+    BRIDGE_DEBUG_PRINTLN("RX ingress full, dropping queued prio=%d\n", worst->prio);
+    _ingress_drops[worst->prio]++;
+    _mgr->free(worst->packet);
+    slot = worst;
+  }
+  slot->packet = packet;
+  slot->prio = prio;
+  slot->seq = _ingress_seq++;
+
+  releaseIngress();
+}
+
+void BridgeBase::clearIngress() {
+  for (int i = 0; i < BRIDGE_INGRESS_QUEUE_SIZE; i++) {
+    if (_ingress[i].packet) {
+      _mgr->free(_ingress[i].packet);
+      _ingress[i].packet = NULL;
+    }
+  }
+}
+
+uint32_t BridgeBase::randomEpoch() {
+  return ((uint32_t)random(0x10000) << 16) | (uint32_t)random(0x10000);
+}
+
+uint8_t BridgeBase::getIngressPrio(const mesh::Packet *packet) {
+  uint8_t type = packet->getPayloadType();
+  if (type == PAYLOAD_TYPE_ADVERT) return BRIDGE_PRIO_ADVERT;
+  if (type == PAYLOAD_TYPE_ACK) return BRIDGE_PRIO_ACK;
+  if (packet->isRouteDirect()) return BRIDGE_PRIO_DIRECT;
+  return BRIDGE_PRIO_FLOOD;
+}
+
+void BridgeBase::releaseIngress() {
+  unsigned long now = millis();
+  if (_airtime_refill == 0) _airtime_refill = now;
+
+  // each radio may transmit for t, then must wait t * its budget factor
+  int num_ports = _dispatcher->getNumRadios();
+  for (int p = 0; p < num_ports; p++) {
+    _airtime_tokens[p] += (now - _airtime_refill) / (1.0f + _dispatcher->getPortAirtimeBudgetFactor(p));
+    if (_airtime_tokens[p] > BRIDGE_AIRTIME_BURST_MILLIS) _airtime_tokens[p] = BRIDGE_AIRTIME_BURST_MILLIS;
+  }
+  _airtime_refill = now;
+
+  while (true) {
+    IngressSlot *best = NULL;
+    for (int i = 0; i < BRIDGE_INGRESS_QUEUE_SIZE; i++) {
+      IngressSlot *s = &_ingress[i];
+      if (s->packet && (best == NULL || s->prio < best->prio ||
+                        (s->prio == best->prio && (int32_t)(s->seq - best->seq) < 0))) {
+        best = s;
+      }
+    }
+    if (best == NULL) break;
+
+    // a packet longer than the whole burst waits for a full bucket, then leaves it in debt
+    uint32_t airtime[MAX_RADIO_PORTS];
+    bool fits = true;
+    for (int p = 0; p < num_ports; p++) {
+      airtime[p] = _dispatcher->getRadio(p)->getEstAirtimeFor(best->packet->getRawLength());
+      if (_airtime_tokens[p] < airtime[p] && _airtime_tokens[p] < BRIDGE_AIRTIME_BURST_MILLIS) fits = false;
+    }
+    if (!fits) break;
+    for (int p = 0; p < num_ports; p++) _airtime_tokens[p] -= airtime[p];
+
+    // bridge_delay provides a buffer to prevent immediate processing conflicts in the mesh network.
+    _mgr->queueInbound(best->packet, now + _prefs->bridge_delay);
+    best->packet = NULL;
   }
 }
@@ -6,6 +6,23 @@
 
 #include <RTClib.h>
 
+// Packets from the bridge waiting for LoRa airtime
+#ifndef BRIDGE_INGRESS_QUEUE_SIZE
+#define BRIDGE_INGRESS_QUEUE_SIZE 8
+#endif
+
+// Airtime (ms) bridged packets may use in a burst, before being held to the airtime budget
+#ifndef BRIDGE_AIRTIME_BURST_MILLIS
+#define BRIDGE_AIRTIME_BURST_MILLIS 4000
+#endif
+
+// Ingress priority classes, highest first
+#define BRIDGE_PRIO_DIRECT  0
+#define BRIDGE_PRIO_ACK     1
+#define BRIDGE_PRIO_FLOOD   2
+#define BRIDGE_PRIO_ADVERT  3
+#define BRIDGE_NUM_PRIOS    4
+
 /**
  * @brief Base class implementing common bridge functionality
  *
@@ -14,9 +31,10 @@
  *
  * Features:
  * - Fletcher-16 checksum calculation for data integrity
- * - Packet duplicate detection using SimpleMeshTables
+ * - Packet duplicate detection using the mesh's SimpleMeshTables, tagged with this bridge's interface
  * - Common timestamp formatting for debug logging
  * - Shared packet management and queuing logic
+ * - Ingress shaping, so a fast bridge link can't use more LoRa airtime than the radio's budget
  */
 class BridgeBase : public AbstractBridge {
 public:
@@ -29,6 +47,14 @@ public:
    */
   bool isRunning() const override;
 
+  /**
+   * @brief Gets the number of bridged packets dropped by the ingress shaper
+   *
+   * @param prio BRIDGE_PRIO_* class
+   * @return Packets dropped in that class, since boot
+   */
+  uint32_t getIngressDrops(int prio) const { return _ingress_drops[prio]; }
+
   /**
    * @brief Common magic number used by all bridge implementations for packet identification
    *
@@ -49,6 +75,16 @@ public:
   static constexpr uint16_t BRIDGE_LENGTH_SIZE = sizeof(uint16_t);
   static constexpr uint16_t BRIDGE_CHECKSUM_SIZE = sizeof(uint16_t);
 
+  /**
+   * @brief Overhead of a length framed packet: magic + length + checksum
+   */
+  static constexpr uint16_t BRIDGE_FRAME_OVERHEAD = BRIDGE_MAGIC_SIZE + BRIDGE_LENGTH_SIZE + BRIDGE_CHECKSUM_SIZE;
+
+  /**
+   * @brief Largest length framed packet
+   */
+  static constexpr uint16_t BRIDGE_MAX_FRAME_SIZE = (MAX_TRANS_UNIT + 1) + BRIDGE_FRAME_OVERHEAD;
+
 protected:
   /** Tracks bridge state */
   bool _initialized = false;
@@ -62,8 +98,32 @@ protected:
   /** Node preferences for configuration settings */
   NodePrefs *_prefs;
 
-  /** Tracks seen packets to prevent loops in broadcast communications */
-  SimpleMeshTables _seen_packets;
+  /**
+   * Tracks seen packets to prevent loops in broadcast communications.
+   * Shared with the mesh and other bridges, so each packet is hashed once.
+   */
+  SimpleMeshTables *_seen_packets;
+
+  /** This bridge's PACKET_IFACE_* bit in the shared tables */
+  uint8_t _iface;
+
+  /** The mesh, for its radios' airtime estimates and budgets */
+  mesh::Dispatcher *_dispatcher;
+
+  /** Bridged packets waiting for airtime */
+  struct IngressSlot {
+    mesh::Packet *packet; // NULL if slot free
+    uint8_t prio;
+    uint32_t seq; // arrival order, within a class
+  };
+  IngressSlot _ingress[BRIDGE_INGRESS_QUEUE_SIZE];
+  uint32_t _ingress_seq = 0;
+
+  /** Airtime (ms) available now, per radio port. Can go negative, after a packet longer than the burst */
+  float _airtime_tokens[MAX_RADIO_PORTS];
+  unsigned long _airtime_refill = 0;
+
+  uint32_t _ingress_drops[BRIDGE_NUM_PRIOS] = { 0 };
 
   /**
    * @brief Constructs a BridgeBase instance
@@ -71,9 +131,26 @@ protected:
    * @param prefs Node preferences for configuration settings
    * @param mgr PacketManager for allocating and queuing packets
    * @param rtc RTCClock for timestamping debug messages
+   * @param tables The mesh's packet tables, shared for duplicate detection
+   * @param iface PACKET_IFACE_* bit identifying this bridge
+   * @param dispatcher The mesh, for its radios' airtime estimates and budgets
    */
-  BridgeBase(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc)
-      : _prefs(prefs), _mgr(mgr), _rtc(rtc) {}
+  BridgeBase(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc, SimpleMeshTables *tables,
+             uint8_t iface, mesh::Dispatcher *dispatcher)
+      : _prefs(prefs), _mgr(mgr), _rtc(rtc), _seen_packets(tables), _iface(iface), _dispatcher(dispatcher) {
+    memset(_ingress, 0, sizeof(_ingress));
+    for (int i = 0; i < MAX_RADIO_PORTS; i++) _airtime_tokens[i] = BRIDGE_AIRTIME_BURST_MILLIS;
+  }
+
+  /**
+   * @brief Checks and marks a packet as seen on this bridge
+   *
+   * Only call from the main loop (loop(), sendPacket() or onPacketReceived()), never from a
+   * driver callback on another task, as the tables are shared with the mesh and aren't locked.
+   *
+   * @return true if the packet was already received from, or sent to, this bridge
+   */
+  bool hasSeen(const mesh::Packet *packet) { return _seen_packets->hasSeen(packet, _iface); }
 
   /**
    * @brief Gets formatted date/time string for logging
@@ -106,15 +183,51 @@ protected:
    */
   bool validateChecksum(const uint8_t *data, size_t len, uint16_t received_checksum);
 
+  /**
+   * @brief Writes a packet as a length framed packet, as used by the stream bridges
+   *
+   * Frame: [2 bytes] magic, [2 bytes] length, [n bytes] packet, [2 bytes] Fletcher-16 of packet.
+   * All fields big-endian.
+   *
+   * @param packet The mesh packet to write
+   * @param dest Buffer of at least BRIDGE_MAX_FRAME_SIZE bytes
+   * @return Length of the frame, or 0 if the packet is too large
+   */
+  static uint16_t writeFrame(const mesh::Packet *packet, uint8_t *dest);
+
   /**
    * @brief Common packet handling for received packets
    *
    * Implements the standard pattern used by all bridges:
-   * - Check if packet was seen before using _seen_packets.hasSeen()
-   * - Queue packet for mesh processing if not seen before
+   * - Check if packet was seen before on this bridge using hasSeen()
+   * - Hold packet in the ingress queue if not seen before, see releaseIngress()
    * - Free packet if already seen to prevent duplicates
    *
+   * If the ingress queue is full, the lowest priority packet (newest first) is dropped,
+   * which may be the new packet. Main loop only, see hasSeen().
+   *
    * @param packet The received mesh packet
    */
   void handleReceivedPacket(mesh::Packet *packet);
+
+  /**
+   * @brief Passes held packets to the mesh, as airtime allows
+   *
+   * Each of the mesh's radio ports has its own airtime tokens, which accrue at the rate
+   * its airtime budget (Dispatcher::getPortAirtimeBudgetFactor()) allows it to transmit,
+   * up to BRIDGE_AIRTIME_BURST_MILLIS. A bridged packet may be forwarded on any port, so
+   * each packet passed on costs its estimated airtime on every port, highest priority
+   * class first, then oldest first.
+   * Called from the main loop only: for each received packet, and from each bridge's loop().
+   */
+  void releaseIngress();
+
+  /** @brief Frees any packets still held in the ingress queue, eg. from end() */
+  void clearIngress();
+
+  /** @brief A random epoch for BridgeCodec::setEpoch(), from random(), which the mesh seeds at boot */
+  static uint32_t randomEpoch();
+
+  /** @brief Priority class of a packet: direct > ACK > flood > advert */
+  static uint8_t getIngressPrio(const mesh::Packet *packet);
 };
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <AES.h>
+#include <MeshCore.h>
+#include <SHA256.h>
+#include <Utils.h>
+#include <string.h>
+
+// Senders whose replay windows are remembered, by epoch
+#ifndef BRIDGE_REPLAY_SENDERS
+#define BRIDGE_REPLAY_SENDERS 8
+#endif
+
+/**
+ * @brief Seals and opens bridge frame bodies of up to BODY_SIZE bytes, with no ESP-NOW or WiFi dependencies
+ *
+ * A body is [MAC][ciphertext]. The plaintext is a header, then one or more mesh
+ * packets, each prefixed by its length byte, zero padded to the AES block size:
+ * [4 bytes] Epoch, random per sender per boot
+ * [4 bytes] Counter, from 1 for each epoch
+ * [1 byte] Packet Length (non-zero)
+ * [n bytes] Mesh Packet
+ * ...
+ * A zero length byte (or the end of the plaintext) ends the list.
+ *
+ * The ciphertext is AES-128, the MAC is a truncated HMAC-SHA256 of the ciphertext,
+ * the same encrypt-then-MAC scheme as mesh::Utils::encryptThenMAC(). Both keys are
+ * derived from the bridge secret once, by setSecret(), rather than per frame.
+ *
+ * The epoch and counter are under the MAC, so they can't be altered. open() keeps a
+ * window of the last 32 counters for each of the last BRIDGE_REPLAY_SENDERS epochs
+ * seen, and rejects a counter it has already had, or one too far behind, so a body
+ * replayed while its sender is remembered is dropped before its packets are parsed.
+ * This is not a complete defence: the window is only in RAM, and a body from an
+ * unknown epoch is accepted (and replaces the least recently seen sender), so a body
+ * is accepted again after this node reboots, or once BRIDGE_REPLAY_SENDERS other
+ * epochs (possibly replayed ones) have pushed its sender out. The mesh's packet
+ * tables still drop the packets in it if they were seen recently.
+ *
+ * Used by ESPNowBridge (one body per ESP-NOW frame) and UDPBridge (one body per datagram).
+ */
+template <int BODY_SIZE>
+class BridgeCodec {
+public:
+  static const int MAC_SIZE = 8;
+
+  /** @brief Epoch and counter, at the start of the plaintext */
+  static const int HEADER_SIZE = 8;
+
+  /** @brief Largest body */
+  static const int MAX_BODY_SIZE = BODY_SIZE;
+
+  /** @brief Plaintext space per frame, for the header, packets and their length bytes */
+  static const int MAX_PLAIN_SIZE = ((MAX_BODY_SIZE - MAC_SIZE) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+
+  /** @brief Largest mesh packet that can be bridged, limited by the plaintext and its length byte */
+  static const int MAX_PACKET_SIZE =
+      MAX_PLAIN_SIZE - HEADER_SIZE - 1 < 255 ? MAX_PLAIN_SIZE - HEADER_SIZE - 1 : 255;
+
+  BridgeCodec() : _plain_len(0), _epoch(0), _counter(0), _rx_seq(0) {
+    memset(_hmac_key, 0, sizeof(_hmac_key));
+    memset(_senders, 0, sizeof(_senders));
+  }
+
+  /**
+   * @brief Derives the cipher and MAC keys from a secret, eg. _prefs->bridge_secret
+   *
+   * @param secret Secret text, not necessarily null terminated
+   * @param max_len Maximum length of secret
+   */
+  void setSecret(const char *secret, int max_len) {
+    int len = 0;
+    while (len < max_len && secret[len]) len++;
+    mesh::Utils::sha256(_hmac_key, sizeof(_hmac_key), (const uint8_t *)secret, len);
+    _aes.setKey(_hmac_key, CIPHER_KEY_SIZE);
+    _plain_len = 0;
+    memset(_senders, 0, sizeof(_senders));
+  }
+
+  /**
+   * @brief Starts a new epoch for sealed bodies, and restarts the counter
+   *
+   * @param epoch Random, so it differs from this sender's earlier boots and from other senders
+   */
+  void setEpoch(uint32_t epoch) {
+    _epoch = epoch;
+    _counter = 0;
+  }
+
+  /**
+   * @brief Adds a mesh packet to the pending plaintext
+   *
+   * @return false if it doesn't fit, call seal() first
+   */
+  bool add(const uint8_t *raw, int len) {
+    if (len <= 0 || len > MAX_PACKET_SIZE || HEADER_SIZE + _plain_len + 1 + len > MAX_PLAIN_SIZE) return false;
+    uint8_t *dp = &_plain[HEADER_SIZE + _plain_len];
+    *dp++ = len;
+    memcpy(dp, raw, len);
+    _plain_len += 1 + len;
+    return true;
+  }
+
+  bool hasPending() const { return _plain_len > 0; }
+
+  /** @brief Length of the body seal() would make now, or 0 if nothing pending */
+  int getSealedSize() const {
+    if (_plain_len == 0) return 0;
+    return MAC_SIZE + ((HEADER_SIZE + _plain_len + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+  }
+
+  /**
+   * @brief Encrypts and MACs the pending packets into 'body', with the next counter, then clears them
+   *
+   * @param body Destination, at least MAX_BODY_SIZE bytes
+   * @return Length of body, or 0 if nothing pending
+   */
+  int seal(uint8_t *body) {
+    if (_plain_len == 0) return 0;
+    int len = HEADER_SIZE + _plain_len;
+    memset(&_plain[len], 0, sizeof(_plain) - len);
+    _counter++;
+    memcpy(&_plain[0], &_epoch, 4);
+    memcpy(&_plain[4], &_counter, 4);
+
+    uint8_t *dp = &body[MAC_SIZE];
+    for (int i = 0; i < len; i += CIPHER_BLOCK_SIZE) {
+      _aes.encryptBlock(dp, &_plain[i]);
+      dp += CIPHER_BLOCK_SIZE;
+    }
+    int enc_len = dp - &body[MAC_SIZE];
+    calcMAC(body, &body[MAC_SIZE], enc_len);
+
+    _plain_len = 0;
+    return MAC_SIZE + enc_len;
+  }
+
+  /**
+   * @brief Checks the MAC of a received body, decrypts it and checks it isn't a replay
+   *
+   * @param plain Destination, at least MAX_PLAIN_SIZE bytes. Set to the packet list, without the header
+   * @return Length of packet list, or 0 if body is invalid, from another network, or a replay
+   */
+  int open(const uint8_t *body, int len, uint8_t *plain) {
+    int enc_len = len - MAC_SIZE;
+    if (enc_len <= 0 || enc_len > MAX_PLAIN_SIZE || (enc_len % CIPHER_BLOCK_SIZE) != 0) return 0;
+
+    uint8_t mac[MAC_SIZE];
+    calcMAC(mac, &body[MAC_SIZE], enc_len);
+    if (memcmp(mac, body, MAC_SIZE) != 0) return 0;
+
+    for (int i = 0; i < enc_len; i += CIPHER_BLOCK_SIZE) {
+      _aes.decryptBlock(&plain[i], &body[MAC_SIZE + i]);
+    }
+    uint32_t epoch, counter;
+    memcpy(&epoch, &plain[0], 4);
+    memcpy(&counter, &plain[4], 4);
+    if (!checkReplay(epoch, counter)) return 0;
+
+    memmove(plain, &plain[HEADER_SIZE], enc_len - HEADER_SIZE);
+    return enc_len - HEADER_SIZE;
+  }
+
+  /**
+   * @brief Gets the next packet from an opened plaintext
+   *
+   * @param pos Offset in plaintext, start at 0
+   * @param raw Set to the packet bytes
+   * @return Length of packet, or 0 if no more
+   */
+  static int nextPacket(const uint8_t *plain, int plain_len, int &pos, const uint8_t **raw) {
+    if (pos >= plain_len) return 0;
+    int len = plain[pos];
+    if (len == 0 || pos + 1 + len > plain_len) return 0;
+    *raw = &plain[pos + 1];
+    pos += 1 + len;
+    return len;
+  }
+
+private:
+  /** A sender's epoch, its highest counter so far, and which of the 32 before that have been seen */
+  struct Sender {
+    uint32_t epoch;
+    uint32_t top;     // 0 if slot unused
+    uint32_t window;  // bit n set: top - n seen
+    uint32_t last_seq;
+  };
+
+  AES128 _aes;
+  uint8_t _hmac_key[PUB_KEY_SIZE];
+  uint8_t _plain[MAX_PLAIN_SIZE];
+  int _plain_len; // packet bytes, after the header
+  uint32_t _epoch, _counter;
+  Sender _senders[BRIDGE_REPLAY_SENDERS];
+  uint32_t _rx_seq;
+
+  void calcMAC(uint8_t *mac, const uint8_t *data, int len) {
+    SHA256 sha;
+    sha.resetHMAC(_hmac_key, sizeof(_hmac_key));
+    sha.update(data, len);
+    sha.finalizeHMAC(_hmac_key, sizeof(_hmac_key), mac, MAC_SIZE);
+  }
+
+  /** @return true, and marks the counter as seen, unless it is a replay */
+  bool checkReplay(uint32_t epoch, uint32_t counter) {
+    if (counter == 0) return false;
+
+    Sender *s = NULL;
+    Sender *victim = &_senders[0]; // an unused slot, else the least recently seen
+    for (int i = 0; i < BRIDGE_REPLAY_SENDERS; i++) {
+      Sender *t = &_senders[i];
+      if (t->top != 0 && t->epoch == epoch) {
+        s = t;
+        break;
+      }
+      if (victim->top != 0 && (t->top == 0 || (int32_t)(t->last_seq - victim->last_seq) < 0)) victim = t;
+    }
+    if (s == NULL) { // new sender, or one not seen for a while
+      s = victim;
+      s->epoch = epoch;
+      s->top = counter;
+      s->window = 1;
+    } else if (counter > s->top) {
+      uint32_t shift = counter - s->top;
+      s->window = shift < 32 ? (s->window << shift) | 1 : 1;
+      s->top = counter;
+    } else {
+      uint32_t age = s->top - counter;
+      if (age >= 32 || (s->window & (1UL << age))) return false;
+      s->window |= 1UL << age;
+    }
+    s->last_seq = ++_rx_seq;
+    return true;
+  }
+};
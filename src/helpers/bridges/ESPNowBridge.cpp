@@ -21,14 +21,23 @@ void ESPNowBridge::send_cb(const uint8_t *mac, esp_now_send_status_t status) {
   }
 }
 
-ESPNowBridge::ESPNowBridge(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc)
-    : BridgeBase(prefs, mgr, rtc), _rx_buffer_pos(0) {
+ESPNowBridge::ESPNowBridge(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc, SimpleMeshTables *tables,
+                           mesh::Dispatcher *dispatcher)
+    : BridgeBase(prefs, mgr, rtc, tables, PACKET_IFACE_ESPNOW, dispatcher), _tx_busy(false), _tx_start(0), _rx_head(0),
+      _rx_tail(0) {
   _instance = this;
 }
 
 void ESPNowBridge::begin() {
   BRIDGE_DEBUG_PRINTLN("Initializing...\n");
 
+  // Key schedule is worked out once here, not per frame
+  _codec.setSecret(_prefs->bridge_secret, sizeof(_prefs->bridge_secret));
+  _codec.setEpoch(randomEpoch());
+  _tx_busy = false;
+  _rx_head = 0;
+  _rx_tail = 0;
+
   // Initialize WiFi in station mode
   WiFi.mode(WIFI_STA);
   
@@ -76,6 +85,7 @@ void ESPNowBridge::end() {
   // Unregister callbacks
   esp_now_register_recv_cb(nullptr);
   esp_now_register_send_cb(nullptr);
+  clearIngress();
 
   // Deinitialize ESP-NOW
   if (esp_now_deinit() != ESP_OK) {
@@ -90,19 +100,29 @@ void ESPNowBridge::end() {
 }
 
 void ESPNowBridge::loop() {
-  // Nothing to do here - ESP-NOW is callback based
-}
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
+
+  uint8_t tail = _rx_tail.load(std::memory_order_relaxed);
+  while (tail != _rx_head.load(std::memory_order_acquire)) {
+    RxFrame &frame = _rx_queue[tail];
+    decodeFrame(frame.data, frame.len);
+    tail = (tail + 1) % ESPNOW_BRIDGE_RX_QUEUE_SIZE;
+    _rx_tail.store(tail, std::memory_order_release);
+  }
 
-void ESPNowBridge::xorCrypt(uint8_t *data, size_t len) {
-  size_t keyLen = strlen(_prefs->bridge_secret);
-  for (size_t i = 0; i < len; i++) {
-    data[i] ^= _prefs->bridge_secret[i % keyLen];
+  if (_codec.hasPending() && (!_tx_busy || millis() - _tx_start >= ESPNOW_BRIDGE_TX_TIMEOUT_MILLIS)) {
+    sendFrame();
   }
+
+  releaseIngress();
 }
 
 void ESPNowBridge::onDataRecv(const uint8_t *mac, const uint8_t *data, int32_t len) {
-  // Ignore packets that are too small to contain header + checksum
-  if (len < (BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE)) {
+  // Ignore packets that are too small to contain header + MAC
+  if (len <= (int32_t)(BRIDGE_MAGIC_SIZE + ESPNowCodec::MAC_SIZE)) {
     BRIDGE_DEBUG_PRINTLN("RX packet too small, len=%d\n", len);
     return;
   }
@@ -120,39 +140,73 @@ void ESPNowBridge::onDataRecv(const uint8_t *mac, const uint8_t *data, int32_t l
     return;
   }
 
-  // Make a copy we can decrypt
-  uint8_t decrypted[MAX_ESPNOW_PACKET_SIZE];
-  const size_t encryptedDataLen = len - BRIDGE_MAGIC_SIZE;
-  memcpy(decrypted, data + BRIDGE_MAGIC_SIZE, encryptedDataLen);
-
-  // Try to decrypt (checksum + payload)
-  xorCrypt(decrypted, encryptedDataLen);
-
-  // Validate checksum
-  uint16_t received_checksum = (decrypted[0] << 8) | decrypted[1];
-  const size_t payloadLen = encryptedDataLen - BRIDGE_CHECKSUM_SIZE;
-
-  if (!validateChecksum(decrypted + BRIDGE_CHECKSUM_SIZE, payloadLen, received_checksum)) {
-    // Failed to decrypt - likely from a different network
-    BRIDGE_DEBUG_PRINTLN("RX checksum mismatch, rcv=0x%04X\n", received_checksum);
+  uint8_t head = _rx_head.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) % ESPNOW_BRIDGE_RX_QUEUE_SIZE;
+  if (next == _rx_tail.load(std::memory_order_acquire)) {
+    BRIDGE_DEBUG_PRINTLN("RX queue full, dropping len=%d\n", len);
     return;
   }
+  RxFrame &frame = _rx_queue[head];
+  memcpy(frame.data, data, len);
+  frame.len = len;
+  _rx_head.store(next, std::memory_order_release);
+}
 
-  BRIDGE_DEBUG_PRINTLN("RX, payload_len=%d\n", payloadLen);
+void ESPNowBridge::decodeFrame(const uint8_t *data, int len) {
+  uint8_t plain[ESPNowCodec::MAX_PLAIN_SIZE];
+  int plain_len = _codec.open(data + BRIDGE_MAGIC_SIZE, len - BRIDGE_MAGIC_SIZE, plain);
+  if (plain_len == 0) {
+    // Failed MAC check - likely from a different network - or a replayed frame
+    BRIDGE_DEBUG_PRINTLN("RX MAC mismatch or replay, len=%d\n", len);
+    return;
+  }
 
-  // Create mesh packet
-  mesh::Packet *pkt = _instance->_mgr->allocNew();
-  if (!pkt) return;
+  int pos = 0;
+  const uint8_t *raw;
+  int raw_len;
+  while ((raw_len = ESPNowCodec::nextPacket(plain, plain_len, pos, &raw)) > 0) {
+    BRIDGE_DEBUG_PRINTLN("RX, payload_len=%d\n", raw_len);
 
-  if (pkt->readFrom(decrypted + BRIDGE_CHECKSUM_SIZE, payloadLen)) {
-    _instance->onPacketReceived(pkt);
-  } else {
-    _instance->_mgr->free(pkt);
+    // Create mesh packet
+    mesh::Packet *pkt = _mgr->allocNew();
+    if (!pkt) {
+      BRIDGE_DEBUG_PRINTLN("RX failed to allocate packet\n");
+      return;
+    }
+    if (pkt->readFrom(raw, raw_len)) {
+      onPacketReceived(pkt);
+    } else {
+      _mgr->free(pkt);
+    }
   }
 }
 
 void ESPNowBridge::onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  // Could add transmission error handling here if needed
+  _tx_busy = false;
+}
+
+void ESPNowBridge::sendFrame() {
+  uint8_t buffer[MAX_ESPNOW_PACKET_SIZE];
+
+  // Write magic header (2 bytes)
+  buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
+  buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;
+
+  // MAC + encrypted packets
+  const size_t totalPacketSize = BRIDGE_MAGIC_SIZE + _codec.seal(buffer + BRIDGE_MAGIC_SIZE);
+
+  // Broadcast using ESP-NOW
+  uint8_t broadcastAddress[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  _tx_start = millis();
+  _tx_busy = true;
+  esp_err_t result = esp_now_send(broadcastAddress, buffer, totalPacketSize);
+
+  if (result == ESP_OK) {
+    BRIDGE_DEBUG_PRINTLN("TX, len=%d\n", totalPacketSize);
+  } else {
+    _tx_busy = false;
+    BRIDGE_DEBUG_PRINTLN("TX FAILED!\n");
+  }
 }
 
 void ESPNowBridge::sendPacket(mesh::Packet *packet) {
@@ -167,47 +221,24 @@ void ESPNowBridge::sendPacket(mesh::Packet *packet) {
     return;
   }
 
-  if (!_seen_packets.hasSeen(packet)) {
-    // Create a temporary buffer just for size calculation and reuse for actual writing
-    uint8_t sizingBuffer[MAX_PAYLOAD_SIZE];
-    uint16_t meshPacketLen = packet->writeTo(sizingBuffer);
+  if (!hasSeen(packet)) {
+    uint8_t raw[MAX_TRANS_UNIT + 1];
+    uint16_t meshPacketLen = packet->writeTo(raw);
 
     // Check if packet fits within our maximum payload size
-    if (meshPacketLen > MAX_PAYLOAD_SIZE) {
+    if (meshPacketLen > ESPNowCodec::MAX_PACKET_SIZE) {
       BRIDGE_DEBUG_PRINTLN("TX packet too large (payload=%d, max=%d)\n", meshPacketLen,
-                           MAX_PAYLOAD_SIZE);
+                           ESPNowCodec::MAX_PACKET_SIZE);
       return;
     }
 
-    uint8_t buffer[MAX_ESPNOW_PACKET_SIZE];
-
-    // Write magic header (2 bytes)
-    buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
-    buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;
-
-    // Write packet payload starting after magic header and checksum
-    const size_t packetOffset = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE;
-    memcpy(buffer + packetOffset, sizingBuffer, meshPacketLen);
-
-    // Calculate and add checksum (only of the payload)
-    uint16_t checksum = fletcher16(buffer + packetOffset, meshPacketLen);
-    buffer[2] = (checksum >> 8) & 0xFF; // High byte
-    buffer[3] = checksum & 0xFF;        // Low byte
-
-    // Encrypt payload and checksum (not including magic header)
-    xorCrypt(buffer + BRIDGE_MAGIC_SIZE, meshPacketLen + BRIDGE_CHECKSUM_SIZE);
-
-    // Total packet size: magic header + checksum + payload
-    const size_t totalPacketSize = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE + meshPacketLen;
-
-    // Broadcast using ESP-NOW
-    uint8_t broadcastAddress[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
-    esp_err_t result = esp_now_send(broadcastAddress, buffer, totalPacketSize);
-
-    if (result == ESP_OK) {
-      BRIDGE_DEBUG_PRINTLN("TX, len=%d\n", meshPacketLen);
-    } else {
-      BRIDGE_DEBUG_PRINTLN("TX FAILED!\n");
+    // Frame is full, so send it now, even if the last one hasn't finished
+    if (!_codec.add(raw, meshPacketLen)) {
+      sendFrame();
+      _codec.add(raw, meshPacketLen);
+    }
+    if (!_tx_busy) {
+      sendFrame();
     }
   }
 }
@@ -3,9 +3,25 @@
 #include "MeshCore.h"
 #include "esp_now.h"
 #include "helpers/bridges/BridgeBase.h"
+#include "helpers/bridges/BridgeCodec.h"
+
+#include <atomic>
 
 #ifdef WITH_ESPNOW_BRIDGE
 
+/** @brief ESP-NOW frame bodies, to fit an ESP-NOW frame (250 bytes) after the 2 byte magic header */
+typedef BridgeCodec<248> ESPNowCodec;
+
+// Frames received by the ESP-NOW callback, waiting for loop() to decode them
+#ifndef ESPNOW_BRIDGE_RX_QUEUE_SIZE
+#define ESPNOW_BRIDGE_RX_QUEUE_SIZE 4
+#endif
+
+// How long to wait for the send callback before sending the next frame anyway
+#ifndef ESPNOW_BRIDGE_TX_TIMEOUT_MILLIS
+#define ESPNOW_BRIDGE_TX_TIMEOUT_MILLIS 50
+#endif
+
 /**
  * @brief Bridge implementation using ESP-NOW protocol for packet transport
  *
@@ -15,20 +31,18 @@
  *
  * Features:
  * - Broadcast-based communication (all bridges receive all packets)
- * - Network isolation using XOR encryption with shared secret
- * - Duplicate packet detection using SimpleMeshTables tracking
- * - Maximum packet size of 250 bytes (ESP-NOW limitation)
+ * - Network isolation and authentication using AES-128 and HMAC-SHA256, keyed by a shared secret
+ * - Replays of recent frames dropped, by an epoch and counter under the MAC (see BridgeCodec)
+ * - Several mesh packets coalesced into one ESP-NOW frame while a send is in progress
+ * - Duplicate packet detection using the mesh's SimpleMeshTables, as PACKET_IFACE_ESPNOW
+ * - Maximum packet size of 231 bytes (ESP-NOW limitation, less cipher and replay counter overhead)
  *
  * Packet Structure:
  * [2 bytes] Magic Header - Used to identify ESPNowBridge packets
- * [2 bytes] Fletcher-16 checksum of encrypted payload (calculated over payload only)
- * [246 bytes max] Encrypted payload containing the mesh packet
+ * [8 bytes] Truncated HMAC-SHA256 of ciphertext
+ * [240 bytes max] AES-128 ciphertext of the epoch and counter, then one or more length prefixed mesh packets
  *
- * The Fletcher-16 checksum is used to validate packet integrity and detect
- * corrupted or tampered packets. It's calculated over the encrypted payload
- * and provides a simple but effective way to verify packets are both
- * uncorrupted and from the same network (since the checksum is calculated
- * after encryption).
+ * See BridgeCodec for the plaintext layout, key derivation and replay window.
  *
  * Configuration:
  * - Define WITH_ESPNOW_BRIDGE to enable this bridge
@@ -37,7 +51,7 @@
  * Network Isolation:
  * Multiple independent mesh networks can coexist by using different
  * _prefs->bridge_secret values. Packets encrypted with a different key will
- * fail the checksum validation and be discarded.
+ * fail the MAC check and be discarded.
  */
 class ESPNowBridge : public BridgeBase {
 private:
@@ -53,38 +67,44 @@ private:
    *
    * Our Bridge Packet Structure (must fit in ESP-NOW payload):
    * - Magic header: 2 bytes
-   * - Checksum: 2 bytes
-   * - Available payload: 246 bytes
+   * - Body: 248 bytes, see ESPNowCodec
    */
   static const size_t MAX_ESPNOW_PACKET_SIZE = 250;
 
+  /** Keys, and the mesh packets waiting to be sent */
+  ESPNowCodec _codec;
+
+  /** True from esp_now_send() until the send callback (WiFi task) */
+  std::atomic<bool> _tx_busy;
+  unsigned long _tx_start;
+
   /**
-   * Size constants for packet parsing
+   * Received frames, written by the ESP-NOW callback (WiFi task) and read by loop(),
+   * so decoding and the packet manager are only used from the main loop.
+   * Single producer, single consumer: only the callback stores _rx_head, only loop()
+   * stores _rx_tail, each with release order, so a frame's bytes are written before
+   * the other side sees its slot change hands.
    */
-  static const size_t MAX_PAYLOAD_SIZE = MAX_ESPNOW_PACKET_SIZE - (BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE);
-
-  /** Buffer for receiving ESP-NOW packets */
-  uint8_t _rx_buffer[MAX_ESPNOW_PACKET_SIZE];
+  struct RxFrame {
+    uint8_t data[MAX_ESPNOW_PACKET_SIZE];
+    uint8_t len;
+  };
+  RxFrame _rx_queue[ESPNOW_BRIDGE_RX_QUEUE_SIZE];
+  std::atomic<uint8_t> _rx_head, _rx_tail;
 
-  /** Current position in receive buffer */
-  size_t _rx_buffer_pos;
+  /**
+   * Seals the pending mesh packets into a frame and broadcasts it
+   */
+  void sendFrame();
 
   /**
-   * Performs XOR encryption/decryption of data
-   * Used to isolate different mesh networks
-   *
-   * Uses _prefs->bridge_secret as the key in a simple XOR operation.
-   * The same operation is used for both encryption and decryption.
-   * While not cryptographically secure, it provides basic network isolation.
-   *
-   * @param data Pointer to data to encrypt/decrypt
-   * @param len Length of data in bytes
+   * Checks, decrypts and queues each mesh packet in a received frame
    */
-  void xorCrypt(uint8_t *data, size_t len);
+  void decodeFrame(const uint8_t *data, int len);
 
   /**
    * ESP-NOW receive callback
-   * Called by ESP-NOW when a packet is received
+   * Called by ESP-NOW when a packet is received, copies it for loop()
    *
    * @param mac Source MAC address
    * @param data Received data
@@ -108,12 +128,16 @@ public:
    * @param prefs Node preferences for configuration settings
    * @param mgr PacketManager for allocating and queuing packets
    * @param rtc RTCClock for timestamping debug messages
+   * @param tables The mesh's packet tables, shared for duplicate detection
+   * @param dispatcher The mesh, for its radios' airtime estimates and budgets
    */
-  ESPNowBridge(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc);
+  ESPNowBridge(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc, SimpleMeshTables *tables,
+               mesh::Dispatcher *dispatcher);
 
   /**
    * Initializes the ESP-NOW bridge
    *
+   * - Derives the cipher and MAC keys from _prefs->bridge_secret
    * - Configures WiFi in station mode
    * - Initializes ESP-NOW protocol
    * - Registers callbacks
@@ -133,12 +157,15 @@ public:
 
   /**
    * Main loop handler
-   * ESP-NOW is callback-based, so this is currently empty
+   * - Decodes frames queued by the receive callback
+   * - Sends any coalesced packets once the previous frame is done
+   * - Passes held packets to the mesh as airtime allows, see releaseIngress()
    */
   void loop() override;
 
   /**
-   * Called when a packet is received via ESP-NOW
+   * Called from loop() for each packet decoded from a received frame, never from the
+   * receive callback, as the shared packet tables are only used from the main loop
    * Queues the packet for mesh processing if not seen before
    *
    * @param packet The received mesh packet
@@ -147,7 +174,8 @@ public:
 
   /**
    * Called when a packet needs to be transmitted via ESP-NOW
-   * Encrypts and broadcasts the packet if not seen before
+   * Adds the packet to the pending frame if not seen before, which is sent
+   * straight away unless a send is still in progress
    *
    * @param packet The mesh packet to transmit
    */
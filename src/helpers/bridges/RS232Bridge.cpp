@@ -1,11 +1,13 @@
 #include "RS232Bridge.h"
 
 #include <HardwareSerial.h>
+#include <string.h>
 
 #ifdef WITH_RS232_BRIDGE
 
-RS232Bridge::RS232Bridge(NodePrefs *prefs, Stream &serial, mesh::PacketManager *mgr, mesh::RTCClock *rtc)
-    : BridgeBase(prefs, mgr, rtc), _serial(&serial) {}
+RS232Bridge::RS232Bridge(NodePrefs *prefs, Stream &serial, mesh::PacketManager *mgr, mesh::RTCClock *rtc,
+                         SimpleMeshTables *tables, mesh::Dispatcher *dispatcher)
+    : BridgeBase(prefs, mgr, rtc, tables, PACKET_IFACE_RS232, dispatcher), _serial(&serial) {}
 
 void RS232Bridge::begin() {
   BRIDGE_DEBUG_PRINTLN("Initializing at %d baud...\n", _prefs->bridge_baud);
@@ -24,6 +26,8 @@ void RS232Bridge::begin() {
 #elif defined(STM32_PLATFORM)
   ((HardwareSerial *)_serial)->setRx(WITH_RS232_BRIDGE_RX);
   ((HardwareSerial *)_serial)->setTx(WITH_RS232_BRIDGE_TX);
+#elif defined(NATIVE_PLATFORM)
+  // host tests, no pins to set
 #else
 #error RS232Bridge was not tested on the current platform
 #endif
@@ -36,6 +40,7 @@ void RS232Bridge::begin() {
 void RS232Bridge::end() {
   BRIDGE_DEBUG_PRINTLN("Stopping...\n");
   ((HardwareSerial *)_serial)->end();
+  clearIngress();
 
   // Update bridge state
   _initialized = false;
@@ -47,59 +52,90 @@ void RS232Bridge::loop() {
     return;
   }
 
-  while (_serial->available()) {
-    uint8_t b = _serial->read();
+  drainTx();
 
-    if (_rx_buffer_pos < 2) {
-      // Waiting for magic word
-      if ((_rx_buffer_pos == 0 && b == ((BRIDGE_PACKET_MAGIC >> 8) & 0xFF)) ||
-          (_rx_buffer_pos == 1 && b == (BRIDGE_PACKET_MAGIC & 0xFF))) {
-        _rx_buffer[_rx_buffer_pos++] = b;
+  int avail = _serial->available();
+  if (avail > 0) {
+    uint16_t space = RX_BUFFER_SIZE - _rx_len;
+    if (avail > space) avail = space;
+    _rx_len += _serial->readBytes(_rx_buffer + _rx_len, avail);
+    decodeFrames();
+  }
+
+  releaseIngress();
+}
+
+void RS232Bridge::decodeFrames() {
+  const uint8_t magic_hi = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
+  const uint8_t magic_lo = BRIDGE_PACKET_MAGIC & 0xFF;
+  uint16_t pos = 0;
+
+  while (pos < _rx_len) {
+    uint8_t *frame = (uint8_t *)memchr(_rx_buffer + pos, magic_hi, _rx_len - pos);
+    if (frame == NULL) {
+      pos = _rx_len; // no frame start anywhere, discard all
+      break;
+    }
+    pos = frame - _rx_buffer;
+    uint16_t avail = _rx_len - pos;
+
+    if (avail < 2) break; // wait for more
+    if (frame[1] != magic_lo) {
+      pos++;
+      continue;
+    }
+    if (avail < 4) break;
+
+    uint16_t len = (frame[2] << 8) | frame[3];
+    if (len > (MAX_TRANS_UNIT + 1)) {
+      BRIDGE_DEBUG_PRINTLN("RX invalid length %d, resyncing\n", len);
+      pos++;
+      continue;
+    }
+    if (avail < len + SERIAL_OVERHEAD) break; // wait for rest of frame
+
+    uint16_t received_checksum = (frame[4 + len] << 8) | frame[5 + len];
+    if (!validateChecksum(frame + 4, len, received_checksum)) {
+      BRIDGE_DEBUG_PRINTLN("RX checksum mismatch, rcv=0x%04x\n", received_checksum);
+      pos++;
+      continue;
+    }
+
+    BRIDGE_DEBUG_PRINTLN("RX, len=%d crc=0x%04x\n", len, received_checksum);
+    mesh::Packet *pkt = _mgr->allocNew();
+    if (pkt) {
+      if (pkt->readFrom(frame + 4, len)) {
+        onPacketReceived(pkt);
       } else {
-        // Invalid magic byte, reset and start over
-        _rx_buffer_pos = 0;
-        // Check if this byte could be the start of a new magic word
-        if (b == ((BRIDGE_PACKET_MAGIC >> 8) & 0xFF)) {
-          _rx_buffer[_rx_buffer_pos++] = b;
-        }
+        BRIDGE_DEBUG_PRINTLN("RX failed to parse packet\n");
+        _mgr->free(pkt);
       }
     } else {
-      // Reading length, payload, and checksum
-      _rx_buffer[_rx_buffer_pos++] = b;
-
-      if (_rx_buffer_pos >= 4) {
-        uint16_t len = (_rx_buffer[2] << 8) | _rx_buffer[3];
-
-        // Validate length field
-        if (len > (MAX_TRANS_UNIT + 1)) {
-          BRIDGE_DEBUG_PRINTLN("RX invalid length %d, resetting\n", len);
-          _rx_buffer_pos = 0; // Invalid length, reset
-          continue;
-        }
-
-        if (_rx_buffer_pos == len + SERIAL_OVERHEAD) { // Full packet received
-          uint16_t received_checksum = (_rx_buffer[4 + len] << 8) | _rx_buffer[5 + len];
-
-          if (validateChecksum(_rx_buffer + 4, len, received_checksum)) {
-            BRIDGE_DEBUG_PRINTLN("RX, len=%d crc=0x%04x\n", len, received_checksum);
-            mesh::Packet *pkt = _mgr->allocNew();
-            if (pkt) {
-              if (pkt->readFrom(_rx_buffer + 4, len)) {
-                onPacketReceived(pkt);
-              } else {
-                BRIDGE_DEBUG_PRINTLN("RX failed to parse packet\n");
-                _mgr->free(pkt);
-              }
-            } else {
-              BRIDGE_DEBUG_PRINTLN("RX failed to allocate packet\n");
-            }
-          } else {
-            BRIDGE_DEBUG_PRINTLN("RX checksum mismatch, rcv=0x%04x\n", received_checksum);
-          }
-          _rx_buffer_pos = 0; // Reset for next packet
-        }
-      }
+      BRIDGE_DEBUG_PRINTLN("RX failed to allocate packet\n");
     }
+    pos += len + SERIAL_OVERHEAD;
+  }
+
+  // Keep any partial frame, at the start of the buffer
+  if (pos > 0) {
+    _rx_len -= pos;
+    memmove(_rx_buffer, _rx_buffer + pos, _rx_len);
+  }
+}
+
+void RS232Bridge::drainTx() {
+  while (_tx_count > 0) {
+    int room = _serial->availableForWrite();
+    if (room <= 0) break;
+
+    uint16_t n = _tx_count;
+    if (n > RS232_BRIDGE_TX_BUFFER_SIZE - _tx_head) n = RS232_BRIDGE_TX_BUFFER_SIZE - _tx_head; // up to wrap
+    if (n > room) n = room;
+
+    n = _serial->write(_tx_buffer + _tx_head, n);
+    if (n == 0) break;
+    _tx_head = (_tx_head + n) % RS232_BRIDGE_TX_BUFFER_SIZE;
+    _tx_count -= n;
   }
 }
 
@@ -115,32 +151,30 @@ void RS232Bridge::sendPacket(mesh::Packet *packet) {
     return;
   }
 
-  if (!_seen_packets.hasSeen(packet)) {
+  if (!hasSeen(packet)) {
 
+    // Build magic, length, payload and checksum
     uint8_t buffer[MAX_SERIAL_PACKET_SIZE];
-    uint16_t len = packet->writeTo(buffer + 4);
-
-    // Check if packet fits within our maximum payload size
-    if (len > (MAX_TRANS_UNIT + 1)) {
-      BRIDGE_DEBUG_PRINTLN("TX packet too large (payload=%d, max=%d)\n", len, MAX_TRANS_UNIT + 1);
+    uint16_t frame_len = writeFrame(packet, buffer);
+    if (frame_len == 0) {
+      BRIDGE_DEBUG_PRINTLN("TX packet too large (max=%d)\n", MAX_TRANS_UNIT + 1);
       return;
     }
 
-    // Build packet header
-    buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF; // Magic high byte
-    buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;        // Magic low byte
-    buffer[2] = (len >> 8) & 0xFF;                 // Length high byte
-    buffer[3] = len & 0xFF;                        // Length low byte
-
-    // Calculate checksum over the payload
-    uint16_t checksum = fletcher16(buffer + 4, len);
-    buffer[4 + len] = (checksum >> 8) & 0xFF; // Checksum high byte
-    buffer[5 + len] = checksum & 0xFF;        // Checksum low byte
+    // Queue complete packet, written out by loop()
+    if (frame_len > RS232_BRIDGE_TX_BUFFER_SIZE - _tx_count) {
+      BRIDGE_DEBUG_PRINTLN("TX queue full, dropping len=%d\n", frame_len - SERIAL_OVERHEAD);
+      return;
+    }
+    uint16_t tail = (_tx_head + _tx_count) % RS232_BRIDGE_TX_BUFFER_SIZE;
+    for (uint16_t i = 0; i < frame_len; i++) {
+      _tx_buffer[(tail + i) % RS232_BRIDGE_TX_BUFFER_SIZE] = buffer[i];
+    }
+    _tx_count += frame_len;
 
-    // Send complete packet
-    _serial->write(buffer, len + SERIAL_OVERHEAD);
+    BRIDGE_DEBUG_PRINTLN("TX, len=%d\n", frame_len - SERIAL_OVERHEAD);
 
-    BRIDGE_DEBUG_PRINTLN("TX, len=%d crc=0x%04x\n", len, checksum);
+    drainTx(); // start writing straight away, if UART has room
   }
 }
 
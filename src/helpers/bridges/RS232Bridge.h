@@ -6,6 +6,10 @@
 
 #ifdef WITH_RS232_BRIDGE
 
+#ifndef RS232_BRIDGE_TX_BUFFER_SIZE
+#define RS232_BRIDGE_TX_BUFFER_SIZE 1024
+#endif
+
 /**
  * @brief Bridge implementation using RS232/UART protocol for packet transport
  *
@@ -16,8 +20,10 @@
  * Features:
  * - Point-to-point communication over hardware UART
  * - Fletcher-16 checksum for data integrity verification
- * - Magic header for packet synchronization and frame alignment
- * - Duplicate packet detection using SimpleMeshTables tracking
+ * - Magic header for packet synchronization and frame alignment, resynchronising after corrupt frames
+ * - Bulk reads, with all complete frames decoded in one loop() call
+ * - Non-blocking transmit through a queue drained from loop()
+ * - Duplicate packet detection using the mesh's SimpleMeshTables, as PACKET_IFACE_RS232
  * - Configurable RX/TX pins via build defines
  * - Fixed baud rate at 115200 for consistent timing
  *
@@ -36,6 +42,7 @@
  * - Define WITH_RS232_BRIDGE to enable this bridge
  * - Define WITH_RS232_BRIDGE_RX with the RX pin number
  * - Define WITH_RS232_BRIDGE_TX with the TX pin number
+ * - Define RS232_BRIDGE_TX_BUFFER_SIZE to change the transmit queue size (default 1024 bytes)
  *
  * Platform Support:
  * Different platforms require different pin configuration methods:
@@ -53,8 +60,11 @@ public:
    * @param serial The hardware serial port to use
    * @param mgr PacketManager for allocating and queuing packets
    * @param rtc RTCClock for timestamping debug messages
+   * @param tables The mesh's packet tables, shared for duplicate detection
+   * @param dispatcher The mesh, for its radios' airtime estimates and budgets
    */
-  RS232Bridge(NodePrefs *prefs, Stream &serial, mesh::PacketManager *mgr, mesh::RTCClock *rtc);
+  RS232Bridge(NodePrefs *prefs, Stream &serial, mesh::PacketManager *mgr, mesh::RTCClock *rtc, SimpleMeshTables *tables,
+              mesh::Dispatcher *dispatcher);
 
   /**
    * Initializes the RS232 bridge
@@ -73,15 +83,12 @@ public:
   void end() override;
 
   /**
-   * @brief Main loop handler for processing incoming serial data
+   * @brief Main loop handler for serial data
    *
-   * Implements a state machine for packet reception:
-   * 1. Searches for magic header bytes for packet synchronization
-   * 2. Reads length field to determine expected packet size
-   * 3. Validates packet length against maximum allowed size
-   * 4. Receives complete packet payload and checksum
-   * 5. Validates Fletcher-16 checksum for data integrity
-   * 6. Creates mesh packet and forwards if valid
+   * - Writes as much of the transmit queue as the UART will take without blocking
+   * - Reads all available bytes (up to the receive buffer size) in one go
+   * - Decodes every complete frame in the receive buffer, see decodeFrames()
+   * - Passes held packets to the mesh as airtime allows, see releaseIngress()
    */
   void loop() override;
 
@@ -92,7 +99,7 @@ public:
    * - Adds magic header for synchronization
    * - Includes payload length field
    * - Calculates Fletcher-16 checksum over payload
-   * - Transmits complete framed packet
+   * - Appends framed packet to the transmit queue (dropped if the queue is full)
    * - Uses duplicate detection to prevent retransmission
    *
    * @param packet The mesh packet to transmit
@@ -138,11 +145,39 @@ private:
   /** Hardware serial port interface */
   Stream *_serial;
 
-  /** Buffer for building received packets */
-  uint8_t _rx_buffer[MAX_SERIAL_PACKET_SIZE];
+  /**
+   * @brief Receive buffer size, room for two whole frames
+   *
+   * A frame with a corrupted length field can't hide a following frame,
+   * as the following frame is still in the buffer when the checksum fails.
+   */
+  static constexpr uint16_t RX_BUFFER_SIZE = 2 * MAX_SERIAL_PACKET_SIZE;
+
+  /** Bytes read from serial, not yet decoded */
+  uint8_t _rx_buffer[RX_BUFFER_SIZE];
+
+  /** Number of bytes in the receive buffer */
+  uint16_t _rx_len = 0;
+
+  /** Framed packets waiting to be written, as a ring buffer */
+  uint8_t _tx_buffer[RS232_BRIDGE_TX_BUFFER_SIZE];
+
+  /** Ring buffer positions: next byte to write to serial, and number of bytes queued */
+  uint16_t _tx_head = 0;
+  uint16_t _tx_count = 0;
+
+  /**
+   * @brief Decodes all complete frames in the receive buffer
+   *
+   * Scans for the magic header with memchr(), then checks length and checksum.
+   * Anything invalid skips just one byte, so a real frame starting inside
+   * garbage or a corrupt frame is still found. Decoded bytes are then removed
+   * from the buffer, leaving any partial frame at the start.
+   */
+  void decodeFrames();
 
-  /** Current position in the receive buffer */
-  uint16_t _rx_buffer_pos = 0;
+  /** @brief Writes queued bytes while the UART has room */
+  void drainTx();
 };
 
 #endif
@@ -0,0 +1,229 @@
+#include "UDPBridge.h"
+
+#include <WiFi.h>
+
+#ifdef WITH_UDP_BRIDGE
+
+UDPBridge::UDPBridge(NodePrefs *prefs, UDPBridgeSocket &socket, mesh::PacketManager *mgr, mesh::RTCClock *rtc,
+                     SimpleMeshTables *tables, mesh::Dispatcher *dispatcher)
+    : BridgeBase(prefs, mgr, rtc, tables, PACKET_IFACE_UDP, dispatcher), _socket(socket) {}
+
+void UDPBridge::addDestination(const IPAddress &addr) {
+  if (_num_dests >= UDP_BRIDGE_MAX_PEERS + 1) {
+    BRIDGE_DEBUG_PRINTLN("Too many peers, ignoring %s\n", addr.toString().c_str());
+    return;
+  }
+  Destination &dest = _dests[_num_dests++];
+  dest.addr = addr;
+  dest.pending.setSecret(_prefs->bridge_secret, sizeof(_prefs->bridge_secret));
+  dest.pending.setEpoch(randomEpoch()); // own counter per destination, so each needs its own epoch
+  dest.tokens = MAX_DATAGRAM_SIZE; // allow an initial burst of one full datagram
+  dest.refill_time = millis();
+}
+
+void UDPBridge::parsePeers(const char *list) {
+  char tmp[24];
+  while (*list) {
+    int n = 0;
+    while (*list && *list != ',') {
+      if (n < (int)sizeof(tmp) - 1) tmp[n++] = *list;
+      list++;
+    }
+    tmp[n] = 0;
+    if (*list == ',') list++;
+
+    IPAddress addr;
+    if (n > 0 && addr.fromString(tmp)) {
+      addDestination(addr);
+    } else if (n > 0) {
+      BRIDGE_DEBUG_PRINTLN("Invalid peer address '%s'\n", tmp);
+    }
+  }
+}
+
+void UDPBridge::begin() {
+  BRIDGE_DEBUG_PRINTLN("Initializing on port %d...\n", WITH_UDP_BRIDGE_PORT);
+
+  // Key schedule is worked out once here, not per datagram
+  _rx_codec.setSecret(_prefs->bridge_secret, sizeof(_prefs->bridge_secret));
+  _num_dests = 0;
+  IPAddress group;
+  _has_multicast = group.fromString(WITH_UDP_BRIDGE_MULTICAST);
+  if (_has_multicast) {
+    addDestination(group);
+  }
+  parsePeers(WITH_UDP_BRIDGE_PEERS);
+
+#if defined(NATIVE_PLATFORM)
+  // host tests use the machine's own network
+#elif !defined(WIFI_SSID) || !defined(WIFI_PWD)
+#error "WIFI_SSID and WIFI_PWD must be defined"
+#else
+  if (WiFi.status() != WL_CONNECTED) {
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(WIFI_SSID, WIFI_PWD);
+  }
+#endif
+
+  // Update bridge state
+  _initialized = true;
+}
+
+void UDPBridge::end() {
+  BRIDGE_DEBUG_PRINTLN("Stopping...\n");
+  if (_socket_open) {
+    _socket.end();
+    _socket_open = false;
+  }
+  _num_dests = 0;
+  clearIngress();
+
+  // Update bridge state
+  _initialized = false;
+}
+
+void UDPBridge::loop() {
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
+
+  if (!_socket_open) {
+    if (WiFi.status() != WL_CONNECTED) return;
+
+    _socket_open = _socket.begin(WITH_UDP_BRIDGE_PORT, _has_multicast ? &_dests[0].addr : NULL);
+    if (!_socket_open) return;
+    BRIDGE_DEBUG_PRINTLN("Listening on %s:%d\n", WiFi.localIP().toString().c_str(), WITH_UDP_BRIDGE_PORT);
+  }
+
+  // Receive all waiting datagrams
+  int len;
+  while ((len = _socket.receive(_rx_buffer, MAX_DATAGRAM_SIZE)) > 0) {
+    if (len > MAX_DATAGRAM_SIZE) {
+      BRIDGE_DEBUG_PRINTLN("RX datagram too large, len=%d\n", len);
+      continue;
+    }
+    decodeDatagram(_rx_buffer, len);
+  }
+
+  // Send batches which have waited long enough
+  for (int i = 0; i < _num_dests; i++) {
+    Destination &dest = _dests[i];
+    if (dest.pending.hasPending() && millis() - dest.batch_start >= UDP_BRIDGE_BATCH_MILLIS) {
+      flush(dest);
+    }
+  }
+
+  releaseIngress();
+}
+
+void UDPBridge::decodeDatagram(const uint8_t *data, int len) {
+  if (len <= BRIDGE_MAGIC_SIZE + UDPCodec::MAC_SIZE) {
+    BRIDGE_DEBUG_PRINTLN("RX datagram too small, len=%d\n", len);
+    return;
+  }
+  uint16_t magic = (data[0] << 8) | data[1];
+  if (magic != BRIDGE_PACKET_MAGIC) {
+    BRIDGE_DEBUG_PRINTLN("RX invalid magic 0x%04X\n", magic);
+    return;
+  }
+
+  int plain_len = _rx_codec.open(data + BRIDGE_MAGIC_SIZE, len - BRIDGE_MAGIC_SIZE, _rx_plain);
+  if (plain_len == 0) {
+    // Failed MAC check - corrupt, forged, or from a different network - or a replayed datagram
+    BRIDGE_DEBUG_PRINTLN("RX MAC mismatch or replay, len=%d\n", len);
+    return;
+  }
+
+  int pos = 0;
+  const uint8_t *raw;
+  int raw_len;
+  while ((raw_len = UDPCodec::nextPacket(_rx_plain, plain_len, pos, &raw)) > 0) {
+    BRIDGE_DEBUG_PRINTLN("RX, len=%d\n", raw_len);
+    mesh::Packet *pkt = _mgr->allocNew();
+    if (!pkt) {
+      BRIDGE_DEBUG_PRINTLN("RX failed to allocate packet\n");
+      return;
+    }
+    if (pkt->readFrom(raw, raw_len)) {
+      onPacketReceived(pkt);
+    } else {
+      BRIDGE_DEBUG_PRINTLN("RX failed to parse packet\n");
+      _mgr->free(pkt);
+    }
+  }
+}
+
+void UDPBridge::refill(Destination &dest) {
+  unsigned long now = millis();
+  uint32_t elapsed = now - dest.refill_time;
+  if (elapsed == 0) return;
+
+  int32_t add = ((uint64_t)elapsed * UDP_BRIDGE_PEER_RATE) / 1000;
+  if (add == 0) return; // wait until at least one byte is earned, so remainders aren't lost
+  dest.refill_time = now;
+  dest.tokens += add;
+  if (dest.tokens > MAX_DATAGRAM_SIZE) dest.tokens = MAX_DATAGRAM_SIZE;
+}
+
+bool UDPBridge::flush(Destination &dest) {
+  if (!dest.pending.hasPending()) return true;
+
+  int len = BRIDGE_MAGIC_SIZE + dest.pending.getSealedSize();
+  refill(dest);
+  if (dest.tokens < len) return false; // over rate, try again next loop()
+
+  _tx_buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
+  _tx_buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;
+  dest.pending.seal(_tx_buffer + BRIDGE_MAGIC_SIZE);
+
+  if (_socket.send(dest.addr, WITH_UDP_BRIDGE_PORT, _tx_buffer, len)) {
+    BRIDGE_DEBUG_PRINTLN("TX to %s, len=%d\n", dest.addr.toString().c_str(), len);
+  } else {
+    BRIDGE_DEBUG_PRINTLN("TX to %s FAILED!\n", dest.addr.toString().c_str());
+  }
+  dest.tokens -= len;
+  return true;
+}
+
+void UDPBridge::sendPacket(mesh::Packet *packet) {
+  // Guard against uninitialized state
+  if (_initialized == false || !_socket_open) {
+    return;
+  }
+
+  // First validate the packet pointer
+  if (!packet) {
+    BRIDGE_DEBUG_PRINTLN("TX invalid packet pointer\n");
+    return;
+  }
+
+  if (!hasSeen(packet)) {
+    uint8_t raw[MAX_TRANS_UNIT + 1];
+    int raw_len = packet->writeTo(raw);
+    if (raw_len > UDPCodec::MAX_PACKET_SIZE) {
+      BRIDGE_DEBUG_PRINTLN("TX packet too large (len=%d, max=%d)\n", raw_len, UDPCodec::MAX_PACKET_SIZE);
+      return;
+    }
+
+    for (int i = 0; i < _num_dests; i++) {
+      Destination &dest = _dests[i];
+      if (!dest.pending.hasPending()) dest.batch_start = millis();
+      if (dest.pending.add(raw, raw_len)) continue;
+
+      // datagram full, so send it and start the next one
+      if (!flush(dest)) {
+        BRIDGE_DEBUG_PRINTLN("TX to %s over rate, dropping len=%d\n", dest.addr.toString().c_str(), raw_len);
+        continue;
+      }
+      dest.batch_start = millis();
+      dest.pending.add(raw, raw_len);
+    }
+  }
+}
+
+void UDPBridge::onPacketReceived(mesh::Packet *packet) {
+  handleReceivedPacket(packet);
+}
+
+#endif
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "helpers/bridges/BridgeBase.h"
+#include "helpers/bridges/BridgeCodec.h"
+#include "helpers/bridges/UDPBridgeSocket.h"
+
+#ifdef WITH_UDP_BRIDGE
+
+#ifndef WITH_UDP_BRIDGE_PORT
+#define WITH_UDP_BRIDGE_PORT 5062
+#endif
+
+// Multicast group shared by all bridges on the LAN, or "" to only use WITH_UDP_BRIDGE_PEERS
+#ifndef WITH_UDP_BRIDGE_MULTICAST
+#define WITH_UDP_BRIDGE_MULTICAST "239.255.62.62"
+#endif
+
+// Comma separated unicast peer addresses, eg. "10.0.1.2,10.0.2.2"
+#ifndef WITH_UDP_BRIDGE_PEERS
+#define WITH_UDP_BRIDGE_PEERS ""
+#endif
+
+#ifndef UDP_BRIDGE_MAX_PEERS
+#define UDP_BRIDGE_MAX_PEERS 4
+#endif
+
+// How long a packet may wait for others to share its datagram
+#ifndef UDP_BRIDGE_BATCH_MILLIS
+#define UDP_BRIDGE_BATCH_MILLIS 20
+#endif
+
+// Sustained rate to each peer (and to the multicast group), in bytes per second
+#ifndef UDP_BRIDGE_PEER_RATE
+#define UDP_BRIDGE_PEER_RATE 32000
+#endif
+
+/**
+ * @brief Bridge implementation using UDP/IP for packet transport
+ *
+ * This bridge links mesh segments over an existing IP network (eg. a LAN or VPN
+ * backhaul between distant repeater clusters), without the baud rate limits of
+ * a serial link.
+ *
+ * Features:
+ * - Multicast to all bridges on the LAN, and/or a fixed list of unicast peers
+ * - Several mesh packets batched into each datagram
+ * - Datagrams encrypted and authenticated with _prefs->bridge_secret
+ * - Per-destination rate limiting, so a burst of traffic can't flood a slow link
+ * - Duplicate packet detection using the mesh's SimpleMeshTables, as PACKET_IFACE_UDP
+ *
+ * Datagram Structure:
+ * [2 bytes] Magic Header (0xC03E)
+ * [n bytes] Body, sealed by BridgeCodec (see BridgeCodec.h): MAC, then the
+ *           encrypted mesh packets, each prefixed by its length
+ *
+ * Datagrams that fail the MAC check (corrupt, forged, or from a bridge with
+ * a different secret) are dropped whole.
+ *
+ * Configuration:
+ * - Define WITH_UDP_BRIDGE to enable this bridge
+ * - Define WIFI_SSID and WIFI_PWD for the network to join
+ * - Set _prefs->bridge_secret to the same key on every bridge
+ * - Define WITH_UDP_BRIDGE_PORT, WITH_UDP_BRIDGE_MULTICAST, WITH_UDP_BRIDGE_PEERS to choose destinations
+ * - Define UDP_BRIDGE_BATCH_MILLIS and UDP_BRIDGE_PEER_RATE to tune batching and rate limiting
+ *
+ * Platform Support:
+ * - ESP32 (WiFiUDP, see WiFiUDPBridgeSocket)
+ * - Any other UDPBridgeSocket, eg. host sockets in the native tests
+ */
+class UDPBridge : public BridgeBase {
+public:
+  /**
+   * @brief Constructs a UDPBridge instance
+   *
+   * @param prefs Node preferences for configuration settings
+   * @param socket Datagram socket to send and receive on
+   * @param mgr PacketManager for allocating and queuing packets
+   * @param rtc RTCClock for timestamping debug messages
+   * @param tables The mesh's packet tables, shared for duplicate detection
+   * @param dispatcher The mesh, for its radios' airtime estimates and budgets
+   */
+  UDPBridge(NodePrefs *prefs, UDPBridgeSocket &socket, mesh::PacketManager *mgr, mesh::RTCClock *rtc,
+            SimpleMeshTables *tables, mesh::Dispatcher *dispatcher);
+
+  /**
+   * Initializes the UDP bridge
+   *
+   * - Derives the cipher and MAC keys from _prefs->bridge_secret
+   * - Parses the multicast group and peer list
+   * - Starts joining the WiFi network, if not already connected
+   * - The socket is opened by loop() once the network is up
+   */
+  void begin() override;
+
+  /**
+   * Stops the UDP bridge
+   *
+   * - Closes the socket and drops any queued datagrams
+   */
+  void end() override;
+
+  /**
+   * @brief Main loop handler
+   *
+   * - Opens the socket when the network comes up
+   * - Receives all waiting datagrams, and queues the packets in each one that passes the MAC check
+   * - Sends batched datagrams that are due and within each destination's rate limit
+   * - Passes held packets to the mesh as airtime allows, see releaseIngress()
+   */
+  void loop() override;
+
+  /**
+   * @brief Called when a packet needs to be sent to the other bridges
+   *
+   * Appends the packet to each destination's pending datagram.
+   * A full datagram is sent straight away if its rate limit allows,
+   * otherwise the packet is dropped for that destination.
+   *
+   * @param packet The mesh packet to transmit
+   */
+  void sendPacket(mesh::Packet *packet) override;
+
+  /**
+   * @brief Called for each packet in a datagram that passed the MAC check
+   *
+   * @param packet The received mesh packet
+   */
+  void onPacketReceived(mesh::Packet *packet) override;
+
+private:
+  /**
+   * @brief Largest datagram sent, to stay within a typical 1500 byte MTU without IP fragmentation
+   */
+  static constexpr uint16_t MAX_DATAGRAM_SIZE = 1400;
+
+  /** @brief Seals a datagram's body, after the magic header */
+  typedef BridgeCodec<MAX_DATAGRAM_SIZE - BRIDGE_MAGIC_SIZE> UDPCodec;
+
+  /**
+   * @brief A destination (multicast group or unicast peer) with its pending datagram
+   */
+  struct Destination {
+    IPAddress addr;
+    UDPCodec pending;          // keys, and the packets waiting to be sealed and sent
+    unsigned long batch_start; // millis() when first packet was added
+    int32_t tokens;            // bytes that may be sent now
+    unsigned long refill_time;
+  };
+
+  UDPBridgeSocket &_socket;
+  bool _socket_open = false;
+
+  Destination _dests[UDP_BRIDGE_MAX_PEERS + 1]; // + multicast
+  int _num_dests = 0;
+  bool _has_multicast = false;
+
+  /** For opening received datagrams */
+  UDPCodec _rx_codec;
+
+  /** Buffers for a datagram being sent or received, and a received datagram's plaintext */
+  uint8_t _tx_buffer[MAX_DATAGRAM_SIZE];
+  uint8_t _rx_buffer[MAX_DATAGRAM_SIZE];
+  uint8_t _rx_plain[UDPCodec::MAX_PLAIN_SIZE];
+
+  void addDestination(const IPAddress &addr);
+  void parsePeers(const char *list);
+
+  /**
+   * @brief Checks and decrypts a received datagram, then queues each mesh packet in it
+   */
+  void decodeDatagram(const uint8_t *data, int len);
+
+  /**
+   * @brief Sends a destination's pending datagram, if its rate limit allows
+   *
+   * @return true if sent (or nothing pending)
+   */
+  bool flush(Destination &dest);
+
+  /** @brief Adds tokens for the time passed since last refill */
+  void refill(Destination &dest);
+};
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <WiFi.h>
+
+/**
+ * @brief Datagram socket used by UDPBridge
+ *
+ * Keeps the bridge independent of the network stack, so it runs over WiFiUDP on
+ * the ESP32, or over host sockets in the native tests.
+ */
+class UDPBridgeSocket {
+public:
+  virtual ~UDPBridgeSocket() = default;
+
+  /**
+   * @brief Opens the socket
+   *
+   * @param port Local port
+   * @param group Multicast group to join, or NULL for unicast only
+   * @return true if open
+   */
+  virtual bool begin(uint16_t port, const IPAddress *group) = 0;
+
+  /** @brief Closes the socket */
+  virtual void end() = 0;
+
+  /**
+   * @brief Receives the next waiting datagram, without blocking
+   *
+   * Datagrams sent by this node (eg. its own multicast, looped back) are skipped.
+   *
+   * @param buf Destination
+   * @param max_len Size of buf. A longer datagram is discarded
+   * @return Length of datagram, 0 if none waiting, or more than max_len if it was discarded
+   */
+  virtual int receive(uint8_t *buf, int max_len) = 0;
+
+  /**
+   * @brief Sends one datagram
+   *
+   * @return true if sent whole
+   */
+  virtual bool send(const IPAddress &addr, uint16_t port, const uint8_t *data, int len) = 0;
+};
+
+#if defined(ESP32)
+
+#include <WiFiUdp.h>
+
+/**
+ * @brief UDPBridgeSocket over the ESP32's WiFiUDP
+ */
+class WiFiUDPBridgeSocket : public UDPBridgeSocket {
+  WiFiUDP _udp;
+
+public:
+  bool begin(uint16_t port, const IPAddress *group) override {
+    return group ? _udp.beginMulticast(*group, port) : _udp.begin(port);
+  }
+
+  void end() override { _udp.stop(); }
+
+  int receive(uint8_t *buf, int max_len) override {
+    int len;
+    while ((len = _udp.parsePacket()) > 0) {
+      if (_udp.remoteIP() == WiFi.localIP()) { // our own multicast, looped back
+        _udp.flush();
+        continue;
+      }
+      if (len > max_len) {
+        _udp.flush();
+        return len;
+      }
+      return _udp.read(buf, len);
+    }
+    return 0;
+  }
+
+  bool send(const IPAddress &addr, uint16_t port, const uint8_t *data, int len) override {
+    return _udp.beginPacket(addr, port) && _udp.write(data, len) == (size_t)len && _udp.endPacket();
+  }
+};
+
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FramePool.h"
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
@@ -18,18 +19,11 @@ class SerialBLEInterface : public BaseSerialInterface, BLESecurityCallbacks, BLE
   unsigned long _last_write;
   unsigned long adv_restart_time;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
+  FramePool frame_pool;
+  FrameQueue recv_queue;
+  FrameQueue send_queue;
 
-  #define FRAME_QUEUE_SIZE  4
-  int recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
-
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  void clearBuffers() { recv_queue.clear(frame_pool); send_queue.clear(frame_pool); }
 
 protected:
   // BLESecurityCallbacks methods
@@ -58,7 +52,6 @@ public:
     _isEnabled = false;
     _last_write = 0;
     last_conn_id = 0;
-    send_queue_len = recv_queue_len = 0;
   }
 
   /**
@@ -79,6 +72,7 @@ public:
   bool isWriteBusy() const override;
   size_t writeFrame(const uint8_t src[], size_t len) override;
   size_t checkRecvFrame(uint8_t dest[]) override;
+  uint32_t getNumDroppedFrames() const override { return send_queue.getNumDropped() + recv_queue.getNumDropped(); }
 };
 
 #if BLE_DEBUG_LOGGING && ARDUINO
@@ -1,13 +1,15 @@
 #include "SerialWifiInterface.h"
 #include <WiFi.h>
 
+#define PUSH_FRAME_MIN_CODE   0x80   // frames from this code up are unsolicited, so sent to all clients
+
 void SerialWifiInterface::begin(int port) {
   // wifi setup is handled outside of this class, only starts the server
   server.begin(port);
 }
 
 // ---------- public methods
-void SerialWifiInterface::enable() { 
+void SerialWifiInterface::enable() {
   if (_isEnabled) return;
 
   _isEnabled = true;
@@ -18,155 +20,201 @@ void SerialWifiInterface::disable() {
   _isEnabled = false;
 }
 
+void SerialWifiInterface::clearBuffers() {
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    sessions[i].send_queue.clear(frame_pool);
+  }
+}
+
+bool SerialWifiInterface::queueFrame(Session& s, int h) {
+  if (s.send_queue.count() >= WIFI_MAX_QUEUED_PER_CLIENT) {
+    s.send_queue.markDropped();
+    return false;
+  }
+  frame_pool.addRef(h);
+  return s.send_queue.push(frame_pool, h);
+}
+
 size_t SerialWifiInterface::writeFrame(const uint8_t src[], size_t len) {
   if (len > MAX_FRAME_SIZE) {
     WIFI_DEBUG_PRINTLN("writeFrame(), frame too big, len=%d\n", len);
     return 0;
   }
+  if (len == 0 || !isConnected()) return 0;
 
-  if (deviceConnected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
-      WIFI_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
-      return 0;
-    }
+  int h = frame_pool.alloc(src, len);   // stored once, then ref'd by each session's queue
+  if (h < 0) {
+    WIFI_DEBUG_PRINTLN("writeFrame(), frame pool is empty!");
+    sessions[_reply_session].send_queue.markDropped();
+    return 0;
+  }
 
-    send_queue[send_queue_len].len = len;  // add to send queue
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
+  bool queued = false;
+  if (src[0] >= PUSH_FRAME_MIN_CODE) {
+    for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+      if (sessions[i].connected && queueFrame(sessions[i], h)) queued = true;
+    }
+  } else if (sessions[_reply_session].connected) {
+    queued = queueFrame(sessions[_reply_session], h);
+  }
+  frame_pool.release(h);   // the alloc() ref
 
-    return len;
+  if (!queued) {
+    WIFI_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
+    return 0;
   }
-  return 0;
+  return len;
 }
 
 bool SerialWifiInterface::isWriteBusy() const {
-  return false;
+  return sessions[_reply_session].send_queue.count() >= WIFI_MAX_QUEUED_PER_CLIENT;
 }
 
-bool SerialWifiInterface::hasReceivedFrameHeader() {
-  return received_frame_header.type != 0 && received_frame_header.length != 0;
+bool SerialWifiInterface::hasReceivedFrameHeader(const Session& s) {
+  return s.received_frame_header.type != 0 && s.received_frame_header.length != 0;
 }
 
-void SerialWifiInterface::resetReceivedFrameHeader() {
-  received_frame_header.type = 0;
-  received_frame_header.length = 0;
+void SerialWifiInterface::resetReceivedFrameHeader(Session& s) {
+  s.received_frame_header.type = 0;
+  s.received_frame_header.length = 0;
 }
 
-size_t SerialWifiInterface::checkRecvFrame(uint8_t dest[]) {
-  // check if new client connected
+void SerialWifiInterface::closeSession(Session& s) {
+  s.client.stop();
+  s.connected = false;
+  s.send_queue.clear(frame_pool);
+  resetReceivedFrameHeader(s);
+}
+
+void SerialWifiInterface::acceptClients() {
   auto newClient = server.available();
-  if (newClient) {
+  if (!newClient) return;
+
+  // use a free session, or else replace the one idle the longest (probably a stale connection)
+  int idx = -1;
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    if (!sessions[i].connected) { idx = i; break; }
+    if (idx < 0 || sessions[i].last_activity < sessions[idx].last_activity) idx = i;
+  }
+  if (sessions[idx].connected) {
+    WIFI_DEBUG_PRINTLN("All sessions busy, dropping session %d", idx);
+  }
+  closeSession(sessions[idx]);
+
+  sessions[idx].client = newClient;
+  sessions[idx].connected = true;
+  sessions[idx].last_activity = millis();
+  WIFI_DEBUG_PRINTLN("Got connection, session %d", idx);
+}
 
-    // disconnect existing client
-    deviceConnected = false;
-    client.stop();
+size_t SerialWifiInterface::readFrame(Session& s, uint8_t dest[]) {
+  // check if we are waiting for a frame header
+  if (!hasReceivedFrameHeader(s)) {
 
-    // switch active connection to new client
-    client = newClient;
+    // make sure we have received enough bytes for a frame header
+    // 3 bytes frame header = (1 byte frame type) + (2 bytes frame length as unsigned 16-bit little endian)
+    int frame_header_length = 3;
+    if (s.client.available() >= frame_header_length) {
 
-    // forget received frame header
-    resetReceivedFrameHeader();
-    
-  }
+      // read frame header
+      s.client.readBytes(&s.received_frame_header.type, 1);
+      s.client.readBytes((uint8_t*)&s.received_frame_header.length, 2);
 
-  if (client.connected()) {
-    if (!deviceConnected) {
-      WIFI_DEBUG_PRINTLN("Got connection");
-      deviceConnected = true;
     }
-  } else {
-    if (deviceConnected) {
-      deviceConnected = false;
-      WIFI_DEBUG_PRINTLN("Disconnected");
+  }
+
+  // check if we have received a frame header
+  if (!hasReceivedFrameHeader(s)) return 0;
+
+  // make sure we have received enough bytes for the required frame length
+  int available = s.client.available();
+  int frame_type = s.received_frame_header.type;
+  int frame_length = s.received_frame_header.length;
+  if (frame_length > available) {
+    WIFI_DEBUG_PRINTLN("Waiting for %d more bytes", frame_length - available);
+    return 0;
+  }
+
+  // skip frames that are larger than MAX_FRAME_SIZE, or not the expected type
+  // '<' is 0x3c which indicates a frame sent from app to radio
+  if (frame_length > MAX_FRAME_SIZE || frame_type != '<') {
+    WIFI_DEBUG_PRINTLN("Skipping frame: type=0x%x, length=%d", frame_type, frame_length);
+    while (frame_length > 0) {
+      uint8_t skip[1];
+      int skipped = s.client.read(skip, 1);
+      frame_length -= skipped;
     }
+    resetReceivedFrameHeader(s);
+    return 0;
   }
 
-  if (deviceConnected) {
-    if (send_queue_len > 0) {   // first, check send queue
-      
-      _last_write = millis();
-      int len = send_queue[0].len;
-
-      uint8_t pkt[3+len]; // use same header as serial interface so client can delimit frames
-      pkt[0] = '>';
-      pkt[1] = (len & 0xFF);  // LSB
-      pkt[2] = (len >> 8);    // MSB
-      memcpy(&pkt[3], send_queue[0].buf, send_queue[0].len);
-      client.write(pkt, 3 + len);
-      send_queue_len--;
-      for (int i = 0; i < send_queue_len; i++) {   // delete top item from queue
-        send_queue[i] = send_queue[i + 1];
-      }
-    } else {
-
-      // check if we are waiting for a frame header
-      if(!hasReceivedFrameHeader()){
-
-        // make sure we have received enough bytes for a frame header
-        // 3 bytes frame header = (1 byte frame type) + (2 bytes frame length as unsigned 16-bit little endian)
-        int frame_header_length = 3;
-        if(client.available() >= frame_header_length){
-
-          // read frame header
-          client.readBytes(&received_frame_header.type, 1);
-          client.readBytes((uint8_t*)&received_frame_header.length, 2);
-
-        }
-
-      }
-
-      // check if we have received a frame header
-      if(hasReceivedFrameHeader()){
-
-        // make sure we have received enough bytes for the required frame length
-        int available = client.available();
-        int frame_type = received_frame_header.type;
-        int frame_length = received_frame_header.length;
-        if(frame_length > available){
-          WIFI_DEBUG_PRINTLN("Waiting for %d more bytes", frame_length - available);
-          return 0;
-        }
-
-        // skip frames that are larger than MAX_FRAME_SIZE
-        if(frame_length > MAX_FRAME_SIZE){
-          WIFI_DEBUG_PRINTLN("Skipping frame: length=%d is larger than MAX_FRAME_SIZE=%d", frame_length, MAX_FRAME_SIZE);
-          while(frame_length > 0){
-            uint8_t skip[1];
-            int skipped = client.read(skip, 1);
-            frame_length -= skipped;
-          }
-          resetReceivedFrameHeader();
-          return 0;
-        }
-
-        // skip frames that are not expected type
-        // '<' is 0x3c which indicates a frame sent from app to radio
-        if(frame_type != '<'){
-          WIFI_DEBUG_PRINTLN("Skipping frame: type=0x%x is unexpected", frame_type);
-          while(frame_length > 0){
-            uint8_t skip[1];
-            int skipped = client.read(skip, 1);
-            frame_length -= skipped;
-          }
-          resetReceivedFrameHeader();
-          return 0;
-        }
-
-        // read frame data to provided buffer
-        client.readBytes(dest, frame_length);
-
-        // ready for next frame
-        resetReceivedFrameHeader();
-        return frame_length;
-
-      }
-      
+  // read frame data to provided buffer
+  s.client.readBytes(dest, frame_length);
+  s.last_activity = millis();
+
+  // ready for next frame
+  resetReceivedFrameHeader(s);
+  return frame_length;
+}
+
+size_t SerialWifiInterface::checkRecvFrame(uint8_t dest[]) {
+  acceptClients();
+
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    Session& s = sessions[i];
+    if (s.connected && !s.client.connected()) {
+      WIFI_DEBUG_PRINTLN("Disconnected, session %d", i);
+      closeSession(s);
     }
   }
 
+  // send one frame per session, so a slow client doesn't hold up the others
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    Session& s = sessions[i];
+    if (!s.connected || s.send_queue.isEmpty()) continue;
+
+    _last_write = millis();
+    int h = s.send_queue.peek();
+    int len = frame_pool.length(h);
+
+    uint8_t* pkt = frame_pool.headroom(h); // use same header as serial interface so client can delimit frames
+    pkt[0] = '>';
+    pkt[1] = (len & 0xFF);  // LSB
+    pkt[2] = (len >> 8);    // MSB
+    s.client.write(pkt, FRAME_POOL_HEADROOM + len);
+    s.send_queue.pop(frame_pool);
+  }
+
+  for (int n = 0; n < WIFI_MAX_CLIENTS; n++) {
+    int i = (_next_recv + n) % WIFI_MAX_CLIENTS;
+    if (!sessions[i].connected) continue;
+
+    size_t len = readFrame(sessions[i], dest);
+    if (len > 0) {
+      _reply_session = i;   // replies to this command go back to this client
+      _next_recv = (i + 1) % WIFI_MAX_CLIENTS;
+      return len;
+    }
+  }
   return 0;
 }
 
 bool SerialWifiInterface::isConnected() const {
-  return deviceConnected;  //pServer != NULL && pServer->getConnectedCount() > 0;
-}
\ No newline at end of file
+  return getNumClients() > 0;
+}
+
+int SerialWifiInterface::getNumClients() const {
+  int n = 0;
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    if (sessions[i].connected) n++;
+  }
+  return n;
+}
+
+uint32_t SerialWifiInterface::getNumDroppedFrames() const {
+  uint32_t n = 0;
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+    n += sessions[i].send_queue.getNumDropped();
+  }
+  return n;
+}
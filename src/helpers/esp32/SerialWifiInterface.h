@@ -1,47 +1,66 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FramePool.h"
 #include <WiFi.h>
 
+#ifndef WIFI_MAX_CLIENTS
+  #define WIFI_MAX_CLIENTS  4
+#endif
+
+// so one slow client can't use up the whole pool
+#ifndef WIFI_MAX_QUEUED_PER_CLIENT
+  #define WIFI_MAX_QUEUED_PER_CLIENT  (SERIAL_FRAME_POOL_SIZE / 2)
+#endif
+
+/**
+ * \brief  Companion interface for several concurrent TCP clients (eg. phone app plus dashboards).
+ *     Replies go to the client whose command is being handled, push frames (code >= 0x80) go to all clients.
+ *     Each client has its own send queue, all sharing one FramePool, so a broadcast is stored only once.
+ */
 class SerialWifiInterface : public BaseSerialInterface {
-  bool deviceConnected;
   bool _isEnabled;
   unsigned long _last_write;
-  unsigned long adv_restart_time;
 
   WiFiServer server;
-  WiFiClient client;
 
   struct FrameHeader {
     uint8_t type;
     uint16_t length;
   };
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
+  struct Session {
+    WiFiClient client;
+    FrameHeader received_frame_header;
+    FrameQueue send_queue;
+    unsigned long last_activity;
+    bool connected;
   };
 
-  FrameHeader received_frame_header;
-
-  #define FRAME_QUEUE_SIZE  4
-  int recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
+  FramePool frame_pool;
+  Session sessions[WIFI_MAX_CLIENTS];
+  int _reply_session;   // whose command is being handled
+  int _next_recv;       // round-robin, so a busy client can't starve the others
 
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  void clearBuffers();
+  void acceptClients();
+  void closeSession(Session& s);
+  bool queueFrame(Session& s, int h);
+  size_t readFrame(Session& s, uint8_t dest[]);
 
-protected:
+  static bool hasReceivedFrameHeader(const Session& s);
+  static void resetReceivedFrameHeader(Session& s);
 
 public:
-  SerialWifiInterface() : server(WiFiServer()), client(WiFiClient()) {
-    deviceConnected = false;
+  SerialWifiInterface() : server(WiFiServer()) {
     _isEnabled = false;
     _last_write = 0;
-    send_queue_len = recv_queue_len = 0;
-    received_frame_header.type = 0;
-    received_frame_header.length = 0;
+    _reply_session = _next_recv = 0;
+    for (int i = 0; i < WIFI_MAX_CLIENTS; i++) {
+      sessions[i].connected = false;
+      sessions[i].last_activity = 0;
+      resetReceivedFrameHeader(sessions[i]);
+    }
   }
 
   void begin(int port);
@@ -56,9 +75,11 @@ public:
 
   size_t writeFrame(const uint8_t src[], size_t len) override;
   size_t checkRecvFrame(uint8_t dest[]) override;
+  uint32_t getNumDroppedFrames() const override;
+  int getReplySession() const override { return _reply_session; }
+  void setReplySession(int session) override { _reply_session = session; }
 
-  bool hasReceivedFrameHeader();
-  void resetReceivedFrameHeader();
+  int getNumClients() const;
 };
 
 #if WIFI_DEBUG_LOGGING && ARDUINO
@@ -195,30 +195,12 @@ void SerialBLEInterface::begin(const char* prefix, char* name, uint32_t pin_code
 }
 
 void SerialBLEInterface::clearBuffers() {
-  send_queue_len = 0;
-  recv_queue_len = 0;
+  send_queue.clear(frame_pool);
+  recv_queue.clear(frame_pool);
   _last_retry_attempt = 0;
   bleuart.flush();
 }
 
-void SerialBLEInterface::shiftSendQueueLeft() {
-  if (send_queue_len > 0) {
-    send_queue_len--;
-    for (uint8_t i = 0; i < send_queue_len; i++) {
-      send_queue[i] = send_queue[i + 1];
-    }
-  }
-}
-
-void SerialBLEInterface::shiftRecvQueueLeft() {
-  if (recv_queue_len > 0) {
-    recv_queue_len--;
-    for (uint8_t i = 0; i < recv_queue_len; i++) {
-      recv_queue[i] = recv_queue[i + 1];
-    }
-  }
-}
-
 bool SerialBLEInterface::isValidConnection(uint16_t handle, bool requireWaitingForSecurity) const {
   if (_conn_handle != handle) {
     return false;
@@ -272,46 +254,42 @@ size_t SerialBLEInterface::writeFrame(const uint8_t src[], size_t len) {
 
   bool connected = isConnected();
   if (connected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
+    if (!send_queue.pushCopy(frame_pool, src, len)) {
       BLE_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
       return 0;
     }
-
-    send_queue[send_queue_len].len = len;
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
-    
     return len;
   }
   return 0;
 }
 
 size_t SerialBLEInterface::checkRecvFrame(uint8_t dest[]) {
-  if (send_queue_len > 0) {
+  if (!send_queue.isEmpty()) {
     if (!isConnected()) {
       BLE_DEBUG_PRINTLN("writeBytes: connection invalid, clearing send queue");
-      send_queue_len = 0;
+      send_queue.clear(frame_pool);
     } else {
       unsigned long now = millis();
       bool throttle_active = (_last_retry_attempt > 0 && (now - _last_retry_attempt) < BLE_RETRY_THROTTLE_MS);
 
       if (!throttle_active) {
-        Frame frame_to_send = send_queue[0];
+        int h = send_queue.peek();
+        size_t frame_len = frame_pool.length(h);
 
-        size_t written = bleuart.write(frame_to_send.buf, frame_to_send.len);
-        if (written == frame_to_send.len) {
-          BLE_DEBUG_PRINTLN("writeBytes: sz=%u, hdr=%u", (unsigned)frame_to_send.len, (unsigned)frame_to_send.buf[0]);
+        size_t written = bleuart.write(frame_pool.data(h), frame_len);
+        if (written == frame_len) {
+          BLE_DEBUG_PRINTLN("writeBytes: sz=%u, hdr=%u", (unsigned)frame_len, (unsigned)frame_pool.data(h)[0]);
           _last_retry_attempt = 0;
-          shiftSendQueueLeft();
+          send_queue.pop(frame_pool);
         } else if (written > 0) {
-          BLE_DEBUG_PRINTLN("writeBytes: partial write, sent=%u of %u, dropping corrupted frame", (unsigned)written, (unsigned)frame_to_send.len);
+          BLE_DEBUG_PRINTLN("writeBytes: partial write, sent=%u of %u, dropping corrupted frame", (unsigned)written, (unsigned)frame_len);
           _last_retry_attempt = 0;
-          shiftSendQueueLeft();
+          send_queue.pop(frame_pool);
         } else {
           if (!isConnected()) {
             BLE_DEBUG_PRINTLN("writeBytes failed: connection lost, dropping frame");
             _last_retry_attempt = 0;
-            shiftSendQueueLeft();
+            send_queue.pop(frame_pool);
           } else {
             BLE_DEBUG_PRINTLN("writeBytes failed (buffer full), keeping frame for retry");
             _last_retry_attempt = now;
@@ -321,13 +299,14 @@ size_t SerialBLEInterface::checkRecvFrame(uint8_t dest[]) {
     }
   }
   
-  if (recv_queue_len > 0) {
-    size_t len = recv_queue[0].len;
-    memcpy(dest, recv_queue[0].buf, len);
+  if (!recv_queue.isEmpty()) {
+    int h = recv_queue.peek();
+    size_t len = frame_pool.length(h);
+    memcpy(dest, frame_pool.data(h), len);
     
     BLE_DEBUG_PRINTLN("readBytes: sz=%u, hdr=%u", (unsigned)len, (unsigned)dest[0]);
     
-    shiftRecvQueueLeft();
+    recv_queue.pop(frame_pool);
     return len;
   }
   
@@ -361,14 +340,6 @@ void SerialBLEInterface::onBleUartRX(uint16_t conn_handle) {
   }
   
   while (instance->bleuart.available() > 0) {
-    if (instance->recv_queue_len >= FRAME_QUEUE_SIZE) {
-      while (instance->bleuart.available() > 0) {
-        instance->bleuart.read();
-      }
-      BLE_DEBUG_PRINTLN("onBleUartRX: recv queue full, dropping data");
-      break;
-    }
-    
     int avail = instance->bleuart.available();
     
     if (avail > MAX_FRAME_SIZE) {
@@ -381,10 +352,17 @@ void SerialBLEInterface::onBleUartRX(uint16_t conn_handle) {
       continue;
     }
     
-    int read_len = avail;
-    instance->recv_queue[instance->recv_queue_len].len = read_len;
-    instance->bleuart.readBytes(instance->recv_queue[instance->recv_queue_len].buf, read_len);
-    instance->recv_queue_len++;
+    int h = instance->recv_queue.isFull() ? -1 : instance->frame_pool.alloc(NULL, avail);
+    if (h < 0) {
+      instance->recv_queue.markDropped();
+      while (instance->bleuart.available() > 0) {
+        instance->bleuart.read();
+      }
+      BLE_DEBUG_PRINTLN("onBleUartRX: recv queue full, dropping data");
+      break;
+    }
+    instance->bleuart.readBytes(instance->frame_pool.data(h), avail);   // straight into pool buffer
+    instance->recv_queue.push(instance->frame_pool, h);
   }
 }
 
@@ -393,5 +371,5 @@ bool SerialBLEInterface::isConnected() const {
 }
 
 bool SerialBLEInterface::isWriteBusy() const {
-  return send_queue_len >= (FRAME_QUEUE_SIZE * 2 / 3);
+  return send_queue.count() >= (SERIAL_FRAME_POOL_SIZE * 2 / 3);
 }
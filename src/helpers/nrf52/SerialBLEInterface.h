@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FramePool.h"
 #include <bluefruit.h>
 
 #ifndef BLE_TX_POWER
@@ -15,22 +16,11 @@ class SerialBLEInterface : public BaseSerialInterface {
   unsigned long _last_health_check;
   unsigned long _last_retry_attempt;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
-
-  #define FRAME_QUEUE_SIZE  12
-  
-  uint8_t send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
-  
-  uint8_t recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
+  FramePool frame_pool;
+  FrameQueue send_queue;
+  FrameQueue recv_queue;
 
   void clearBuffers();
-  void shiftSendQueueLeft();
-  void shiftRecvQueueLeft();
   bool isValidConnection(uint16_t handle, bool requireWaitingForSecurity = false) const;
   bool isAdvertising() const;
   static void onConnect(uint16_t connection_handle);
@@ -48,8 +38,6 @@ public:
     _conn_handle = BLE_CONN_HANDLE_INVALID;
     _last_health_check = 0;
     _last_retry_attempt = 0;
-    send_queue_len = 0;
-    recv_queue_len = 0;
   }
 
   /**
@@ -68,6 +56,7 @@ public:
   bool isWriteBusy() const override;
   size_t writeFrame(const uint8_t src[], size_t len) override;
   size_t checkRecvFrame(uint8_t dest[]) override;
+  uint32_t getNumDroppedFrames() const override { return send_queue.getNumDropped() + recv_queue.getNumDropped(); }
 };
 
 #if BLE_DEBUG_LOGGING && ARDUINO
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+ * Host (platform = native) stand-ins for the few Arduino core APIs that the unit tests' code paths use.
+ * Header-only, so that PlatformIO doesn't treat this directory as a test.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <Stream.h>
+
+typedef bool boolean;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+namespace native {
+
+/** \brief  milliseconds added to the real clock, so tests can skip ahead in time without sleeping */
+inline int64_t& clockOffsetMicros() { static int64_t offset = 0; return offset; }
+
+inline int64_t nowMicros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()
+         + clockOffsetMicros();
+}
+
+/** \brief  advances millis() / micros() by 'ms', as if that much time had passed */
+inline void advanceMillis(uint32_t ms) { clockOffsetMicros() += (int64_t) ms * 1000; }
+
+}
+
+inline unsigned long millis() { return (unsigned long) (native::nowMicros() / 1000); }
+inline unsigned long micros() { return (unsigned long) native::nowMicros(); }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+inline char* ltoa(long value, char* str, int base) {   // base 10 only
+  sprintf(str, "%ld", value);
+  return str;
+}
+
+inline void randomSeed(unsigned long seed) { srand(seed); }
+inline long random(long howbig) { return howbig <= 0 ? 0 : rand() % howbig; }
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+
+class String {
+  std::string _s;
+public:
+  String(const char* s = "") : _s(s) { }
+  String(const std::string& s) : _s(s) { }
+  const char* c_str() const { return _s.c_str(); }
+  unsigned int length() const { return _s.length(); }
+  bool operator==(const char* s) const { return _s == s; }
+};
+
+/**
+ * \brief  serial port with nothing attached: output is discarded, nothing is ever received
+ */
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { }
+  void end() { }
+  void setPins(int rx, int tx) { }
+  operator bool() const { return true; }
+
+  size_t write(uint8_t c) override { return 1; }
+  size_t write(const uint8_t* buf, size_t len) override { return len; }
+  int availableForWrite() override { return 256; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+};
+
+inline HardwareSerial Serial;
+inline HardwareSerial Serial1;
+inline HardwareSerial Serial2;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define LPP_TEMPERATURE       103
+#define LPP_VOLTAGE           116
+#define LPP_GPS               136
+
+/**
+ * \brief  host stand-in for the CayenneLPP library's encoder, covering the channel types the firmware uses
+ */
+class CayenneLPP {
+  uint8_t _buf[255];
+  uint8_t _max_size, _size;
+
+  uint8_t add(uint8_t channel, uint8_t type, const int32_t* vals, int num, int bytes_each) {
+    if (_size + 2 + num * bytes_each > _max_size) return 0;
+    _buf[_size++] = channel;
+    _buf[_size++] = type;
+    for (int i = 0; i < num; i++) {
+      for (int b = bytes_each - 1; b >= 0; b--) _buf[_size++] = vals[i] >> (8 * b);   // big endian
+    }
+    return _size;
+  }
+
+public:
+  CayenneLPP(uint8_t size) : _max_size(size), _size(0) { }
+
+  void reset() { _size = 0; }
+  uint8_t getSize() const { return _size; }
+  uint8_t* getBuffer() { return _buf; }
+
+  uint8_t addTemperature(uint8_t channel, float celsius) {
+    int32_t v = lroundf(celsius * 10);
+    return add(channel, LPP_TEMPERATURE, &v, 1, 2);
+  }
+  uint8_t addVoltage(uint8_t channel, float volts) {
+    int32_t v = lroundf(volts * 100);
+    return add(channel, LPP_VOLTAGE, &v, 1, 2);
+  }
+  uint8_t addGPS(uint8_t channel, float lat, float lon, float alt) {
+    int32_t v[3] = { (int32_t) lroundf(lat * 10000), (int32_t) lroundf(lon * 10000), (int32_t) lroundf(alt * 100) };
+    return add(channel, LPP_GPS, v, 3, 3);
+  }
+};
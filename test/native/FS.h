@@ -0,0 +1,117 @@
+#pragma once
+
+/*
+ * Host stand-in for the Arduino-ESP32 FS API: an in-memory filesystem, so that code which stores to flash
+ * (DataStore, IdentityStore, ...) runs under test.  Only the calls that code makes are here.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Stream.h>
+
+namespace fs {
+
+typedef std::vector<uint8_t> FileData;
+
+struct FSState {
+  size_t written = 0;    // bytes, since the FS was created
+  size_t space_left = SIZE_MAX;   // writes past this are cut short, as on a full flash
+};
+
+class File : public Stream {
+  std::shared_ptr<FileData> _data;
+  size_t _pos = 0;
+  FSState* _state = NULL;
+
+public:
+  File() { }
+  File(std::shared_ptr<FileData> data, size_t pos, FSState* state) : _data(data), _pos(pos), _state(state) { }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override {
+    if (!_data) return 0;
+    if (len > _state->space_left) len = _state->space_left;
+    if (_pos + len > _data->size()) _data->resize(_pos + len);
+    memcpy(_data->data() + _pos, buf, len);
+    _pos += len;
+    _state->written += len;
+    _state->space_left -= len;
+    return len;
+  }
+  int available() override { return _data ? _data->size() - _pos : 0; }
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int peek() override { return available() > 0 ? (*_data)[_pos] : -1; }
+  int read(uint8_t* buf, size_t len) {
+    size_t n = available();
+    if (len < n) n = len;
+    if (n > 0) memcpy(buf, _data->data() + _pos, n);
+    _pos += n;
+    return n;
+  }
+  size_t readBytes(uint8_t* buf, size_t len) override { return read(buf, len); }
+  bool seek(uint32_t pos) {
+    if (!_data || pos > _data->size()) return false;
+    _pos = pos;
+    return true;
+  }
+  size_t position() const { return _pos; }
+  size_t size() const { return _data ? _data->size() : 0; }
+  void close() { _data.reset(); }
+  operator bool() const { return (bool) _data; }
+};
+
+class FS {
+  std::map<std::string, std::shared_ptr<FileData>> _files;
+  FSState _state;
+
+public:
+  File open(const char* path, const char* mode = "r", bool create = false) {
+    auto it = _files.find(path);
+    if (mode[0] == 'r') {
+      return it == _files.end() ? File() : File(it->second, 0, &_state);
+    }
+    if (it == _files.end() || mode[0] == 'w') {
+      _files[path] = std::make_shared<FileData>();   // a handle still open on the old contents keeps those
+      it = _files.find(path);
+    }
+    return File(it->second, mode[0] == 'a' ? it->second->size() : 0, &_state);
+  }
+  bool exists(const char* path) { return _files.count(path) > 0; }
+  bool remove(const char* path) { return _files.erase(path) > 0; }
+  bool rename(const char* from, const char* to) {
+    auto it = _files.find(from);
+    if (it == _files.end()) return false;
+    _files[to] = it->second;
+    _files.erase(from);
+    return true;
+  }
+  bool mkdir(const char* path) { return true; }
+  bool format() {
+    _files.clear();
+    return true;
+  }
+
+  /** \brief  total bytes in all files, for tests */
+  size_t usedBytes() const {
+    size_t n = 0;
+    for (auto& f : _files) n += f.second->size();
+    return n;
+  }
+  /** \brief  bytes written since created, for tests */
+  size_t bytesWritten() const { return _state.written; }
+  int numFiles() const { return _files.size(); }
+  /** \brief  for tests: how many more bytes can be written (SIZE_MAX for no limit) */
+  void setSpaceLeft(size_t n) { _state.space_left = n; }
+};
+
+}
+
+using fs::File;
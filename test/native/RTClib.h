@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \brief  host stand-in for RTClib's DateTime, from unix time (UTC)
+ */
+class DateTime {
+  uint16_t _y;
+  uint8_t _m, _d, _hh, _mm, _ss;
+
+public:
+  DateTime(uint32_t t = 0) {
+    _ss = t % 60; t /= 60;
+    _mm = t % 60; t /= 60;
+    _hh = t % 24; t /= 24;
+
+    // civil from days, after Howard Hinnant's algorithm
+    int32_t z = t + 719468;
+    int32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    _d = doy - (153 * mp + 2) / 5 + 1;
+    _m = mp < 10 ? mp + 3 : mp - 9;
+    _y = yoe + era * 400 + (_m <= 2);
+  }
+
+  uint16_t year() const { return _y; }
+  uint8_t month() const { return _m; }
+  uint8_t day() const { return _d; }
+  uint8_t hour() const { return _hh; }
+  uint8_t minute() const { return _mm; }
+  uint8_t second() const { return _ss; }
+};
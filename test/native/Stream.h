@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+/**
+ * \brief  host stand-in for the Arduino Print class.  Subclasses only need to override write(uint8_t)
+ */
+class Print {
+public:
+  virtual ~Print() { }
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && write(buf[n])) n++;
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t *) s, strlen(s)); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() { }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t) c); }
+  size_t print(int n) { return printf("%d", n); }
+  size_t print(unsigned int n) { return printf("%u", n); }
+  size_t print(long n) { return printf("%ld", n); }
+  size_t print(unsigned long n) { return printf("%lu", n); }
+  size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+  size_t println() { return write("\r\n"); }
+  template<typename T> size_t println(T v) { return print(v) + println(); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char tmp[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+    if (n < 0) return 0;
+    if (n >= (int) sizeof(tmp)) n = sizeof(tmp) - 1;
+    return write((const uint8_t *) tmp, n);
+  }
+};
+
+/**
+ * \brief  host stand-in for the Arduino Stream class
+ */
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() { return -1; }
+
+  virtual size_t readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+      int c = read();
+      if (c < 0) break;
+      buf[n++] = c;
+    }
+    return n;
+  }
+  size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t *) buf, len); }
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+/*
+ * Host stand-in for the ESP32 WiFi library: the station is always connected (to the loopback interface),
+ * and WiFiServer / WiFiClient are non-blocking TCP sockets.
+ */
+
+#include <Arduino.h>
+#include <memory>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WL_CONNECTED     3
+#define WL_DISCONNECTED  6
+
+#define WIFI_OFF   0
+#define WIFI_STA   1
+
+class IPAddress {
+  uint8_t _b[4];
+public:
+  IPAddress() { memset(_b, 0, sizeof(_b)); }
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { _b[0] = a; _b[1] = b; _b[2] = c; _b[3] = d; }
+
+  bool fromString(const char* s) {
+    unsigned v[4];
+    char tail;
+    if (sscanf(s, "%u.%u.%u.%u%c", &v[0], &v[1], &v[2], &v[3], &tail) != 4) return false;
+    for (int i = 0; i < 4; i++) {
+      if (v[i] > 255) return false;
+      _b[i] = v[i];
+    }
+    return true;
+  }
+  String toString() const {
+    char tmp[16];
+    snprintf(tmp, sizeof(tmp), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+    return String(tmp);
+  }
+  uint8_t operator[](int i) const { return _b[i]; }
+  bool operator==(const IPAddress& other) const { return memcmp(_b, other._b, 4) == 0; }
+  bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+  /** \returns  address in network byte order, as for sockaddr_in */
+  uint32_t toNetwork() const { uint32_t a; memcpy(&a, _b, 4); return a; }
+  static IPAddress fromNetwork(uint32_t a) { IPAddress ip; memcpy(ip._b, &a, 4); return ip; }
+};
+
+class WiFiClass {
+  IPAddress _local_ip = IPAddress(127, 0, 0, 1);
+public:
+  int status() const { return WL_CONNECTED; }
+  void mode(int m) { }
+  void begin(const char* ssid, const char* pwd) { }
+  void disconnect() { }
+  IPAddress localIP() const { return _local_ip; }
+  void setLocalIP(const IPAddress& ip) { _local_ip = ip; }   // host only, eg. to run several 'nodes' on 127.0.0.x
+};
+
+inline WiFiClass WiFi;
+
+class WiFiClient {
+  struct Socket {
+    int fd;
+    Socket(int f) : fd(f) { }
+    ~Socket() { if (fd >= 0) ::close(fd); }
+  };
+  std::shared_ptr<Socket> _sock;   // copies share the connection, as with the ESP32 WiFiClient
+
+public:
+  WiFiClient() { }
+  explicit WiFiClient(int fd) : _sock(std::make_shared<Socket>(fd)) {
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+
+  operator bool() const { return _sock && _sock->fd >= 0; }
+
+  int available() {
+    if (!*this) return 0;
+    uint8_t tmp[MAX_BUF];
+    int n = recv(_sock->fd, tmp, sizeof(tmp), MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 ? n : 0;
+  }
+
+  uint8_t connected() {
+    if (!*this) return 0;
+    uint8_t c;
+    int n = recv(_sock->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+  }
+
+  int read(uint8_t* buf, size_t len) {
+    if (!*this) return -1;
+    int n = recv(_sock->fd, buf, len, MSG_DONTWAIT);
+    return n > 0 ? n : -1;
+  }
+  size_t readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+      int r = read(&buf[n], len - n);
+      if (r <= 0) break;
+      n += r;
+    }
+    return n;
+  }
+
+  size_t write(const uint8_t* buf, size_t len) {
+    if (!*this) return 0;
+    size_t n = 0;
+    while (n < len) {    // blocking, like the ESP32 client's write()
+      int w = send(_sock->fd, &buf[n], len - n, MSG_NOSIGNAL);
+      if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { yield(); continue; }
+      if (w <= 0) break;
+      n += w;
+    }
+    return n;
+  }
+
+  void stop() {
+    if (_sock && _sock->fd >= 0) {
+      ::close(_sock->fd);
+      _sock->fd = -1;
+    }
+    _sock.reset();
+  }
+
+private:
+  static const int MAX_BUF = 4096;
+};
+
+class WiFiServer {
+  int _fd = -1;
+public:
+  ~WiFiServer() { if (_fd >= 0) ::close(_fd); }
+
+  void begin(uint16_t port) {
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = WiFi.localIP().toNetwork();
+    if (bind(_fd, (sockaddr *) &addr, sizeof(addr)) != 0 || listen(_fd, 8) != 0) {
+      perror("WiFiServer::begin()");
+      ::close(_fd);
+      _fd = -1;
+      return;
+    }
+    fcntl(_fd, F_SETFL, O_NONBLOCK);
+  }
+
+  /** \returns  a newly accepted client, if any */
+  WiFiClient available() {
+    if (_fd < 0) return WiFiClient();
+    int fd = accept(_fd, NULL, NULL);
+    return fd >= 0 ? WiFiClient(fd) : WiFiClient();
+  }
+};
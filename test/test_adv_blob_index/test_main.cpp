@@ -0,0 +1,202 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+
+#define MAX_BLOBRECS  1000
+#include "../../examples/companion_radio/AdvBlobIndex.h"
+
+/*
+ * Benchmarks the RAM index of the '/adv_blobs' file against the record-by-record scan it replaced,
+ * with the file simulated in RAM.  Records read is the number that matters on flash.
+ */
+
+#define NUM_BLOBS      1000
+#define NUM_OPS       20000
+#define BLOB_DATA_LEN   100
+
+struct BlobRec {    // same layout as in DataStore.cpp
+  uint32_t timestamp;
+  uint8_t  key[BLOB_KEY_SIZE];
+  uint8_t  len;
+  uint8_t  data[BLOB_DATA_LEN];
+};
+
+struct BlobFile {
+  std::vector<BlobRec> recs;
+  long reads = 0;
+
+  BlobFile() : recs(NUM_BLOBS) { memset(recs.data(), 0, recs.size() * sizeof(BlobRec)); }
+
+  void read(int slot, BlobRec* dest) { *dest = recs[slot]; reads++; }
+  void write(int slot, const BlobRec* src) { recs[slot] = *src; }
+};
+
+static void makeKey(uint32_t n, uint8_t* key) {
+  uint32_t h = n * 2654435761u;   // spread keys like pub_key prefixes
+  for (int i = 0; i < BLOB_KEY_SIZE; i++) {
+    key[i] = h >> ((i % 4) * 8);
+    if (i % 4 == 3) h = h * 2654435761u + n;
+  }
+}
+
+static void makeRec(BlobRec* rec, const uint8_t* key, uint32_t timestamp) {
+  memcpy(rec->key, key, BLOB_KEY_SIZE);
+  rec->timestamp = timestamp;
+  rec->len = BLOB_DATA_LEN;
+  memset(rec->data, key[0] ^ (uint8_t)timestamp, BLOB_DATA_LEN);
+}
+
+/* the lookups from DataStore before the index was added */
+struct ScanStore {
+  BlobFile file;
+
+  int get(const uint8_t* key, BlobRec* dest) {
+    for (int slot = 0; slot < NUM_BLOBS; slot++) {
+      file.read(slot, dest);
+      if (memcmp(key, dest->key, BLOB_KEY_SIZE) == 0) return dest->len;
+    }
+    return 0;
+  }
+
+  void put(const uint8_t* key, uint32_t timestamp) {
+    int found = 0;
+    uint32_t min_timestamp = 0xFFFFFFFF;
+    BlobRec tmp;
+    for (int slot = 0; slot < NUM_BLOBS; slot++) {
+      file.read(slot, &tmp);
+      if (memcmp(key, tmp.key, BLOB_KEY_SIZE) == 0) {
+        found = slot;
+        break;
+      }
+      if (tmp.timestamp < min_timestamp) {
+        min_timestamp = tmp.timestamp;
+        found = slot;
+      }
+    }
+    makeRec(&tmp, key, timestamp);
+    file.write(found, &tmp);
+  }
+};
+
+/* the lookups from DataStore with AdvBlobIndex */
+struct IndexedStore {
+  BlobFile file;
+  AdvBlobIndex index;
+
+  IndexedStore() { index.reset(NUM_BLOBS); }
+
+  int get(const uint8_t* key, BlobRec* dest) {
+    int slot = index.find(key);
+    if (slot < 0) return 0;
+    file.read(slot, dest);
+    index.touch(slot);
+    return dest->len;
+  }
+
+  void put(const uint8_t* key, uint32_t timestamp) {
+    int slot = index.find(key);
+    if (slot < 0) slot = index.getEvictSlot();
+    BlobRec tmp;
+    makeRec(&tmp, key, timestamp);
+    file.write(slot, &tmp);
+    index.assign(slot, key);
+  }
+};
+
+static uint32_t next_rand = 1;
+static uint32_t nextRand() {
+  next_rand = next_rand * 1103515245u + 12345u;
+  return next_rand >> 8;
+}
+
+/* a contact export or advert receipt mix: mostly lookups of known keys, some updates, some new keys */
+template<typename STORE>
+static double runWorkload(STORE& store, long* hits) {
+  next_rand = 1;
+  uint32_t num_keys = 0;
+  uint8_t key[BLOB_KEY_SIZE];
+  BlobRec rec;
+
+  auto start = std::chrono::steady_clock::now();
+  for (; num_keys < NUM_BLOBS; num_keys++) {
+    makeKey(num_keys, key);
+    store.put(key, num_keys + 1);
+  }
+  *hits = 0;
+  for (uint32_t i = 0; i < NUM_OPS; i++) {
+    uint32_t r = nextRand();
+    if (r % 10 < 7) {
+      makeKey(num_keys - 1 - (r >> 4) % NUM_BLOBS, key);   // a recently stored key
+      if (store.get(key, &rec) > 0 && memcmp(rec.key, key, BLOB_KEY_SIZE) == 0) (*hits)++;
+    } else if (r % 10 < 9) {
+      makeKey(num_keys - 1 - (r >> 4) % NUM_BLOBS, key);
+      store.put(key, NUM_BLOBS + i + 1);
+    } else {
+      makeKey(num_keys++, key);
+      store.put(key, NUM_BLOBS + i + 1);
+    }
+  }
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void setUp(void) { }
+void tearDown(void) { }
+
+void test_find_assign_evict(void) {
+  AdvBlobIndex index;
+  index.reset(20);
+  TEST_ASSERT_EQUAL(20, index.getNumSlots());
+  TEST_ASSERT_EQUAL(0, index.getEvictSlot());
+
+  uint8_t keys[20][BLOB_KEY_SIZE];
+  for (int i = 0; i < 20; i++) {
+    makeKey(i, keys[i]);
+    keys[i][0] = i * BLOB_HASH_BUCKETS;   // all in the same hash bucket
+    TEST_ASSERT_EQUAL(-1, index.find(keys[i]));
+    int slot = index.getEvictSlot();
+    TEST_ASSERT_EQUAL(i, slot);
+    index.assign(slot, keys[i]);
+  }
+  for (int i = 0; i < 20; i++) TEST_ASSERT_EQUAL(i, index.find(keys[i]));
+
+  index.touch(0);
+  TEST_ASSERT_EQUAL(1, index.getEvictSlot());
+
+  uint8_t key[BLOB_KEY_SIZE];
+  makeKey(12345, key);
+  index.assign(index.getEvictSlot(), key);
+  TEST_ASSERT_EQUAL(-1, index.find(keys[1]));
+  TEST_ASSERT_EQUAL(1, index.find(key));
+  TEST_ASSERT_EQUAL(2, index.getEvictSlot());
+  for (int i = 2; i < 20; i++) TEST_ASSERT_EQUAL(i, index.find(keys[i]));
+}
+
+void test_benchmark_1000_blobs(void) {
+  static ScanStore scan;
+  static IndexedStore indexed;
+  long scan_hits, index_hits;
+
+  double scan_us = runWorkload(scan, &scan_hits);
+  double index_us = runWorkload(indexed, &index_hits);
+
+  char msg[200];
+  snprintf(msg, sizeof(msg), "scan:  %ld hits, %.1f records read/op, %.2f us/op",
+           scan_hits, scan.file.reads / (double)(NUM_BLOBS + NUM_OPS), scan_us / (NUM_BLOBS + NUM_OPS));
+  TEST_MESSAGE(msg);
+  snprintf(msg, sizeof(msg), "index: %ld hits, %.1f records read/op, %.2f us/op",
+           index_hits, indexed.file.reads / (double)(NUM_BLOBS + NUM_OPS), index_us / (NUM_BLOBS + NUM_OPS));
+  TEST_MESSAGE(msg);
+
+  // LRU eviction also keeps blobs that are only being read, where the scan evicted the oldest written
+  TEST_ASSERT_GREATER_OR_EQUAL(scan_hits, index_hits);
+  TEST_ASSERT_GREATER_THAN(NUM_OPS / 2, index_hits);
+  TEST_ASSERT_LESS_OR_EQUAL(NUM_OPS, indexed.file.reads);    // at most one record read per get, none per put
+  TEST_ASSERT_GREATER_THAN(100 * indexed.file.reads, scan.file.reads);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_find_assign_evict);
+  RUN_TEST(test_benchmark_1000_blobs);
+  return UNITY_END();
+}
@@ -0,0 +1,220 @@
+#include <unity.h>
+#include <vector>
+#include <Arduino.h>
+#include <helpers/bridges/BridgeCodec.h>
+
+/*
+ * BridgeCodec on its own, at ESPNowBridge's body size: round trips, packing, MAC and key checks, and the
+ * replay window.
+ */
+
+typedef BridgeCodec<248> ESPNowCodec;
+
+static ESPNowCodec tx, rx;
+static uint8_t body[ESPNowCodec::MAX_BODY_SIZE];
+static uint8_t plain[ESPNowCodec::MAX_PLAIN_SIZE];
+
+static std::vector<uint8_t> makeRaw(int id, int len) {
+  std::vector<uint8_t> raw(len);
+  for (int k = 0; k < len; k++) raw[k] = id * 31 + k;
+  return raw;
+}
+
+/* seals one packet of 'len' bytes */
+static int sealOne(ESPNowCodec& codec, int id, int len) {
+  std::vector<uint8_t> raw = makeRaw(id, len);
+  codec.add(raw.data(), len);
+  return codec.seal(body);
+}
+
+/* opens 'body' with 'rx', and returns the packets in it */
+static std::vector<std::vector<uint8_t>> openPackets(const uint8_t* b, int len) {
+  std::vector<std::vector<uint8_t>> out;
+  int plain_len = rx.open(b, len, plain);
+  int pos = 0;
+  const uint8_t* raw;
+  int raw_len;
+  while ((raw_len = ESPNowCodec::nextPacket(plain, plain_len, pos, &raw)) > 0) {
+    out.emplace_back(raw, raw + raw_len);
+  }
+  return out;
+}
+
+void setUp(void) {
+  tx.setSecret("secret", 16);
+  tx.setEpoch(0x1234);
+  rx.setSecret("secret", 16);
+}
+
+void tearDown(void) { }
+
+void test_round_trip(void) {
+  std::vector<uint8_t> raw = makeRaw(1, 100);
+  TEST_ASSERT_FALSE(tx.hasPending());
+  TEST_ASSERT_EQUAL(0, tx.seal(body));
+  TEST_ASSERT_TRUE(tx.add(raw.data(), raw.size()));
+  TEST_ASSERT_TRUE(tx.hasPending());
+
+  int sealed = tx.getSealedSize();
+  int len = tx.seal(body);
+  TEST_ASSERT_EQUAL(sealed, len);
+  TEST_ASSERT_EQUAL(0, (len - ESPNowCodec::MAC_SIZE) % CIPHER_BLOCK_SIZE);
+  TEST_ASSERT_FALSE(tx.hasPending());
+
+  std::vector<std::vector<uint8_t>> got = openPackets(body, len);
+  TEST_ASSERT_EQUAL(1, (int) got.size());
+  TEST_ASSERT_TRUE(got[0] == raw);
+}
+
+void test_packs_until_full(void) {
+  // 20 byte packets, each with its length byte, after the header
+  int fit = (ESPNowCodec::MAX_PLAIN_SIZE - ESPNowCodec::HEADER_SIZE) / 21;
+  int n = 0;
+  while (true) {
+    std::vector<uint8_t> raw = makeRaw(n, 20);
+    if (!tx.add(raw.data(), raw.size())) break;
+    n++;
+  }
+  TEST_ASSERT_EQUAL(fit, n);
+  int len = tx.seal(body);
+  TEST_ASSERT_TRUE(len <= ESPNowCodec::MAX_BODY_SIZE);
+
+  std::vector<std::vector<uint8_t>> got = openPackets(body, len);
+  TEST_ASSERT_EQUAL(n, (int) got.size());
+  for (int i = 0; i < n; i++) TEST_ASSERT_TRUE(got[i] == makeRaw(i, 20));
+}
+
+void test_packet_size_limits(void) {
+  std::vector<uint8_t> raw = makeRaw(2, ESPNowCodec::MAX_PACKET_SIZE + 1);
+  TEST_ASSERT_FALSE(tx.add(raw.data(), 0));
+  TEST_ASSERT_FALSE(tx.add(raw.data(), raw.size()));
+  TEST_ASSERT_TRUE(tx.add(raw.data(), ESPNowCodec::MAX_PACKET_SIZE));
+  TEST_ASSERT_FALSE(tx.add(raw.data(), 1));   // full
+
+  int len = tx.seal(body);
+  TEST_ASSERT_EQUAL(ESPNowCodec::MAC_SIZE + ESPNowCodec::MAX_PLAIN_SIZE, len);
+  std::vector<std::vector<uint8_t>> got = openPackets(body, len);
+  TEST_ASSERT_EQUAL(1, (int) got.size());
+  TEST_ASSERT_EQUAL(ESPNowCodec::MAX_PACKET_SIZE, (int) got[0].size());
+}
+
+void test_wrong_key_and_tampering(void) {
+  int len = sealOne(tx, 3, 50);
+
+  ESPNowCodec other;
+  other.setSecret("secreT", 16);
+  TEST_ASSERT_EQUAL(0, other.open(body, len, plain));
+
+  for (int i = 0; i < len; i++) {
+    body[i] ^= 0x80;
+    TEST_ASSERT_EQUAL(0, rx.open(body, len, plain));
+    body[i] ^= 0x80;
+  }
+  TEST_ASSERT_EQUAL(0, rx.open(body, len - CIPHER_BLOCK_SIZE, plain));   // truncated
+  TEST_ASSERT_EQUAL(0, rx.open(body, ESPNowCodec::MAC_SIZE, plain));     // no ciphertext
+  TEST_ASSERT_EQUAL(0, rx.open(body, len - 1, plain));                   // not whole blocks
+
+  // only a secret's first 16 characters count, and it needn't be null terminated
+  ESPNowCodec same;
+  same.setSecret("secret\0ignored", 16);
+  TEST_ASSERT_TRUE(same.open(body, len, plain) > 0);
+}
+
+void test_replay_rejected(void) {
+  int len = sealOne(tx, 4, 60);
+  std::vector<uint8_t> first(body, body + len);
+
+  TEST_ASSERT_TRUE(rx.open(first.data(), len, plain) > 0);
+  TEST_ASSERT_EQUAL(0, rx.open(first.data(), len, plain));
+
+  // later bodies are still accepted, but not the first one again
+  for (int i = 0; i < 5; i++) {
+    len = sealOne(tx, 5 + i, 60);
+    TEST_ASSERT_TRUE(rx.open(body, len, plain) > 0);
+  }
+  TEST_ASSERT_EQUAL(0, rx.open(first.data(), first.size(), plain));
+}
+
+void test_reordering_within_window(void) {
+  std::vector<std::vector<uint8_t>> bodies;
+  for (int i = 0; i < 40; i++) {
+    int len = sealOne(tx, i, 30);
+    bodies.emplace_back(body, body + len);
+  }
+
+  // newest first: the 31 before it are in the window, older ones aren't
+  TEST_ASSERT_TRUE(rx.open(bodies[39].data(), bodies[39].size(), plain) > 0);
+  for (int i = 38; i >= 0; i--) {
+    int n = rx.open(bodies[i].data(), bodies[i].size(), plain);
+    if (39 - i < 32) {
+      TEST_ASSERT_TRUE(n > 0);
+    } else {
+      TEST_ASSERT_EQUAL(0, n);
+    }
+  }
+  // and each only once
+  for (int i = 8; i < 40; i++) TEST_ASSERT_EQUAL(0, rx.open(bodies[i].data(), bodies[i].size(), plain));
+}
+
+void test_senders_and_epochs(void) {
+  ESPNowCodec a, b;
+  a.setSecret("secret", 16);
+  b.setSecret("secret", 16);
+  a.setEpoch(100);
+  b.setEpoch(200);
+
+  // two senders, each with their own counters
+  int len = sealOne(a, 1, 40);
+  std::vector<uint8_t> oldest(body, body + len);
+  TEST_ASSERT_TRUE(rx.open(body, len, plain) > 0);
+  len = sealOne(b, 1, 40);
+  TEST_ASSERT_TRUE(rx.open(body, len, plain) > 0);
+
+  // a reboot is a new epoch, so its counter starting again isn't a replay
+  a.setEpoch(101);
+  len = sealOne(a, 2, 40);
+  std::vector<uint8_t> rebooted(body, body + len);
+  TEST_ASSERT_TRUE(rx.open(rebooted.data(), len, plain) > 0);
+  TEST_ASSERT_EQUAL(0, rx.open(rebooted.data(), len, plain));
+
+  // more senders than are remembered: the least recently seen is forgotten first, so its old bodies
+  // are accepted again (the mesh's packet tables still drop the packets in them, if recent)
+  for (int e = 0; e < BRIDGE_REPLAY_SENDERS - 1; e++) {
+    ESPNowCodec c;
+    c.setSecret("secret", 16);
+    c.setEpoch(1000 + e);
+    len = sealOne(c, 3, 40);
+    TEST_ASSERT_TRUE(rx.open(body, len, plain) > 0);
+  }
+  TEST_ASSERT_EQUAL(0, rx.open(rebooted.data(), rebooted.size(), plain));   // still remembered
+  TEST_ASSERT_TRUE(rx.open(oldest.data(), oldest.size(), plain) > 0);
+}
+
+void test_seal_throughput(void) {
+  const int n = 20000;
+  unsigned long start = micros();
+  int total = 0;
+  for (int i = 0; i < n; i++) {
+    int len = sealOne(tx, i, 100);
+    total += rx.open(body, len, plain) > 0;
+  }
+  unsigned long us = micros() - start;
+  TEST_ASSERT_EQUAL(n, total);
+
+  char msg[100];
+  snprintf(msg, sizeof(msg), "seal + open of a 100 byte packet: %.1f us", (float) us / n);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_packs_until_full);
+  RUN_TEST(test_packet_size_limits);
+  RUN_TEST(test_wrong_key_and_tampering);
+  RUN_TEST(test_replay_rejected);
+  RUN_TEST(test_reordering_within_window);
+  RUN_TEST(test_senders_and_epochs);
+  RUN_TEST(test_seal_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,202 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <helpers/CompactEncoding.h>
+
+/*
+ * CompactWriter round trips, against a reference reader, and entries per packet for realistic neighbour
+ * tables, written the way simple_repeater writes a NEIGHBOURS_FORMAT_COMPACT reply.
+ */
+
+#define RESULTS_MAX      130   // results space in a single-packet neighbours reply
+#define LEGACY_ENTRY(p)  ((p) + 4 + 1)
+
+struct CompactReader {
+  const uint8_t* buf;
+  int len, pos = 0;
+  bool error = false;
+
+  CompactReader(const uint8_t* b, int l) : buf(b), len(l) { }
+
+  uint8_t getByte() {
+    if (pos >= len) { error = true; return 0; }
+    return buf[pos++];
+  }
+  uint32_t getVarint() {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      uint8_t c = getByte();
+      v |= (uint32_t)(c & 0x7F) << shift;
+      if ((c & 0x80) == 0) return v;
+    }
+    error = true;
+    return 0;
+  }
+  int32_t getSigned() {
+    uint32_t z = getVarint();
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+  }
+};
+
+struct Neighbour {
+  uint8_t key[32];
+  uint32_t heard_secs_ago;
+  int8_t snr;
+};
+
+/* 'n' neighbours sorted newest first, heard at random intervals of up to 'max_gap' secs */
+static void makeNeighbours(Neighbour* dest, int n, uint32_t max_gap, unsigned seed) {
+  srand(seed);
+  uint32_t t = rand() % 60;
+  for (int i = 0; i < n; i++) {
+    for (int k = 0; k < 32; k++) dest[i].key[k] = rand();
+    t += rand() % (max_gap + 1);
+    dest[i].heard_secs_ago = t;
+    dest[i].snr = (rand() % 120) - 60;   // SNR x 4
+  }
+}
+
+/* as simple_repeater, for REQ_TYPE_GET_NEIGHBOURS with NEIGHBOURS_FORMAT_COMPACT */
+static int writeNeighbours(CompactWriter& out, const Neighbour* list, int n, int prefix_len) {
+  int32_t prev_secs_ago = 0;
+  int count = 0;
+  for (; count < n; count++) {
+    int mark = out.mark();
+    out.putBytes(list[count].key, prefix_len);
+    out.putSigned((int32_t)list[count].heard_secs_ago - prev_secs_ago);
+    out.putByte(list[count].snr);
+    if (out.hasOverflow()) {
+      out.rewind(mark);
+      break;
+    }
+    prev_secs_ago = list[count].heard_secs_ago;
+  }
+  return count;
+}
+
+void setUp(void) { }
+void tearDown(void) { }
+
+void test_varint_boundaries(void) {
+  const uint32_t vals[] = { 0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFFF, 0x200000, 0xFFFFFFF, 0x10000000, 0xFFFFFFFF };
+  const int sizes[] =     { 1, 1, 1,    2,    2,      3,      3,        4,        4,         5,          5 };
+  for (int i = 0; i < (int)(sizeof(vals) / sizeof(vals[0])); i++) {
+    uint8_t buf[8];
+    CompactWriter w(buf, sizeof(buf));
+    w.putVarint(vals[i]);
+    TEST_ASSERT_FALSE(w.hasOverflow());
+    TEST_ASSERT_EQUAL(sizes[i], w.getLength());
+
+    CompactReader r(buf, w.getLength());
+    TEST_ASSERT_EQUAL_UINT32(vals[i], r.getVarint());
+    TEST_ASSERT_FALSE(r.error);
+    TEST_ASSERT_EQUAL(w.getLength(), r.pos);
+  }
+}
+
+void test_zigzag_round_trip(void) {
+  const int32_t vals[] = { 0, -1, 1, -64, 63, -65, 64, 100000, -100000, 2147483647, -2147483647 - 1 };
+  for (int32_t v : vals) {
+    uint8_t buf[8];
+    CompactWriter w(buf, sizeof(buf));
+    w.putSigned(v);
+    CompactReader r(buf, w.getLength());
+    TEST_ASSERT_EQUAL_INT32(v, r.getSigned());
+    TEST_ASSERT_EQUAL(w.getLength(), r.pos);
+  }
+  // small magnitudes of either sign take one byte
+  for (int32_t v = -64; v <= 63; v++) {
+    uint8_t buf[8];
+    CompactWriter w(buf, sizeof(buf));
+    w.putSigned(v);
+    TEST_ASSERT_EQUAL(1, w.getLength());
+  }
+}
+
+void test_overflow_and_rewind(void) {
+  uint8_t buf[10];
+  memset(buf, 0xEE, sizeof(buf));
+  CompactWriter w(buf, 6);
+  const uint8_t key[4] = { 1, 2, 3, 4 };
+
+  w.putBytes(key, 4);
+  int mark = w.mark();
+  w.putVarint(0x4000);   // 3 bytes, only 2 left
+  TEST_ASSERT_TRUE(w.hasOverflow());
+  TEST_ASSERT_TRUE(w.getLength() <= 6);
+  TEST_ASSERT_EQUAL_HEX8(0xEE, buf[6]);   // never past max_len
+
+  w.rewind(mark);
+  TEST_ASSERT_FALSE(w.hasOverflow());
+  TEST_ASSERT_EQUAL(4, w.getLength());
+
+  w.putBytes(key, 3);   // putBytes is all or nothing
+  TEST_ASSERT_TRUE(w.hasOverflow());
+  TEST_ASSERT_EQUAL(4, w.getLength());
+}
+
+void test_neighbours_round_trip(void) {
+  const int prefix_lens[] = { 1, 4, 6 };
+  const uint32_t gaps[] = { 30, 600, 7200 };
+  for (int prefix_len : prefix_lens) {
+    for (uint32_t gap : gaps) {
+      Neighbour list[50];
+      makeNeighbours(list, 50, gap, prefix_len * 1000 + gap);
+
+      uint8_t buf[RESULTS_MAX];
+      CompactWriter w(buf, sizeof(buf));
+      int count = writeNeighbours(w, list, 50, prefix_len);
+      TEST_ASSERT_FALSE(w.hasOverflow());
+      TEST_ASSERT_TRUE(count >= RESULTS_MAX / LEGACY_ENTRY(prefix_len));   // never worse than the fixed layout
+
+      CompactReader r(buf, w.getLength());
+      int32_t secs = 0;
+      for (int i = 0; i < count; i++) {
+        for (int k = 0; k < prefix_len; k++) TEST_ASSERT_EQUAL_HEX8(list[i].key[k], r.getByte());
+        secs += r.getSigned();
+        TEST_ASSERT_EQUAL_UINT32(list[i].heard_secs_ago, (uint32_t)secs);
+        TEST_ASSERT_EQUAL_INT8(list[i].snr, (int8_t)r.getByte());
+      }
+      TEST_ASSERT_FALSE(r.error);
+      TEST_ASSERT_EQUAL(w.getLength(), r.pos);   // whole entries only
+
+      char msg[120];
+      snprintf(msg, sizeof(msg), "prefix %d, gaps up to %5u s: %2d entries in %3d bytes (fixed layout fits %2d)",
+               prefix_len, (unsigned)gap, count, w.getLength(), RESULTS_MAX / LEGACY_ENTRY(prefix_len));
+      TEST_MESSAGE(msg);
+    }
+  }
+}
+
+void test_unsorted_deltas(void) {
+  // eg. sorted by SNR, so deltas go both ways
+  Neighbour list[20];
+  makeNeighbours(list, 20, 3600, 7);
+  for (int i = 0; i < 20; i += 2) {
+    uint32_t t = list[i].heard_secs_ago;
+    list[i].heard_secs_ago = list[19 - i].heard_secs_ago;
+    list[19 - i].heard_secs_ago = t;
+  }
+  uint8_t buf[RESULTS_MAX];
+  CompactWriter w(buf, sizeof(buf));
+  int count = writeNeighbours(w, list, 20, 4);
+
+  CompactReader r(buf, w.getLength());
+  int32_t secs = 0;
+  for (int i = 0; i < count; i++) {
+    r.pos += 4;
+    secs += r.getSigned();
+    TEST_ASSERT_EQUAL_UINT32(list[i].heard_secs_ago, (uint32_t)secs);
+    r.getByte();
+  }
+  TEST_ASSERT_EQUAL(w.getLength(), r.pos);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_varint_boundaries);
+  RUN_TEST(test_zigzag_round_trip);
+  RUN_TEST(test_overflow_and_rewind);
+  RUN_TEST(test_neighbours_round_trip);
+  RUN_TEST(test_unsorted_deltas);
+  return UNITY_END();
+}
@@ -0,0 +1,294 @@
+#include <unity.h>
+#include <deque>
+#include <vector>
+#include <Arduino.h>
+#include <helpers/BaseChatMesh.h>
+#include <helpers/ArduinoHelpers.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include <DataStore.h>
+
+/*
+ * Companion contact paging: more contacts than MAX_CONTACTS go into a DataStore, with the least recently used
+ * paged out to flash (here, the in-memory FS).  After a reload the extra ones stay paged out, they page back in
+ * by pub_key, and a message from a paged out contact is resolved through searchPeersByHash().
+ */
+
+#define NUM_TEST_CONTACTS   (MAX_CONTACTS + 48)
+
+#if NUM_TEST_CONTACTS > MAX_STORED_CONTACTS
+  #error "native env needs MAX_STORED_CONTACTS > MAX_CONTACTS + 48"
+#endif
+
+/** \brief  a radio which keeps what it sends, and receives what a test queues for it */
+class FakeRadio : public mesh::Radio {
+public:
+  std::deque<std::vector<uint8_t>> rx;
+  std::vector<std::vector<uint8_t>> sent;
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    if (rx.empty()) return 0;
+    int len = rx.front().size();
+    memcpy(bytes, rx.front().data(), len);
+    rx.pop_front();
+    return len;
+  }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return 1; }
+  float packetScore(float snr, int packet_len) override { return 1; }
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    sent.emplace_back(bytes, bytes + len);
+    return true;
+  }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+  bool isReceiving() override { return false; }
+};
+
+/** \brief  a chat mesh which keeps its contacts in a DataStore, as companion_radio's MyMesh does */
+class TestChatMesh : public BaseChatMesh, public DataStoreHost {
+  DataStore* _store;
+
+public:
+  int num_msgs = 0;
+  char last_from[32];
+  char last_text[MAX_TEXT_LEN + 1];
+
+  TestChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc,
+               mesh::PacketManager& mgr, mesh::MeshTables& tables, DataStore& store)
+      : BaseChatMesh(radio, ms, rng, rtc, mgr, tables), _store(&store) { }
+
+  int searchPeers(const uint8_t* hash) { return searchPeersByHash(hash); }
+
+  // DataStoreHost
+  bool onContactLoaded(const ContactInfo& contact) override {
+    return getNumContacts() < MAX_CONTACTS && addContact(contact);
+  }
+  bool onContactJournalUpdate(const ContactInfo& contact) override {
+    ContactInfo* existing = lookupContactByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+    if (existing) {
+      *existing = contact;
+      existing->shared_secret_valid = false;
+      return true;
+    }
+    return onContactLoaded(contact);
+  }
+  void onContactJournalDelete(const uint8_t* key_prefix, int prefix_len) override {
+    ContactInfo* existing = lookupContactByPubKey(key_prefix, prefix_len);
+    if (existing) removeContact(*existing);
+  }
+  bool getContactForSave(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
+  bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return false; }
+  bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return false; }
+
+protected:
+  bool pageOutContact(const ContactInfo& contact) override { return _store->pageOutContact(contact); }
+  bool loadPagedContact(const uint8_t* pub_key, int prefix_len, ContactInfo& dest) override {
+    return _store->pageInContact(pub_key, prefix_len, dest);
+  }
+  int searchPagedContactsByHash(const uint8_t* hash, uint8_t pub_keys[][PUB_KEY_SIZE], int max_matches) override {
+    return _store->searchPagedContactsByHash(hash, pub_keys, max_matches);
+  }
+  bool getNextPagedContact(int& cursor, ContactInfo& dest) const override {
+    return _store->getNextPagedContact(cursor, dest);
+  }
+
+  void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) override { }
+  ContactInfo* processAck(const uint8_t *data) override { return NULL; }
+  void onContactPathUpdated(const ContactInfo& contact) override { }
+  void onMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override {
+    num_msgs++;
+    StrHelper::strncpy(last_from, contact.name, sizeof(last_from));
+    StrHelper::strncpy(last_text, text, sizeof(last_text));
+  }
+  void onCommandDataRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onSignedMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const uint8_t *sender_prefix, const char *text) override { }
+  uint32_t calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const override { return 1000; }
+  uint32_t calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const override { return 1000; }
+  void onSendTimeout() override { }
+  void onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) override { }
+  uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) override { return 0; }
+  void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) override { }
+};
+
+/** \brief  one node: a mesh, and everything it runs on */
+struct Node {
+  FakeRadio radio;
+  ArduinoMillis ms;
+  StdRNG rng;
+  VolatileRTCClock rtc;
+  StaticPoolPacketManager mgr;
+  SimpleMeshTables tables;
+  DataStore store;
+  TestChatMesh mesh;
+
+  Node(fs::FS& fs) : mgr(16), store(fs, rtc), mesh(radio, ms, rng, rtc, mgr, tables, store) {
+    store.begin();
+    mesh.self_id = mesh::LocalIdentity(&rng);
+    mesh.begin();
+  }
+};
+
+static StdRNG id_rng;
+static mesh::LocalIdentity ids[NUM_TEST_CONTACTS];
+
+static ContactInfo makeContact(int i) {
+  ContactInfo c;
+  memset(&c, 0, sizeof(c));
+  c.id = ids[i];
+  sprintf(c.name, "contact-%d", i);
+  c.type = ADV_TYPE_CHAT;
+  c.out_path_len = OUT_PATH_UNKNOWN;
+  c.lastmod = 1000 + i;
+  return c;
+}
+
+/* every contact the store knows about, resident or paged out, must be there exactly once */
+static void assertAllStored(Node& node) {
+  int seen[NUM_TEST_CONTACTS] = { 0 };
+  ContactInfo c;
+  for (int i = 0; node.mesh.getContactByIdx(i, c); i++) {
+    int n = atoi(&c.name[8]);
+    TEST_ASSERT_TRUE(c.id.matches(ids[n]));
+    seen[n]++;
+  }
+  int cursor = 0;
+  while (node.store.getNextPagedContact(cursor, c)) {
+    int n = atoi(&c.name[8]);
+    TEST_ASSERT_TRUE(c.id.matches(ids[n]));
+    seen[n]++;
+  }
+  for (int i = 0; i < NUM_TEST_CONTACTS; i++) TEST_ASSERT_EQUAL(1, seen[i]);
+}
+
+/* a filesystem holding NUM_TEST_CONTACTS contacts, added to a running mesh which pages out the extra ones */
+static void populate(fs::FS& fs) {
+  Node node(fs);
+  node.store.loadContacts(&node.mesh);   // empty
+  for (int i = 0; i < NUM_TEST_CONTACTS; i++) {
+    TEST_ASSERT_TRUE(node.mesh.addContact(makeContact(i)));
+  }
+  TEST_ASSERT_EQUAL(MAX_CONTACTS, node.mesh.getNumContacts());
+  TEST_ASSERT_EQUAL(NUM_TEST_CONTACTS - MAX_CONTACTS, node.store.getNumPagedContacts());
+  node.store.saveContacts(&node.mesh);
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_reload_keeps_extra_contacts_paged(void) {
+  fs::FS fs;
+  populate(fs);
+
+  Node node(fs);
+  node.store.loadContacts(&node.mesh);
+  TEST_ASSERT_EQUAL(MAX_CONTACTS, node.mesh.getNumContacts());
+  TEST_ASSERT_EQUAL(NUM_TEST_CONTACTS - MAX_CONTACTS, node.store.getNumPagedContacts());
+  assertAllStored(node);
+}
+
+void test_page_in_and_out(void) {
+  fs::FS fs;
+  populate(fs);
+
+  Node node(fs);
+  node.store.loadContacts(&node.mesh);
+
+  // page each paged out contact in, in turn, which pages another out each time
+  std::vector<int> paged;
+  ContactInfo c;
+  int cursor = 0;
+  while (node.store.getNextPagedContact(cursor, c)) paged.push_back(atoi(&c.name[8]));
+  TEST_ASSERT_EQUAL(NUM_TEST_CONTACTS - MAX_CONTACTS, (int) paged.size());
+
+  for (int n : paged) {
+    ContactInfo* found = node.mesh.lookupContactByPubKey(ids[n].pub_key, PUB_KEY_SIZE);
+    TEST_ASSERT_NOT_NULL(found);
+    TEST_ASSERT_EQUAL_STRING(makeContact(n).name, found->name);
+    TEST_ASSERT_EQUAL(MAX_CONTACTS, node.mesh.getNumContacts());
+    TEST_ASSERT_EQUAL(NUM_TEST_CONTACTS - MAX_CONTACTS, node.store.getNumPagedContacts());
+  }
+  // the ones paged in last are now resident
+  for (int k = paged.size() - MAX_CONTACTS; k < (int) paged.size(); k++) {
+    bool resident = false;
+    for (int i = 0; node.mesh.getContactByIdx(i, c); i++) {
+      if (c.id.matches(ids[paged[k]])) resident = true;
+    }
+    TEST_ASSERT_TRUE(resident);
+  }
+  assertAllStored(node);
+
+  // and nothing is lost across a save and reload
+  node.store.saveContacts(&node.mesh);
+  Node again(fs);
+  again.store.loadContacts(&again.mesh);
+  TEST_ASSERT_EQUAL(MAX_CONTACTS, again.mesh.getNumContacts());
+  assertAllStored(again);
+}
+
+void test_message_from_paged_contact(void) {
+  fs::FS fs, sender_fs;
+  populate(fs);
+
+  Node node(fs);
+  node.store.loadContacts(&node.mesh);
+  ContactInfo c;
+  int cursor = 0;
+  TEST_ASSERT_TRUE(node.store.getNextPagedContact(cursor, c));
+  int n = atoi(&c.name[8]);
+
+  // a paged out contact is found by its hash, but isn't paged in just for that
+  int num_paged = node.store.getNumPagedContacts();
+  uint8_t hash[PATH_HASH_SIZE];
+  ids[n].copyHashTo(hash);
+  TEST_ASSERT_TRUE(node.mesh.searchPeers(hash) >= 1);
+  TEST_ASSERT_EQUAL(num_paged, node.store.getNumPagedContacts());
+
+  // contact 'n' sends a message, which the node decrypts with the paged out contact's key
+  Node sender(sender_fs);
+  sender.mesh.self_id = ids[n];
+  ContactInfo to;
+  memset(&to, 0, sizeof(to));
+  to.id = node.mesh.self_id;
+  strcpy(to.name, "node");
+  to.type = ADV_TYPE_CHAT;
+  to.out_path_len = OUT_PATH_UNKNOWN;
+  TEST_ASSERT_TRUE(sender.mesh.addContact(to));
+
+  uint32_t expected_ack, est_timeout;
+  TEST_ASSERT_EQUAL(MSG_SEND_SENT_FLOOD, sender.mesh.sendMessage(to, sender.rtc.getCurrentTime(), 0, "hello from flash", expected_ack, est_timeout));
+  for (int i = 0; i < 50 && sender.radio.sent.empty(); i++) {
+    native::advanceMillis(100);
+    sender.mesh.loop();
+  }
+  TEST_ASSERT_EQUAL(1, (int) sender.radio.sent.size());
+
+  node.radio.rx.push_back(sender.radio.sent[0]);
+  for (int i = 0; i < 50 && node.mesh.num_msgs == 0; i++) {
+    native::advanceMillis(100);
+    node.mesh.loop();
+  }
+  TEST_ASSERT_EQUAL(1, node.mesh.num_msgs);
+  TEST_ASSERT_EQUAL_STRING(c.name, node.mesh.last_from);
+  TEST_ASSERT_EQUAL_STRING("hello from flash", node.mesh.last_text);
+
+  // and the sender is now resident, with another contact paged out in its place
+  TEST_ASSERT_EQUAL(num_paged, node.store.getNumPagedContacts());
+  bool resident = false;
+  for (int i = 0; node.mesh.getContactByIdx(i, c); i++) {
+    if (c.id.matches(ids[n])) resident = true;
+  }
+  TEST_ASSERT_TRUE(resident);
+}
+
+int main(int argc, char **argv) {
+  id_rng.begin(1234);
+  for (int i = 0; i < NUM_TEST_CONTACTS; i++) ids[i] = mesh::LocalIdentity(&id_rng);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_reload_keeps_extra_contacts_paged);
+  RUN_TEST(test_page_in_and_out);
+  RUN_TEST(test_message_from_paged_contact);
+  return UNITY_END();
+}
@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include <helpers/BaseSerialInterface.h>
+#include "../../examples/companion_radio/ContactsBulk.h"
+
+/*
+ * Round trip of the RESP_CODE_CONTACTS_BULK compact records, and a sync throughput comparison against
+ * one RESP_CODE_CONTACT frame per contact.  Both are sent one frame per transport write slot, so sync time
+ * is modelled as frames x slot time.
+ */
+
+#define NUM_CONTACTS          300
+#define CONTACT_FRAME_SIZE    148      // RESP_CODE_CONTACT
+#define BLE_SLOT_MILLIS       15       // one notification per connection interval
+
+static const char* names[] = { "Bob", "alice-base", "Repeater North Ridge", "KD9XYZ mobile", "Rm: Club",
+                               "Sensor 7", "marek", "Harbour Rptr", "🚲 Tom", "Station 12 (solar)" };
+
+static void makeContacts(std::vector<ContactInfo>& list) {
+  uint32_t seed = 12345;
+  auto rnd = [&seed]() { seed = seed * 1103515245u + 12345u; return seed >> 8; };
+
+  for (int n = 0; n < NUM_CONTACTS; n++) {
+    ContactInfo c;
+    memset(&c, 0, sizeof(c));
+    for (int i = 0; i < PUB_KEY_SIZE; i++) c.id.pub_key[i] = rnd();
+    snprintf(c.name, sizeof(c.name), "%s %d", names[rnd() % 10], n);
+    c.type = 1 + rnd() % 4;
+    c.flags = (rnd() % 10) == 0 ? 1 : 0;
+    if (rnd() % 10 < 6) {
+      c.out_path_len = OUT_PATH_UNKNOWN;    // most are only heard via flood
+    } else {
+      c.out_path_len = rnd() % 5;   // 0..4 hops, 1 byte hashes
+      for (int i = 0; i < c.out_path_len; i++) c.out_path[i] = rnd();
+    }
+    if (rnd() % 10 < 3) {
+      c.gps_lat = -33000000 - (int32_t)(rnd() % 1000000);
+      c.gps_lon = 151000000 + (int32_t)(rnd() % 1000000);
+    }
+    c.last_advert_timestamp = 1760000000 + rnd() % 2000000;
+    c.lastmod = 1760000000 + rnd() % (30*24*3600);   // over the last month, in no particular order
+    list.push_back(c);
+  }
+}
+
+/* packs records the way MyMesh::writeContactsBulkFrame() does */
+static void encodeFrames(const std::vector<ContactInfo>& list, bool omit_paths, std::vector<std::vector<uint8_t>>& frames) {
+  uint8_t frame[MAX_FRAME_SIZE], rec[BULK_REC_MAX_SIZE];
+  size_t next = 0;
+  while (next < list.size()) {
+    int i = 0, n = 0;
+    frame[i++] = 27;   // RESP_CODE_CONTACTS_BULK
+    frame[i++] = 0;
+    uint32_t prev_lastmod = 0;
+    while (next < list.size() && n < 255) {
+      int len = ContactsBulkCodec::writeRecord(rec, list[next], prev_lastmod, omit_paths);
+      if (i + len > MAX_FRAME_SIZE) break;
+      memcpy(&frame[i], rec, len);
+      i += len;
+      prev_lastmod = list[next++].lastmod;
+      n++;
+    }
+    frame[1] = n;
+    frames.push_back(std::vector<uint8_t>(frame, frame + i));
+  }
+}
+
+/* host side decoder */
+static bool decodeFrame(const std::vector<uint8_t>& frame, std::vector<ContactInfo>& list) {
+  if (frame.size() < 2 || frame[0] != 27) return false;
+  int i = 2;
+  uint32_t lastmod = 0;
+  for (int n = 0; n < frame[1]; n++) {
+    ContactInfo c;
+    int len = ContactsBulkCodec::readRecord(&frame[i], frame.size() - i, c, lastmod);
+    if (len == 0) return false;
+    i += len;
+    lastmod = c.lastmod;
+    list.push_back(c);
+  }
+  return i == (int) frame.size();
+}
+
+static void assertSameContact(const ContactInfo& a, const ContactInfo& b, bool with_path) {
+  TEST_ASSERT_EQUAL_MEMORY(a.id.pub_key, b.id.pub_key, PUB_KEY_SIZE);
+  TEST_ASSERT_EQUAL_STRING(a.name, b.name);
+  TEST_ASSERT_EQUAL(a.type, b.type);
+  TEST_ASSERT_EQUAL(a.flags, b.flags);
+  TEST_ASSERT_EQUAL(a.out_path_len, b.out_path_len);
+  if (with_path && a.out_path_len != OUT_PATH_UNKNOWN) TEST_ASSERT_EQUAL_MEMORY(a.out_path, b.out_path, a.out_path_len);
+  TEST_ASSERT_EQUAL(a.last_advert_timestamp, b.last_advert_timestamp);
+  TEST_ASSERT_EQUAL(a.gps_lat, b.gps_lat);
+  TEST_ASSERT_EQUAL(a.gps_lon, b.gps_lon);
+  TEST_ASSERT_EQUAL(a.lastmod, b.lastmod);
+}
+
+void setUp(void) { }
+void tearDown(void) { }
+
+void test_round_trip(void) {
+  std::vector<ContactInfo> contacts;
+  makeContacts(contacts);
+
+  for (int omit = 0; omit <= 1; omit++) {
+    std::vector<std::vector<uint8_t>> frames;
+    encodeFrames(contacts, omit, frames);
+
+    std::vector<ContactInfo> decoded;
+    for (auto& f : frames) {
+      TEST_ASSERT_LESS_OR_EQUAL(MAX_FRAME_SIZE, f.size());
+      TEST_ASSERT_TRUE(decodeFrame(f, decoded));
+    }
+    TEST_ASSERT_EQUAL(contacts.size(), decoded.size());
+    for (size_t i = 0; i < contacts.size(); i++) assertSameContact(contacts[i], decoded[i], !omit);
+  }
+}
+
+void test_truncated_record_rejected(void) {
+  std::vector<ContactInfo> contacts;
+  makeContacts(contacts);
+  uint8_t rec[BULK_REC_MAX_SIZE];
+  int len = ContactsBulkCodec::writeRecord(rec, contacts[0], 0, false);
+
+  ContactInfo c;
+  TEST_ASSERT_EQUAL(len, ContactsBulkCodec::readRecord(rec, len, c, 0));
+  for (int n = 0; n < len; n++) TEST_ASSERT_EQUAL(0, ContactsBulkCodec::readRecord(rec, n, c, 0));
+}
+
+void test_throughput_vs_per_contact_frames(void) {
+  std::vector<ContactInfo> contacts;
+  makeContacts(contacts);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::vector<uint8_t>> frames;
+  encodeFrames(contacts, false, frames);
+  double encode_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  std::vector<ContactInfo> decoded;
+  for (auto& f : frames) decodeFrame(f, decoded);
+  double decode_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+  size_t bulk_bytes = 0;
+  for (auto& f : frames) bulk_bytes += f.size();
+
+  char msg[200];
+  snprintf(msg, sizeof(msg), "per-contact: %d frames, %d bytes, ~%.1f s at %d ms/frame",
+           NUM_CONTACTS, NUM_CONTACTS * CONTACT_FRAME_SIZE, NUM_CONTACTS * BLE_SLOT_MILLIS / 1000.0, BLE_SLOT_MILLIS);
+  TEST_MESSAGE(msg);
+  snprintf(msg, sizeof(msg), "bulk:        %d frames, %d bytes, ~%.1f s at %d ms/frame (%.1f contacts/frame)",
+           (int) frames.size(), (int) bulk_bytes, frames.size() * BLE_SLOT_MILLIS / 1000.0, BLE_SLOT_MILLIS,
+           NUM_CONTACTS / (double) frames.size());
+  TEST_MESSAGE(msg);
+  snprintf(msg, sizeof(msg), "host cpu:    encode %.1f us, decode %.1f us, for %d contacts", encode_us, decode_us, NUM_CONTACTS);
+  TEST_MESSAGE(msg);
+
+  TEST_ASSERT_EQUAL(NUM_CONTACTS, decoded.size());
+  TEST_ASSERT_LESS_THAN(NUM_CONTACTS / 2, frames.size());
+  TEST_ASSERT_LESS_THAN(NUM_CONTACTS * CONTACT_FRAME_SIZE / 2, bulk_bytes);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_truncated_record_rejected);
+  RUN_TEST(test_throughput_vs_per_contact_frames);
+  return UNITY_END();
+}
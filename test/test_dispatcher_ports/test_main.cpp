@@ -0,0 +1,201 @@
+#include <unity.h>
+#include <deque>
+#include <vector>
+#include <Arduino.h>
+#include <Dispatcher.h>
+#include <helpers/StaticPoolPacketManager.h>
+
+/*
+ * Dispatcher with two radio ports: packets cross between ports, each port keeps to its own airtime budget,
+ * a port with nothing queued for it stays out of LBT, and a PacketManager that doesn't track ports still
+ * drives port 0.
+ */
+
+#define POOL_SIZE   16
+
+/** \brief  a radio whose sends take 'send_millis', and which counts its LBT checks */
+class FakeRadio : public mesh::Radio {
+public:
+  std::deque<std::vector<uint8_t>> rx;
+  std::vector<std::vector<uint8_t>> sent;
+  uint32_t send_millis = 0;
+  unsigned long send_start = 0;
+  bool busy = false;   // channel activity, for LBT
+  int lbt_checks = 0;
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    if (rx.empty()) return 0;
+    int len = rx.front().size();
+    memcpy(bytes, rx.front().data(), len);
+    rx.pop_front();
+    return len;
+  }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return 1; }
+  float packetScore(float snr, int packet_len) override { return 1; }
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    sent.emplace_back(bytes, bytes + len);
+    send_start = millis();
+    return true;
+  }
+  bool isSendComplete() override { return millis() - send_start >= send_millis; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+  bool isReceiving() override {
+    lbt_checks++;
+    return busy;
+  }
+};
+
+class StubClock : public mesh::MillisecondClock {
+public:
+  unsigned long getMillis() override { return millis(); }
+};
+
+/** \brief  forwards to a StaticPoolPacketManager, but only the required methods, so doesn't know about ports */
+class PortlessManager : public mesh::PacketManager {
+  StaticPoolPacketManager _mgr;
+
+public:
+  PortlessManager(int pool_size) : _mgr(pool_size) { }
+
+  mesh::Packet* allocNew() override { return _mgr.allocNew(); }
+  void free(mesh::Packet* packet) override { _mgr.free(packet); }
+  void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override { _mgr.queueOutbound(packet, priority, scheduled_for); }
+  mesh::Packet* getNextOutbound(uint32_t now) override { return _mgr.getNextOutbound(now); }
+  int getOutboundCount(uint32_t now) const override { return _mgr.getOutboundCount(now); }
+  int getFreeCount() const override { return _mgr.getFreeCount(); }
+  mesh::Packet* getOutboundByIdx(int i) override { return _mgr.getOutboundByIdx(i); }
+  mesh::Packet* removeOutboundByIdx(int i) override { return _mgr.removeOutboundByIdx(i); }
+  void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override { _mgr.queueInbound(packet, scheduled_for); }
+  mesh::Packet* getNextInbound(uint32_t now) override { return _mgr.getNextInbound(now); }
+};
+
+/* relays floods, on the ports 'port_mask' picks, each port with its own budget */
+class TestDispatcher : public mesh::Dispatcher {
+public:
+  uint8_t port_mask = 0xFF;
+  float budget[MAX_RADIO_PORTS] = { 0 };
+
+  TestDispatcher(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::PacketManager& mgr)
+      : mesh::Dispatcher(radio, ms, mgr) { }
+
+  float getPortAirtimeBudgetFactor(int port) const override { return budget[port]; }
+
+protected:
+  uint8_t getOutboundPorts(const mesh::Packet* packet) const override { return port_mask; }
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override {
+    return pkt->isRouteFlood() ? ACTION_RETRANSMIT(1) : ACTION_RELEASE;
+  }
+};
+
+static StubClock ms_clock;
+
+static mesh::Packet* makePacket(mesh::Dispatcher& dispatcher, int id) {
+  mesh::Packet* pkt = dispatcher.obtainNewPacket();
+  pkt->header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  pkt->payload_len = 20;
+  for (int k = 0; k < pkt->payload_len; k++) pkt->payload[k] = id * 13 + k;
+  return pkt;
+}
+
+static void runLoops(mesh::Dispatcher& dispatcher, int n, uint32_t step_millis) {
+  for (int i = 0; i < n; i++) {
+    native::advanceMillis(step_millis);
+    dispatcher.loop();
+  }
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_relay_across_ports(void) {
+  StaticPoolPacketManager mgr(POOL_SIZE);
+  FakeRadio lora, other;
+  TestDispatcher dispatcher(lora, ms_clock, mgr);
+  TEST_ASSERT_EQUAL(1, dispatcher.addRadio(other));
+  dispatcher.begin();
+
+  // a flood heard on port 1 goes out on both ports
+  mesh::Packet* pkt = makePacket(dispatcher, 1);
+  uint8_t raw[MAX_TRANS_UNIT];
+  int len = pkt->writeTo(raw);
+  dispatcher.releasePacket(pkt);
+  other.rx.emplace_back(raw, raw + len);
+  runLoops(dispatcher, 10, 1);
+
+  TEST_ASSERT_EQUAL(1, (int) lora.sent.size());
+  TEST_ASSERT_EQUAL(1, (int) other.sent.size());
+  TEST_ASSERT_EQUAL_MEMORY(raw, lora.sent[0].data(), len);
+  TEST_ASSERT_EQUAL_MEMORY(raw, other.sent[0].data(), len);
+  TEST_ASSERT_EQUAL(POOL_SIZE, mgr.getFreeCount());   // each port's copy returned to the pool
+}
+
+void test_ports_keep_own_budget(void) {
+  StaticPoolPacketManager mgr(POOL_SIZE);
+  FakeRadio lora, other;
+  lora.send_millis = other.send_millis = 5;
+  TestDispatcher dispatcher(lora, ms_clock, mgr);
+  dispatcher.addRadio(other);
+  dispatcher.budget[0] = 100;   // silent for half a second after each send
+  dispatcher.begin();
+
+  for (int i = 0; i < 3; i++) dispatcher.sendPacket(makePacket(dispatcher, i), 1);
+  runLoops(dispatcher, 20, 5);
+
+  TEST_ASSERT_EQUAL(1, (int) lora.sent.size());
+  TEST_ASSERT_EQUAL(3, (int) other.sent.size());
+
+  runLoops(dispatcher, 300, 5);
+  TEST_ASSERT_EQUAL(3, (int) lora.sent.size());
+  TEST_ASSERT_EQUAL(POOL_SIZE, mgr.getFreeCount());
+}
+
+void test_idle_port_skips_lbt(void) {
+  StaticPoolPacketManager mgr(POOL_SIZE);
+  FakeRadio lora, other;
+  TestDispatcher dispatcher(lora, ms_clock, mgr);
+  dispatcher.addRadio(other);
+  dispatcher.port_mask = 1;   // port 0 only
+  dispatcher.begin();
+
+  // port 0's packet waits on a busy channel (short of the CAD fail max), and port 1 has nothing queued for it
+  lora.busy = true;
+  dispatcher.sendPacket(makePacket(dispatcher, 1), 1);
+  runLoops(dispatcher, 10, 250);
+  TEST_ASSERT_TRUE(lora.lbt_checks > 0);
+  TEST_ASSERT_EQUAL(0, (int) lora.sent.size());
+  TEST_ASSERT_EQUAL(0, other.lbt_checks);
+
+  lora.busy = false;
+  runLoops(dispatcher, 5, 250);
+  TEST_ASSERT_EQUAL(1, (int) lora.sent.size());
+  TEST_ASSERT_EQUAL(0, (int) other.sent.size());
+  TEST_ASSERT_EQUAL(0, other.lbt_checks);
+}
+
+void test_portless_manager_serves_port_0(void) {
+  PortlessManager mgr(POOL_SIZE);
+  FakeRadio lora, other;
+  TestDispatcher dispatcher(lora, ms_clock, mgr);
+  dispatcher.addRadio(other);
+  dispatcher.port_mask = 1;
+  dispatcher.begin();
+
+  for (int i = 0; i < 3; i++) dispatcher.sendPacket(makePacket(dispatcher, i), 1);
+  runLoops(dispatcher, 10, 1);
+
+  TEST_ASSERT_EQUAL(3, (int) lora.sent.size());
+  TEST_ASSERT_EQUAL(0, (int) other.sent.size());
+  TEST_ASSERT_EQUAL(0, other.lbt_checks);
+  TEST_ASSERT_EQUAL(POOL_SIZE, mgr.getFreeCount());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_relay_across_ports);
+  RUN_TEST(test_ports_keep_own_budget);
+  RUN_TEST(test_idle_port_skips_lbt);
+  RUN_TEST(test_portless_manager_serves_port_0);
+  return UNITY_END();
+}
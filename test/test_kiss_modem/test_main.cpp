@@ -0,0 +1,399 @@
+#include <unity.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <unistd.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <KissModem.h>
+#include <KissBench.h>
+
+/*
+ * Loopback fake modem: the real KissModem, on a simulated radio, served from a thread that stands in for the
+ * firmware's loop().  Its serial port is a pty, so the host client library (tools/kiss_client) talks to it
+ * exactly as it would to a modem on /dev/ttyUSB0.  Checks the client against the modem, then benchmarks
+ * crypto round-trip latency and pipelined throughput, and transmit throughput of Data frames.
+ */
+
+#define BENCH_OPS          300
+#define PIPELINE_DEPTH     4
+#define TX_BENCH_PACKETS   60
+
+/** \brief  the modem's serial port: the master side of a pty */
+class FdStream : public Stream {
+  int _fd;
+  uint8_t _buf[256];
+  int _pos = 0, _len = 0;
+
+  bool fill() {
+    if (_pos < _len) return true;
+    ssize_t n = ::read(_fd, _buf, sizeof(_buf));
+    if (n <= 0) return false;
+    _pos = 0;
+    _len = n;
+    return true;
+  }
+
+public:
+  FdStream(int fd) : _fd(fd) { }
+
+  int available() override { return fill() ? _len - _pos : 0; }
+  int read() override { return fill() ? _buf[_pos++] : -1; }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override {
+    size_t done = 0;
+    while (done < len) {
+      ssize_t n = ::write(_fd, buf + done, len - done);
+      if (n > 0) {
+        done += n;
+      } else {
+        pollfd p = { _fd, POLLOUT, 0 };
+        poll(&p, 1, 10);
+      }
+    }
+    return done;
+  }
+};
+
+/** \brief  LoRa airtime on a virtual channel: packets sent are recorded, and the test 'hears' packets by injecting them */
+class SimRadio : public mesh::Radio {
+  std::mutex _lock;
+  std::deque<std::vector<uint8_t>> _inbound;
+  unsigned long _tx_end = 0;
+  bool _sending = false;
+
+public:
+  std::vector<std::vector<uint8_t>> sent;
+
+  void inject(const uint8_t* pkt, int len) {
+    std::lock_guard<std::mutex> guard(_lock);
+    _inbound.emplace_back(pkt, pkt + len);
+  }
+  int numSent() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return sent.size();
+  }
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_inbound.empty()) return 0;
+    int len = std::min((int) _inbound.front().size(), sz);
+    memcpy(bytes, _inbound.front().data(), len);
+    _inbound.pop_front();
+    return len;
+  }
+  uint32_t getEstAirtimeFor(int len_bytes) override {
+    return 10 + len_bytes / 8;   // roughly SF7 / BW250
+  }
+  float packetScore(float snr, int packet_len) override { return snr; }
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    std::lock_guard<std::mutex> guard(_lock);
+    sent.emplace_back(bytes, bytes + len);
+    _tx_end = millis() + getEstAirtimeFor(len);
+    _sending = true;
+    return true;
+  }
+  bool isSendComplete() override { return (long)(millis() - _tx_end) >= 0; }
+  void onSendFinished() override { _sending = false; }
+  bool isInRecvMode() const override { return !_sending; }
+  float getLastSNR() const override { return 6.25f; }
+  float getLastRSSI() const override { return -70; }
+};
+
+class SimBoard : public mesh::MainBoard {
+public:
+  uint16_t getBattMilliVolts() override { return 4100; }
+  const char* getManufacturerName() const override { return "Loopback"; }
+  void reboot() override { }
+  uint8_t getStartupReason() const override { return 0; }
+};
+
+class TestRNG : public mesh::RNG {
+public:
+  void random(uint8_t* dest, size_t sz) override {
+    for (size_t i = 0; i < sz; i++) dest[i] = rand();
+  }
+};
+
+static TestRNG rng;
+static SimRadio radio;
+static SimBoard board;
+static SensorManager sensors;
+static mesh::LocalIdentity* identity;
+static FdStream* serial;
+static KissModem* modem;
+static KissClient client;
+
+static std::atomic<bool> modem_running;
+static std::thread modem_thread;
+
+static void modemLoop() {
+  while (modem_running) {   // as examples/kiss_modem/main.cpp
+    modem->loop();
+    if (!modem->isActuallyTransmitting()) {
+      uint8_t rx_buf[256];
+      int rx_len = radio.recvRaw(rx_buf, sizeof(rx_buf));
+      if (rx_len > 0) {
+        modem->onPacketReceived((int8_t)(radio.getLastSNR() * 4), (int8_t)radio.getLastRSSI(), rx_buf, rx_len);
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+}
+
+struct Unsolicited {
+  int tx_done = 0, rx_meta = 0, data = 0;
+  std::vector<uint8_t> last_data;
+};
+
+static void onFrame(void* ctx, uint8_t type, const uint8_t* data, int len) {
+  Unsolicited* u = (Unsolicited *) ctx;
+  if (type == KISS_CMD_DATA) {
+    u->data++;
+    u->last_data.assign(data, data + len);
+  } else if (type == KISS_CMD_SETHARDWARE && data[0] == HW_RESP_TX_DONE) {
+    u->tx_done++;
+  } else if (type == KISS_CMD_SETHARDWARE && data[0] == HW_RESP_RX_META) {
+    u->rx_meta++;
+  }
+}
+
+void setUp(void) {
+  client.setFrameHandler(NULL, NULL);
+}
+
+void tearDown(void) { }
+
+void test_identity_and_ping(void) {
+  uint8_t pub_key[PUB_KEY_SIZE];
+  TEST_ASSERT_TRUE(client.getIdentity(pub_key));
+  TEST_ASSERT_EQUAL_MEMORY(identity->pub_key, pub_key, PUB_KEY_SIZE);
+
+  // payloads full of bytes that need escaping, both ways
+  uint8_t data[255], echo[255];
+  for (int i = 0; i < (int) sizeof(data); i++) data[i] = (i & 1) ? KISS_FEND : KISS_FESC;
+  TEST_ASSERT_EQUAL(255, client.ping(data, 255, echo));
+  TEST_ASSERT_EQUAL_MEMORY(data, echo, 255);
+  TEST_ASSERT_EQUAL(0, client.ping(NULL, 0, echo));
+}
+
+void test_crypto_against_host(void) {
+  uint8_t msg[100];
+  for (int i = 0; i < (int) sizeof(msg); i++) msg[i] = i * 3;
+
+  uint8_t sig[SIGNATURE_SIZE];
+  TEST_ASSERT_EQUAL(SIGNATURE_SIZE, client.sign(msg, sizeof(msg), sig));
+  TEST_ASSERT_TRUE(mesh::Identity(identity->pub_key).verify(sig, msg, sizeof(msg)));
+  TEST_ASSERT_EQUAL(1, client.verify(identity->pub_key, sig, msg, sizeof(msg)));
+  sig[0] ^= 1;
+  TEST_ASSERT_EQUAL(0, client.verify(identity->pub_key, sig, msg, sizeof(msg)));
+
+  uint8_t secret[PUB_KEY_SIZE], enc[256], dec[256], host_dec[256];
+  for (int i = 0; i < PUB_KEY_SIZE; i++) secret[i] = 0xC0 + i;
+  int enc_len = client.encrypt(secret, msg, sizeof(msg), enc, sizeof(enc));
+  TEST_ASSERT_EQUAL(CIPHER_MAC_SIZE + 112, enc_len);
+  TEST_ASSERT_EQUAL(112, mesh::Utils::MACThenDecrypt(secret, host_dec, enc, enc_len));
+  TEST_ASSERT_EQUAL_MEMORY(msg, host_dec, sizeof(msg));
+  TEST_ASSERT_EQUAL(112, client.decrypt(secret, enc, enc_len, dec, sizeof(dec)));
+  TEST_ASSERT_EQUAL_MEMORY(msg, dec, sizeof(msg));
+  enc[enc_len - 1] ^= 1;
+  TEST_ASSERT_EQUAL(-HW_ERR_MAC_FAILED, client.decrypt(secret, enc, enc_len, dec, sizeof(dec)));
+
+  uint8_t digest[32], host_digest[32];
+  TEST_ASSERT_EQUAL(32, client.hash(msg, sizeof(msg), digest));
+  mesh::Utils::sha256(host_digest, 32, msg, sizeof(msg));
+  TEST_ASSERT_EQUAL_MEMORY(host_digest, digest, 32);
+
+  TEST_ASSERT_EQUAL(-HW_ERR_INVALID_LENGTH, client.hash(NULL, 0, digest));
+}
+
+void test_batch_sign(void) {
+  uint8_t msgs[3][20];
+  KissBatchItem items[3];
+  for (int i = 0; i < 3; i++) {
+    memset(msgs[i], 'a' + i, sizeof(msgs[i]));
+    items[i] = { msgs[i], (int) sizeof(msgs[i]) };
+  }
+  TEST_ASSERT_EQUAL(3, client.batch(HW_CMD_SIGN_DATA, items, 3));
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL(0, items[i].status);
+    TEST_ASSERT_EQUAL(SIGNATURE_SIZE, items[i].result_len);
+    TEST_ASSERT_TRUE(mesh::Identity(identity->pub_key).verify(items[i].result, msgs[i], sizeof(msgs[i])));
+  }
+}
+
+void test_packets_through_sim_radio(void) {
+  Unsolicited u;
+
+  // no CSMA delays, so sending is paced by simulated airtime only
+  uint8_t zero = 0, always = 255;
+  client.sendFrame(0x01, &zero, 1);     // TXDELAY
+  client.sendFrame(0x02, &always, 1);   // PERSISTENCE
+
+  int before = radio.numSent();
+  uint8_t pkt[40];
+  for (int i = 0; i < 4; i++) {
+    memset(pkt, i, sizeof(pkt));
+    TEST_ASSERT_TRUE(client.sendPacket(pkt, sizeof(pkt)));
+  }
+  uint8_t heard[30];
+  memset(heard, KISS_FEND, sizeof(heard));
+  radio.inject(heard, sizeof(heard));
+
+  uint8_t type, frame[KISS_CLIENT_MAX_FRAME];
+  while (u.tx_done < 4 || u.rx_meta < 1) {
+    int n = client.readFrame(&type, frame, sizeof(frame), 2000);
+    TEST_ASSERT_TRUE_MESSAGE(n >= 0, "no TxDone / received packet from modem");
+    onFrame(&u, type, frame, n);
+  }
+  TEST_ASSERT_EQUAL(before + 4, radio.numSent());
+  TEST_ASSERT_EQUAL(1, u.data);
+  TEST_ASSERT_EQUAL(sizeof(heard), u.last_data.size());
+  TEST_ASSERT_EQUAL_MEMORY(heard, u.last_data.data(), sizeof(heard));
+}
+
+void test_batch_response_bound(void) {
+  // a Sign result is much bigger than its item, so the response, not the request, runs out of frame first
+  const int max_items = (KISS_MAX_FRAME_SIZE - 4) / (3 + SIGNATURE_SIZE);
+  uint8_t msg = 0x55;
+  KissBatchItem items[max_items + 1];
+  for (int i = 0; i <= max_items; i++) items[i] = { &msg, 1 };
+  TEST_ASSERT_EQUAL(-HW_ERR_INVALID_LENGTH, client.batch(HW_CMD_SIGN_DATA, items, max_items + 1));
+  TEST_ASSERT_EQUAL(max_items, client.batch(HW_CMD_SIGN_DATA, items, max_items));
+
+  // and the modem is still in step afterwards
+  uint8_t pub_key[PUB_KEY_SIZE];
+  TEST_ASSERT_TRUE(client.getIdentity(pub_key));
+}
+
+/* an advert's signed message: public key, timestamp and app data, of the largest size */
+struct Advert {
+  uint8_t pub_key_sig_msg[PUB_KEY_SIZE + SIGNATURE_SIZE + PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE];
+  uint8_t* sig() { return &pub_key_sig_msg[PUB_KEY_SIZE]; }
+  uint8_t* msg() { return &pub_key_sig_msg[PUB_KEY_SIZE + SIGNATURE_SIZE]; }
+  static const int msg_len = PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE;
+};
+
+static int batchCapacity(int item_len) {
+  return (KISS_MAX_FRAME_SIZE - 1 - 1 - 2) / (2 + item_len);   // type, Batch sub-command, SubCmd + Count
+}
+
+void test_batch_verify_adverts(void) {
+  const int full = batchCapacity(PUB_KEY_SIZE + SIGNATURE_SIZE + Advert::msg_len);
+  const int compact = batchCapacity(SIGNATURE_SIZE + Advert::msg_len);
+  std::vector<Advert> adverts(compact);
+  for (int i = 0; i < compact; i++) {
+    mesh::LocalIdentity signer(&rng);
+    memcpy(adverts[i].pub_key_sig_msg, signer.pub_key, PUB_KEY_SIZE);
+    memcpy(adverts[i].msg(), signer.pub_key, PUB_KEY_SIZE);
+    for (int k = PUB_KEY_SIZE; k < Advert::msg_len; k++) adverts[i].msg()[k] = rand();
+    signer.sign(adverts[i].sig(), adverts[i].msg(), Advert::msg_len);
+  }
+  adverts[1].msg()[40] ^= 1;   // tampered
+
+  std::vector<KissBatchItem> items(compact);
+  for (int i = 0; i < full; i++) items[i] = { adverts[i].pub_key_sig_msg, PUB_KEY_SIZE + SIGNATURE_SIZE + Advert::msg_len };
+  TEST_ASSERT_EQUAL(full, client.batch(HW_CMD_VERIFY_SIGNATURE, items.data(), full));
+  for (int i = 0; i < full; i++) TEST_ASSERT_EQUAL(i == 1 ? 0 : 1, items[i].result[0]);
+
+  for (int i = 0; i < compact; i++) items[i] = { adverts[i].sig(), SIGNATURE_SIZE + Advert::msg_len };
+  TEST_ASSERT_EQUAL(compact, client.batch(HW_CMD_VERIFY_SIGNATURE | HW_BATCH_SIGNER_IN_MSG, items.data(), compact));
+  for (int i = 0; i < compact; i++) {
+    TEST_ASSERT_EQUAL(0, items[i].status);
+    TEST_ASSERT_EQUAL(i == 1 ? 0 : 1, items[i].result[0]);
+  }
+
+  // and on the frame sizes of the ESP32 and nRF52 builds
+  const int full_len = 2 + PUB_KEY_SIZE + SIGNATURE_SIZE + Advert::msg_len, compact_len = 2 + SIGNATURE_SIZE + Advert::msg_len;
+  char msg[200];
+  snprintf(msg, sizeof(msg), "largest adverts per Verify batch, 512 / 1024 / 2048 byte frames: %d / %d / %d, with signer in message %d / %d / %d",
+           508 / full_len, 1020 / full_len, 2044 / full_len, 508 / compact_len, 1020 / compact_len, 2044 / compact_len);
+  TEST_MESSAGE(msg);
+}
+
+static void report(const char* label, int payload_len, const KissBenchResult& lat, const KissBenchResult& thr) {
+  char msg[200];
+  snprintf(msg, sizeof(msg), "%-7s %3d bytes: latency p50 %6.0f us, p99 %6.0f us; throughput %7.0f ops/s (depth %d)",
+           label, payload_len, lat.p50_us, lat.p99_us, thr.ops_per_sec, PIPELINE_DEPTH);
+  TEST_MESSAGE(msg);
+}
+
+void test_crypto_latency_and_throughput(void) {
+  const uint8_t cmds[] = { HW_CMD_PING, HW_CMD_HASH, HW_CMD_SIGN_DATA, HW_CMD_VERIFY_SIGNATURE,
+                           HW_CMD_ENCRYPT_DATA, HW_CMD_DECRYPT_DATA };
+  const int payload_lens[] = { 32, 200 };
+  for (int payload_len : payload_lens) {
+    KissBench bench(client);
+    TEST_ASSERT_TRUE(bench.begin(payload_len));
+    for (uint8_t cmd : cmds) {
+      KissBenchResult lat = bench.run(cmd, BENCH_OPS, 1);
+      KissBenchResult thr = bench.run(cmd, BENCH_OPS, PIPELINE_DEPTH);
+      report(KissBench::commandName(cmd), payload_len, lat, thr);
+      TEST_ASSERT_EQUAL(BENCH_OPS, lat.ops);
+      TEST_ASSERT_EQUAL(BENCH_OPS, thr.ops);
+      TEST_ASSERT_EQUAL(0, lat.errors + thr.errors);
+      TEST_ASSERT_TRUE(thr.ops_per_sec >= 0.75 * 1e6 / lat.p50_us);   // pipelining doesn't cost throughput
+    }
+  }
+}
+
+void test_tx_throughput(void) {
+  uint8_t zero = 0, always = 255;
+  client.sendFrame(0x01, &zero, 1);     // TXDELAY
+  client.sendFrame(0x02, &always, 1);   // PERSISTENCE
+
+  const int packet_lens[] = { 40, 200 };
+  for (int packet_len : packet_lens) {
+    int before = radio.numSent();
+    KissBench bench(client);
+    KissTxBenchResult tx = bench.runTx(TX_BENCH_PACKETS, packet_len);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Tx      %3d bytes: %5.1f packets/s, %6.0f bytes/s, %3.0f%% of the time on air (%d packets)",
+             packet_len, tx.packets_per_sec, tx.bytes_per_sec, tx.airtime_share * 100, TX_BENCH_PACKETS);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(TX_BENCH_PACKETS, tx.packets);
+    TEST_ASSERT_EQUAL(0, tx.errors);
+    TEST_ASSERT_EQUAL(before + TX_BENCH_PACKETS, radio.numSent());
+    TEST_ASSERT_TRUE(tx.airtime_share > 0.5);   // queue kept full, so the radio is rarely idle
+  }
+}
+
+int main(int argc, char **argv) {
+  int master, slave;
+  char slave_path[64];
+  if (openpty(&master, &slave, slave_path, NULL, NULL) != 0) return 1;
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  termios tio;
+  tcgetattr(master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(master, TCSANOW, &tio);
+
+  identity = new mesh::LocalIdentity(&rng);
+  serial = new FdStream(master);
+  modem = new KissModem(*serial, *identity, rng, radio, board, sensors);
+  modem->begin();
+  modem_running = true;
+  modem_thread = std::thread(modemLoop);
+
+  if (!client.open(slave_path)) return 1;
+  close(slave);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_identity_and_ping);
+  RUN_TEST(test_crypto_against_host);
+  RUN_TEST(test_batch_sign);
+  RUN_TEST(test_batch_response_bound);
+  RUN_TEST(test_batch_verify_adverts);
+  RUN_TEST(test_packets_through_sim_radio);
+  RUN_TEST(test_crypto_latency_and_throughput);
+  RUN_TEST(test_tx_throughput);
+  int result = UNITY_END();
+
+  modem_running = false;
+  modem_thread.join();
+  return result;
+}
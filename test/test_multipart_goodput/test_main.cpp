@@ -0,0 +1,228 @@
+#include <unity.h>
+#include <math.h>
+#include <helpers/MultipartReply.h>
+#include <helpers/StaticPoolPacketManager.h>
+
+/*
+ * Goodput simulator: a large REQ/RESPONSE reply (eg. an ACL or neighbours dump) fetched as one multipart transfer,
+ * with selective-repeat ACKs, versus fetched page by page as single-packet replies, each page retried after the
+ * requester's timeout, over one direct hop that loses packets at random.  Both ends of the multipart transfer
+ * are the real MultipartTransfers; the radio is LoRa airtime arithmetic on a virtual clock.
+ */
+
+#define REPLY_SIZE          1000
+#define SINGLE_PAGE_SIZE     130    // results per page in a single-packet neighbours reply
+#define SERVER_RESPONSE_DELAY  300  // as simple_repeater
+#define NUM_TRIALS           200
+#define MAX_SIM_MILLIS    600000    // give up on a transfer after this
+
+// companion_radio's direct timeout, for zero hops
+#define SEND_TIMEOUT_BASE_MILLIS        500
+#define DIRECT_SEND_PERHOP_FACTOR       6
+#define DIRECT_SEND_PERHOP_EXTRA_MILLIS 250
+
+struct SimClock : public mesh::MillisecondClock {
+  unsigned long t = 1;
+  unsigned long getMillis() override { return t; }
+};
+
+/* LoRa time on air, SF10 / BW250 / CR4-5, 16 symbol preamble, explicit header and CRC */
+static unsigned long airtime(int payload_len) {
+  // raw packet: header, path len, then datagram: dest/src hashes, MAC, ciphertext
+  int raw_len = 2 + 2 + CIPHER_MAC_SIZE + ((payload_len + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+  const double sf = 10, t_sym = 1024.0 / 250.0;
+  double n = 8 + fmax(ceil((8.0*raw_len - 4*sf + 28 + 16) / (4*sf)) * 5, 0);
+  return (unsigned long) ((16 + 4.25 + n) * t_sym);
+}
+
+static unsigned long directTimeout(unsigned long pkt_airtime) {
+  return SEND_TIMEOUT_BASE_MILLIS + pkt_airtime * DIRECT_SEND_PERHOP_FACTOR + DIRECT_SEND_PERHOP_EXTRA_MILLIS;
+}
+
+struct LossyLink {
+  uint32_t rng;
+  float loss;
+  int sent = 0;
+
+  LossyLink(float l, uint32_t seed) : loss(l), rng(seed) { }
+  bool deliver() {
+    sent++;
+    rng = rng * 1664525 + 1013904223;
+    return (rng >> 8) * (1.0f / (1 << 24)) >= loss;
+  }
+};
+
+struct Result {
+  unsigned long millis;
+  int packets;
+  bool ok;
+};
+
+static uint8_t reply_data[REPLY_SIZE];
+static const uint8_t requester_key[PUB_KEY_SIZE] = { 0x11, 0x22, 0x33, 0x44 };
+
+/*
+ * Multipart: one request, then fragments.  'flood' means the request was sent flood, so only fragment 0 comes
+ * back (with the path), and the rest wait for the requester's first ACK.
+ */
+static Result fetchMultipart(LossyLink& link, bool flood, bool ack_on_path) {
+  SimClock clock;
+  StaticPoolPacketManager responder_pool(32), requester_pool(32);
+  MultipartTransfers responder, requester;
+  responder.begin(&responder_pool, &clock);
+  requester.begin(&requester_pool, &clock);
+
+  const uint32_t tag = 0x5A5A0001;
+  const unsigned long req_air = airtime(4 + 1 + 4), ack_air = airtime(4 + 1 + 6);
+  const unsigned long frag_air = airtime(MULTIPART_HDR_SIZE + MULTIPART_CHUNK_SIZE);
+
+  MultipartSession* in = requester.expectInbound(tag, requester_key);
+  MultipartSession* out = NULL;
+  uint16_t to_send = 0;
+  bool requested = false;
+
+  while (clock.t < MAX_SIM_MILLIS) {
+    if (!requested) {   // (re)send the request
+      unsigned long sent_at = clock.t;
+      clock.t += req_air;
+      if (!link.deliver()) {
+        clock.t = sent_at + directTimeout(req_air);
+        continue;
+      }
+      requested = true;
+      out = responder.startOutbound(tag, requester_key, reply_data, REPLY_SIZE);
+      if (out == NULL) return { clock.t, link.sent, false };
+      to_send = flood ? 1 : out->fullMask();
+    }
+
+    // responder sends what's pending, requester takes what arrives
+    bool got_any = false, got_path = false;
+    clock.t += SERVER_RESPONSE_DELAY;
+    for (int i = 0; i < out->count; i++) {
+      if ((to_send & (1 << i)) == 0) continue;
+      uint8_t frag[MAX_PACKET_PAYLOAD];
+      int len = responder.writeFragment(out, i, frag);
+      clock.t += frag_air;
+      if (link.deliver()) {
+        got_any = true;
+        if (flood && i == 0) got_path = true;
+        if (requester.recvFragment(in, frag, len) > 0) {
+          clock.t += ack_air;   // final ACK, so responder frees its buffers (not waited for)
+          link.deliver();
+          return { clock.t, link.sent, true };
+        }
+      }
+    }
+    to_send = 0;
+
+    if (in->mask == 0 && !got_any) {   // nothing at all, so requester times out and asks again
+      clock.t += directTimeout(req_air);
+      requested = false;
+      continue;
+    }
+
+    // requester sends a selective ACK, straight away if fragment 0 came with the path, else when fragments stop
+    if (!(got_path && ack_on_path)) {
+      MultipartSession* due;
+      while ((due = requester.getNextAckDue()) == NULL && in->ack_due != 0) clock.t += 100;
+      if (due == NULL) {   // out of ACK retries, so requester gives up and asks again
+        requester.release(in);
+        in = requester.expectInbound(tag, requester_key);
+        requested = false;
+        continue;
+      }
+    }
+    clock.t += ack_air;
+    if (link.deliver()) to_send = responder.applyAck(out, in->mask);
+  }
+  return { clock.t, link.sent, false };
+}
+
+/* Single-packet: one request per page, retried after the requester's timeout if the request or reply is lost */
+static Result fetchPaged(LossyLink& link) {
+  SimClock clock;
+  const unsigned long req_air = airtime(4 + 1 + 4 + 2), reply_air = airtime(4 + 4 + SINGLE_PAGE_SIZE);
+
+  for (int offset = 0; offset < REPLY_SIZE && clock.t < MAX_SIM_MILLIS; ) {
+    unsigned long sent_at = clock.t;
+    clock.t += req_air;
+    if (link.deliver()) {
+      clock.t += SERVER_RESPONSE_DELAY + reply_air;
+      if (link.deliver()) {
+        offset += SINGLE_PAGE_SIZE;
+        continue;
+      }
+    }
+    clock.t = sent_at + directTimeout(req_air);
+  }
+  return { clock.t, link.sent, clock.t < MAX_SIM_MILLIS };
+}
+
+struct Stats {
+  double goodput;   // bytes/sec, over all trials
+  double packets;   // mean per transfer
+  int failed;
+};
+
+template <typename F>
+static Stats runTrials(float loss, F fetch) {
+  unsigned long total_millis = 0;
+  long total_packets = 0;
+  int ok = 0, failed = 0;
+  for (int n = 0; n < NUM_TRIALS; n++) {
+    LossyLink link(loss, 12345 + n);
+    Result r = fetch(link);
+    if (!r.ok) { failed++; continue; }
+    total_millis += r.millis;
+    total_packets += r.packets;
+    ok++;
+  }
+  return { ok ? (double) ok * REPLY_SIZE * 1000.0 / total_millis : 0, ok ? (double) total_packets / ok : 0, failed };
+}
+
+static void report(const char* label, float loss, const Stats& s) {
+  char msg[160];
+  snprintf(msg, sizeof(msg), "loss %2.0f%%  %-26s goodput %5.1f bytes/s, %5.1f packets/transfer, %d failed",
+           loss * 100, label, s.goodput, s.packets, s.failed);
+  TEST_MESSAGE(msg);
+}
+
+void setUp(void) {
+  for (int i = 0; i < REPLY_SIZE; i++) reply_data[i] = i * 7;
+}
+
+void tearDown(void) { }
+
+void test_fragmented_vs_single_packet_direct(void) {
+  const float losses[] = { 0.0f, 0.1f, 0.2f, 0.3f };
+  for (float loss : losses) {
+    Stats paged = runTrials(loss, [](LossyLink& l) { return fetchPaged(l); });
+    Stats multi = runTrials(loss, [](LossyLink& l) { return fetchMultipart(l, false, true); });
+    report("single-packet pages", loss, paged);
+    report("multipart, direct", loss, multi);
+
+    TEST_ASSERT_EQUAL(0, multi.failed);
+    TEST_ASSERT_TRUE(multi.packets < paged.packets);   // fewer, fuller packets, and no per-page requests
+    if (loss == 0) TEST_ASSERT_TRUE(multi.goodput > paged.goodput);
+  }
+}
+
+void test_flood_ack_on_path(void) {
+  const float losses[] = { 0.0f, 0.2f };
+  for (float loss : losses) {
+    Stats waited = runTrials(loss, [](LossyLink& l) { return fetchMultipart(l, true, false); });
+    Stats prompt = runTrials(loss, [](LossyLink& l) { return fetchMultipart(l, true, true); });
+    report("multipart, flood, gap ACK", loss, waited);
+    report("multipart, flood, path ACK", loss, prompt);
+
+    TEST_ASSERT_EQUAL(0, prompt.failed);
+    TEST_ASSERT_TRUE(prompt.goodput > waited.goodput);
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fragmented_vs_single_packet_direct);
+  RUN_TEST(test_flood_ack_on_path);
+  return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <helpers/ArduinoHelpers.h>
+#include <OfflineQueue.h>
+
+/*
+ * Companion's OfflineQueue, spooling to the in-memory FS: frames come back in order, a full spool keeps
+ * taking frames as the app drains it without rewriting what's already in flash, the per-class quotas and
+ * drop counters, and a failed write to the spool.
+ */
+
+#define FRAME_LEN     100
+#define REC_LEN       (FRAME_LEN + 2)   // spool record header
+#define CAPACITY      (OFFLINE_QUEUE_SIZE + OFFLINE_SPOOL_MAX_BYTES / REC_LEN)
+
+#if OFFLINE_SPOOL_MAX_BYTES == 0
+  #error "native env needs OFFLINE_SPOOL_MAX_BYTES"
+#endif
+
+static VolatileRTCClock rtc;
+
+static int makeFrame(uint8_t frame[], uint32_t seq, int len, bool is_channel) {
+  memset(frame, 0, len);
+  frame[0] = is_channel ? 0x08 : 0x07;
+  memcpy(&frame[1], &seq, 4);
+  for (int i = 5; i < len; i++) frame[i] = seq + i;
+  return len;
+}
+
+/* the next frame must be 'seq', of 'len' bytes */
+static void assertNext(OfflineQueue& q, uint32_t seq, int len, bool is_channel) {
+  uint8_t expected[MAX_FRAME_SIZE], frame[MAX_FRAME_SIZE];
+  makeFrame(expected, seq, len, is_channel);
+  TEST_ASSERT_EQUAL(len, q.get(frame));
+  TEST_ASSERT_EQUAL_MEMORY(expected, frame, len);
+}
+
+static bool addFrame(OfflineQueue& q, uint32_t seq, int len, bool is_channel) {
+  uint8_t frame[MAX_FRAME_SIZE];
+  return q.add(frame, makeFrame(frame, seq, len, is_channel), is_channel);
+}
+
+static int fill(OfflineQueue& q, uint32_t& seq) {
+  int n = 0;
+  while (addFrame(q, seq, FRAME_LEN, false)) {
+    seq++;
+    n++;
+  }
+  return n;
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_spool_keeps_order(void) {
+  fs::FS fs;
+  DataStore store(fs, rtc);
+  OfflineQueue q;
+  q.begin(&store);
+
+  uint32_t seq = 0;
+  TEST_ASSERT_EQUAL(CAPACITY, fill(q, seq));
+  TEST_ASSERT_EQUAL(CAPACITY, q.count());
+  TEST_ASSERT_EQUAL(CAPACITY - OFFLINE_QUEUE_SIZE, q.getNumSpooled());
+  TEST_ASSERT_EQUAL(1, q.getDroppedDirect());
+  TEST_ASSERT_TRUE(fs.usedBytes() <= OFFLINE_SPOOL_MAX_BYTES);
+
+  for (uint32_t i = 0; i < CAPACITY; i++) assertNext(q, i, FRAME_LEN, false);
+  uint8_t frame[MAX_FRAME_SIZE];
+  TEST_ASSERT_EQUAL(0, q.get(frame));
+  TEST_ASSERT_EQUAL(0, q.count());
+  TEST_ASSERT_EQUAL(0, fs.numFiles());   // spool removed once drained
+
+  // a spool left from before a reboot is discarded
+  fill(q, seq);
+  TEST_ASSERT_TRUE(fs.numFiles() > 0);
+  OfflineQueue after_reboot;
+  after_reboot.begin(&store);
+  TEST_ASSERT_EQUAL(0, fs.numFiles());
+}
+
+void test_full_spool_reclaims_without_rewrite(void) {
+  fs::FS fs;
+  DataStore store(fs, rtc);
+  OfflineQueue q;
+  q.begin(&store);
+
+  uint32_t seq = 0, next = 0;
+  fill(q, seq);
+
+  // app syncs one frame at a time while new ones keep arriving: each is taken, and is the only thing written
+  size_t written = fs.bytesWritten();
+  for (int i = 0; i < 1000; i++) {
+    assertNext(q, next++, FRAME_LEN, false);
+    TEST_ASSERT_TRUE(addFrame(q, seq++, FRAME_LEN, false));
+    TEST_ASSERT_EQUAL(CAPACITY, q.count());
+    TEST_ASSERT_TRUE(fs.usedBytes() <= OFFLINE_SPOOL_MAX_BYTES + OFFLINE_SPOOL_MAX_BYTES / OFFLINE_SPOOL_SEGMENTS);
+  }
+  TEST_ASSERT_EQUAL(1000 * REC_LEN, fs.bytesWritten() - written);
+  TEST_ASSERT_EQUAL(1, q.getDroppedDirect());   // only the one when first filled
+
+  while (next < seq) assertNext(q, next++, FRAME_LEN, false);
+  TEST_ASSERT_EQUAL(0, q.count());
+}
+
+void test_quotas_and_drops(void) {
+  fs::FS fs;
+  DataStore store(fs, rtc);
+  OfflineQueue q;
+  q.begin(&store);
+
+  // channel msgs past their quota evict the oldest channel msg
+  const int extra = 11;
+  for (int i = 0; i < OFFLINE_MAX_CHANNEL_FRAMES + extra; i++) TEST_ASSERT_TRUE(addFrame(q, i, 10, true));
+  TEST_ASSERT_EQUAL(OFFLINE_MAX_CHANNEL_FRAMES, q.getNumChannel());
+  TEST_ASSERT_EQUAL(extra, q.getDroppedChannel());
+
+  // direct frames have their own quota
+  for (int i = 0; i < OFFLINE_MAX_DIRECT_FRAMES; i++) TEST_ASSERT_TRUE(addFrame(q, i, 10, false));
+  TEST_ASSERT_FALSE(addFrame(q, 9999, 10, false));
+  TEST_ASSERT_EQUAL(OFFLINE_MAX_DIRECT_FRAMES, q.getNumDirect());
+  TEST_ASSERT_EQUAL(1, q.getDroppedDirect());
+
+  for (int i = extra; i < OFFLINE_MAX_CHANNEL_FRAMES + extra; i++) assertNext(q, i, 10, true);
+  for (int i = 0; i < OFFLINE_MAX_DIRECT_FRAMES; i++) assertNext(q, i, 10, false);
+  TEST_ASSERT_EQUAL(0, q.count());
+  TEST_ASSERT_EQUAL(0, q.getNumSpooled());
+}
+
+void test_failed_write_is_skipped(void) {
+  fs::FS fs;
+  DataStore store(fs, rtc);
+  OfflineQueue q;
+  q.begin(&store);
+
+  for (uint32_t i = 0; i < OFFLINE_QUEUE_SIZE + 3; i++) TEST_ASSERT_TRUE(addFrame(q, i, FRAME_LEN, false));
+
+  // flash fills up part way through a record
+  fs.setSpaceLeft(REC_LEN / 2);
+  TEST_ASSERT_FALSE(addFrame(q, 1000, FRAME_LEN, false));
+  TEST_ASSERT_EQUAL(1, q.getDroppedDirect());
+
+  // once there's space again, the frames after it are kept, and none are misread
+  fs.setSpaceLeft(SIZE_MAX);
+  for (uint32_t i = OFFLINE_QUEUE_SIZE + 3; i < OFFLINE_QUEUE_SIZE + 8; i++) TEST_ASSERT_TRUE(addFrame(q, i, FRAME_LEN, false));
+  for (uint32_t i = 0; i < OFFLINE_QUEUE_SIZE + 8; i++) assertNext(q, i, FRAME_LEN, false);
+  TEST_ASSERT_EQUAL(0, q.count());
+  TEST_ASSERT_EQUAL(1, q.getDroppedDirect());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_spool_keeps_order);
+  RUN_TEST(test_full_spool_reclaims_without_rewrite);
+  RUN_TEST(test_quotas_and_drops);
+  RUN_TEST(test_failed_write_is_skipped);
+  return UNITY_END();
+}
@@ -0,0 +1,352 @@
+#include <unity.h>
+#include <deque>
+#include <random>
+#include <vector>
+#include <helpers/bridges/RS232Bridge.h>
+#include <helpers/StaticPoolPacketManager.h>
+
+/*
+ * RS232Bridge framing over a scripted UART: the transmit queue against a UART with little room, and the
+ * receiver against a stream with corrupted frames, garbage and false frame starts, read in random size bursts.
+ */
+
+#define NUM_PACKETS   40
+
+/** \brief  a UART whose reads come in bursts of at most 'burst' bytes, and which takes at most 'room' bytes per write */
+class ScriptedSerial : public HardwareSerial {
+public:
+  std::deque<uint8_t> rx;
+  std::vector<uint8_t> tx;
+  int burst = 1 << 30;
+  int room = 1 << 30;
+
+  int available() override { return std::min((int) rx.size(), burst); }
+  int read() override {
+    if (rx.empty()) return -1;
+    int c = rx.front();
+    rx.pop_front();
+    return c;
+  }
+  size_t readBytes(uint8_t* buf, size_t len) override {
+    size_t n = 0;
+    while (n < len && !rx.empty()) buf[n++] = read();
+    return n;
+  }
+  int availableForWrite() override { return room; }
+  size_t write(const uint8_t* buf, size_t len) override {
+    if ((int) len > room) len = room;
+    tx.insert(tx.end(), buf, buf + len);
+    return len;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+};
+
+class StubRadio : public mesh::Radio {
+public:
+  uint32_t airtime = 1;
+
+  int recvRaw(uint8_t* bytes, int sz) override { return 0; }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return airtime; }
+  float packetScore(float snr, int packet_len) override { return 0; }
+  bool startSendRaw(const uint8_t* bytes, int len) override { return true; }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+};
+
+class StubRTC : public mesh::RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1750000000; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+class StubClock : public mesh::MillisecondClock {
+public:
+  unsigned long getMillis() override { return millis(); }
+};
+
+/* the mesh, only for its radios and their airtime budgets */
+class StubDispatcher : public mesh::Dispatcher {
+public:
+  float budget[MAX_RADIO_PORTS] = { 0 };
+
+  StubDispatcher(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::PacketManager& mgr)
+      : mesh::Dispatcher(radio, ms, mgr) { }
+
+  float getPortAirtimeBudgetFactor(int port) const override { return budget[port]; }
+
+protected:
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override { return ACTION_RELEASE; }
+};
+
+static StubClock ms_clock;
+
+/* one bridge and its side of the mesh */
+struct Node {
+  NodePrefs prefs;
+  StaticPoolPacketManager mgr;
+  SimpleMeshTables tables;
+  ScriptedSerial serial;
+  StubDispatcher dispatcher;
+  RS232Bridge bridge;
+
+  Node(mesh::RTCClock* rtc, mesh::Radio* radio) : mgr(64), dispatcher(*radio, ms_clock, mgr),
+      bridge(&prefs, serial, &mgr, rtc, &tables, &dispatcher) {
+    memset(&prefs, 0, sizeof(prefs));
+    bridge.begin();
+  }
+
+  /* packets the bridge has passed to the mesh */
+  std::vector<std::vector<uint8_t>> takeInbound() {
+    std::vector<std::vector<uint8_t>> out;
+    mesh::Packet* pkt;
+    while ((pkt = mgr.getNextInbound(millis() + 100000)) != NULL) {
+      out.emplace_back(pkt->payload, pkt->payload + pkt->payload_len);
+      mgr.free(pkt);
+    }
+    return out;
+  }
+};
+
+static StubRTC rtc;
+static StubRadio radio;
+static std::mt19937 rng;
+
+static uint16_t fletcher16(const uint8_t* data, int len) {
+  uint16_t sum1 = 0, sum2 = 0;
+  for (int i = 0; i < len; i++) {
+    sum1 = (sum1 + data[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  return (sum2 << 8) | sum1;
+}
+
+static mesh::Packet* makePacket(mesh::PacketManager& mgr, int id) {
+  mesh::Packet* pkt = mgr.allocNew();
+  pkt->header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  pkt->path_len = 0;
+  pkt->payload_len = 10 + (id * 37) % 170;
+  for (int k = 0; k < pkt->payload_len; k++) pkt->payload[k] = id * 13 + k;
+  pkt->payload[0] = BridgeBase::BRIDGE_PACKET_MAGIC >> 8;   // a false frame start inside every frame
+  return pkt;
+}
+
+/* sends packets 'first' onwards through 'node', and returns each one's frame as written to the UART */
+static std::vector<std::vector<uint8_t>> sendPackets(Node& node, int first, int count) {
+  std::vector<std::vector<uint8_t>> frames;
+  for (int i = first; i < first + count; i++) {
+    mesh::Packet* pkt = makePacket(node.mgr, i);
+    size_t before = node.serial.tx.size();
+    node.bridge.sendPacket(pkt);
+    for (int n = 0; n < 1000 && node.serial.tx.size() - before < (size_t) pkt->getRawLength() + 6; n++) {
+      node.bridge.loop();
+    }
+    frames.emplace_back(node.serial.tx.begin() + before, node.serial.tx.end());
+    node.mgr.free(pkt);
+  }
+  return frames;
+}
+
+void setUp(void) {
+  rng.seed(1);
+}
+
+void tearDown(void) { }
+
+void test_tx_queue_with_slow_uart(void) {
+  Node sender(&rtc, &radio);
+  sender.serial.room = 7;
+  std::vector<std::vector<uint8_t>> frames = sendPackets(sender, 0, NUM_PACKETS);
+
+  for (int i = 0; i < NUM_PACKETS; i++) {
+    mesh::Packet* pkt = makePacket(sender.mgr, i);
+    uint8_t raw[MAX_TRANS_UNIT + 1];
+    int len = pkt->writeTo(raw);
+    sender.mgr.free(pkt);
+
+    const std::vector<uint8_t>& f = frames[i];
+    TEST_ASSERT_EQUAL(len + 6, (int) f.size());
+    TEST_ASSERT_EQUAL_HEX8(0xC0, f[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x3E, f[1]);
+    TEST_ASSERT_EQUAL(len, (f[2] << 8) | f[3]);
+    TEST_ASSERT_EQUAL_MEMORY(raw, &f[4], len);
+    TEST_ASSERT_EQUAL_HEX16(fletcher16(raw, len), (f[4 + len] << 8) | f[5 + len]);
+  }
+}
+
+void test_tx_queue_full_drops_whole_frames(void) {
+  Node sender(&rtc, &radio);
+  sender.serial.room = 0;   // UART stalled
+  for (int i = 0; i < NUM_PACKETS; i++) {
+    mesh::Packet* pkt = makePacket(sender.mgr, i);
+    sender.bridge.sendPacket(pkt);
+    sender.mgr.free(pkt);
+  }
+  TEST_ASSERT_EQUAL(0, (int) sender.serial.tx.size());
+
+  sender.serial.room = 64;
+  for (int n = 0; n < 200; n++) sender.bridge.loop();
+  TEST_ASSERT_TRUE(sender.serial.tx.size() > 0);
+  TEST_ASSERT_TRUE(sender.serial.tx.size() <= RS232_BRIDGE_TX_BUFFER_SIZE);
+
+  // what did go out is a run of whole frames, all of which decode
+  Node receiver(&rtc, &radio);
+  receiver.serial.rx.assign(sender.serial.tx.begin(), sender.serial.tx.end());
+  std::vector<std::vector<uint8_t>> got;
+  while (!receiver.serial.rx.empty()) {
+    receiver.bridge.loop();
+    for (auto& p : receiver.takeInbound()) got.push_back(p);
+  }
+  TEST_ASSERT_TRUE(got.size() > 0);
+
+  // in order, with the packets that didn't fit left out
+  int id = 0;
+  for (auto& p : got) {
+    bool found = false;
+    for (; id < NUM_PACKETS && !found; id++) {
+      mesh::Packet* pkt = makePacket(sender.mgr, id);
+      found = pkt->payload_len == (int) p.size() && memcmp(pkt->payload, p.data(), p.size()) == 0;
+      sender.mgr.free(pkt);
+    }
+    TEST_ASSERT_TRUE(found);
+  }
+}
+
+void test_corrupted_bursty_stream(void) {
+  Node sender(&rtc, &radio);
+  std::vector<std::vector<uint8_t>> frames = sendPackets(sender, 0, NUM_PACKETS);
+
+  // every fifth frame intact, the others behind a false header, corrupt, behind garbage, or with a bad length
+  std::vector<uint8_t> stream;
+  std::vector<int> expected;
+  for (int i = 0; i < NUM_PACKETS; i++) {
+    std::vector<uint8_t> f = frames[i];
+    bool intact = true;
+    switch (i % 5) {
+      case 1: {   // false frame start, whose length covers this frame
+        const uint8_t fake[] = { 0xC0, 0x3E, 0x00, 0x40 };
+        stream.insert(stream.end(), fake, fake + sizeof(fake));
+        break;
+      }
+      case 2:
+        f.back() ^= 0x55;   // bad checksum
+        intact = false;
+        break;
+      case 3:
+        for (int k = 0; k < 9; k++) stream.push_back(rng());
+        stream.push_back(0xC0);   // stray magic
+        break;
+      case 4:
+        f[2] = 0xFF;   // length out of range
+        intact = false;
+        break;
+    }
+    stream.insert(stream.end(), f.begin(), f.end());
+    if (intact) expected.push_back(i);
+  }
+
+  Node receiver(&rtc, &radio);
+  receiver.serial.rx.assign(stream.begin(), stream.end());
+  std::vector<std::vector<uint8_t>> got;
+  for (int n = 0; n < 10000 && !receiver.serial.rx.empty(); n++) {
+    receiver.serial.burst = 1 + rng() % 300;
+    receiver.bridge.loop();
+    for (auto& p : receiver.takeInbound()) got.push_back(p);
+  }
+  receiver.bridge.loop();
+  for (auto& p : receiver.takeInbound()) got.push_back(p);
+
+  char msg[100];
+  snprintf(msg, sizeof(msg), "%d byte stream, %d frames: %d intact, %d delivered", (int) stream.size(),
+           NUM_PACKETS, (int) expected.size(), (int) got.size());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(expected.size(), got.size());
+  for (int i = 0; i < (int) got.size(); i++) {
+    mesh::Packet* pkt = makePacket(sender.mgr, expected[i]);
+    TEST_ASSERT_EQUAL(pkt->payload_len, (int) got[i].size());
+    TEST_ASSERT_EQUAL_MEMORY(pkt->payload, got[i].data(), pkt->payload_len);
+    sender.mgr.free(pkt);
+  }
+}
+
+void test_frames_byte_at_a_time(void) {
+  Node sender(&rtc, &radio);
+  std::vector<std::vector<uint8_t>> frames = sendPackets(sender, 100, 3);
+
+  Node receiver(&rtc, &radio);
+  receiver.serial.burst = 1;
+  int delivered = 0;
+  for (auto& f : frames) {
+    for (uint8_t b : f) {
+      receiver.serial.rx.push_back(b);
+      receiver.bridge.loop();
+      delivered += receiver.takeInbound().size();
+    }
+  }
+  TEST_ASSERT_EQUAL(3, delivered);
+}
+
+void test_back_to_back_frames_in_one_loop(void) {
+  Node sender(&rtc, &radio);
+  std::vector<std::vector<uint8_t>> frames = sendPackets(sender, 200, 3);
+
+  Node receiver(&rtc, &radio);
+  for (auto& f : frames) receiver.serial.rx.insert(receiver.serial.rx.end(), f.begin(), f.end());
+  receiver.bridge.loop();
+  TEST_ASSERT_TRUE(receiver.serial.rx.empty());
+  TEST_ASSERT_EQUAL(3, (int) receiver.takeInbound().size());
+
+  // the same frames again are duplicates, still consumed in one loop()
+  for (auto& f : frames) receiver.serial.rx.insert(receiver.serial.rx.end(), f.begin(), f.end());
+  receiver.bridge.loop();
+  TEST_ASSERT_TRUE(receiver.serial.rx.empty());
+  TEST_ASSERT_EQUAL(0, (int) receiver.takeInbound().size());
+}
+
+void test_ingress_held_to_each_port_budget(void) {
+  StubRadio slow;
+  radio.airtime = slow.airtime = 500;
+  Node sender(&rtc, &radio);
+  std::vector<std::vector<uint8_t>> frames = sendPackets(sender, 300, 2 * BRIDGE_INGRESS_QUEUE_SIZE);
+
+  // a second port, whose budget allows 1/10 of the time on air
+  Node receiver(&rtc, &radio);
+  TEST_ASSERT_EQUAL(1, receiver.dispatcher.addRadio(slow));
+  receiver.dispatcher.budget[1] = 9.0f;
+
+  // the burst passes a full queue straight away
+  int n = 0;
+  for (; n < BRIDGE_INGRESS_QUEUE_SIZE; n++) {
+    receiver.serial.rx.insert(receiver.serial.rx.end(), frames[n].begin(), frames[n].end());
+  }
+  while (!receiver.serial.rx.empty()) receiver.bridge.loop();
+  TEST_ASSERT_EQUAL(BRIDGE_INGRESS_QUEUE_SIZE, (int) receiver.takeInbound().size());
+
+  // then, in 5 seconds port 0 could send the rest, but port 1 only earns 500 ms
+  for (; n < 2 * BRIDGE_INGRESS_QUEUE_SIZE; n++) {
+    receiver.serial.rx.insert(receiver.serial.rx.end(), frames[n].begin(), frames[n].end());
+  }
+  while (!receiver.serial.rx.empty()) receiver.bridge.loop();
+  TEST_ASSERT_EQUAL(0, (int) receiver.takeInbound().size());
+  native::advanceMillis(5000);
+  receiver.bridge.loop();
+  TEST_ASSERT_EQUAL(1, (int) receiver.takeInbound().size());
+
+  // with the same budget on both ports, the rest go
+  receiver.dispatcher.budget[1] = 0;
+  native::advanceMillis(5000);
+  receiver.bridge.loop();
+  TEST_ASSERT_EQUAL(BRIDGE_INGRESS_QUEUE_SIZE - 1, (int) receiver.takeInbound().size());
+  radio.airtime = 1;
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_tx_queue_with_slow_uart);
+  RUN_TEST(test_tx_queue_full_drops_whole_frames);
+  RUN_TEST(test_corrupted_bursty_stream);
+  RUN_TEST(test_frames_byte_at_a_time);
+  RUN_TEST(test_back_to_back_frames_in_one_loop);
+  RUN_TEST(test_ingress_held_to_each_port_budget);
+  return UNITY_END();
+}
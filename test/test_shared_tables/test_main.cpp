@@ -0,0 +1,96 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <helpers/SimpleMeshTables.h>
+
+/*
+ * SimpleMeshTables shared by the mesh and bridges: a packet is new once to each interface, never passed back
+ * to where it came from, the last-hash memo follows the payload, and only the mesh's checks count as dups.
+ */
+
+static void makePacket(mesh::Packet& pkt, uint8_t type, int id) {
+  pkt.header = (type << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  pkt.path_len = 0;
+  pkt.payload_len = 20;
+  for (int k = 0; k < pkt.payload_len; k++) pkt.payload[k] = id * 13 + k;
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_new_once_per_interface(void) {
+  SimpleMeshTables tables;
+  mesh::Packet pkt;
+  makePacket(pkt, PAYLOAD_TYPE_TXT_MSG, 1);
+
+  // from the mesh: new to the mesh, then new to each bridge, once
+  TEST_ASSERT_FALSE(tables.hasSeen(&pkt));
+  TEST_ASSERT_TRUE(tables.hasSeen(&pkt));
+  TEST_ASSERT_FALSE(tables.hasSeen(&pkt, PACKET_IFACE_RS232));
+  TEST_ASSERT_TRUE(tables.hasSeen(&pkt, PACKET_IFACE_RS232));
+  TEST_ASSERT_FALSE(tables.hasSeen(&pkt, PACKET_IFACE_ESPNOW));
+  TEST_ASSERT_TRUE(tables.hasSeen(&pkt, PACKET_IFACE_ESPNOW));
+
+  // from a bridge: still new to the mesh and the other bridge, but never passed back
+  mesh::Packet bridged;
+  makePacket(bridged, PAYLOAD_TYPE_TXT_MSG, 2);
+  TEST_ASSERT_FALSE(tables.hasSeen(&bridged, PACKET_IFACE_RS232));
+  TEST_ASSERT_FALSE(tables.hasSeen(&bridged));
+  TEST_ASSERT_FALSE(tables.hasSeen(&bridged, PACKET_IFACE_ESPNOW));
+  TEST_ASSERT_TRUE(tables.hasSeen(&bridged, PACKET_IFACE_RS232));
+}
+
+void test_acks_per_interface(void) {
+  SimpleMeshTables tables;
+  mesh::Packet ack;
+  makePacket(ack, PAYLOAD_TYPE_ACK, 3);
+  ack.payload_len = 4;
+
+  TEST_ASSERT_FALSE(tables.hasSeen(&ack, PACKET_IFACE_ESPNOW));
+  TEST_ASSERT_FALSE(tables.hasSeen(&ack));
+  TEST_ASSERT_TRUE(tables.hasSeen(&ack));
+  TEST_ASSERT_TRUE(tables.hasSeen(&ack, PACKET_IFACE_ESPNOW));
+  TEST_ASSERT_FALSE(tables.hasSeen(&ack, PACKET_IFACE_RS232));
+}
+
+void test_memo_follows_payload(void) {
+  SimpleMeshTables tables;
+  mesh::Packet pkt;
+  makePacket(pkt, PAYLOAD_TYPE_TXT_MSG, 4);
+  TEST_ASSERT_FALSE(tables.hasSeen(&pkt));
+
+  // the same Packet, changed in place, is a different packet
+  pkt.payload[pkt.payload_len - 1] ^= 1;
+  TEST_ASSERT_FALSE(tables.hasSeen(&pkt));
+  pkt.payload_len--;
+  TEST_ASSERT_FALSE(tables.hasSeen(&pkt));
+
+  makePacket(pkt, PAYLOAD_TYPE_TXT_MSG, 4);
+  TEST_ASSERT_TRUE(tables.hasSeen(&pkt));
+}
+
+void test_clear_and_stats_are_mesh_only(void) {
+  SimpleMeshTables tables;
+  mesh::Packet pkt;
+  makePacket(pkt, PAYLOAD_TYPE_TXT_MSG, 5);
+
+  tables.hasSeen(&pkt);
+  tables.hasSeen(&pkt, PACKET_IFACE_RS232);
+  TEST_ASSERT_TRUE(tables.hasSeen(&pkt, PACKET_IFACE_RS232));
+  TEST_ASSERT_EQUAL(0, tables.getNumFloodDups());
+  TEST_ASSERT_TRUE(tables.hasSeen(&pkt));
+  TEST_ASSERT_EQUAL(1, tables.getNumFloodDups());
+
+  tables.clear(&pkt);
+  TEST_ASSERT_FALSE(tables.hasSeen(&pkt));
+  TEST_ASSERT_TRUE(tables.hasSeen(&pkt, PACKET_IFACE_RS232));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_new_once_per_interface);
+  RUN_TEST(test_acks_per_interface);
+  RUN_TEST(test_memo_follows_payload);
+  RUN_TEST(test_clear_and_stats_are_mesh_only);
+  return UNITY_END();
+}
@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <MeshCore.h>
+#include <helpers/TextCompressor.h>
+
+/*
+ * TextCompressor round trips, and its ratio and CPU cost over the corpus the code tables were generated from
+ * (tools/text_compress/corpus.txt) and over held-out messages they weren't (heldout.txt).
+ */
+
+#define CPU_ITERATIONS  2000
+#define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)   // as BaseChatMesh.h
+
+static std::vector<std::string> loadLines(const char* name) {
+  std::vector<std::string> lines;
+  std::string here = __FILE__;
+  here = here.substr(0, here.find_last_of("/\\") + 1);
+  const std::string paths[] = { here + "../../tools/text_compress/" + name, std::string("tools/text_compress/") + name };
+  for (auto& path : paths) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (f == NULL) continue;
+    char buf[512];
+    while (fgets(buf, sizeof(buf), f)) {
+      std::string s(buf);
+      while (!s.empty() && (s.back() == '\n' || s.back() == '\r')) s.pop_back();
+      lines.push_back(s);
+    }
+    fclose(f);
+    break;
+  }
+  return lines;
+}
+
+struct RatioStats {
+  long in = 0, out = 0;
+  long blocks_in = 0, blocks_out = 0;   // DM plaintext: timestamp(4) + txt_type(1) + text, in cipher blocks
+  int not_compressed = 0;
+};
+
+static void measure(const std::vector<std::string>& lines, RatioStats& st) {
+  for (auto& s : lines) {
+    uint8_t packed[MAX_TEXT_LEN];
+    int n = TextCompressor::compress(packed, sizeof(packed), s.c_str(), s.size());
+    if (n > 0) {
+      char text[MAX_TEXT_LEN + 1];
+      int m = TextCompressor::decompress(text, sizeof(text), packed, n);
+      TEST_ASSERT_EQUAL((int) s.size(), m);
+      TEST_ASSERT_EQUAL_MEMORY(s.c_str(), text, m);
+      TEST_ASSERT_TRUE(n < (int) s.size());
+    } else {
+      st.not_compressed++;
+    }
+    int sent = n > 0 ? n : s.size();
+    st.in += s.size();
+    st.out += sent;
+    st.blocks_in += (5 + s.size() + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE;
+    st.blocks_out += (5 + sent + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE;
+  }
+}
+
+static void report(const char* name, size_t num, const RatioStats& st) {
+  char msg[200];
+  snprintf(msg, sizeof(msg), "%s: %zu msgs, %ld -> %ld bytes (%.1f%%), cipher blocks %ld -> %ld, %d sent as-is",
+           name, num, st.in, st.out, 100.0 * st.out / st.in, st.blocks_in, st.blocks_out, st.not_compressed);
+  TEST_MESSAGE(msg);
+}
+
+void setUp(void) { }
+void tearDown(void) { }
+
+void test_round_trip_edge_cases(void) {
+  const char* texts[] = {
+    "", "a", "the", "  ", "\x01\x02\x7F", "caf\xC3\xA9 \xF0\x9F\x93\xA1 ok",
+    "the the the the the the the the the the the the the the the the",
+  };
+  for (const char* t : texts) {
+    int len = strlen(t);
+    uint8_t packed[MAX_TEXT_LEN];
+    int n = TextCompressor::compress(packed, sizeof(packed), t, len);
+    TEST_ASSERT_TRUE(n < len || n == 0);
+    if (n > 0) {
+      char text[MAX_TEXT_LEN];
+      TEST_ASSERT_EQUAL(len, TextCompressor::decompress(text, sizeof(text), packed, n));
+      TEST_ASSERT_EQUAL_MEMORY(t, text, len);
+    }
+  }
+
+  // longest text, and a destination too small for it
+  std::string longest(MAX_TEXT_LEN, 'e');
+  uint8_t packed[MAX_TEXT_LEN];
+  int n = TextCompressor::compress(packed, sizeof(packed), longest.c_str(), longest.size());
+  TEST_ASSERT_TRUE(n > 0);
+  char text[MAX_TEXT_LEN];
+  TEST_ASSERT_EQUAL(MAX_TEXT_LEN, TextCompressor::decompress(text, sizeof(text), packed, n));
+  TEST_ASSERT_EQUAL(-1, TextCompressor::decompress(text, MAX_TEXT_LEN - 1, packed, n));
+  TEST_ASSERT_EQUAL(-1, TextCompressor::decompress(text, sizeof(text), packed, n / 2));   // truncated
+}
+
+void test_corpus_ratio(void) {
+  std::vector<std::string> corpus = loadLines("corpus.txt"), heldout = loadLines("heldout.txt");
+  TEST_ASSERT_TRUE_MESSAGE(corpus.size() > 0 && heldout.size() > 0, "tools/text_compress corpus not found");
+
+  RatioStats c, h;
+  measure(corpus, c);
+  measure(heldout, h);
+  report("corpus ", corpus.size(), c);
+  report("heldout", heldout.size(), h);
+  TEST_ASSERT_TRUE(h.out < h.in * 3 / 4);   // tables not just fitted to the corpus
+  TEST_ASSERT_TRUE(h.blocks_out < h.blocks_in);
+}
+
+void test_cpu_cost(void) {
+  std::vector<std::string> lines = loadLines("corpus.txt");
+  TEST_ASSERT_TRUE(lines.size() > 0);
+
+  volatile int sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < CPU_ITERATIONS; k++) {
+    for (auto& s : lines) {
+      uint8_t packed[MAX_TEXT_LEN];
+      sink += TextCompressor::compress(packed, sizeof(packed), s.c_str(), s.size());
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::vector<std::vector<uint8_t>> packed;
+  for (auto& s : lines) {
+    uint8_t buf[MAX_TEXT_LEN];
+    int n = TextCompressor::compress(buf, sizeof(buf), s.c_str(), s.size());
+    if (n > 0) packed.emplace_back(buf, buf + n);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  for (int k = 0; k < CPU_ITERATIONS; k++) {
+    for (auto& p : packed) {
+      char text[MAX_TEXT_LEN];
+      sink += TextCompressor::decompress(text, sizeof(text), p.data(), p.size());
+    }
+  }
+  auto t3 = std::chrono::steady_clock::now();
+
+  double c = std::chrono::duration<double, std::micro>(t1 - t0).count() / (CPU_ITERATIONS * lines.size());
+  double d = std::chrono::duration<double, std::micro>(t3 - t2).count() / (CPU_ITERATIONS * packed.size());
+  char msg[120];
+  snprintf(msg, sizeof(msg), "host CPU: compress %.2f us/msg, decompress %.2f us/msg", c, d);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_edge_cases);
+  RUN_TEST(test_corpus_ratio);
+  RUN_TEST(test_cpu_cost);
+  return UNITY_END();
+}
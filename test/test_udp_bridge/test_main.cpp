@@ -0,0 +1,247 @@
+#include <unity.h>
+#include <vector>
+#include <helpers/bridges/UDPBridge.h>
+#include <helpers/StaticPoolPacketManager.h>
+
+/*
+ * UDPBridge between two 'nodes' on 127.0.0.1 and 127.0.0.2 (the native env's WITH_UDP_BRIDGE_PEERS), over host
+ * sockets: sealed datagrams get through, and datagrams with a different secret, a bad MAC or no MAC at all
+ * (the old RS232-style frames) are dropped whole.
+ */
+
+#define NUM_PACKETS   30
+
+/** \brief  UDPBridgeSocket over a non-blocking host socket, bound to one loopback address */
+class HostSocket : public UDPBridgeSocket {
+  IPAddress _local;
+  int _fd = -1;
+
+public:
+  HostSocket(const IPAddress& local) : _local(local) { }
+  ~HostSocket() { end(); }
+
+  bool begin(uint16_t port, const IPAddress* group) override {
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = _local.toNetwork();
+    if (_fd < 0 || bind(_fd, (sockaddr *) &addr, sizeof(addr)) != 0) {
+      perror("HostSocket::begin()");
+      end();
+      return false;
+    }
+    fcntl(_fd, F_SETFL, O_NONBLOCK);
+    return true;
+  }
+
+  void end() override {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+  }
+
+  int receive(uint8_t* buf, int max_len) override {
+    if (_fd < 0) return 0;
+    int n = recv(_fd, buf, max_len, MSG_TRUNC);
+    return n > 0 ? n : 0;
+  }
+
+  bool send(const IPAddress& to, uint16_t port, const uint8_t* data, int len) override {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = to.toNetwork();
+    return sendto(_fd, data, len, 0, (sockaddr *) &addr, sizeof(addr)) == len;
+  }
+};
+
+class StubRadio : public mesh::Radio {
+public:
+  int recvRaw(uint8_t* bytes, int sz) override { return 0; }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return 1; }
+  float packetScore(float snr, int packet_len) override { return 0; }
+  bool startSendRaw(const uint8_t* bytes, int len) override { return true; }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+};
+
+class StubRTC : public mesh::RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1750000000; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+class StubClock : public mesh::MillisecondClock {
+public:
+  unsigned long getMillis() override { return millis(); }
+};
+
+/* the mesh, only for its radio's airtime budget */
+class StubDispatcher : public mesh::Dispatcher {
+public:
+  StubDispatcher(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::PacketManager& mgr)
+      : mesh::Dispatcher(radio, ms, mgr) { }
+
+protected:
+  float getAirtimeBudgetFactor() const override { return 0; }
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override { return ACTION_RELEASE; }
+};
+
+static StubRTC rtc;
+static StubRadio radio;
+static StubClock ms_clock;
+
+/* one bridge and its side of the mesh */
+struct Node {
+  NodePrefs prefs;
+  StaticPoolPacketManager mgr;
+  SimpleMeshTables tables;
+  HostSocket socket;
+  StubDispatcher dispatcher;
+  UDPBridge bridge;
+
+  Node(const IPAddress& local, const char* secret) : mgr(64), socket(local), dispatcher(radio, ms_clock, mgr),
+      bridge(&prefs, socket, &mgr, &rtc, &tables, &dispatcher) {
+    memset(&prefs, 0, sizeof(prefs));
+    strncpy(prefs.bridge_secret, secret, sizeof(prefs.bridge_secret));
+    bridge.begin();
+    bridge.loop();   // opens the socket
+  }
+  ~Node() { bridge.end(); }
+
+  /* packets the bridge has passed to the mesh */
+  std::vector<std::vector<uint8_t>> takeInbound() {
+    std::vector<std::vector<uint8_t>> out;
+    mesh::Packet* pkt;
+    while ((pkt = mgr.getNextInbound(millis() + 100000)) != NULL) {
+      out.emplace_back(pkt->payload, pkt->payload + pkt->payload_len);
+      mgr.free(pkt);
+    }
+    return out;
+  }
+};
+
+static mesh::Packet* makePacket(mesh::PacketManager& mgr, int id) {
+  mesh::Packet* pkt = mgr.allocNew();
+  pkt->header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  pkt->path_len = 0;
+  pkt->payload_len = 10 + (id * 37) % 170;
+  for (int k = 0; k < pkt->payload_len; k++) pkt->payload[k] = id * 13 + k;
+  return pkt;
+}
+
+static void sendPackets(Node& node, int first, int count) {
+  for (int i = first; i < first + count; i++) {
+    mesh::Packet* pkt = makePacket(node.mgr, i);
+    node.bridge.sendPacket(pkt);
+    node.mgr.free(pkt);
+  }
+}
+
+/* runs both nodes until batches are sent and received */
+static void runLoops(Node& a, Node& b) {
+  for (int n = 0; n < 10; n++) {
+    native::advanceMillis(UDP_BRIDGE_BATCH_MILLIS);
+    a.bridge.loop();
+    b.bridge.loop();
+    delay(1);
+  }
+}
+
+/* sends a datagram from a third address, as another bridge (or anyone else) on the LAN might */
+static void injectDatagram(const uint8_t* data, int len) {
+  HostSocket other(IPAddress(127, 0, 0, 3));
+  TEST_ASSERT_TRUE(other.begin(0, NULL));
+  TEST_ASSERT_TRUE(other.send(IPAddress(127, 0, 0, 2), WITH_UDP_BRIDGE_PORT, data, len));
+}
+
+static const IPAddress ADDR_A(127, 0, 0, 1);
+static const IPAddress ADDR_B(127, 0, 0, 2);
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_sealed_datagrams_cross(void) {
+  Node a(ADDR_A, "secret"), b(ADDR_B, "secret");
+  sendPackets(a, 0, NUM_PACKETS);
+  runLoops(a, b);
+
+  std::vector<std::vector<uint8_t>> got = b.takeInbound();
+  TEST_ASSERT_EQUAL(NUM_PACKETS, (int) got.size());
+  for (int i = 0; i < NUM_PACKETS; i++) {
+    mesh::Packet* pkt = makePacket(a.mgr, i);
+    TEST_ASSERT_EQUAL(pkt->payload_len, (int) got[i].size());
+    TEST_ASSERT_EQUAL_MEMORY(pkt->payload, got[i].data(), pkt->payload_len);
+    a.mgr.free(pkt);
+  }
+
+  // A is also one of the peers, but its own packets aren't passed back to its mesh
+  TEST_ASSERT_EQUAL(0, (int) a.takeInbound().size());
+}
+
+void test_different_secret_dropped(void) {
+  Node a(ADDR_A, "secret"), b(ADDR_B, "other");
+  sendPackets(a, 0, NUM_PACKETS);
+  runLoops(a, b);
+  TEST_ASSERT_EQUAL(0, (int) b.takeInbound().size());
+}
+
+void test_tampered_and_unsealed_dropped(void) {
+  Node b(ADDR_B, "secret");
+
+  // a datagram sealed with the right secret, as from another bridge
+  BridgeCodec<1398> codec;
+  codec.setSecret("secret", 16);
+  mesh::Packet* pkt = makePacket(b.mgr, 7);
+  uint8_t raw[MAX_TRANS_UNIT + 1];
+  int raw_len = pkt->writeTo(raw);
+  b.mgr.free(pkt);
+  uint8_t dgram[1400] = { 0xC0, 0x3E };
+  TEST_ASSERT_TRUE(codec.add(raw, raw_len));
+  int len = 2 + codec.seal(&dgram[2]);
+
+  // each byte of the MAC or ciphertext flipped in turn
+  for (int i = 2; i < len; i += 5) {
+    dgram[i] ^= 0x01;
+    injectDatagram(dgram, len);
+    dgram[i] ^= 0x01;
+  }
+  // a truncated datagram
+  injectDatagram(dgram, len - CIPHER_BLOCK_SIZE);
+
+  // an old, unauthenticated RS232-style frame, magic + length + packet + Fletcher-16
+  uint8_t frame[BridgeBase::BRIDGE_MAX_FRAME_SIZE] = { 0xC0, 0x3E, (uint8_t) (raw_len >> 8), (uint8_t) raw_len };
+  memcpy(&frame[4], raw, raw_len);
+  uint8_t sum1 = 0, sum2 = 0;
+  for (int i = 0; i < raw_len; i++) {
+    sum1 = (sum1 + raw[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  frame[4 + raw_len] = sum2;
+  frame[5 + raw_len] = sum1;
+  injectDatagram(frame, raw_len + 6);
+
+  for (int n = 0; n < 5; n++) {
+    b.bridge.loop();
+    delay(1);
+  }
+  TEST_ASSERT_EQUAL(0, (int) b.takeInbound().size());
+
+  // and the intact datagram is accepted
+  injectDatagram(dgram, len);
+  for (int n = 0; n < 5; n++) {
+    b.bridge.loop();
+    delay(1);
+  }
+  TEST_ASSERT_EQUAL(1, (int) b.takeInbound().size());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sealed_datagrams_cross);
+  RUN_TEST(test_different_secret_dropped);
+  RUN_TEST(test_tampered_and_unsealed_dropped);
+  return UNITY_END();
+}
@@ -0,0 +1,193 @@
+#include <unity.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <helpers/esp32/SerialWifiInterface.h>
+
+/*
+ * Loopback harness for the multi-client companion TCP interface: SerialWifiInterface is served from a thread
+ * that stands in for MyMesh's loop(), and scripted clients connect over 127.0.0.1, pipeline commands and
+ * measure the round-trip latency of each reply, while the 'mesh' also broadcasts push frames.
+ */
+
+#define TEST_PORT            (15000 + (getpid() % 1000))
+#define MAX_CMDS_PER_LOOP    4        // as MAX_CMD_FRAMES_PER_LOOP in companion_radio
+#define CMD_ECHO             0x16     // any non-push code, the 'mesh' just echoes it
+#define PUSH_TEST            0x88
+#define PUSH_INTERVAL_CMDS   50       // one push per this many commands handled
+
+static SerialWifiInterface iface;
+static std::atomic<bool> server_running;
+static std::atomic<int> cmds_handled;
+
+static void serverLoop() {
+  uint8_t frame[MAX_FRAME_SIZE];
+  while (server_running) {
+    // like MyMesh::checkSerialInterface(): several commands per loop, while there's room for replies
+    size_t len = iface.checkRecvFrame(frame);
+    for (int n = 0; len > 0; n++) {
+      frame[0] = CMD_ECHO;
+      iface.writeFrame(frame, len);   // reply goes to the client that sent it
+      if (++cmds_handled % PUSH_INTERVAL_CMDS == 0) {
+        uint8_t push[8] = { PUSH_TEST };
+        iface.writeFrame(push, sizeof(push));
+      }
+      if (n + 1 >= MAX_CMDS_PER_LOOP || iface.isWriteBusy()) break;
+      len = iface.checkRecvFrame(frame);
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));   // rest of the mesh loop
+  }
+}
+
+struct ClientResult {
+  std::vector<double> latencies_us;
+  int misrouted = 0;
+  int pushes = 0;
+  bool ok = false;
+};
+
+static int connectClient() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(TEST_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr *) &addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  timeval tv = { 5, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+static bool readFully(int fd, uint8_t* buf, int len) {
+  while (len > 0) {
+    int n = recv(fd, buf, len, 0);
+    if (n <= 0) return false;
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+/* sends 'num_cmds' commands, keeping up to 'depth' outstanding */
+static void runClient(int id, int num_cmds, int depth, ClientResult* result) {
+  int fd = connectClient();
+  if (fd < 0) return;
+
+  std::vector<std::chrono::steady_clock::time_point> sent(num_cmds);
+  int next_send = 0, next_reply = 0;
+  while (next_reply < num_cmds) {
+    while (next_send < num_cmds && next_send - next_reply < depth) {
+      uint8_t cmd[3 + 8] = { '<', 8, 0, 0x01, (uint8_t) id };
+      memcpy(&cmd[5], &next_send, 4);
+      sent[next_send++] = std::chrono::steady_clock::now();
+      if (send(fd, cmd, sizeof(cmd), 0) != sizeof(cmd)) { close(fd); return; }
+    }
+    uint8_t hdr[3], body[MAX_FRAME_SIZE];
+    if (!readFully(fd, hdr, 3) || hdr[0] != '>') { close(fd); return; }
+    int len = hdr[1] | (hdr[2] << 8);
+    if (len > MAX_FRAME_SIZE || !readFully(fd, body, len)) { close(fd); return; }
+
+    if (body[0] == PUSH_TEST) {
+      result->pushes++;
+      continue;
+    }
+    int seq;
+    memcpy(&seq, &body[2], 4);
+    if (body[1] != id || seq != next_reply) {
+      result->misrouted++;
+      continue;
+    }
+    result->latencies_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent[seq]).count());
+    next_reply++;
+  }
+  close(fd);
+  result->ok = true;
+}
+
+static double percentile(std::vector<double> v, double p) {
+  std::sort(v.begin(), v.end());
+  return v.empty() ? 0 : v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+static std::thread server_thread;
+
+void setUp(void) {
+  cmds_handled = 0;
+  server_running = true;
+  server_thread = std::thread(serverLoop);
+}
+
+void tearDown(void) {
+  server_running = false;
+  server_thread.join();
+}
+
+static void runLoad(int num_clients, int num_cmds, int depth) {
+  std::vector<ClientResult> results(num_clients);
+  std::vector<std::thread> clients;
+  for (int i = 0; i < num_clients; i++) clients.emplace_back(runClient, i, num_cmds, depth, &results[i]);
+  for (auto& t : clients) t.join();
+
+  std::vector<double> all;
+  int pushes = 0;
+  for (int i = 0; i < num_clients; i++) {
+    TEST_ASSERT_TRUE_MESSAGE(results[i].ok, "client did not get all its replies");
+    TEST_ASSERT_EQUAL(0, results[i].misrouted);
+    all.insert(all.end(), results[i].latencies_us.begin(), results[i].latencies_us.end());
+    pushes += results[i].pushes;
+  }
+  char msg[200];
+  snprintf(msg, sizeof(msg), "%d clients x %d cmds, depth %d: latency p50 %.0f us, p99 %.0f us, max %.0f us, %d pushes received",
+           num_clients, num_cmds, depth, percentile(all, 0.5), percentile(all, 0.99), percentile(all, 1.0), pushes);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(num_clients * num_cmds, (int) all.size());
+}
+
+void test_single_client(void) {
+  runLoad(1, 500, 1);
+}
+
+void test_concurrent_pipelined_clients(void) {
+  runLoad(WIFI_MAX_CLIENTS, 500, 4);
+}
+
+void test_push_frames_go_to_every_client(void) {
+  std::vector<int> fds;
+  for (int i = 0; i < WIFI_MAX_CLIENTS; i++) fds.push_back(connectClient());
+  while (iface.getNumClients() < WIFI_MAX_CLIENTS) delay(1);
+
+  // one client's commands trigger a push, which every client must see
+  uint8_t cmd[3 + 8] = { '<', 8, 0, 0x01, 0 };
+  for (int n = 0; n < PUSH_INTERVAL_CMDS; n++) {
+    memcpy(&cmd[5], &n, 4);
+    send(fds[0], cmd, sizeof(cmd), 0);
+    uint8_t hdr[3], body[MAX_FRAME_SIZE];
+    TEST_ASSERT_TRUE(readFully(fds[0], hdr, 3));
+    TEST_ASSERT_TRUE(readFully(fds[0], body, hdr[1] | (hdr[2] << 8)));
+    if (body[0] == PUSH_TEST) n--;   // not a reply
+  }
+  for (int i = 1; i < WIFI_MAX_CLIENTS; i++) {
+    uint8_t hdr[3], body[MAX_FRAME_SIZE];
+    TEST_ASSERT_TRUE(readFully(fds[i], hdr, 3));
+    TEST_ASSERT_TRUE(readFully(fds[i], body, hdr[1] | (hdr[2] << 8)));
+    TEST_ASSERT_EQUAL(PUSH_TEST, body[0]);
+  }
+  for (int fd : fds) close(fd);
+}
+
+int main(int argc, char **argv) {
+  iface.begin(TEST_PORT);
+  iface.enable();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_single_client);
+  RUN_TEST(test_concurrent_pipelined_clients);
+  RUN_TEST(test_push_frames_go_to_every_client);
+  return UNITY_END();
+}
@@ -0,0 +1,145 @@
+#include "KissBench.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+#define MAX_DATA_LEN   255   // Data frame payload limit
+
+static double percentile(std::vector<double>& sorted, double p) {
+  return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+const char* KissBench::commandName(uint8_t sub_cmd) {
+  switch (sub_cmd) {
+    case HW_CMD_PING:             return "Ping";
+    case HW_CMD_SIGN_DATA:        return "Sign";
+    case HW_CMD_VERIFY_SIGNATURE: return "Verify";
+    case HW_CMD_ENCRYPT_DATA:     return "Encrypt";
+    case HW_CMD_DECRYPT_DATA:     return "Decrypt";
+    case HW_CMD_HASH:             return "Hash";
+    default:                      return "?";
+  }
+}
+
+bool KissBench::begin(int payload_len) {
+  if (payload_len < 1 || payload_len > (int) sizeof(_payload)) return false;
+  _payload_len = payload_len;
+  for (int i = 0; i < payload_len; i++) _payload[i] = rand();
+  for (int i = 0; i < (int) sizeof(_secret); i++) _secret[i] = rand();
+
+  if (!_client.getIdentity(_pub_key)) return false;
+  if (_client.sign(_payload, _payload_len, _signature) != (int) sizeof(_signature)) return false;
+  _ciphertext_len = _client.encrypt(_secret, _payload, _payload_len, _ciphertext, sizeof(_ciphertext));
+  return _ciphertext_len > 0;
+}
+
+int KissBench::buildRequest(uint8_t sub_cmd, uint8_t* req) {
+  switch (sub_cmd) {
+    case HW_CMD_VERIFY_SIGNATURE:
+      memcpy(req, _pub_key, 32);
+      memcpy(&req[32], _signature, 64);
+      memcpy(&req[96], _payload, _payload_len);
+      return 96 + _payload_len;
+    case HW_CMD_ENCRYPT_DATA:
+      memcpy(req, _secret, 32);
+      memcpy(&req[32], _payload, _payload_len);
+      return 32 + _payload_len;
+    case HW_CMD_DECRYPT_DATA:
+      memcpy(req, _secret, 32);
+      memcpy(&req[32], _ciphertext, _ciphertext_len);
+      return 32 + _ciphertext_len;
+    default:   // Ping, Sign, Hash
+      memcpy(req, _payload, _payload_len);
+      return _payload_len;
+  }
+}
+
+KissBenchResult KissBench::run(uint8_t sub_cmd, int num_ops, int depth) {
+  KissBenchResult result = {};
+  uint8_t req[96 + sizeof(_ciphertext)];
+  int req_len = buildRequest(sub_cmd, req);
+
+  std::vector<Clock::time_point> sent(num_ops);
+  std::vector<double> latencies;
+  std::vector<uint8_t> resp(KISS_CLIENT_MAX_FRAME);
+  int next_send = 0, next_reply = 0;
+
+  auto start = Clock::now();
+  while (next_reply < num_ops) {
+    while (next_send < num_ops && next_send - next_reply < depth) {
+      sent[next_send++] = Clock::now();
+      if (!_client.sendHardware(sub_cmd, req, req_len)) return result;
+    }
+    int n = _client.readResponse(sub_cmd, resp.data(), resp.size());
+    if (n == KISS_CLIENT_ERR_TIMEOUT || n == KISS_CLIENT_ERR_IO) break;   // lost sync, so give up on the run
+    if (n < 0 || (sub_cmd == HW_CMD_VERIFY_SIGNATURE && resp[0] != 1)) result.errors++;
+    latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent[next_reply]).count());
+    next_reply++;
+  }
+  double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::sort(latencies.begin(), latencies.end());
+  result.ops = latencies.size();
+  result.p50_us = percentile(latencies, 0.5);
+  result.p99_us = percentile(latencies, 0.99);
+  result.max_us = latencies.empty() ? 0 : latencies.back();
+  result.ops_per_sec = secs > 0 ? result.ops / secs : 0;
+  return result;
+}
+
+KissTxBenchResult KissBench::runTx(int num_packets, int packet_len) {
+  KissTxBenchResult result = {};
+  if (packet_len < 1 || packet_len > MAX_DATA_LEN) return result;
+  uint8_t pkt[MAX_DATA_LEN];
+  for (int i = 0; i < packet_len; i++) pkt[i] = rand();
+
+  uint32_t airtime_ms = 0;
+  uint8_t len_byte = packet_len;
+  std::vector<uint8_t> frame(KISS_CLIENT_MAX_FRAME);
+  if (_client.sendHardware(HW_CMD_GET_AIRTIME, &len_byte, 1)
+      && _client.readResponse(HW_CMD_GET_AIRTIME, frame.data(), frame.size()) == 4) {
+    memcpy(&airtime_ms, frame.data(), 4);
+  }
+  int timeout_ms = KISS_CLIENT_DEFAULT_TIMEOUT + 2 * airtime_ms;   // for a TxDone, including CSMA
+
+  int sent = 0, finished = 0;
+  int window = 1;   // frames outstanding, until the first TxDone gives the modem's queue size
+  auto start = Clock::now(), end = start;
+  while (finished < num_packets) {
+    while (sent < num_packets && sent - finished < window) {
+      if (!_client.sendPacket(pkt, packet_len)) return result;
+      sent++;
+    }
+    uint8_t type;
+    int n = _client.readFrame(&type, frame.data(), frame.size(), timeout_ms);
+    if (n == KISS_CLIENT_ERR_TIMEOUT || n == KISS_CLIENT_ERR_IO) break;   // lost sync, so give up on the run
+    if (n < 2 || type != KISS_CMD_SETHARDWARE) continue;   // eg. a packet heard meanwhile
+
+    if (frame[0] == HW_RESP_TX_DONE) {   // result, queued, queue size
+      finished++;
+      if (frame[1] == 0x01) {
+        result.packets++;
+      } else {
+        result.errors++;
+      }
+      if (n >= 4 && frame[3] > 0) window = frame[3];
+      end = Clock::now();
+    } else if (frame[0] == HW_RESP_ERROR && frame[1] == HW_ERR_TX_QUEUE_FULL) {
+      finished++;   // that frame was dropped
+      result.errors++;
+    }
+  }
+  double secs = std::chrono::duration<double>(end - start).count();
+
+  if (secs > 0) {
+    result.packets_per_sec = result.packets / secs;
+    result.bytes_per_sec = result.packets_per_sec * packet_len;
+    result.airtime_share = result.packets * (airtime_ms / 1000.0) / secs;
+  }
+  return result;
+}
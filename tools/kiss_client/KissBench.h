@@ -0,0 +1,57 @@
+#pragma once
+
+#include "KissClient.h"
+
+/*
+ * Crypto round-trip latency and pipelined command throughput of a KISS modem, and its transmit throughput for
+ * Data frames, as seen from the host.  Used by the kiss_bench command line tool against real hardware, and by
+ * test/test_kiss_modem against the loopback modem.
+ */
+
+struct KissBenchResult {
+  int ops, errors;
+  double p50_us, p99_us, max_us;   // request sent to response decoded
+  double ops_per_sec;
+};
+
+struct KissTxBenchResult {
+  int packets, errors;             // sent (TxDone with success), and failed or dropped (TxQueueFull)
+  double packets_per_sec, bytes_per_sec;
+  double airtime_share;            // of the run, time on air by the modem's GetAirtime estimate (0 if unknown)
+};
+
+class KissBench {
+  KissClient& _client;
+  uint8_t _pub_key[32];
+  uint8_t _secret[32];
+  uint8_t _payload[1024];
+  uint8_t _signature[64];
+  uint8_t _ciphertext[1024 + 32];
+  int _payload_len, _ciphertext_len;
+
+  int buildRequest(uint8_t sub_cmd, uint8_t* req);
+
+public:
+  KissBench(KissClient& client) : _client(client), _payload_len(0), _ciphertext_len(0) { }
+
+  /**
+   * \brief  prepares requests of 'payload_len' bytes: fetches the modem's identity, and a signature and
+   *         ciphertext for the Verify and Decrypt runs.
+   */
+  bool begin(int payload_len);
+
+  /**
+   * \brief  times 'num_ops' requests of one command (Ping, Sign, Verify, Encrypt, Decrypt or Hash), keeping up
+   *         to 'depth' outstanding.  depth 1 gives round-trip latency, more gives pipelined command throughput.
+   */
+  KissBenchResult run(uint8_t sub_cmd, int num_ops, int depth);
+
+  /**
+   * \brief  transmits 'num_packets' Data frames of 'packet_len' bytes, keeping the modem's transmit queue full
+   *         (its size comes from each TxDone), and times them from the first sent to the last TxDone.
+   *         NOTE: on a real modem these go out on air.
+   */
+  KissTxBenchResult runTx(int num_packets, int packet_len);
+
+  static const char* commandName(uint8_t sub_cmd);
+};
@@ -0,0 +1,312 @@
+#include "KissClient.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+#define PUB_KEY_SIZE     32
+#define SIGNATURE_SIZE   64
+
+static speed_t toSpeed(int baud) {
+  switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    default:      return B115200;
+  }
+}
+
+static long nowMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+KissClient::KissClient() : _fd(-1), _own_fd(false), _handler(NULL), _handler_ctx(NULL),
+    _in_pos(0), _in_len(0), _frame_len(0), _escaped(false), _in_frame(false), _overflow(false) { }
+
+KissClient::~KissClient() {
+  close();
+}
+
+bool KissClient::open(const char* path, int baud) {
+  close();
+  int fd = ::open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (fd < 0) return false;
+
+  if (isatty(fd)) {
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+      ::close(fd);
+      return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CRTSCTS;
+    cfsetispeed(&tio, toSpeed(baud));
+    cfsetospeed(&tio, toSpeed(baud));
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+      ::close(fd);
+      return false;
+    }
+    tcflush(fd, TCIOFLUSH);
+  }
+  attach(fd);
+  _own_fd = true;
+  return true;
+}
+
+void KissClient::attach(int fd) {
+  close();
+  _fd = fd;
+  _own_fd = false;
+  _in_pos = _in_len = 0;
+  _frame_len = 0;
+  _escaped = _in_frame = _overflow = false;
+}
+
+void KissClient::close() {
+  if (_fd >= 0 && _own_fd) ::close(_fd);
+  _fd = -1;
+}
+
+bool KissClient::writeAll(const uint8_t* buf, int len) {
+  while (len > 0) {
+    ssize_t n = ::write(_fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        pollfd p = { _fd, POLLOUT, 0 };
+        poll(&p, 1, 100);
+        continue;
+      }
+      return false;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool KissClient::sendFrame(uint8_t type, const uint8_t* data, int len) {
+  if (_fd < 0) return false;
+
+  std::vector<uint8_t> out;
+  out.reserve(2 * (len + 1) + 2);
+  out.push_back(KISS_FEND);
+  for (int i = -1; i < len; i++) {
+    uint8_t b = i < 0 ? type : data[i];
+    if (b == KISS_FEND) {
+      out.push_back(KISS_FESC);
+      out.push_back(KISS_TFEND);
+    } else if (b == KISS_FESC) {
+      out.push_back(KISS_FESC);
+      out.push_back(KISS_TFESC);
+    } else {
+      out.push_back(b);
+    }
+  }
+  out.push_back(KISS_FEND);
+  return writeAll(out.data(), out.size());
+}
+
+bool KissClient::sendHardware(uint8_t sub_cmd, const uint8_t* data, int len) {
+  std::vector<uint8_t> body(1 + len);
+  body[0] = sub_cmd;
+  if (len > 0) memcpy(&body[1], data, len);
+  return sendFrame(KISS_CMD_SETHARDWARE, body.data(), body.size());
+}
+
+int KissClient::readFrame(uint8_t* type, uint8_t* data, int max_len, int timeout_ms) {
+  if (_fd < 0) return KISS_CLIENT_ERR_IO;
+
+  long deadline = nowMillis() + timeout_ms;
+  for (;;) {
+    while (_in_pos < _in_len) {
+      uint8_t b = _in_buf[_in_pos++];
+      if (b == KISS_FEND) {
+        bool complete = _in_frame && _frame_len > 0 && !_overflow;
+        int len = _frame_len;
+        _frame_len = 0;
+        _escaped = _overflow = false;
+        _in_frame = true;
+        if (!complete) continue;
+
+        *type = _frame[0];
+        if (len - 1 > max_len) return KISS_CLIENT_ERR_PROTOCOL;
+        memcpy(data, &_frame[1], len - 1);
+        return len - 1;
+      }
+      if (!_in_frame) continue;
+
+      if (b == KISS_FESC) {
+        _escaped = true;
+        continue;
+      }
+      if (_escaped) {
+        _escaped = false;
+        if (b == KISS_TFEND) b = KISS_FEND;
+        else if (b == KISS_TFESC) b = KISS_FESC;
+        else continue;
+      }
+      if (_frame_len < KISS_CLIENT_MAX_FRAME) {
+        _frame[_frame_len++] = b;
+      } else {
+        _overflow = true;   // drop the rest, up to the next FEND
+      }
+    }
+
+    long remaining = deadline - nowMillis();
+    if (remaining <= 0) return KISS_CLIENT_ERR_TIMEOUT;
+    pollfd p = { _fd, POLLIN, 0 };
+    int r = poll(&p, 1, remaining);
+    if (r < 0 && errno != EINTR) return KISS_CLIENT_ERR_IO;
+    if (r <= 0) continue;
+
+    ssize_t n = ::read(_fd, _in_buf, sizeof(_in_buf));
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+    if (n <= 0) return KISS_CLIENT_ERR_IO;   // EOF, or device gone
+    _in_pos = 0;
+    _in_len = n;
+  }
+}
+
+uint8_t KissClient::responseCode(uint8_t sub_cmd) {
+  switch (sub_cmd) {
+    case HW_CMD_SET_RADIO:
+    case HW_CMD_SET_TX_POWER:
+    case HW_CMD_REBOOT:
+      return HW_RESP_OK;
+    case HW_CMD_SET_SIGNAL_REPORT:
+      return HW_RESP(HW_CMD_GET_SIGNAL_REPORT);
+    default:
+      return HW_RESP(sub_cmd);
+  }
+}
+
+int KissClient::readResponse(uint8_t sub_cmd, uint8_t* resp, int max_len, int timeout_ms) {
+  uint8_t expected = responseCode(sub_cmd);
+  long deadline = nowMillis() + timeout_ms;
+  for (;;) {
+    long remaining = deadline - nowMillis();
+    uint8_t type;
+    int len = readFrame(&type, _scratch, sizeof(_scratch), remaining > 0 ? remaining : 0);
+    if (len < 0) return len;
+
+    const uint8_t* data = _scratch;
+    if (type == KISS_CMD_SETHARDWARE && len >= 1) {
+      if (data[0] == expected) {
+        if (len - 1 > max_len) return KISS_CLIENT_ERR_PROTOCOL;
+        memcpy(resp, &data[1], len - 1);
+        return len - 1;
+      }
+      if (data[0] == HW_RESP_ERROR && !(len >= 2 && data[1] == HW_ERR_TX_QUEUE_FULL)) {   // that's for a Data frame
+        return len >= 2 && data[1] != 0 ? -(int)data[1] : KISS_CLIENT_ERR_PROTOCOL;
+      }
+    }
+    if (_handler) _handler(_handler_ctx, type, data, len);
+  }
+}
+
+int KissClient::request(uint8_t sub_cmd, const uint8_t* data, int len, int timeout_ms) {
+  if (!sendHardware(sub_cmd, data, len)) return KISS_CLIENT_ERR_IO;
+  return readResponse(sub_cmd, _resp, sizeof(_resp), timeout_ms);
+}
+
+bool KissClient::getIdentity(uint8_t* pub_key) {
+  int n = request(HW_CMD_GET_IDENTITY, NULL, 0, KISS_CLIENT_DEFAULT_TIMEOUT);
+  if (n != PUB_KEY_SIZE) return false;
+  memcpy(pub_key, _resp, PUB_KEY_SIZE);
+  return true;
+}
+
+int KissClient::ping(const uint8_t* data, int len, uint8_t* echo) {
+  int n = request(HW_CMD_PING, data, len, KISS_CLIENT_DEFAULT_TIMEOUT);
+  if (n < 0) return n;
+  if (n != len) return KISS_CLIENT_ERR_PROTOCOL;
+  if (echo) memcpy(echo, _resp, n);
+  return n;
+}
+
+int KissClient::sign(const uint8_t* data, int len, uint8_t* signature) {
+  int n = request(HW_CMD_SIGN_DATA, data, len, KISS_CLIENT_DEFAULT_TIMEOUT);
+  if (n < 0) return n;
+  if (n != SIGNATURE_SIZE) return KISS_CLIENT_ERR_PROTOCOL;
+  memcpy(signature, _resp, n);
+  return n;
+}
+
+int KissClient::verify(const uint8_t* pub_key, const uint8_t* signature, const uint8_t* data, int len) {
+  std::vector<uint8_t> req(PUB_KEY_SIZE + SIGNATURE_SIZE + len);
+  memcpy(&req[0], pub_key, PUB_KEY_SIZE);
+  memcpy(&req[PUB_KEY_SIZE], signature, SIGNATURE_SIZE);
+  memcpy(&req[PUB_KEY_SIZE + SIGNATURE_SIZE], data, len);
+  int n = request(HW_CMD_VERIFY_SIGNATURE, req.data(), req.size(), KISS_CLIENT_DEFAULT_TIMEOUT);
+  if (n < 0) return n;
+  return n == 1 ? _resp[0] : KISS_CLIENT_ERR_PROTOCOL;
+}
+
+static int keyedRequest(KissClient& client, uint8_t sub_cmd, const uint8_t* secret, const uint8_t* data, int len,
+                        uint8_t* out, int max_len) {
+  std::vector<uint8_t> req(PUB_KEY_SIZE + len);
+  memcpy(&req[0], secret, PUB_KEY_SIZE);
+  memcpy(&req[PUB_KEY_SIZE], data, len);
+  if (!client.sendHardware(sub_cmd, req.data(), req.size())) return KISS_CLIENT_ERR_IO;
+  return client.readResponse(sub_cmd, out, max_len);
+}
+
+int KissClient::encrypt(const uint8_t* secret, const uint8_t* data, int len, uint8_t* out, int max_len) {
+  return keyedRequest(*this, HW_CMD_ENCRYPT_DATA, secret, data, len, out, max_len);
+}
+
+int KissClient::decrypt(const uint8_t* secret, const uint8_t* data, int len, uint8_t* out, int max_len) {
+  return keyedRequest(*this, HW_CMD_DECRYPT_DATA, secret, data, len, out, max_len);
+}
+
+int KissClient::hash(const uint8_t* data, int len, uint8_t* digest) {
+  int n = request(HW_CMD_HASH, data, len, KISS_CLIENT_DEFAULT_TIMEOUT);
+  if (n < 0) return n;
+  if (n != 32) return KISS_CLIENT_ERR_PROTOCOL;
+  memcpy(digest, _resp, n);
+  return n;
+}
+
+int KissClient::batch(uint8_t sub_cmd, KissBatchItem* items, int count) {
+  if (count < 1 || count > 255) return KISS_CLIENT_ERR_PROTOCOL;
+
+  std::vector<uint8_t> req = { sub_cmd, (uint8_t) count };
+  for (int i = 0; i < count; i++) {
+    req.push_back(items[i].len & 0xFF);
+    req.push_back(items[i].len >> 8);
+    req.insert(req.end(), items[i].data, items[i].data + items[i].len);
+  }
+  int n = request(HW_CMD_BATCH, req.data(), req.size(), KISS_CLIENT_DEFAULT_TIMEOUT);
+  if (n < 0) return n;
+
+  // SubCmd, Count, then per item: Status, Length (2), Result
+  if (n < 2 || _resp[0] != sub_cmd || _resp[1] != count) return KISS_CLIENT_ERR_PROTOCOL;
+  int ofs = 2;
+  for (int i = 0; i < count; i++) {
+    if (ofs + 3 > n) return KISS_CLIENT_ERR_PROTOCOL;
+    int len = _resp[ofs + 1] | (_resp[ofs + 2] << 8);
+    if (ofs + 3 + len > n) return KISS_CLIENT_ERR_PROTOCOL;
+    items[i].status = _resp[ofs];
+    items[i].result = &_resp[ofs + 3];
+    items[i].result_len = len;
+    ofs += 3 + len;
+  }
+  return count;
+}
+
+bool KissClient::sendPacket(const uint8_t* packet, int len, bool high_priority) {
+  return sendFrame((high_priority ? 0x10 : 0x00) | KISS_CMD_DATA, packet, len);
+}
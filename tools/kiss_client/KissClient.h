@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Host-side client library for the KISS modem firmware (examples/kiss_modem), for Linux and other POSIX hosts.
+ * See docs/kiss_modem_protocol.md for the frames.  Requests are synchronous: each helper sends one SetHardware
+ * command and waits for its response, handing any other frames (received packets, TxDone) that arrive in the
+ * meantime to the frame handler.  For pipelining, use sendHardware() and readResponse() directly.
+ */
+
+#define KISS_FEND  0xC0
+#define KISS_FESC  0xDB
+#define KISS_TFEND 0xDC
+#define KISS_TFESC 0xDD
+
+#define KISS_CMD_DATA        0x00
+#define KISS_CMD_SETHARDWARE 0x06
+
+#define HW_CMD_GET_IDENTITY      0x01
+#define HW_CMD_VERIFY_SIGNATURE  0x03
+#define HW_CMD_SIGN_DATA         0x04
+#define HW_CMD_ENCRYPT_DATA      0x05
+#define HW_CMD_DECRYPT_DATA      0x06
+#define HW_CMD_HASH              0x08
+#define HW_CMD_SET_RADIO         0x09
+#define HW_CMD_SET_TX_POWER      0x0A
+#define HW_CMD_GET_AIRTIME       0x0F
+#define HW_CMD_PING              0x17
+#define HW_CMD_REBOOT            0x18
+#define HW_CMD_SET_SIGNAL_REPORT 0x19
+#define HW_CMD_GET_SIGNAL_REPORT 0x1A
+#define HW_CMD_BATCH             0x1B
+
+#define HW_BATCH_SIGNER_IN_MSG   0x40   // Batch VerifySignature items are Signature + Message, key at start of Message
+
+#define HW_RESP(cmd)             ((cmd) | 0x80)
+#define HW_RESP_OK               0xF0
+#define HW_RESP_ERROR            0xF1
+#define HW_RESP_TX_DONE          0xF8
+#define HW_RESP_RX_META          0xF9
+#define HW_RESP_RX_PACKET        0xFA
+
+#define HW_ERR_TX_QUEUE_FULL     0x07
+
+/* errors returned by the client itself; errors reported by the modem are returned as -HW_ERR_* (-1 .. -127) */
+#define KISS_CLIENT_ERR_TIMEOUT   -256
+#define KISS_CLIENT_ERR_IO        -257
+#define KISS_CLIENT_ERR_PROTOCOL  -258   // malformed or oversized response
+
+/* largest unescaped frame the client accepts: more than any modem's KISS_MAX_FRAME_SIZE */
+#define KISS_CLIENT_MAX_FRAME     4096
+
+#define KISS_CLIENT_DEFAULT_TIMEOUT  2000   // millis
+
+/**
+ * \brief  called with each frame that isn't the response being waited for: type is the KISS type byte, and
+ *         for SetHardware frames data[0] is the response code.
+ */
+typedef void (*KissFrameHandler)(void* ctx, uint8_t type, const uint8_t* data, int len);
+
+struct KissBatchItem {
+  const uint8_t* data;    // request item, as for the single command
+  int len;
+  int status;             // out: 0, or HW_ERR_*
+  const uint8_t* result;  // out: points into the client's buffer, valid until the next request
+  int result_len;
+};
+
+class KissClient {
+  int _fd;
+  bool _own_fd;
+  KissFrameHandler _handler;
+  void* _handler_ctx;
+
+  uint8_t _in_buf[1024];   // raw bytes read, not yet decoded
+  int _in_pos, _in_len;
+  uint8_t _frame[KISS_CLIENT_MAX_FRAME];
+  int _frame_len;
+  bool _escaped, _in_frame, _overflow;
+  uint8_t _scratch[KISS_CLIENT_MAX_FRAME];
+  uint8_t _resp[KISS_CLIENT_MAX_FRAME];
+
+  bool writeAll(const uint8_t* buf, int len);
+  int request(uint8_t sub_cmd, const uint8_t* data, int len, int timeout_ms);
+
+public:
+  KissClient();
+  ~KissClient();
+
+  /**
+   * \brief  opens a serial device (or pty) in raw mode.
+   * \returns false if it can't be opened or configured.
+   */
+  bool open(const char* path, int baud = 115200);
+
+  /** \brief  uses an already open descriptor, eg. a socket.  It isn't closed by close(). */
+  void attach(int fd);
+  void close();
+  bool isOpen() const { return _fd >= 0; }
+  int getFd() const { return _fd; }
+
+  void setFrameHandler(KissFrameHandler handler, void* ctx) { _handler = handler; _handler_ctx = ctx; }
+
+  bool sendFrame(uint8_t type, const uint8_t* data, int len);
+  bool sendHardware(uint8_t sub_cmd, const uint8_t* data, int len);
+
+  /**
+   * \brief  waits for the next complete frame.
+   * \returns  length of 'data' (after the type byte), or KISS_CLIENT_ERR_*
+   */
+  int readFrame(uint8_t* type, uint8_t* data, int max_len, int timeout_ms);
+
+  /**
+   * \brief  waits for the response to a SetHardware command sent with sendHardware().  Other frames go to the
+   *         frame handler.
+   * \param  resp  the response data, after the response code.
+   * \returns  length of 'resp', -HW_ERR_* if the modem replied with an Error, or KISS_CLIENT_ERR_*
+   */
+  int readResponse(uint8_t sub_cmd, uint8_t* resp, int max_len, int timeout_ms = KISS_CLIENT_DEFAULT_TIMEOUT);
+
+  /** \returns  the response code the modem answers 'sub_cmd' with */
+  static uint8_t responseCode(uint8_t sub_cmd);
+
+  bool getIdentity(uint8_t* pub_key);
+  int ping(const uint8_t* data, int len, uint8_t* echo);
+
+  /** \returns  SIGNATURE_SIZE, or error */
+  int sign(const uint8_t* data, int len, uint8_t* signature);
+
+  /** \returns  1 if valid, 0 if not, or error */
+  int verify(const uint8_t* pub_key, const uint8_t* signature, const uint8_t* data, int len);
+
+  /** \returns  length of MAC + ciphertext written to 'out', or error */
+  int encrypt(const uint8_t* secret, const uint8_t* data, int len, uint8_t* out, int max_len);
+
+  /** \returns  length of plaintext written to 'out' (padded to a cipher block), or error */
+  int decrypt(const uint8_t* secret, const uint8_t* data, int len, uint8_t* out, int max_len);
+
+  /** \returns  32 (SHA-256 length), or error */
+  int hash(const uint8_t* data, int len, uint8_t* digest);
+
+  /**
+   * \brief  runs 'count' Verify/Sign/Encrypt/Decrypt items in one Batch frame, filling in each item's status
+   *         and result.  For adverts, use HW_CMD_VERIFY_SIGNATURE | HW_BATCH_SIGNER_IN_MSG.
+   * \returns  count, or error for the whole batch (-HW_ERR_INVALID_LENGTH if request or response won't fit a frame)
+   */
+  int batch(uint8_t sub_cmd, KissBatchItem* items, int count);
+
+  /** \brief  queues a raw packet for transmit.  TxDone arrives later, through the frame handler. */
+  bool sendPacket(const uint8_t* packet, int len, bool high_priority = false);
+};
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "KissBench.h"
+
+/*
+ * kiss_bench <device> [baud] [payload_len] [tx_packets]
+ *
+ * Prints round-trip latency (one request at a time) and pipelined throughput (four outstanding) for each
+ * crypto command of a KISS modem on a serial port.  With 'tx_packets', also transmits that many Data frames of
+ * 'payload_len' bytes, with the modem's queue kept full, and prints the transmit throughput.  These go out on
+ * air, so only use it where that's allowed.
+ */
+
+#define NUM_OPS           200
+#define PIPELINE_DEPTH    4
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <device> [baud] [payload_len] [tx_packets]\n", argv[0]);
+    return 2;
+  }
+  int baud = argc > 2 ? atoi(argv[2]) : 115200;
+  int payload_len = argc > 3 ? atoi(argv[3]) : 64;
+  int tx_packets = argc > 4 ? atoi(argv[4]) : 0;
+
+  KissClient client;
+  if (!client.open(argv[1], baud)) {
+    perror(argv[1]);
+    return 1;
+  }
+  KissBench bench(client);
+  if (!bench.begin(payload_len)) {
+    fprintf(stderr, "%s: no response from modem\n", argv[1]);
+    return 1;
+  }
+
+  const uint8_t cmds[] = { HW_CMD_PING, HW_CMD_HASH, HW_CMD_SIGN_DATA, HW_CMD_VERIFY_SIGNATURE,
+                           HW_CMD_ENCRYPT_DATA, HW_CMD_DECRYPT_DATA };
+  printf("%d byte payloads, %d ops each\n", payload_len, NUM_OPS);
+  printf("%-8s %10s %10s %10s %12s %7s\n", "command", "p50 us", "p99 us", "max us", "ops/s (x4)", "errors");
+  for (uint8_t cmd : cmds) {
+    KissBenchResult lat = bench.run(cmd, NUM_OPS, 1);
+    KissBenchResult thr = bench.run(cmd, NUM_OPS, PIPELINE_DEPTH);
+    printf("%-8s %10.0f %10.0f %10.0f %12.1f %7d\n", KissBench::commandName(cmd),
+           lat.p50_us, lat.p99_us, lat.max_us, thr.ops_per_sec, lat.errors + thr.errors);
+  }
+
+  if (tx_packets > 0) {
+    KissTxBenchResult tx = bench.runTx(tx_packets, payload_len);
+    printf("\ntransmit, %d packets: %.2f packets/s, %.0f bytes/s, %.0f%% of the time on air, %d errors\n",
+           tx_packets, tx.packets_per_sec, tx.bytes_per_sec, tx.airtime_share * 100, tx.errors);
+  }
+  return 0;
+}
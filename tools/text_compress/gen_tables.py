@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+Generates the code_lens[] and tokens[] tables in src/helpers/TextCompressor.cpp.
+
+Symbol frequencies come from corpus.txt (one chat message per line), plus a prior of English letter
+frequencies, so the code isn't fitted to this corpus alone.  heldout.txt is not used here; it's for
+checking the ratio on text the tables weren't built from (see test/test_text_compress).
+
+Usage:  python3 tools/text_compress/gen_tables.py [corpus.txt]
+Paste the output over the tables in TextCompressor.cpp.  Changing them changes the wire format, so only
+do it together with a new feature bit.
+"""
+
+import collections
+import heapq
+import os
+import sys
+
+MAX_CODE_LEN = 15   # TC_MAX_CODE_LEN
+
+# common fragments, coded as one symbol each. Order matters for ties, as they are matched longest first
+TOKENS = [" the ", "the", " you", "ing", " and", "ent", "ion", "tha", " to", " is", " it", " in", " of", " on",
+          "th", "he", "in", "er", "an", "re", "on", "at", "en", "nd", "es", "or", "ou", "is", "ll", "e ", "s ", "t ", "d ", ", "]
+TOKENS.sort(key=lambda t: -len(t))
+
+ENGLISH_LETTERS = "etaoinshrdlcumwfgypbvkjxqz"   # most frequent first
+
+
+def tokenize(text):
+    out = []
+    i = 0
+    while i < len(text):
+        for t in TOKENS:
+            if text.startswith(t, i):
+                out.append(t)
+                i += len(t)
+                break
+        else:
+            out.append(text[i])
+            i += 1
+    return out
+
+
+def symbol_freqs(lines):
+    counts = collections.Counter()
+    for line in lines:
+        counts.update(tokenize(line))
+
+    # symbols in code order: printable ASCII 32..126, escape, then tokens
+    syms = [chr(c) for c in range(32, 127)] + ["ESC"] + TOKENS
+    freq = {}
+    for s in syms:
+        f = counts.get(s, 0) * 4 + 1
+        if len(s) == 1 and s in ENGLISH_LETTERS:
+            f += 26 - ENGLISH_LETTERS.index(s)
+        if len(s) == 1 and s.isupper():
+            f += 2
+        if len(s) == 1 and s.isdigit():
+            f += 4
+        freq[s] = f
+    freq["ESC"] = 6   # UTF-8 and other raw bytes
+    return syms, freq
+
+
+def huffman_lengths(syms, freq):
+    heap = [(freq[s], i, [s]) for i, s in enumerate(syms)]
+    heapq.heapify(heap)
+    lens = collections.Counter()
+    seq = len(heap)
+    while len(heap) > 1:
+        a = heapq.heappop(heap)
+        b = heapq.heappop(heap)
+        for s in a[2] + b[2]:
+            lens[s] += 1
+        seq += 1
+        heapq.heappush(heap, (a[0] + b[0], seq, a[2] + b[2]))
+    return lens
+
+
+def c_array(vals, per_line=24):
+    return "\n".join("  " + ", ".join(str(v) for v in vals[i:i + per_line]) + ","
+                     for i in range(0, len(vals), per_line))
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(os.path.abspath(__file__)), "corpus.txt")
+    with open(path, encoding="utf-8") as f:
+        lines = [l.rstrip("\n") for l in f]
+
+    syms, freq = symbol_freqs(lines)
+    lens = huffman_lengths(syms, freq)
+    if max(lens.values()) > MAX_CODE_LEN:
+        sys.exit("code too long: %d bits" % max(lens.values()))
+    if abs(sum(2 ** -lens[s] for s in syms) - 1) > 1e-9:
+        sys.exit("not a complete prefix code")
+
+    print("static const uint8_t code_lens[TC_NUM_SYMBOLS] = {")
+    print(c_array([lens[s] for s in syms]))
+    print("};")
+    print("static const char* const tokens[TC_NUM_TOKENS] = {   // longest first")
+    print("  " + ", ".join('"%s"' % t for t in TOKENS))
+    print("};")
+    print("%d symbols, %d tokens, longest code %d bits" % (len(syms), len(TOKENS), max(lens.values())), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
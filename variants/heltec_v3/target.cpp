@@ -12,6 +12,10 @@ HeltecV3Board board;
 
 WRAPPER_CLASS radio_driver(radio, board);
 
+#ifdef ESPNOW_EXTRA_RADIO
+  ESPNOWRadio espnow_radio;
+#endif
+
 ESP32RTCClock fallback_clock;
 AutoDiscoverRTCClock rtc_clock(fallback_clock);
 
@@ -31,7 +35,11 @@ AutoDiscoverRTCClock rtc_clock(fallback_clock);
 bool radio_init() {
   fallback_clock.begin();
   rtc_clock.begin(Wire);
-  
+
+#ifdef ESPNOW_EXTRA_RADIO
+  espnow_radio.init();
+#endif
+
 #if defined(P_LORA_SCLK)
   return radio.std_init(&spi);
 #else
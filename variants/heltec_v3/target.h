@@ -12,12 +12,19 @@
   #include <helpers/ui/SSD1306Display.h>
   #include <helpers/ui/MomentaryButton.h>
 #endif
+#ifdef ESPNOW_EXTRA_RADIO
+  #include <helpers/esp32/ESPNOWRadio.h>
+#endif
 
 extern HeltecV3Board board;
 extern WRAPPER_CLASS radio_driver;
 extern AutoDiscoverRTCClock rtc_clock;
 extern EnvironmentSensorManager sensors;
 
+#ifdef ESPNOW_EXTRA_RADIO
+  extern ESPNOWRadio espnow_radio;   // second radio port, see WITH_EXTRA_RADIO
+#endif
+
 #ifdef DISPLAY_CLASS
   extern DISPLAY_CLASS display;
   extern MomentaryButton user_btn;